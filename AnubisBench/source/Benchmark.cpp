@@ -0,0 +1,364 @@
+#include "Benchmark.h"
+#include <utils.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include "Window.h"
+#include "LinearAllocator.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+static nlohmann::json PercentilesToJSON(const TPercentiles& percentiles)
+{
+	return {
+		{ "mean", percentiles.m_dMean },
+		{ "p50", percentiles.m_dP50 },
+		{ "p95", percentiles.m_dP95 },
+		{ "p99", percentiles.m_dP99 },
+		{ "max", percentiles.m_dMax },
+	};
+}
+
+CBenchmark::CBenchmark(const TBenchOptions& options) : m_options(options)
+{
+}
+
+bool CBenchmark::Run()
+{
+	m_vecResults.clear();
+
+	for (const TBenchScene& scene : m_options.m_vecScenes)
+	{
+		syslog("Running scene %s (%dx%d cells, seed %u)", scene.m_stName.c_str(), scene.m_iTerrainCells, scene.m_iTerrainCells, scene.m_uiSeed);
+
+		TSceneResult result{};
+		if (RunScene(scene, result) == false)
+		{
+			syserr("Scene %s failed", scene.m_stName.c_str());
+			return (false);
+		}
+
+		syslog("%s: frame p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, %.0f draws, %.0f triangles", result.m_stName.c_str(),
+			result.m_frameTime.m_dP50, result.m_frameTime.m_dP95, result.m_frameTime.m_dP99, result.m_dDrawCalls, result.m_dTriangles);
+
+		m_vecResults.push_back(std::move(result));
+	}
+
+	return (true);
+}
+
+bool CBenchmark::RunScene(const TBenchScene& scene, TSceneResult& result)
+{
+	// the window owns the GL context and the render thread, one per scene
+	std::unique_ptr<CWindow> pWindow = std::make_unique<CWindow>();
+
+	pWindow->SetWindowType(m_options.m_bHeadless ? EWindowMode::HEADLESS_MODE : EWindowMode::WINDOWED_MODE);
+	pWindow->SetHeadlessSize(m_options.m_iWidth, m_options.m_iHeight);
+	pWindow->SetSwapInterval(0);
+	pWindow->SetFixedTimestep(m_options.m_fTimestep);
+	pWindow->SetFrameLimit(m_options.m_ulWarmupFrames + m_options.m_ulFrames);
+	pWindow->SetTerrainSize(scene.m_iTerrainCells, scene.m_iTerrainCells, scene.m_uiSeed);
+
+	CCameraPath cameraPath;
+	if (m_options.m_stCameraPath.empty() == false)
+	{
+		if (cameraPath.Load(m_options.m_stCameraPath) == false)
+		{
+			return (false);
+		}
+	}
+	else
+	{
+		// one lap around the terrain, warmup included
+		const GLfloat fExtent = static_cast<GLfloat>(scene.m_iTerrainCells * CELL_SCALE);
+		const GLfloat fHeight = static_cast<GLfloat>(TERRAIN_HEIGHT_SCALE);
+		const Vector3D v3Center(fExtent * 0.5f, fHeight * 0.5f, fExtent * 0.5f);
+		const GLfloat fDuration = (m_options.m_ulWarmupFrames + m_options.m_ulFrames) * m_options.m_fTimestep;
+
+		cameraPath = CCameraPath::CreateOrbit(v3Center, fExtent * 0.6f, fExtent * 0.25f + fHeight, fDuration, BENCH_ORBIT_KEYFRAMES);
+
+		if (m_options.m_stRecordCameraPath.empty() == false)
+		{
+			cameraPath.Save(m_options.m_stRecordCameraPath);
+		}
+	}
+	pWindow->SetCameraPath(cameraPath);
+
+	if (pWindow->InitializeWindow() == false)
+	{
+		return (false);
+	}
+
+	std::vector<GLdouble> vecFrameTimes;
+	std::map<std::string, std::vector<GLdouble>> mapCPUSamples;
+	std::map<std::string, std::vector<GLdouble>> mapGPUSamples;
+	vecFrameTimes.reserve(static_cast<size_t>(m_options.m_ulFrames));
+
+	TRenderStats warmupStats{};
+	GLuint64 ulLastGPUFrame = UINT64_MAX;
+	GLuint64 ulFrame = 0;
+
+	while (pWindow->UpdateFrame())
+	{
+		if (ulFrame++ < m_options.m_ulWarmupFrames)
+		{
+			warmupStats = pWindow->GetRenderStats();
+			continue;
+		}
+
+		const TFrameTimings& timings = pWindow->GetFrameTimings();
+		vecFrameTimes.push_back(timings.m_dFrameTime);
+		mapCPUSamples["Main::Input"].push_back(timings.m_dInputTime);
+		mapCPUSamples["Main::Wait"].push_back(timings.m_dWaitTime);
+		mapCPUSamples["Main::Build"].push_back(timings.m_dBuildTime);
+
+		// GPU results arrive a few frames late, take each resolved frame once
+		TGPUFrameResult gpuFrame{};
+		if (CGPUProfiler::Instance().GetLastFrame(gpuFrame) && gpuFrame.m_ulFrameIndex != ulLastGPUFrame && gpuFrame.m_ulFrameIndex >= m_options.m_ulWarmupFrames)
+		{
+			ulLastGPUFrame = gpuFrame.m_ulFrameIndex;
+			for (const TGPUScopeResult& scopeResult : gpuFrame.m_vecScopes)
+			{
+				mapGPUSamples[scopeResult.m_szName].push_back(scopeResult.m_dGPUTime);
+				mapCPUSamples[std::string("Render::") + scopeResult.m_szName].push_back(scopeResult.m_dCPUTime);
+			}
+		}
+	}
+
+	const TRenderStats renderStats = pWindow->GetRenderStats();
+	const GLuint64 ulRenderedFrames = renderStats.m_ulFrames - warmupStats.m_ulFrames;
+
+	result.m_stName = scene.m_stName;
+	result.m_ulFrames = vecFrameTimes.size();
+	result.m_frameTime = ComputePercentiles(vecFrameTimes);
+
+	for (auto& [stName, vecSamples] : mapCPUSamples)
+	{
+		result.m_mapCPUPhases[stName] = ComputePercentiles(vecSamples);
+	}
+
+	for (auto& [stName, vecSamples] : mapGPUSamples)
+	{
+		result.m_mapGPUPhases[stName] = ComputePercentiles(vecSamples);
+	}
+
+	if (ulRenderedFrames > 0)
+	{
+		result.m_dDrawCalls = static_cast<GLdouble>(renderStats.m_ulDrawCalls - warmupStats.m_ulDrawCalls) / ulRenderedFrames;
+		result.m_dTriangles = static_cast<GLdouble>(renderStats.m_ulTriangles - warmupStats.m_ulTriangles) / ulRenderedFrames;
+	}
+
+	// sampled while the scene is still loaded
+	result.m_lBufferMemory = CGLResourceManager::Instance().GetBufferMemory();
+	result.m_lProcessMemory = GetProcessMemory();
+	result.m_lFrameArenaHighWater = static_cast<GLint64>(CFrameAllocator::Instance().GetStats().m_stHighWater);
+
+	return (result.m_ulFrames > 0);
+}
+
+nlohmann::json CBenchmark::ToJSON() const
+{
+	nlohmann::json jsonScenes = nlohmann::json::object();
+
+	for (const TSceneResult& result : m_vecResults)
+	{
+		nlohmann::json jsonCPU = nlohmann::json::object();
+		for (const auto& [stName, percentiles] : result.m_mapCPUPhases)
+		{
+			jsonCPU[stName] = PercentilesToJSON(percentiles);
+		}
+
+		nlohmann::json jsonGPU = nlohmann::json::object();
+		for (const auto& [stName, percentiles] : result.m_mapGPUPhases)
+		{
+			jsonGPU[stName] = PercentilesToJSON(percentiles);
+		}
+
+		jsonScenes[result.m_stName] = {
+			{ "frames", result.m_ulFrames },
+			{ "frame_time_ms", PercentilesToJSON(result.m_frameTime) },
+			{ "cpu_ms", jsonCPU },
+			{ "gpu_ms", jsonGPU },
+			{ "draw_calls", result.m_dDrawCalls },
+			{ "triangles", result.m_dTriangles },
+			{ "memory", {
+				{ "gpu_buffers", result.m_lBufferMemory },
+				{ "process", result.m_lProcessMemory },
+				{ "frame_arena_high_water", result.m_lFrameArenaHighWater },
+			} },
+		};
+	}
+
+	return {
+		{ "version", BENCH_REPORT_VERSION },
+		{ "settings", {
+			{ "headless", m_options.m_bHeadless },
+			{ "width", m_options.m_iWidth },
+			{ "height", m_options.m_iHeight },
+			{ "frames", m_options.m_ulFrames },
+			{ "warmup_frames", m_options.m_ulWarmupFrames },
+			{ "timestep", m_options.m_fTimestep },
+			{ "camera_path", m_options.m_stCameraPath },
+		} },
+		{ "scenes", jsonScenes },
+	};
+}
+
+bool CBenchmark::WriteReport(const std::string& stPath) const
+{
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file << ToJSON().dump(1, '\t');
+
+	syslog("Wrote benchmark report %s", stPath.c_str());
+	return (file.good());
+}
+
+GLint CBenchmark::CompareWithBaseline(const std::string& stPath, GLdouble dThreshold) const
+{
+	std::ifstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open baseline %s", stPath.c_str());
+		return (-1);
+	}
+
+	// not const, missing keys read as null instead of asserting
+	nlohmann::json jsonBaseline = nlohmann::json::parse(file, nullptr, false);
+	if (jsonBaseline.is_discarded() || jsonBaseline.value("version", 0) != BENCH_REPORT_VERSION)
+	{
+		syserr("%s is not a benchmark report of version %d", stPath.c_str(), BENCH_REPORT_VERSION);
+		return (-1);
+	}
+
+	nlohmann::json jsonCurrent = ToJSON();
+	const GLdouble dNoiseFloor = static_cast<GLdouble>(BENCH_TIME_NOISE_FLOOR_US) / 1000.0;
+	const GLdouble dFactor = 1.0 + dThreshold / 100.0;
+	GLint iRegressions = 0;
+
+	// higher is worse for every metric, times additionally ignore tiny absolute changes
+	auto CheckMetric = [&](const std::string& stScene, const std::string& stMetric, const nlohmann::json& jsonBase, const nlohmann::json& jsonValue, bool bIsTime)
+	{
+		if (jsonBase.is_number() == false || jsonValue.is_number() == false)
+		{
+			return;
+		}
+
+		const GLdouble dBase = jsonBase.get<GLdouble>();
+		const GLdouble dValue = jsonValue.get<GLdouble>();
+		if (dValue <= dBase * dFactor || (bIsTime && dValue - dBase < dNoiseFloor))
+		{
+			return;
+		}
+
+		const GLdouble dChange = (dBase > 0.0) ? (dValue / dBase - 1.0) * 100.0 : 100.0;
+		syserr("Regression in %s %s: %.3f -> %.3f (+%.1f%%)", stScene.c_str(), stMetric.c_str(), dBase, dValue, dChange);
+		iRegressions++;
+	};
+
+	nlohmann::json& jsonBaseScenes = jsonBaseline["scenes"];
+	for (auto& [stScene, jsonScene] : jsonCurrent["scenes"].items())
+	{
+		if (jsonBaseScenes.contains(stScene) == false)
+		{
+			syswarn("Scene %s is not in the baseline", stScene.c_str());
+			continue;
+		}
+
+		nlohmann::json& jsonBaseScene = jsonBaseScenes[stScene];
+
+		for (const char* szPercentile : { "p50", "p95", "p99" })
+		{
+			CheckMetric(stScene, std::string("frame_time_ms.") + szPercentile, jsonBaseScene["frame_time_ms"][szPercentile], jsonScene["frame_time_ms"][szPercentile], true);
+		}
+
+		// phases are noisier per frame, p95 is enough to spot a slower pass
+		for (const char* szGroup : { "cpu_ms", "gpu_ms" })
+		{
+			for (auto& [stPhase, jsonPhase] : jsonScene[szGroup].items())
+			{
+				if (jsonBaseScene[szGroup].contains(stPhase))
+				{
+					CheckMetric(stScene, std::string(szGroup) + "." + stPhase + ".p95", jsonBaseScene[szGroup][stPhase]["p95"], jsonPhase["p95"], true);
+				}
+			}
+		}
+
+		CheckMetric(stScene, "draw_calls", jsonBaseScene["draw_calls"], jsonScene["draw_calls"], false);
+		CheckMetric(stScene, "triangles", jsonBaseScene["triangles"], jsonScene["triangles"], false);
+
+		for (auto& [stMemory, jsonMemory] : jsonScene["memory"].items())
+		{
+			CheckMetric(stScene, "memory." + stMemory, jsonBaseScene["memory"][stMemory], jsonMemory, false);
+		}
+	}
+
+	syslog("Compared with baseline %s, %d regressions (threshold %.1f%%)", stPath.c_str(), iRegressions, dThreshold);
+	return (iRegressions);
+}
+
+TPercentiles CBenchmark::ComputePercentiles(std::vector<GLdouble> vecSamples)
+{
+	TPercentiles percentiles{};
+	if (vecSamples.empty())
+	{
+		return (percentiles);
+	}
+
+	std::sort(vecSamples.begin(), vecSamples.end());
+
+	// nearest rank, always one of the measured values
+	auto Percentile = [&vecSamples](GLdouble dPercent)
+	{
+		const size_t stRank = static_cast<size_t>(std::ceil(dPercent / 100.0 * vecSamples.size()));
+		return vecSamples[std::min(std::max<size_t>(stRank, 1), vecSamples.size()) - 1];
+	};
+
+	GLdouble dSum = 0.0;
+	for (GLdouble dSample : vecSamples)
+	{
+		dSum += dSample;
+	}
+
+	percentiles.m_dMean = dSum / vecSamples.size();
+	percentiles.m_dP50 = Percentile(50.0);
+	percentiles.m_dP95 = Percentile(95.0);
+	percentiles.m_dP99 = Percentile(99.0);
+	percentiles.m_dMax = vecSamples.back();
+	return (percentiles);
+}
+
+GLint64 CBenchmark::GetProcessMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memoryCounters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)))
+	{
+		return static_cast<GLint64>(memoryCounters.WorkingSetSize);
+	}
+	return (0);
+#else
+	// second field of statm is the resident set in pages
+	std::ifstream file("/proc/self/statm");
+	GLint64 lSize = 0;
+	GLint64 lResident = 0;
+	if (file >> lSize >> lResident)
+	{
+		return lResident * sysconf(_SC_PAGESIZE);
+	}
+	return (0);
+#endif
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+enum EBenchmarkData
+{
+	BENCH_REPORT_VERSION = 1,
+
+	BENCH_DEFAULT_FRAMES = 600,
+	BENCH_DEFAULT_WARMUP_FRAMES = 60,
+	BENCH_DEFAULT_THRESHOLD = 10,		// percent slower than the baseline counted as regression
+
+	// Timing differences below this are noise, whatever the percentage
+	BENCH_TIME_NOISE_FLOOR_US = 50,
+
+	BENCH_ORBIT_KEYFRAMES = 16,
+};
+
+typedef struct SBenchScene
+{
+	std::string m_stName;
+	GLint m_iTerrainCells;		// terrain is square, cells per side
+	GLuint m_uiSeed;			// heightmap seed
+} TBenchScene;
+
+typedef struct SBenchOptions
+{
+	bool m_bHeadless;
+	GLint m_iWidth;
+	GLint m_iHeight;
+
+	GLuint64 m_ulFrames;		// measured frames per scene
+	GLuint64 m_ulWarmupFrames;	// rendered before measuring
+	GLfloat m_fTimestep;		// seconds of simulation per frame
+
+	std::string m_stCameraPath;			// replayed path, empty orbits around the terrain
+	std::string m_stRecordCameraPath;	// the generated orbit is saved here
+	std::vector<TBenchScene> m_vecScenes;
+} TBenchOptions;
+
+typedef struct SPercentiles
+{
+	GLdouble m_dMean;
+	GLdouble m_dP50;
+	GLdouble m_dP95;
+	GLdouble m_dP99;
+	GLdouble m_dMax;
+} TPercentiles;
+
+typedef struct SSceneResult
+{
+	std::string m_stName;
+	GLuint64 m_ulFrames;
+
+	TPercentiles m_frameTime;							// ms, main thread frame including the wait on the render thread
+	std::map<std::string, TPercentiles> m_mapCPUPhases;	// ms
+	std::map<std::string, TPercentiles> m_mapGPUPhases;	// ms
+
+	// averages per rendered frame
+	GLdouble m_dDrawCalls;
+	GLdouble m_dTriangles;
+
+	// bytes
+	GLint64 m_lBufferMemory;
+	GLint64 m_lProcessMemory;
+	GLint64 m_lFrameArenaHighWater;
+} TSceneResult;
+
+/**
+ * Renders deterministic scenes along a camera path with a fixed timestep and
+ * reports frame time percentiles, per phase CPU / GPU timings, draw statistics
+ * and memory as JSON. A stored report can be used as baseline to catch
+ * regressions.
+ */
+class CBenchmark
+{
+public:
+	explicit CBenchmark(const TBenchOptions& options);
+	~CBenchmark() = default;
+
+	/**
+	 * Runs every scene, each one in its own window and context.
+	 *
+	 * @return false if a scene could not be started
+	 */
+	bool Run();
+
+	bool WriteReport(const std::string& stPath) const;
+
+	/**
+	 * Compares the results with a report written by an earlier run, every
+	 * metric worse by more than dThreshold percent is logged.
+	 *
+	 * @return Number of regressions, -1 if the baseline could not be read
+	 */
+	GLint CompareWithBaseline(const std::string& stPath, GLdouble dThreshold) const;
+
+protected:
+	bool RunScene(const TBenchScene& scene, TSceneResult& result);
+	nlohmann::json ToJSON() const;
+
+	static TPercentiles ComputePercentiles(std::vector<GLdouble> vecSamples);
+
+	/**
+	 * Resident memory of the process in bytes.
+	 */
+	static GLint64 GetProcessMemory();
+
+private:
+	TBenchOptions m_options;
+	std::vector<TSceneResult> m_vecResults;
+};
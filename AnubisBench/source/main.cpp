@@ -0,0 +1,177 @@
+#include <utils.h>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "LinearAllocator.h"
+#include "CPUProfiler.h"
+#include "Logger.h"
+#include "Window.h"
+
+#pragma comment(lib, "glfw3.lib")
+
+enum EBenchMainData
+{
+	BENCH_DEFAULT_SEED = 1337,
+};
+
+typedef struct SBenchLaunchOptions
+{
+	TBenchOptions m_benchOptions;
+	std::string m_stOutputPath;
+	std::string m_stBaselinePath;
+	GLdouble m_dThreshold;
+} TBenchLaunchOptions;
+
+/**
+ * Comma separated terrain sizes, one scene each.
+ */
+static std::vector<TBenchScene> ParseScenes(const char* szSizes, GLuint uiSeed)
+{
+	std::vector<TBenchScene> vecScenes;
+
+	std::stringstream stream(szSizes);
+	std::string stSize;
+	while (std::getline(stream, stSize, ','))
+	{
+		const GLint iCells = std::atoi(stSize.c_str());
+		if (iCells <= 0)
+		{
+			syserr("Invalid terrain size %s", stSize.c_str());
+			continue;
+		}
+
+		vecScenes.push_back({ "terrain_" + std::to_string(iCells), iCells, uiSeed });
+	}
+
+	return (vecScenes);
+}
+
+/**
+ * [--scenes 64,256,1024] [--seed N] [--frames N] [--warmup N] [--timestep S]
+ * [--camera path.json] [--record-camera path.json] [--headless] [--size WxH]
+ * [--output report.json] [--baseline report.json] [--threshold percent]
+ */
+static TBenchLaunchOptions ParseCommandLine(int argc, char* argv[])
+{
+	TBenchLaunchOptions options{};
+	options.m_stOutputPath = "bench_results.json";
+	options.m_dThreshold = BENCH_DEFAULT_THRESHOLD;
+
+	TBenchOptions& benchOptions = options.m_benchOptions;
+	benchOptions.m_bHeadless = false;
+	benchOptions.m_iWidth = HEADLESS_DEFAULT_WIDTH;
+	benchOptions.m_iHeight = HEADLESS_DEFAULT_HEIGHT;
+	benchOptions.m_ulFrames = BENCH_DEFAULT_FRAMES;
+	benchOptions.m_ulWarmupFrames = BENCH_DEFAULT_WARMUP_FRAMES;
+	benchOptions.m_fTimestep = 1.0f / 60.0f;
+
+	const char* szScenes = "64,256,1024";
+	GLuint uiSeed = BENCH_DEFAULT_SEED;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool bHasValue = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			benchOptions.m_bHeadless = true;
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && bHasValue)
+		{
+			const char* szSize = argv[++i];
+			benchOptions.m_iWidth = std::atoi(szSize);
+
+			const char* szHeight = std::strchr(szSize, 'x');
+			benchOptions.m_iHeight = szHeight ? std::atoi(szHeight + 1) : benchOptions.m_iHeight;
+		}
+		else if (std::strcmp(argv[i], "--scenes") == 0 && bHasValue)
+		{
+			szScenes = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && bHasValue)
+		{
+			uiSeed = static_cast<GLuint>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && bHasValue)
+		{
+			benchOptions.m_ulFrames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0 && bHasValue)
+		{
+			benchOptions.m_ulWarmupFrames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--timestep") == 0 && bHasValue)
+		{
+			benchOptions.m_fTimestep = static_cast<GLfloat>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--camera") == 0 && bHasValue)
+		{
+			benchOptions.m_stCameraPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--record-camera") == 0 && bHasValue)
+		{
+			benchOptions.m_stRecordCameraPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && bHasValue)
+		{
+			options.m_stOutputPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baseline") == 0 && bHasValue)
+		{
+			options.m_stBaselinePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--threshold") == 0 && bHasValue)
+		{
+			options.m_dThreshold = std::atof(argv[++i]);
+		}
+		else
+		{
+			syserr("Unknown argument %s", argv[i]);
+		}
+	}
+
+	benchOptions.m_vecScenes = ParseScenes(szScenes, uiSeed);
+	return (options);
+}
+
+int main(int argc, char* argv[])
+{
+	std::unique_ptr<CLogger> pLogger = std::make_unique<CLogger>();
+	pLogger->Initialize("AnubisBench.log");
+
+	std::unique_ptr<CCPUProfiler> pCPUProfiler = std::make_unique<CCPUProfiler>();
+	pCPUProfiler->Initialize();
+	ANUBIS_THREAD_NAME("Main");
+
+	std::unique_ptr<CJobSystem> pJobSystem = std::make_unique<CJobSystem>();
+	pJobSystem->Initialize();
+
+	std::unique_ptr<CFrameAllocator> pFrameAllocator = std::make_unique<CFrameAllocator>();
+	pFrameAllocator->Initialize();
+
+	const TBenchLaunchOptions options = ParseCommandLine(argc, argv);
+	if (options.m_benchOptions.m_vecScenes.empty() || options.m_benchOptions.m_ulFrames == 0 || options.m_benchOptions.m_fTimestep <= 0.0f)
+	{
+		syserr("Nothing to benchmark");
+		return (EXIT_FAILURE);
+	}
+
+	CBenchmark benchmark(options.m_benchOptions);
+	if (benchmark.Run() == false || benchmark.WriteReport(options.m_stOutputPath) == false)
+	{
+		return (EXIT_FAILURE);
+	}
+
+	if (options.m_stBaselinePath.empty() == false)
+	{
+		// unreadable baselines fail as well, a broken CI setup should not pass silently
+		const GLint iRegressions = benchmark.CompareWithBaseline(options.m_stBaselinePath, options.m_dThreshold);
+		return (iRegressions == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	return (EXIT_SUCCESS);
+}
@@ -0,0 +1,604 @@
+#include "MicroBench.h"
+#include <maths.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+enum EMathBenchData
+{
+	MATH_BENCH_INPUT_COUNT = MICROBENCH_BATCH_SIZE,
+	MATH_BENCH_INPUT_MASK = MATH_BENCH_INPUT_COUNT - 1,
+	MATH_BENCH_SEED = 1234,
+};
+
+/**
+ * Same values for both libraries, generated once with a fixed seed.
+ */
+typedef struct SMathInputs
+{
+	std::array<Matrix4, MATH_BENCH_INPUT_COUNT> m_arrMatrices;
+	std::array<glm::mat4, MATH_BENCH_INPUT_COUNT> m_arrGLMMatrices;
+
+	std::array<Vector3D, MATH_BENCH_INPUT_COUNT> m_arrVectors;
+	std::array<glm::vec3, MATH_BENCH_INPUT_COUNT> m_arrGLMVectors;
+
+	std::array<Quaternion, MATH_BENCH_INPUT_COUNT> m_arrQuaternions;
+	std::array<glm::quat, MATH_BENCH_INPUT_COUNT> m_arrGLMQuaternions;
+
+	std::array<GLfloat, MATH_BENCH_INPUT_COUNT> m_arrAngles;	// degrees
+} TMathInputs;
+
+static const TMathInputs& GetInputs()
+{
+	static const TMathInputs s_inputs = []()
+	{
+		TMathInputs inputs{};
+
+		std::mt19937 generator(MATH_BENCH_SEED);
+		std::uniform_real_distribution<GLfloat> distribution(-1.0f, 1.0f);
+		auto RandomVector = [&]()
+		{
+			return glm::vec3(distribution(generator), distribution(generator), distribution(generator));
+		};
+
+		for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+		{
+			// translation * rotation * scale keeps every matrix invertible
+			const glm::vec3 v3Axis = glm::normalize(RandomVector() + glm::vec3(0.0f, 2.0f, 0.0f));
+			glm::mat4 glmMatrix = glm::translate(glm::mat4(1.0f), RandomVector() * 10.0f);
+			glmMatrix = glm::rotate(glmMatrix, distribution(generator) * glm::pi<GLfloat>(), v3Axis);
+			glmMatrix = glm::scale(glmMatrix, glm::vec3(1.5f) + RandomVector() * 0.5f);
+
+			inputs.m_arrGLMMatrices[i] = glmMatrix;
+			inputs.m_arrMatrices[i] = Matrix4(glmMatrix);
+
+			const glm::vec3 v3Vector = RandomVector() + glm::vec3(0.0f, 0.0f, 1.5f);
+			inputs.m_arrGLMVectors[i] = v3Vector;
+			inputs.m_arrVectors[i] = Vector3D(v3Vector.x, v3Vector.y, v3Vector.z);
+
+			const glm::quat quat = glm::angleAxis(distribution(generator) * glm::pi<GLfloat>(), v3Axis);
+			inputs.m_arrGLMQuaternions[i] = quat;
+
+			// the component constructor mixes up w, set the members directly
+			inputs.m_arrQuaternions[i].x = quat.x;
+			inputs.m_arrQuaternions[i].y = quat.y;
+			inputs.m_arrQuaternions[i].z = quat.z;
+			inputs.m_arrQuaternions[i].w = quat.w;
+
+			inputs.m_arrAngles[i] = distribution(generator) * 180.0f;
+		}
+
+		return (inputs);
+	}();
+
+	return (s_inputs);
+}
+
+template <typename TFunc>
+static void RunThroughput(CBenchState& state, TFunc func)
+{
+	state.SetItemsPerIteration(MATH_BENCH_INPUT_COUNT);
+
+	// independent operations, the CPU can overlap them
+	while (state.KeepRunning())
+	{
+		for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+		{
+			DoNotOptimize(func(i));
+		}
+	}
+}
+
+template <typename T, typename TFunc>
+static void RunLatency(CBenchState& state, T value, TFunc step)
+{
+	state.SetItemsPerIteration(MICROBENCH_CHAIN_LENGTH);
+
+	// every operation waits for the previous result
+	while (state.KeepRunning())
+	{
+		for (GLint i = 0; i < MICROBENCH_CHAIN_LENGTH; i++)
+		{
+			value = step(value);
+		}
+
+		DoNotOptimize(value);
+	}
+}
+
+static GLdouble MaxError(const Matrix4& mat4, const glm::mat4& glmMat4)
+{
+	GLdouble dError = 0.0;
+	for (GLint iColumn = 0; iColumn < 4; iColumn++)
+	{
+		const Vector4D& v4Column = mat4[iColumn];
+		const GLfloat arrValues[4] = { v4Column.x, v4Column.y, v4Column.z, v4Column.w };
+
+		for (GLint iRow = 0; iRow < 4; iRow++)
+		{
+			dError = std::max(dError, static_cast<GLdouble>(std::abs(arrValues[iRow] - glmMat4[iColumn][iRow])));
+		}
+	}
+	return (dError);
+}
+
+static GLdouble MaxError(const Vector3D& v3Value, const glm::vec3& glmValue)
+{
+	return std::max({ std::abs(v3Value.x - glmValue.x), std::abs(v3Value.y - glmValue.y), std::abs(v3Value.z - glmValue.z) });
+}
+
+static GLdouble MaxError(const Quaternion& quat, const glm::quat& glmQuat)
+{
+	return std::max({ std::abs(quat.x - glmQuat.x), std::abs(quat.y - glmQuat.y), std::abs(quat.z - glmQuat.z), std::abs(quat.w - glmQuat.w) });
+}
+
+static TPersProjInfo MakeProjection(GLfloat fFOV)
+{
+	TPersProjInfo persProj{};
+	persProj.FOV = fFOV;
+	persProj.Width = 1920.0f;
+	persProj.Height = 1080.0f;
+	persProj.zNear = 0.1f;
+	persProj.zFar = 10000.0f;
+	return (persProj);
+}
+
+static glm::mat4 MakeGLMProjection(GLfloat fFOV)
+{
+	return glm::perspectiveRH(glm::radians(fFOV), 1920.0f / 1080.0f, 0.1f, 10000.0f);
+}
+
+//
+// Matrix multiply
+//
+static void Mat4MultiplyAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return inputs.m_arrMatrices[i] * inputs.m_arrMatrices[(i + 1) & MATH_BENCH_INPUT_MASK]; });
+}
+
+static void Mat4MultiplyGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return inputs.m_arrGLMMatrices[i] * inputs.m_arrGLMMatrices[(i + 1) & MATH_BENCH_INPUT_MASK]; });
+}
+
+static void Mat4MultiplyAnubisLatency(CBenchState& state)
+{
+	// a pure rotation keeps the chain from overflowing
+	const Matrix4 mat4Rotation(glm::rotate(glm::mat4(1.0f), 0.1f, glm::vec3(0.0f, 1.0f, 0.0f)));
+	RunLatency(state, GetInputs().m_arrMatrices[0], [&mat4Rotation](const Matrix4& mat4) { return mat4 * mat4Rotation; });
+}
+
+static void Mat4MultiplyGLMLatency(CBenchState& state)
+{
+	const glm::mat4 mat4Rotation = glm::rotate(glm::mat4(1.0f), 0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+	RunLatency(state, GetInputs().m_arrGLMMatrices[0], [&mat4Rotation](const glm::mat4& mat4) { return mat4 * mat4Rotation; });
+}
+
+static GLdouble Mat4MultiplyCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLint iNext = (i + 1) & MATH_BENCH_INPUT_MASK;
+		dError = std::max(dError, MaxError(inputs.m_arrMatrices[i] * inputs.m_arrMatrices[iNext], inputs.m_arrGLMMatrices[i] * inputs.m_arrGLMMatrices[iNext]));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(Mat4Multiply, anubis, throughput, Mat4MultiplyAnubis);
+MICRO_BENCHMARK(Mat4Multiply, glm, throughput, Mat4MultiplyGLM);
+MICRO_BENCHMARK(Mat4Multiply, anubis, latency, Mat4MultiplyAnubisLatency);
+MICRO_BENCHMARK(Mat4Multiply, glm, latency, Mat4MultiplyGLMLatency);
+MICRO_BENCHMARK_CHECK(Mat4Multiply, Mat4MultiplyCheck);
+
+//
+// Matrix inverse
+//
+static void Mat4InverseAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return Matrix4().InverseSub(inputs.m_arrMatrices[i]); });
+}
+
+static void Mat4InverseGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return glm::inverse(inputs.m_arrGLMMatrices[i]); });
+}
+
+static void Mat4InverseAnubisLatency(CBenchState& state)
+{
+	// alternates between the matrix and its inverse
+	RunLatency(state, GetInputs().m_arrMatrices[0], [](const Matrix4& mat4) { return Matrix4().InverseSub(mat4); });
+}
+
+static void Mat4InverseGLMLatency(CBenchState& state)
+{
+	RunLatency(state, GetInputs().m_arrGLMMatrices[0], [](const glm::mat4& mat4) { return glm::inverse(mat4); });
+}
+
+static GLdouble Mat4InverseCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		dError = std::max(dError, MaxError(Matrix4().InverseSub(inputs.m_arrMatrices[i]), glm::inverse(inputs.m_arrGLMMatrices[i])));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(Mat4Inverse, anubis, throughput, Mat4InverseAnubis);
+MICRO_BENCHMARK(Mat4Inverse, glm, throughput, Mat4InverseGLM);
+MICRO_BENCHMARK(Mat4Inverse, anubis, latency, Mat4InverseAnubisLatency);
+MICRO_BENCHMARK(Mat4Inverse, glm, latency, Mat4InverseGLMLatency);
+MICRO_BENCHMARK_CHECK(Mat4Inverse, Mat4InverseCheck);
+
+//
+// LookAt, eye and center taken from two different input vectors
+//
+static void LookAtAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	const Vector3D v3Up(0.0f, 1.0f, 0.0f);
+	RunThroughput(state, [&inputs, &v3Up](GLint i) { return Matrix4().LookAtRH(inputs.m_arrVectors[i], inputs.m_arrVectors[(i + 1) & MATH_BENCH_INPUT_MASK], v3Up); });
+}
+
+static void LookAtGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	const glm::vec3 v3Up(0.0f, 1.0f, 0.0f);
+	RunThroughput(state, [&inputs, &v3Up](GLint i) { return glm::lookAtRH(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[(i + 1) & MATH_BENCH_INPUT_MASK], v3Up); });
+}
+
+static void LookAtAnubisLatency(CBenchState& state)
+{
+	const Vector3D v3Center(0.0f, 0.0f, -10.0f);
+	const Vector3D v3Up(0.0f, 1.0f, 0.0f);
+
+	// the next eye position depends on the last matrix
+	RunLatency(state, Vector3D(1.0f, 2.0f, 3.0f), [&v3Center, &v3Up](const Vector3D& v3Eye)
+	{
+		const Matrix4 mat4View = Matrix4().LookAtRH(v3Eye, v3Center, v3Up);
+		return Vector3D(1.0f + mat4View[3][0] * 1e-3f, v3Eye.y, v3Eye.z);
+	});
+}
+
+static void LookAtGLMLatency(CBenchState& state)
+{
+	const glm::vec3 v3Center(0.0f, 0.0f, -10.0f);
+	const glm::vec3 v3Up(0.0f, 1.0f, 0.0f);
+
+	RunLatency(state, glm::vec3(1.0f, 2.0f, 3.0f), [&v3Center, &v3Up](const glm::vec3& v3Eye)
+	{
+		const glm::mat4 mat4View = glm::lookAtRH(v3Eye, v3Center, v3Up);
+		return glm::vec3(1.0f + mat4View[3][0] * 1e-3f, v3Eye.y, v3Eye.z);
+	});
+}
+
+static GLdouble LookAtCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLint iNext = (i + 1) & MATH_BENCH_INPUT_MASK;
+		const Matrix4 mat4View = Matrix4().LookAtRH(inputs.m_arrVectors[i], inputs.m_arrVectors[iNext], Vector3D(0.0f, 1.0f, 0.0f));
+		dError = std::max(dError, MaxError(mat4View, glm::lookAtRH(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[iNext], glm::vec3(0.0f, 1.0f, 0.0f))));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(LookAtRH, anubis, throughput, LookAtAnubis);
+MICRO_BENCHMARK(LookAtRH, glm, throughput, LookAtGLM);
+MICRO_BENCHMARK(LookAtRH, anubis, latency, LookAtAnubisLatency);
+MICRO_BENCHMARK(LookAtRH, glm, latency, LookAtGLMLatency);
+MICRO_BENCHMARK_CHECK(LookAtRH, LookAtCheck);
+
+//
+// Perspective projection, field of view between 30 and 90 degrees
+//
+static void PerspectiveAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return Matrix4().PerspectiveRH(MakeProjection(60.0f + inputs.m_arrAngles[i] / 6.0f)); });
+}
+
+static void PerspectiveGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return MakeGLMProjection(60.0f + inputs.m_arrAngles[i] / 6.0f); });
+}
+
+static void PerspectiveAnubisLatency(CBenchState& state)
+{
+	RunLatency(state, 45.0f, [](GLfloat fFOV) { return 45.0f + Matrix4().PerspectiveRH(MakeProjection(fFOV))[0][0] * 1e-3f; });
+}
+
+static void PerspectiveGLMLatency(CBenchState& state)
+{
+	RunLatency(state, 45.0f, [](GLfloat fFOV) { return 45.0f + MakeGLMProjection(fFOV)[0][0] * 1e-3f; });
+}
+
+static GLdouble PerspectiveCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLfloat fFOV = 60.0f + inputs.m_arrAngles[i] / 6.0f;
+		dError = std::max(dError, MaxError(Matrix4().PerspectiveRH(MakeProjection(fFOV)), MakeGLMProjection(fFOV)));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(PerspectiveRH, anubis, throughput, PerspectiveAnubis);
+MICRO_BENCHMARK(PerspectiveRH, glm, throughput, PerspectiveGLM);
+MICRO_BENCHMARK(PerspectiveRH, anubis, latency, PerspectiveAnubisLatency);
+MICRO_BENCHMARK(PerspectiveRH, glm, latency, PerspectiveGLMLatency);
+MICRO_BENCHMARK_CHECK(PerspectiveRH, PerspectiveCheck);
+
+//
+// Vector normalize
+//
+static void Vec3NormalizeAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i)
+	{
+		Vector3D v3Value = inputs.m_arrVectors[i];
+		return v3Value.normalize();
+	});
+}
+
+static void Vec3NormalizeGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return glm::normalize(inputs.m_arrGLMVectors[i]); });
+}
+
+static void Vec3NormalizeAnubisLatency(CBenchState& state)
+{
+	// scaled back up so every step has real work to do
+	RunLatency(state, GetInputs().m_arrVectors[0], [](const Vector3D& v3Value)
+	{
+		Vector3D v3Result = v3Value;
+		return v3Result.normalize() * 2.0f;
+	});
+}
+
+static void Vec3NormalizeGLMLatency(CBenchState& state)
+{
+	RunLatency(state, GetInputs().m_arrGLMVectors[0], [](const glm::vec3& v3Value) { return glm::normalize(v3Value) * 2.0f; });
+}
+
+static GLdouble Vec3NormalizeCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		Vector3D v3Value = inputs.m_arrVectors[i];
+		dError = std::max(dError, MaxError(v3Value.normalize(), glm::normalize(inputs.m_arrGLMVectors[i])));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(Vec3Normalize, anubis, throughput, Vec3NormalizeAnubis);
+MICRO_BENCHMARK(Vec3Normalize, glm, throughput, Vec3NormalizeGLM);
+MICRO_BENCHMARK(Vec3Normalize, anubis, latency, Vec3NormalizeAnubisLatency);
+MICRO_BENCHMARK(Vec3Normalize, glm, latency, Vec3NormalizeGLMLatency);
+MICRO_BENCHMARK_CHECK(Vec3Normalize, Vec3NormalizeCheck);
+
+//
+// Vector cross product
+//
+static void Vec3CrossAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return inputs.m_arrVectors[i].cross(inputs.m_arrVectors[(i + 1) & MATH_BENCH_INPUT_MASK]); });
+}
+
+static void Vec3CrossGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return glm::cross(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[(i + 1) & MATH_BENCH_INPUT_MASK]); });
+}
+
+static void Vec3CrossAnubisLatency(CBenchState& state)
+{
+	// crossing with a perpendicular unit axis rotates the vector by 90 degrees, its length stays the same
+	const Vector3D v3Axis(0.0f, 0.0f, 1.0f);
+	RunLatency(state, Vector3D(1.0f, 0.0f, 0.0f), [&v3Axis](const Vector3D& v3Value) { return v3Value.cross(v3Axis); });
+}
+
+static void Vec3CrossGLMLatency(CBenchState& state)
+{
+	const glm::vec3 v3Axis(0.0f, 0.0f, 1.0f);
+	RunLatency(state, glm::vec3(1.0f, 0.0f, 0.0f), [&v3Axis](const glm::vec3& v3Value) { return glm::cross(v3Value, v3Axis); });
+}
+
+static GLdouble Vec3CrossCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLint iNext = (i + 1) & MATH_BENCH_INPUT_MASK;
+		dError = std::max(dError, MaxError(inputs.m_arrVectors[i].cross(inputs.m_arrVectors[iNext]), glm::cross(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[iNext])));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(Vec3Cross, anubis, throughput, Vec3CrossAnubis);
+MICRO_BENCHMARK(Vec3Cross, glm, throughput, Vec3CrossGLM);
+MICRO_BENCHMARK(Vec3Cross, anubis, latency, Vec3CrossAnubisLatency);
+MICRO_BENCHMARK(Vec3Cross, glm, latency, Vec3CrossGLMLatency);
+MICRO_BENCHMARK_CHECK(Vec3Cross, Vec3CrossCheck);
+
+//
+// Vector dot product
+//
+static void Vec3DotAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return inputs.m_arrVectors[i].dot(inputs.m_arrVectors[(i + 1) & MATH_BENCH_INPUT_MASK]); });
+}
+
+static void Vec3DotGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return glm::dot(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[(i + 1) & MATH_BENCH_INPUT_MASK]); });
+}
+
+static void Vec3DotAnubisLatency(CBenchState& state)
+{
+	const Vector3D v3Other(0.25f, 0.5f, 0.125f);
+	RunLatency(state, 1.0f, [&v3Other](GLfloat fValue) { return Vector3D(fValue, 1.0f, 1.0f).dot(v3Other); });
+}
+
+static void Vec3DotGLMLatency(CBenchState& state)
+{
+	const glm::vec3 v3Other(0.25f, 0.5f, 0.125f);
+	RunLatency(state, 1.0f, [&v3Other](GLfloat fValue) { return glm::dot(glm::vec3(fValue, 1.0f, 1.0f), v3Other); });
+}
+
+static GLdouble Vec3DotCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLint iNext = (i + 1) & MATH_BENCH_INPUT_MASK;
+		dError = std::max(dError, static_cast<GLdouble>(std::abs(inputs.m_arrVectors[i].dot(inputs.m_arrVectors[iNext]) - glm::dot(inputs.m_arrGLMVectors[i], inputs.m_arrGLMVectors[iNext]))));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(Vec3Dot, anubis, throughput, Vec3DotAnubis);
+MICRO_BENCHMARK(Vec3Dot, glm, throughput, Vec3DotGLM);
+MICRO_BENCHMARK(Vec3Dot, anubis, latency, Vec3DotAnubisLatency);
+MICRO_BENCHMARK(Vec3Dot, glm, latency, Vec3DotGLMLatency);
+MICRO_BENCHMARK_CHECK(Vec3Dot, Vec3DotCheck);
+
+//
+// Quaternion multiply
+//
+static void QuatMultiplyAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i)
+	{
+		Quaternion quat = inputs.m_arrQuaternions[i];
+		return quat * inputs.m_arrQuaternions[(i + 1) & MATH_BENCH_INPUT_MASK];
+	});
+}
+
+static void QuatMultiplyGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	RunThroughput(state, [&inputs](GLint i) { return inputs.m_arrGLMQuaternions[i] * inputs.m_arrGLMQuaternions[(i + 1) & MATH_BENCH_INPUT_MASK]; });
+}
+
+static void QuatMultiplyAnubisLatency(CBenchState& state)
+{
+	const Quaternion quatStep = GetInputs().m_arrQuaternions[1];
+	RunLatency(state, GetInputs().m_arrQuaternions[0], [&quatStep](const Quaternion& quatValue)
+	{
+		Quaternion quat = quatValue;
+		return quat * quatStep;
+	});
+}
+
+static void QuatMultiplyGLMLatency(CBenchState& state)
+{
+	const glm::quat quatStep = GetInputs().m_arrGLMQuaternions[1];
+	RunLatency(state, GetInputs().m_arrGLMQuaternions[0], [&quatStep](const glm::quat& quatValue) { return quatValue * quatStep; });
+}
+
+static GLdouble QuatMultiplyCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		const GLint iNext = (i + 1) & MATH_BENCH_INPUT_MASK;
+		Quaternion quat = inputs.m_arrQuaternions[i];
+		dError = std::max(dError, MaxError(quat * inputs.m_arrQuaternions[iNext], inputs.m_arrGLMQuaternions[i] * inputs.m_arrGLMQuaternions[iNext]));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(QuatMultiply, anubis, throughput, QuatMultiplyAnubis);
+MICRO_BENCHMARK(QuatMultiply, glm, throughput, QuatMultiplyGLM);
+MICRO_BENCHMARK(QuatMultiply, anubis, latency, QuatMultiplyAnubisLatency);
+MICRO_BENCHMARK(QuatMultiply, glm, latency, QuatMultiplyGLMLatency);
+MICRO_BENCHMARK_CHECK(QuatMultiply, QuatMultiplyCheck);
+
+//
+// Vector rotation by axis and angle, SVector3Df::rotate builds the quaternion
+// from the angle in degrees and rotates by its negative
+//
+static glm::vec3 RotateGLM(const glm::vec3& v3Value, GLfloat fAngle, const glm::vec3& v3Axis)
+{
+	return glm::angleAxis(glm::radians(-fAngle), v3Axis) * v3Value;
+}
+
+static void QuatRotateAnubis(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	const Vector3D v3Axis(0.0f, 1.0f, 0.0f);
+	RunThroughput(state, [&inputs, &v3Axis](GLint i)
+	{
+		Vector3D v3Value = inputs.m_arrVectors[i];
+		v3Value.rotate(inputs.m_arrAngles[i], v3Axis);
+		return v3Value;
+	});
+}
+
+static void QuatRotateGLM(CBenchState& state)
+{
+	const TMathInputs& inputs = GetInputs();
+	const glm::vec3 v3Axis(0.0f, 1.0f, 0.0f);
+	RunThroughput(state, [&inputs, &v3Axis](GLint i) { return RotateGLM(inputs.m_arrGLMVectors[i], inputs.m_arrAngles[i], v3Axis); });
+}
+
+static void QuatRotateAnubisLatency(CBenchState& state)
+{
+	const Vector3D v3Axis(0.0f, 1.0f, 0.0f);
+	RunLatency(state, GetInputs().m_arrVectors[0], [&v3Axis](const Vector3D& v3Value)
+	{
+		Vector3D v3Result = v3Value;
+		v3Result.rotate(10.0f, v3Axis);
+		return v3Result;
+	});
+}
+
+static void QuatRotateGLMLatency(CBenchState& state)
+{
+	const glm::vec3 v3Axis(0.0f, 1.0f, 0.0f);
+	RunLatency(state, GetInputs().m_arrGLMVectors[0], [&v3Axis](const glm::vec3& v3Value) { return RotateGLM(v3Value, 10.0f, v3Axis); });
+}
+
+static GLdouble QuatRotateCheck()
+{
+	const TMathInputs& inputs = GetInputs();
+	GLdouble dError = 0.0;
+	for (GLint i = 0; i < MATH_BENCH_INPUT_COUNT; i++)
+	{
+		Vector3D v3Value = inputs.m_arrVectors[i];
+		v3Value.rotate(inputs.m_arrAngles[i], Vector3D(0.0f, 1.0f, 0.0f));
+		dError = std::max(dError, MaxError(v3Value, RotateGLM(inputs.m_arrGLMVectors[i], inputs.m_arrAngles[i], glm::vec3(0.0f, 1.0f, 0.0f))));
+	}
+	return (dError);
+}
+
+MICRO_BENCHMARK(QuatRotate, anubis, throughput, QuatRotateAnubis);
+MICRO_BENCHMARK(QuatRotate, glm, throughput, QuatRotateGLM);
+MICRO_BENCHMARK(QuatRotate, anubis, latency, QuatRotateAnubisLatency);
+MICRO_BENCHMARK(QuatRotate, glm, latency, QuatRotateGLMLatency);
+MICRO_BENCHMARK_CHECK(QuatRotate, QuatRotateCheck);
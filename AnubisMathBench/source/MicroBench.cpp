@@ -0,0 +1,208 @@
+#include "MicroBench.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <nlohmann/json.hpp>
+
+void UseCharPointer(char const volatile* pValue)
+{
+	(void)pValue;
+}
+
+CBenchState::CBenchState(GLuint64 ulIterations)
+{
+	m_ulIterations = ulIterations;
+	m_ulRemaining = ulIterations;
+	m_ulItemsPerIteration = 1;
+}
+
+void CBenchState::SetItemsPerIteration(GLuint64 ulItems)
+{
+	m_ulItemsPerIteration = ulItems;
+}
+
+GLuint64 CBenchState::GetIterations() const
+{
+	return (m_ulIterations);
+}
+
+GLuint64 CBenchState::GetItems() const
+{
+	return (m_ulIterations * m_ulItemsPerIteration);
+}
+
+GLdouble CBenchState::GetElapsedNanoseconds() const
+{
+	return std::chrono::duration<GLdouble, std::nano>(m_timeEnd - m_timeBegin).count();
+}
+
+std::vector<CMicroBench::TBenchmarkEntry>& CMicroBench::GetBenchmarks()
+{
+	static std::vector<TBenchmarkEntry> s_vecBenchmarks;
+	return (s_vecBenchmarks);
+}
+
+std::vector<CMicroBench::TCheckEntry>& CMicroBench::GetChecks()
+{
+	static std::vector<TCheckEntry> s_vecChecks;
+	return (s_vecChecks);
+}
+
+bool CMicroBench::RegisterBenchmark(const char* szGroup, const char* szLibrary, const char* szMode, TBenchFunction pFunction)
+{
+	GetBenchmarks().push_back({ szGroup, szLibrary, szMode, pFunction });
+	return (true);
+}
+
+bool CMicroBench::RegisterCheck(const char* szGroup, TCheckFunction pFunction)
+{
+	GetChecks().push_back({ szGroup, pFunction });
+	return (true);
+}
+
+TMicroBenchResult CMicroBench::RunBenchmark(const TBenchmarkEntry& entry, GLdouble dMinTimeMs)
+{
+	// grow the iteration count until a run is long enough to extrapolate from
+	GLuint64 ulIterations = 1;
+	GLdouble dNanoseconds = 0.0;
+	for (;;)
+	{
+		CBenchState state(ulIterations);
+		entry.m_pFunction(state);
+		dNanoseconds = state.GetElapsedNanoseconds();
+
+		if (dNanoseconds >= static_cast<GLdouble>(MICROBENCH_CALIBRATION_MS) * 1e6 || ulIterations >= (1ull << 40))
+		{
+			break;
+		}
+
+		ulIterations *= 10;
+	}
+
+	const GLdouble dPerIteration = std::max(dNanoseconds / ulIterations, 1e-3);
+	ulIterations = std::max<GLuint64>(1, static_cast<GLuint64>(dMinTimeMs * 1e6 / dPerIteration));
+
+	std::vector<GLdouble> vecPerItem;
+	for (GLint i = 0; i < MICROBENCH_REPETITIONS; i++)
+	{
+		CBenchState state(ulIterations);
+		entry.m_pFunction(state);
+		vecPerItem.push_back(state.GetElapsedNanoseconds() / state.GetItems());
+	}
+
+	std::sort(vecPerItem.begin(), vecPerItem.end());
+
+	TMicroBenchResult result{};
+	result.m_stGroup = entry.m_szGroup;
+	result.m_stLibrary = entry.m_szLibrary;
+	result.m_stMode = entry.m_szMode;
+	result.m_dMedian = vecPerItem[vecPerItem.size() / 2];
+	result.m_dMin = vecPerItem.front();
+	result.m_ulIterations = ulIterations;
+	return (result);
+}
+
+std::vector<TMicroBenchResult> CMicroBench::RunBenchmarks(const std::string& stFilter, GLdouble dMinTimeMs)
+{
+	std::vector<TMicroBenchResult> vecResults;
+
+	for (const TBenchmarkEntry& entry : GetBenchmarks())
+	{
+		if (stFilter.empty() == false && std::string(entry.m_szGroup).find(stFilter) == std::string::npos)
+		{
+			continue;
+		}
+
+		vecResults.push_back(RunBenchmark(entry, dMinTimeMs));
+
+		const TMicroBenchResult& result = vecResults.back();
+		std::printf("%-16s %-7s %-11s %10.3f ns\n", result.m_stGroup.c_str(), result.m_stLibrary.c_str(), result.m_stMode.c_str(), result.m_dMedian);
+	}
+
+	return (vecResults);
+}
+
+std::vector<TMicroBenchCheck> CMicroBench::RunChecks(const std::string& stFilter)
+{
+	std::vector<TMicroBenchCheck> vecChecks;
+
+	for (const TCheckEntry& entry : GetChecks())
+	{
+		if (stFilter.empty() == false && std::string(entry.m_szGroup).find(stFilter) == std::string::npos)
+		{
+			continue;
+		}
+
+		vecChecks.push_back({ entry.m_szGroup, entry.m_pFunction() });
+	}
+
+	return (vecChecks);
+}
+
+void CMicroBench::PrintComparison(const std::vector<TMicroBenchResult>& vecResults, const std::vector<TMicroBenchCheck>& vecChecks)
+{
+	// group + mode -> (anubis, glm)
+	std::map<std::pair<std::string, std::string>, std::pair<GLdouble, GLdouble>> mapPairs;
+	for (const TMicroBenchResult& result : vecResults)
+	{
+		std::pair<GLdouble, GLdouble>& times = mapPairs[{ result.m_stGroup, result.m_stMode }];
+		(result.m_stLibrary == "glm" ? times.second : times.first) = result.m_dMedian;
+	}
+
+	std::map<std::string, GLdouble> mapErrors;
+	for (const TMicroBenchCheck& check : vecChecks)
+	{
+		mapErrors[check.m_stGroup] = check.m_dMaxError;
+	}
+
+	std::printf("\n%-16s %-11s %12s %12s %9s %12s\n", "Operation", "Mode", "anubis ns", "glm ns", "speedup", "max error");
+	for (const auto& [key, times] : mapPairs)
+	{
+		// > 1 means the engine maths is faster than glm
+		const GLdouble dSpeedup = (times.first > 0.0) ? times.second / times.first : 0.0;
+		const auto itError = mapErrors.find(key.first);
+
+		std::printf("%-16s %-11s %12.3f %12.3f %8.2fx ", key.first.c_str(), key.second.c_str(), times.first, times.second, dSpeedup);
+		if (itError != mapErrors.end())
+		{
+			std::printf("%12.3g\n", itError->second);
+		}
+		else
+		{
+			std::printf("%12s\n", "-");
+		}
+	}
+}
+
+bool CMicroBench::WriteJSON(const std::string& stPath, const std::vector<TMicroBenchResult>& vecResults, const std::vector<TMicroBenchCheck>& vecChecks)
+{
+	nlohmann::json jsonResults = nlohmann::json::array();
+	for (const TMicroBenchResult& result : vecResults)
+	{
+		jsonResults.push_back({
+			{ "operation", result.m_stGroup },
+			{ "library", result.m_stLibrary },
+			{ "mode", result.m_stMode },
+			{ "median_ns", result.m_dMedian },
+			{ "min_ns", result.m_dMin },
+			{ "iterations", result.m_ulIterations },
+		});
+	}
+
+	nlohmann::json jsonChecks = nlohmann::json::object();
+	for (const TMicroBenchCheck& check : vecChecks)
+	{
+		jsonChecks[check.m_stGroup] = check.m_dMaxError;
+	}
+
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		std::fprintf(stderr, "Failed to open %s for writing\n", stPath.c_str());
+		return (false);
+	}
+
+	file << nlohmann::json({ { "benchmarks", jsonResults }, { "max_error", jsonChecks } }).dump(1, '\t');
+	return (file.good());
+}
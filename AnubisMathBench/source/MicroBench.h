@@ -0,0 +1,168 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum EMicroBenchData
+{
+	MICROBENCH_REPETITIONS = 5,
+	MICROBENCH_DEFAULT_MIN_TIME_MS = 200,	// per repetition
+	MICROBENCH_CALIBRATION_MS = 10,
+
+	MICROBENCH_BATCH_SIZE = 256,		// independent operations per iteration, throughput mode
+	MICROBENCH_CHAIN_LENGTH = 16,		// dependent operations per iteration, latency mode
+};
+
+/**
+ * Iteration state handed to a benchmark function, the timed region is the
+ * KeepRunning() loop:
+ *
+ *	while (state.KeepRunning())
+ *	{
+ *		...
+ *	}
+ */
+class CBenchState
+{
+public:
+	explicit CBenchState(GLuint64 ulIterations);
+
+	inline bool KeepRunning()
+	{
+		if (m_ulRemaining == m_ulIterations)
+		{
+			// setup before the loop is not measured
+			m_timeBegin = std::chrono::steady_clock::now();
+		}
+
+		if (m_ulRemaining-- > 0)
+		{
+			return (true);
+		}
+
+		m_timeEnd = std::chrono::steady_clock::now();
+		return (false);
+	}
+
+	/**
+	 * Operations done by one iteration, the results are reported per operation.
+	 */
+	void SetItemsPerIteration(GLuint64 ulItems);
+
+	GLuint64 GetIterations() const;
+	GLuint64 GetItems() const;
+	GLdouble GetElapsedNanoseconds() const;
+
+private:
+	GLuint64 m_ulIterations;
+	GLuint64 m_ulRemaining;
+	GLuint64 m_ulItemsPerIteration;
+
+	std::chrono::steady_clock::time_point m_timeBegin;
+	std::chrono::steady_clock::time_point m_timeEnd;
+};
+
+typedef void (*TBenchFunction)(CBenchState& state);
+
+/**
+ * Runs both implementations on the same inputs.
+ *
+ * @return Largest absolute difference between the results
+ */
+typedef GLdouble (*TCheckFunction)();
+
+typedef struct SMicroBenchResult
+{
+	std::string m_stGroup;		// operation, e.g. Mat4Multiply
+	std::string m_stLibrary;	// anubis or glm
+	std::string m_stMode;		// throughput or latency
+	GLdouble m_dMedian;			// ns per operation over the repetitions
+	GLdouble m_dMin;
+	GLuint64 m_ulIterations;	// per repetition
+} TMicroBenchResult;
+
+typedef struct SMicroBenchCheck
+{
+	std::string m_stGroup;
+	GLdouble m_dMaxError;
+} TMicroBenchCheck;
+
+/**
+ * Minimal benchmark runner modelled after Google Benchmark: functions register
+ * themselves statically, the iteration count is calibrated until a repetition
+ * takes the minimum time, the median of the repetitions is reported.
+ */
+class CMicroBench
+{
+public:
+	static bool RegisterBenchmark(const char* szGroup, const char* szLibrary, const char* szMode, TBenchFunction pFunction);
+	static bool RegisterCheck(const char* szGroup, TCheckFunction pFunction);
+
+	/**
+	 * @param stFilter Only groups containing this text are run, empty runs all
+	 */
+	static std::vector<TMicroBenchResult> RunBenchmarks(const std::string& stFilter, GLdouble dMinTimeMs);
+	static std::vector<TMicroBenchCheck> RunChecks(const std::string& stFilter);
+
+	/**
+	 * Prints anubis and glm side by side, per group and mode.
+	 */
+	static void PrintComparison(const std::vector<TMicroBenchResult>& vecResults, const std::vector<TMicroBenchCheck>& vecChecks);
+	static bool WriteJSON(const std::string& stPath, const std::vector<TMicroBenchResult>& vecResults, const std::vector<TMicroBenchCheck>& vecChecks);
+
+protected:
+	typedef struct SBenchmarkEntry
+	{
+		const char* m_szGroup;
+		const char* m_szLibrary;
+		const char* m_szMode;
+		TBenchFunction m_pFunction;
+	} TBenchmarkEntry;
+
+	typedef struct SCheckEntry
+	{
+		const char* m_szGroup;
+		TCheckFunction m_pFunction;
+	} TCheckEntry;
+
+	static TMicroBenchResult RunBenchmark(const TBenchmarkEntry& entry, GLdouble dMinTimeMs);
+
+	// function local statics, registration runs during static initialization
+	static std::vector<TBenchmarkEntry>& GetBenchmarks();
+	static std::vector<TCheckEntry>& GetChecks();
+};
+
+/**
+ * Defined in another translation unit so the compiler has to assume the
+ * value is read.
+ */
+void UseCharPointer(char const volatile* pValue);
+
+/**
+ * Keeps the computation of value from being optimized away.
+ */
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+	UseCharPointer(&reinterpret_cast<char const volatile&>(value));
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+#define MICRO_BENCH_CONCAT_INNER(a, b) a##b
+#define MICRO_BENCH_CONCAT(a, b) MICRO_BENCH_CONCAT_INNER(a, b)
+
+#define MICRO_BENCHMARK(group, library, mode, function) \
+	static const bool MICRO_BENCH_CONCAT(g_bBenchmark_, __LINE__) = CMicroBench::RegisterBenchmark(#group, #library, #mode, function)
+
+#define MICRO_BENCHMARK_CHECK(group, function) \
+	static const bool MICRO_BENCH_CONCAT(g_bCheck_, __LINE__) = CMicroBench::RegisterCheck(#group, function)
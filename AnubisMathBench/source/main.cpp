@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "MicroBench.h"
+
+typedef struct SMathBenchOptions
+{
+	std::string m_stFilter;
+	std::string m_stJSONPath;
+	GLdouble m_dMinTimeMs;
+} TMathBenchOptions;
+
+/**
+ * [--filter text] [--min-time ms] [--json results.json]
+ */
+static TMathBenchOptions ParseCommandLine(int argc, char* argv[])
+{
+	TMathBenchOptions options{};
+	options.m_dMinTimeMs = MICROBENCH_DEFAULT_MIN_TIME_MS;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool bHasValue = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--filter") == 0 && bHasValue)
+		{
+			options.m_stFilter = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--min-time") == 0 && bHasValue)
+		{
+			options.m_dMinTimeMs = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--json") == 0 && bHasValue)
+		{
+			options.m_stJSONPath = argv[++i];
+		}
+		else
+		{
+			std::fprintf(stderr, "Unknown argument %s\n", argv[i]);
+		}
+	}
+
+	return (options);
+}
+
+int main(int argc, char* argv[])
+{
+	const TMathBenchOptions options = ParseCommandLine(argc, argv);
+	if (options.m_dMinTimeMs <= 0.0)
+	{
+		std::fprintf(stderr, "Invalid minimum time\n");
+		return (EXIT_FAILURE);
+	}
+
+	const std::vector<TMicroBenchResult> vecResults = CMicroBench::RunBenchmarks(options.m_stFilter, options.m_dMinTimeMs);
+	const std::vector<TMicroBenchCheck> vecChecks = CMicroBench::RunChecks(options.m_stFilter);
+
+	CMicroBench::PrintComparison(vecResults, vecChecks);
+
+	if (options.m_stJSONPath.empty() == false && CMicroBench::WriteJSON(options.m_stJSONPath, vecResults, vecChecks) == false)
+	{
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
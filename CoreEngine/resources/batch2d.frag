@@ -0,0 +1,56 @@
+#version 460 core
+
+layout (location = 0) in vec2 v2TexCoord;
+layout (location = 1) in vec4 v4Color;
+layout (location = 2) flat in int iTextureIndex;
+
+layout (location = 0) out vec4 v4FragColor;
+
+// BATCH_2D_TEXTURE_SLOTS, the draw binds its textures to units 0 to 7
+const int BATCH_2D_TEXTURE_SLOTS = 8;
+
+// element i samples unit i, fixed at link time
+layout (binding = 0) uniform sampler2D textures[BATCH_2D_TEXTURE_SLOTS];
+
+// 1 where the slot holds distance field glyphs
+uniform int textureModes[BATCH_2D_TEXTURE_SLOTS];
+
+void main()
+{
+	// -1 is plain vertex color
+	if (iTextureIndex < 0)
+	{
+		v4FragColor = v4Color;
+		return;
+	}
+
+	// derivatives before the branch, sampler arrays only take constant indices here
+	vec2 v2DX = dFdx(v2TexCoord);
+	vec2 v2DY = dFdy(v2TexCoord);
+
+	vec4 v4Texel = vec4(1.0f);
+	switch (iTextureIndex)
+	{
+	case 0: v4Texel = textureGrad(textures[0], v2TexCoord, v2DX, v2DY); break;
+	case 1: v4Texel = textureGrad(textures[1], v2TexCoord, v2DX, v2DY); break;
+	case 2: v4Texel = textureGrad(textures[2], v2TexCoord, v2DX, v2DY); break;
+	case 3: v4Texel = textureGrad(textures[3], v2TexCoord, v2DX, v2DY); break;
+	case 4: v4Texel = textureGrad(textures[4], v2TexCoord, v2DX, v2DY); break;
+	case 5: v4Texel = textureGrad(textures[5], v2TexCoord, v2DX, v2DY); break;
+	case 6: v4Texel = textureGrad(textures[6], v2TexCoord, v2DX, v2DY); break;
+	case 7: v4Texel = textureGrad(textures[7], v2TexCoord, v2DX, v2DY); break;
+	}
+
+	// FreeType puts the outline at 128, about one pixel of smoothing at any scale
+	if (textureModes[iTextureIndex] != 0)
+	{
+		float fWidth = max(length(vec2(dFdx(v4Texel.a), dFdy(v4Texel.a))), 1e-4f);
+		v4Texel.a = smoothstep(0.5f - fWidth, 0.5f + fWidth, v4Texel.a);
+	}
+
+	v4FragColor = v4Texel * v4Color;
+	if (v4FragColor.a <= 0.0f)
+	{
+		discard;
+	}
+}
@@ -0,0 +1,24 @@
+#version 460 core
+
+// SVertex2D, positions in pixels from the top left
+layout (location = 0) in vec2 v2InPosition;
+layout (location = 1) in vec2 v2InTexCoord;
+layout (location = 2) in vec4 v4InColor;
+layout (location = 3) in int iInTextureIndex;
+
+layout (location = 0) out vec2 v2TexCoord;
+layout (location = 1) out vec4 v4Color;
+layout (location = 2) flat out int iTextureIndex;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+	// pixels grow down, clip space up
+	vec2 v2Clip = v2InPosition / viewportSize * 2.0f - 1.0f;
+	gl_Position = vec4(v2Clip.x, -v2Clip.y, 0.0f, 1.0f);
+
+	v2TexCoord = v2InTexCoord;
+	v4Color = v4InColor;
+	iTextureIndex = iInTextureIndex;
+}
@@ -0,0 +1,98 @@
+// Prepended to cull.comp and cluster_cull.comp by the shader loader, see CCullPass
+
+// TDrawElementsIndirectCommand
+struct SDrawElementsIndirectCommand
+{
+	uint m_uiCount;
+	uint m_uiInstanceCount;
+	uint m_uiFirstIndex;
+	int m_iBaseVertex;
+	uint m_uiBaseInstance;
+};
+
+uniform vec4 frustumPlanes[6];
+
+// Min/max depth pyramid of the previous frame, see CDepthPyramid
+uniform bool occlusionCulling;
+uniform mat4 previousViewProjection;
+uniform sampler2D depthPyramid;
+uniform ivec2 depthSize;
+uniform int depthPyramidLevels;
+
+bool IsInsideFrustum(vec3 v3Min, vec3 v3Max)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// corner furthest along the plane normal
+		vec4 v4Plane = frustumPlanes[i];
+		vec3 v3Corner = mix(v3Min, v3Max, greaterThanEqual(v4Plane.xyz, vec3(0.0f)));
+
+		if (dot(v4Plane.xyz, v3Corner) + v4Plane.w < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool IsInsideFrustum(vec3 v3Center, float fRadius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, v3Center) + frustumPlanes[i].w < -fRadius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool IsOccluded(vec3 v3Min, vec3 v3Max)
+{
+	// screen rectangle and nearest depth of the box as seen by the previous frame
+	vec2 v2RectMin = vec2(1.0f);
+	vec2 v2RectMax = vec2(0.0f);
+	float fNearestDepth = 1.0f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 v3Corner = mix(v3Min, v3Max, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 v4Clip = previousViewProjection * vec4(v3Corner, 1.0f);
+
+		// crosses the camera plane, no reliable rectangle
+		if (v4Clip.w <= 0.0f)
+		{
+			return false;
+		}
+
+		vec3 v3NDC = v4Clip.xyz / v4Clip.w;
+		v2RectMin = min(v2RectMin, v3NDC.xy * 0.5f + 0.5f);
+		v2RectMax = max(v2RectMax, v3NDC.xy * 0.5f + 0.5f);
+		fNearestDepth = min(fNearestDepth, v3NDC.z * 0.5f + 0.5f);
+	}
+
+	// depth texels covered by the rectangle
+	ivec2 iv2PixelMin = min(ivec2(clamp(v2RectMin, vec2(0.0f), vec2(1.0f)) * vec2(depthSize)), depthSize - 1);
+	ivec2 iv2PixelMax = min(ivec2(clamp(v2RectMax, vec2(0.0f), vec2(1.0f)) * vec2(depthSize)), depthSize - 1);
+
+	// a texel of level n covers 2^(n + 1) depth texels, pick the level where
+	// the rectangle spans at most two texels per axis
+	ivec2 iv2Extent = iv2PixelMax - iv2PixelMin + 1;
+	int iLevel = max(int(ceil(log2(float(max(iv2Extent.x, iv2Extent.y))))) - 1, 0);
+	iLevel = min(iLevel, depthPyramidLevels - 1);
+
+	ivec2 iv2LevelMax = textureSize(depthPyramid, iLevel) - 1;
+	ivec2 iv2TexelMin = min(iv2PixelMin >> (iLevel + 1), iv2LevelMax);
+	ivec2 iv2TexelMax = min(iv2PixelMax >> (iLevel + 1), iv2LevelMax);
+
+	// farthest depth drawn anywhere under the rectangle
+	float fDepth = texelFetch(depthPyramid, iv2TexelMin, iLevel).g;
+	fDepth = max(fDepth, texelFetch(depthPyramid, ivec2(iv2TexelMax.x, iv2TexelMin.y), iLevel).g);
+	fDepth = max(fDepth, texelFetch(depthPyramid, ivec2(iv2TexelMin.x, iv2TexelMax.y), iLevel).g);
+	fDepth = max(fDepth, texelFetch(depthPyramid, iv2TexelMax, iLevel).g);
+
+	// fully behind everything drawn there last frame
+	return fNearestDepth > fDepth;
+}
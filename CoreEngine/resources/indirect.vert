@@ -0,0 +1,33 @@
+#version 460 core
+
+layout (location = 0) in vec3 m_v3Position;
+layout (location = 1) in vec2 m_v2TexCoord;
+layout (location = 2) in vec3 m_v3Normals;
+
+// TIndirectDrawData, one entry per command of the multi draw
+struct SIndirectDrawData
+{
+	mat4 m_mat4Model;
+	uint m_uiMaterial;
+};
+
+layout (std430, binding = 0) readonly buffer IndirectDrawData
+{
+	SIndirectDrawData drawData[];
+};
+
+layout (location = 0) out vec2 v2TexCoord;
+layout (location = 1) flat out uint uiMaterial;
+layout (location = 2) out vec3 v3WorldPosition;
+
+uniform mat4 viewProjectionMatrix;
+
+void main()
+{
+	v2TexCoord = m_v2TexCoord;
+	uiMaterial = drawData[gl_DrawID].m_uiMaterial;
+
+	vec4 v4WorldPosition = drawData[gl_DrawID].m_mat4Model * vec4(m_v3Position, 1.0f);
+	v3WorldPosition = v4WorldPosition.xyz;
+	gl_Position = viewProjectionMatrix * v4WorldPosition;
+}
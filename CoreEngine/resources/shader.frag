@@ -1,8 +1,34 @@
 #version 460 core
+#extension GL_ARB_bindless_texture : enable
+
+layout (location = 0) in vec2 v2TexCoord;
+layout (location = 1) flat in uint uiMaterial;
 
 layout (location = 0) out vec4 v4FragColor;
 
+// white placeholder until the texture manager uploaded the image
+uniform sampler2D albedoTexture;
+
+#ifdef GL_ARB_bindless_texture
+// CBindlessTextures, albedo handle per material ID. Entries of textures that
+// are not resident hold the placeholder handle. The ID is constant per draw.
+layout (std430, binding = 7) readonly buffer MaterialTextures
+{
+	uvec2 materialAlbedo[];
+};
+
+uniform bool bindlessTextures;
+#endif
+
 void main()
 {
-	v4FragColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+#ifdef GL_ARB_bindless_texture
+	if (bindlessTextures)
+	{
+		v4FragColor = texture(sampler2D(materialAlbedo[uiMaterial]), v2TexCoord);
+		return;
+	}
+#endif
+
+	v4FragColor = texture(albedoTexture, v2TexCoord);
 }
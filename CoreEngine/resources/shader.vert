@@ -5,8 +5,15 @@ layout (location = 1) in vec2 m_v2TexCoord;
 layout (location = 2) in vec3 m_v3Normals;
 
 uniform mat4 viewProjectionMatrix;
+uniform mat4 modelMatrix;
+uniform uint material;			// 0, the default material, unless set
+
+layout (location = 0) out vec2 v2TexCoord;
+layout (location = 1) flat out uint uiMaterial;
 
 void main()
 {
-	gl_Position = viewProjectionMatrix * vec4(m_v3Position, 1.0f);	
+	v2TexCoord = m_v2TexCoord;
+	uiMaterial = material;
+	gl_Position = viewProjectionMatrix * modelMatrix * vec4(m_v3Position, 1.0f);	
 }
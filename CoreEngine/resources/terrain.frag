@@ -0,0 +1,117 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : enable
+
+// the feedback only counts fragments that end up visible
+layout (early_fragment_tests) in;
+
+layout (location = 0) in vec2 v2TexCoord;
+layout (location = 1) flat in uint uiMaterial;
+layout (location = 2) in vec3 v3WorldPosition;
+
+layout (location = 0) out vec4 v4FragColor;
+
+// CVirtualTexture, see EVirtualTextureData
+const int PAGE_SIZE = 128;
+const int PAGE_BORDER = 4;
+const int PHYSICAL_PAGE_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+const int CACHE_PAGES = 16;
+const int FEEDBACK_STRIDE = 8;
+
+// white placeholder until the texture manager uploaded the image
+uniform sampler2D albedoTexture;
+
+#ifdef GL_ARB_bindless_texture
+// CBindlessTextures, albedo handle per material ID. Entries of textures that
+// are not resident hold the placeholder handle. The ID is constant per draw.
+layout (std430, binding = 7) readonly buffer MaterialTextures
+{
+	uvec2 materialAlbedo[];
+};
+
+uniform bool bindlessTextures;
+#endif
+
+// One bit per page and level, most detailed level first, cleared every frame
+layout (std430, binding = 8) buffer VirtualTextureFeedback
+{
+	uint feedbackBits[];
+};
+
+// Cache slot x, slot y and level of the page drawn for every page and level
+uniform usampler2D pageTable;
+uniform sampler2D pageCache;
+
+uniform bool virtualTexture;
+uniform float virtualExtent;		// world units along x and z
+uniform int virtualPages;			// per side of level 0
+uniform int virtualLevels;
+uniform ivec2 feedbackJitter;
+
+vec4 SampleAlbedo()
+{
+#ifdef GL_ARB_bindless_texture
+	if (bindlessTextures)
+	{
+		return texture(sampler2D(materialAlbedo[uiMaterial]), v2TexCoord);
+	}
+#endif
+
+	return texture(albedoTexture, v2TexCoord);
+}
+
+void RequestPage(vec2 v2UV, int iLevel)
+{
+	int iPages = virtualPages >> iLevel;
+	ivec2 v2Page = clamp(ivec2(v2UV * float(iPages)), ivec2(0), ivec2(iPages - 1));
+
+	uint uiBit = 0u;
+	for (int i = 0; i < iLevel; i++)
+	{
+		uint uiLevelPages = uint(virtualPages >> i);
+		uiBit += uiLevelPages * uiLevelPages;
+	}
+	uiBit += uint(v2Page.y * iPages + v2Page.x);
+
+	atomicOr(feedbackBits[uiBit >> 5], 1u << (uiBit & 31u));
+}
+
+vec4 SampleVirtualTexture(vec2 v2UV, int iLevel)
+{
+	int iPages = virtualPages >> iLevel;
+	ivec2 v2Page = clamp(ivec2(v2UV * float(iPages)), ivec2(0), ivec2(iPages - 1));
+	uvec4 v4Entry = texelFetch(pageTable, v2Page, iLevel);
+
+	// the entry may point at a coarser parent, the position is taken in its page
+	vec2 v2InPage = fract(v2UV * float(virtualPages >> int(v4Entry.z)));
+	vec2 v2Texel = vec2(v4Entry.xy) * float(PHYSICAL_PAGE_SIZE) + float(PAGE_BORDER) + v2InPage * float(PAGE_SIZE);
+
+	return textureLod(pageCache, v2Texel / float(CACHE_PAGES * PHYSICAL_PAGE_SIZE), 0.0f);
+}
+
+void main()
+{
+	vec4 v4Albedo = SampleAlbedo();
+	if (virtualTexture == false)
+	{
+		v4FragColor = v4Albedo;
+		return;
+	}
+
+	vec2 v2UV = clamp(v3WorldPosition.xz / virtualExtent, vec2(0.0f), vec2(1.0f));
+
+	// mip level from the footprint in virtual texels of level 0
+	vec2 v2Texels = v3WorldPosition.xz / virtualExtent * float(virtualPages * PAGE_SIZE);
+	vec2 v2DX = dFdx(v2Texels);
+	vec2 v2DY = dFdy(v2Texels);
+	float fLod = 0.5f * log2(max(max(dot(v2DX, v2DX), dot(v2DY, v2DY)), 1.0f));
+	int iLevel = clamp(int(floor(fLod)), 0, virtualLevels - 1);
+
+	// a sparse pattern moving every frame still covers every pixel over time
+	ivec2 v2Pixel = (ivec2(gl_FragCoord.xy) + feedbackJitter) % FEEDBACK_STRIDE;
+	if (v2Pixel == ivec2(0))
+	{
+		RequestPage(v2UV, iLevel);
+	}
+
+	v4FragColor = SampleVirtualTexture(v2UV, iLevel) * v4Albedo;
+}
@@ -0,0 +1,381 @@
+#include "Batch2D.h"
+#include <algorithm>
+#include <cmath>
+
+// unit square corners of a quad, two triangles
+static const GLuint QUAD_INDICES[6] = { 0, 1, 2, 2, 1, 3 };
+
+CBatch2D::CBatch2D()
+{
+	m_iViewportWidth = 0;
+	m_iViewportHeight = 0;
+	m_ulFrameIndex = 0;
+	m_iLayer = 0;
+}
+
+void CBatch2D::Begin(GLint iViewportWidth, GLint iViewportHeight, GLuint64 ulFrameIndex)
+{
+	m_iViewportWidth = iViewportWidth;
+	m_iViewportHeight = iViewportHeight;
+	m_ulFrameIndex = ulFrameIndex;
+	m_iLayer = 0;
+
+	m_vecClipRects.clear();
+	m_vecClipRects.push_back(Vector4D(0.0f, 0.0f, static_cast<GLfloat>(iViewportWidth), static_cast<GLfloat>(iViewportHeight)));
+	m_vecClipStack.clear();
+	m_vecClipStack.push_back(0);
+
+	m_vecPrimitives.clear();
+	m_meshData.vVertices.clear();
+	m_meshData.vIndices.clear();
+	m_vecTextures.clear();
+}
+
+void CBatch2D::SetLayer(GLint iLayer)
+{
+	m_iLayer = iLayer;
+}
+
+void CBatch2D::PushClipRect(const Vector4D& v4Rect)
+{
+	const Vector4D& v4Current = m_vecClipRects[m_vecClipStack.back()];
+	const GLfloat fLeft = std::max(v4Rect.x, v4Current.x);
+	const GLfloat fTop = std::max(v4Rect.y, v4Current.y);
+	const GLfloat fRight = std::min(v4Rect.x + v4Rect.z, v4Current.x + v4Current.z);
+	const GLfloat fBottom = std::min(v4Rect.y + v4Rect.w, v4Current.y + v4Current.w);
+
+	m_vecClipStack.push_back(static_cast<GLint>(m_vecClipRects.size()));
+	m_vecClipRects.push_back(Vector4D(fLeft, fTop, std::max(fRight - fLeft, 0.0f), std::max(fBottom - fTop, 0.0f)));
+}
+
+void CBatch2D::PopClipRect()
+{
+	// the viewport stays
+	if (m_vecClipStack.size() > 1)
+	{
+		m_vecClipStack.pop_back();
+	}
+}
+
+Vector4D CBatch2D::Anchor(EAlignment eAlignment, const Vector2D& v2Size, const Vector2D& v2Offset) const
+{
+	const Vector4D& v4Container = m_vecClipRects.empty() ? Vector4D(0.0f, 0.0f, 0.0f, 0.0f) : m_vecClipRects[m_vecClipStack.back()];
+	const GLfloat fCenterX = v4Container.x + (v4Container.z - v2Size.x) * 0.5f;
+	const GLfloat fCenterY = v4Container.y + (v4Container.w - v2Size.y) * 0.5f;
+	const GLfloat fRight = v4Container.x + v4Container.z - v2Size.x;
+	const GLfloat fBottom = v4Container.y + v4Container.w - v2Size.y;
+
+	GLfloat fX = v4Container.x;
+	GLfloat fY = v4Container.y;
+	switch (eAlignment)
+	{
+	case EAlignment::ALIGN_CENTERED:
+		fX = fCenterX;
+		fY = fCenterY;
+		break;
+	case EAlignment::ALIGN_CENTERED_HORIZONTAL:
+		fX = fCenterX;
+		break;
+	case EAlignment::ALIGN_CENTERED_VERTICAL:
+		fY = fCenterY;
+		break;
+	case EAlignment::ALIGN_TOP_RIGHT:
+		fX = fRight;
+		break;
+	case EAlignment::ALIGN_BOTTOM_LEFT:
+		fY = fBottom;
+		break;
+	case EAlignment::ALIGN_BOTTOM_RIGHT:
+		fX = fRight;
+		fY = fBottom;
+		break;
+	case EAlignment::ALIGN_TOP_LEFT:
+	default:
+		break;
+	}
+
+	return (Vector4D(fX + v2Offset.x, fY + v2Offset.y, v2Size.x, v2Size.y));
+}
+
+CBatch2D::TPrimitive2D& CBatch2D::BeginPrimitive(GLint iTexture)
+{
+	TPrimitive2D primitive;
+	primitive.m_iLayer = m_iLayer;
+	primitive.m_iClip = m_vecClipStack.back();
+	primitive.m_iTexture = iTexture;
+	primitive.m_uiFirstVertex = static_cast<GLuint>(m_meshData.vVertices.size());
+	primitive.m_uiVertexCount = 0;
+	primitive.m_uiFirstIndex = static_cast<GLuint>(m_meshData.vIndices.size());
+	primitive.m_uiIndexCount = 0;
+
+	m_vecPrimitives.push_back(primitive);
+	return (m_vecPrimitives.back());
+}
+
+void CBatch2D::EndPrimitive(TPrimitive2D& primitive)
+{
+	primitive.m_uiVertexCount = static_cast<GLuint>(m_meshData.vVertices.size()) - primitive.m_uiFirstVertex;
+	primitive.m_uiIndexCount = static_cast<GLuint>(m_meshData.vIndices.size()) - primitive.m_uiFirstIndex;
+
+	// nothing to draw, e.g. a string of blanks
+	if (primitive.m_uiIndexCount == 0)
+	{
+		m_meshData.vVertices.resize(primitive.m_uiFirstVertex);
+		m_vecPrimitives.pop_back();
+	}
+}
+
+GLint CBatch2D::FindTexture(TextureHandle hTexture, GLuint uiFlags)
+{
+	// a handful of textures per frame, a linear search is enough
+	for (size_t i = 0; i < m_vecTextures.size(); i++)
+	{
+		if (m_vecTextures[i].m_hTexture == hTexture && m_vecTextures[i].m_uiFlags == uiFlags)
+		{
+			return (static_cast<GLint>(i));
+		}
+	}
+
+	m_vecTextures.push_back(TTexture2D{ hTexture, uiFlags });
+	return (static_cast<GLint>(m_vecTextures.size() - 1));
+}
+
+void CBatch2D::AddQuad(const Vector4D& v4Rect, const Vector4D& v4TexRect, const Vector4D& v4Color, GLint iTexture)
+{
+	// indices are local to the primitive, End() rebases them
+	const GLuint uiBase = static_cast<GLuint>(m_meshData.vVertices.size()) - m_vecPrimitives.back().m_uiFirstVertex;
+	for (GLint iCorner = 0; iCorner < 4; iCorner++)
+	{
+		const GLfloat fU = static_cast<GLfloat>(iCorner & 1);
+		const GLfloat fV = static_cast<GLfloat>(iCorner >> 1);
+
+		SVertex2D vertex;
+		vertex.v2Position = Vector2D(v4Rect.x + fU * v4Rect.z, v4Rect.y + fV * v4Rect.w);
+		vertex.v2TexCoord = Vector2D(v4TexRect.x + fU * (v4TexRect.z - v4TexRect.x), v4TexRect.y + fV * (v4TexRect.w - v4TexRect.y));
+		vertex.v4Color = v4Color;
+		vertex.iTextureIndex = iTexture;
+		m_meshData.vVertices.push_back(vertex);
+	}
+
+	for (GLuint uiIndex : QUAD_INDICES)
+	{
+		m_meshData.vIndices.push_back(uiBase + uiIndex);
+	}
+}
+
+void CBatch2D::AddRect(const Vector4D& v4Rect, const Vector4D& v4Color)
+{
+	TPrimitive2D& primitive = BeginPrimitive(BATCH_2D_UNTEXTURED);
+	AddQuad(v4Rect, Vector4D(0.0f, 0.0f, 1.0f, 1.0f), v4Color, BATCH_2D_UNTEXTURED);
+	EndPrimitive(primitive);
+}
+
+void CBatch2D::AddTexturedRect(const Vector4D& v4Rect, TextureHandle hTexture, const Vector4D& v4TexRect, const Vector4D& v4Color)
+{
+	const GLint iTexture = FindTexture(hTexture, 0);
+	TPrimitive2D& primitive = BeginPrimitive(iTexture);
+	AddQuad(v4Rect, v4TexRect, v4Color, iTexture);
+	EndPrimitive(primitive);
+}
+
+void CBatch2D::AddLine(const Vector2D& v2From, const Vector2D& v2To, GLfloat fWidth, const Vector4D& v4Color)
+{
+	const GLfloat fDeltaX = v2To.x - v2From.x;
+	const GLfloat fDeltaY = v2To.y - v2From.y;
+	const GLfloat fLength = std::sqrt(fDeltaX * fDeltaX + fDeltaY * fDeltaY);
+	if (fLength <= 0.0f)
+	{
+		return;
+	}
+
+	// a quad around the segment, half the width on each side
+	const GLfloat fNormalX = -fDeltaY / fLength * fWidth * 0.5f;
+	const GLfloat fNormalY = fDeltaX / fLength * fWidth * 0.5f;
+
+	TPrimitive2D& primitive = BeginPrimitive(BATCH_2D_UNTEXTURED);
+	const Vector2D arrCorners[4] = { Vector2D(v2From.x + fNormalX, v2From.y + fNormalY), Vector2D(v2To.x + fNormalX, v2To.y + fNormalY),
+		Vector2D(v2From.x - fNormalX, v2From.y - fNormalY), Vector2D(v2To.x - fNormalX, v2To.y - fNormalY) };
+
+	const GLuint uiBase = static_cast<GLuint>(m_meshData.vVertices.size()) - primitive.m_uiFirstVertex;
+	for (const Vector2D& v2Corner : arrCorners)
+	{
+		SVertex2D vertex;
+		vertex.v2Position = v2Corner;
+		vertex.v2TexCoord = Vector2D(0.0f, 0.0f);
+		vertex.v4Color = v4Color;
+		vertex.iTextureIndex = BATCH_2D_UNTEXTURED;
+		m_meshData.vVertices.push_back(vertex);
+	}
+
+	for (GLuint uiIndex : QUAD_INDICES)
+	{
+		m_meshData.vIndices.push_back(uiBase + uiIndex);
+	}
+
+	EndPrimitive(primitive);
+}
+
+void CBatch2D::AddMesh(const SMeshData2D& meshData, TextureHandle hTexture)
+{
+	const GLint iTexture = hTexture.IsValid() ? FindTexture(hTexture, 0) : BATCH_2D_UNTEXTURED;
+	TPrimitive2D& primitive = BeginPrimitive(iTexture);
+
+	for (SVertex2D vertex : meshData.vVertices)
+	{
+		vertex.iTextureIndex = iTexture;
+		m_meshData.vVertices.push_back(vertex);
+	}
+
+	// out of range indices would read another primitive's vertices
+	const GLuint uiVertexCount = static_cast<GLuint>(meshData.vVertices.size());
+	for (size_t i = 0; i + 2 < meshData.vIndices.size(); i += 3)
+	{
+		if (meshData.vIndices[i] < uiVertexCount && meshData.vIndices[i + 1] < uiVertexCount && meshData.vIndices[i + 2] < uiVertexCount)
+		{
+			m_meshData.vIndices.insert(m_meshData.vIndices.end(), meshData.vIndices.begin() + i, meshData.vIndices.begin() + i + 3);
+		}
+	}
+
+	EndPrimitive(primitive);
+}
+
+void CBatch2D::AddShapedText(const TShapedText& shapedText, bool bSDF, const Vector2D& v2Position, const Vector4D& v4Color)
+{
+	// the whole string is one primitive
+	const GLint iTexture = FindTexture(TextureHandle(), BATCH_2D_TEXTURE_FONT_ATLAS | (bSDF ? BATCH_2D_TEXTURE_SDF : 0));
+	TPrimitive2D& primitive = BeginPrimitive(iTexture);
+
+	for (const TShapedGlyph& glyph : shapedText.m_vecGlyphs)
+	{
+		AddQuad(Vector4D(v2Position.x + glyph.m_v4Rect.x, v2Position.y + glyph.m_v4Rect.y, glyph.m_v4Rect.z, glyph.m_v4Rect.w), glyph.m_v4TexRect, v4Color, iTexture);
+	}
+
+	EndPrimitive(primitive);
+}
+
+void CBatch2D::AddText(FontHandle hFont, std::string_view svText, const Vector2D& v2Position, const Vector4D& v4Color)
+{
+	CFontAtlas& fontAtlas = CFontAtlas::Instance();
+	const TShapedText* pShapedText = fontAtlas.ShapeText(hFont, svText, m_ulFrameIndex);
+	if (pShapedText)
+	{
+		AddShapedText(*pShapedText, fontAtlas.IsSDF(hFont), v2Position, v4Color);
+	}
+}
+
+void CBatch2D::AddText(FontHandle hFont, std::string_view svText, EAlignment eAlignment, const Vector2D& v2Offset, const Vector4D& v4Color)
+{
+	CFontAtlas& fontAtlas = CFontAtlas::Instance();
+	const TShapedText* pShapedText = fontAtlas.ShapeText(hFont, svText, m_ulFrameIndex);
+	if (pShapedText)
+	{
+		const Vector4D v4Rect = Anchor(eAlignment, pShapedText->m_v2Size, v2Offset);
+		AddShapedText(*pShapedText, fontAtlas.IsSDF(hFont), Vector2D(v4Rect.x, v4Rect.y), v4Color);
+	}
+}
+
+Vector2D CBatch2D::MeasureText(FontHandle hFont, std::string_view svText)
+{
+	const TShapedText* pShapedText = CFontAtlas::Instance().ShapeText(hFont, svText, m_ulFrameIndex);
+	return (pShapedText ? pShapedText->m_v2Size : Vector2D(0.0f, 0.0f));
+}
+
+void CBatch2D::End(TBatch2D& batch)
+{
+	batch.m_meshData.vVertices.clear();
+	batch.m_meshData.vIndices.clear();
+	batch.m_vecTextures.assign(m_vecTextures.begin(), m_vecTextures.end());
+	batch.m_vecDraws.clear();
+
+	// stable, equal keys keep the order they were added in
+	m_vecOrder.resize(m_vecPrimitives.size());
+	for (size_t i = 0; i < m_vecOrder.size(); i++)
+	{
+		m_vecOrder[i] = static_cast<GLuint>(i);
+	}
+
+	std::stable_sort(m_vecOrder.begin(), m_vecOrder.end(), [this](GLuint uiLeft, GLuint uiRight)
+	{
+		const TPrimitive2D& left = m_vecPrimitives[uiLeft];
+		const TPrimitive2D& right = m_vecPrimitives[uiRight];
+		if (left.m_iLayer != right.m_iLayer)
+		{
+			return (left.m_iLayer < right.m_iLayer);
+		}
+		if (left.m_iClip != right.m_iClip)
+		{
+			return (left.m_iClip < right.m_iClip);
+		}
+		return (left.m_iTexture < right.m_iTexture);
+	});
+
+	TDraw2D* pDraw = nullptr;
+	GLint iDrawClip = -1;
+	for (GLuint uiPrimitive : m_vecOrder)
+	{
+		const TPrimitive2D& primitive = m_vecPrimitives[uiPrimitive];
+
+		// the slot of the texture in the current draw, a new draw when it is full
+		GLint iSlot = BATCH_2D_UNTEXTURED;
+		if (pDraw && primitive.m_iClip == iDrawClip && primitive.m_iTexture != BATCH_2D_UNTEXTURED)
+		{
+			const auto itSlot = std::find(pDraw->m_arrTextures.begin(), pDraw->m_arrTextures.end(), primitive.m_iTexture);
+			const auto itFree = std::find(pDraw->m_arrTextures.begin(), pDraw->m_arrTextures.end(), BATCH_2D_UNTEXTURED);
+			if (itSlot != pDraw->m_arrTextures.end())
+			{
+				iSlot = static_cast<GLint>(itSlot - pDraw->m_arrTextures.begin());
+			}
+			else if (itFree != pDraw->m_arrTextures.end())
+			{
+				iSlot = static_cast<GLint>(itFree - pDraw->m_arrTextures.begin());
+				*itFree = primitive.m_iTexture;
+			}
+			else
+			{
+				pDraw = nullptr;
+			}
+		}
+
+		if (pDraw == nullptr || primitive.m_iClip != iDrawClip)
+		{
+			// an empty clip rectangle hides everything in it
+			const Vector4D& v4Clip = m_vecClipRects[primitive.m_iClip];
+			if (v4Clip.z <= 0.0f || v4Clip.w <= 0.0f)
+			{
+				continue;
+			}
+
+			TDraw2D draw;
+			draw.m_uiFirstIndex = static_cast<GLuint>(batch.m_meshData.vIndices.size());
+			draw.m_uiIndexCount = 0;
+			draw.m_v4ClipRect = v4Clip;
+			draw.m_arrTextures.fill(BATCH_2D_UNTEXTURED);
+			if (primitive.m_iTexture != BATCH_2D_UNTEXTURED)
+			{
+				draw.m_arrTextures[0] = primitive.m_iTexture;
+				iSlot = 0;
+			}
+
+			batch.m_vecDraws.push_back(draw);
+			pDraw = &batch.m_vecDraws.back();
+			iDrawClip = primitive.m_iClip;
+		}
+
+		// vertices select the slot of their draw, indices point into the frame's vertices
+		const GLuint uiBaseVertex = static_cast<GLuint>(batch.m_meshData.vVertices.size());
+		const GLuint uiVertexEnd = primitive.m_uiFirstVertex + primitive.m_uiVertexCount;
+		for (GLuint uiVertex = primitive.m_uiFirstVertex; uiVertex < uiVertexEnd; uiVertex++)
+		{
+			SVertex2D vertex = m_meshData.vVertices[uiVertex];
+			vertex.iTextureIndex = iSlot;
+			batch.m_meshData.vVertices.push_back(vertex);
+		}
+
+		for (GLuint uiIndex = 0; uiIndex < primitive.m_uiIndexCount; uiIndex++)
+		{
+			batch.m_meshData.vIndices.push_back(uiBaseVertex + m_meshData.vIndices[primitive.m_uiFirstIndex + uiIndex]);
+		}
+
+		pDraw->m_uiIndexCount += primitive.m_uiIndexCount;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <string_view>
+#include <vector>
+#include <EngineEnums.hpp>
+#include <EngineTypes.hpp>
+#include "FramePacket.h"
+#include "FontAtlas.h"
+
+/**
+ * Immediate mode 2D drawing, HUD and overlays are rebuilt every frame.
+ *
+ * Quads, lines, meshes and text are recorded between Begin() and End() in
+ * pixels from the top left of the viewport. Every call becomes one primitive
+ * keeping the layer and clip rectangle current at the time, End() sorts them
+ * by layer, clip rectangle and texture and merges them into as few draws as
+ * possible: a draw only ends when the clip rectangle changes or it would
+ * sample more than BATCH_2D_TEXTURE_SLOTS textures. Submission order is kept
+ * among equal keys, overlapping primitives with different textures go on
+ * different layers.
+ *
+ * Text is shaped through CFontAtlas and needs it to exist. Main thread only.
+ */
+class CBatch2D
+{
+public:
+	CBatch2D();
+
+	void Begin(GLint iViewportWidth, GLint iViewportHeight, GLuint64 ulFrameIndex);
+
+	/**
+	 * Sorts what was recorded into the packet batch.
+	 */
+	void End(TBatch2D& batch);
+
+	/**
+	 * Primitives on a higher layer are drawn over lower ones, 0 after Begin().
+	 */
+	void SetLayer(GLint iLayer);
+
+	/**
+	 * Clips the following primitives to the rectangle, intersected with the
+	 * current one. It also becomes the container Anchor() aligns in.
+	 */
+	void PushClipRect(const Vector4D& v4Rect);
+	void PopClipRect();
+
+	/**
+	 * Places an item of the given size in the current clip rectangle, the
+	 * viewport without one. The offset is added afterwards, negative values
+	 * move an item anchored to the right or bottom inwards.
+	 *
+	 * ALIGN_CENTERED_HORIZONTAL keeps the item at the top, ALIGN_CENTERED_VERTICAL at the left.
+	 *
+	 * @return x, y, width, height
+	 */
+	Vector4D Anchor(EAlignment eAlignment, const Vector2D& v2Size, const Vector2D& v2Offset) const;
+
+	void AddRect(const Vector4D& v4Rect, const Vector4D& v4Color);
+	void AddTexturedRect(const Vector4D& v4Rect, TextureHandle hTexture, const Vector4D& v4TexRect, const Vector4D& v4Color);
+	void AddLine(const Vector2D& v2From, const Vector2D& v2To, GLfloat fWidth, const Vector4D& v4Color);
+
+	/**
+	 * Triangles with positions in pixels, iTextureIndex of the vertices is
+	 * ignored, the whole mesh samples hTexture or nothing.
+	 */
+	void AddMesh(const SMeshData2D& meshData, TextureHandle hTexture);
+
+	/**
+	 * @param v2Position Top left of the first line
+	 */
+	void AddText(FontHandle hFont, std::string_view svText, const Vector2D& v2Position, const Vector4D& v4Color);
+	void AddText(FontHandle hFont, std::string_view svText, EAlignment eAlignment, const Vector2D& v2Offset, const Vector4D& v4Color);
+
+	/**
+	 * Size of the text in pixels, the layout is cached and reused when the
+	 * text is added in the same frame.
+	 */
+	Vector2D MeasureText(FontHandle hFont, std::string_view svText);
+
+protected:
+	typedef struct SPrimitive2D
+	{
+		GLint m_iLayer;
+		GLint m_iClip;			// into m_vecClipRects
+		GLint m_iTexture;		// into m_vecTextures, BATCH_2D_UNTEXTURED for plain color
+		GLuint m_uiFirstVertex;	// into m_meshData
+		GLuint m_uiVertexCount;
+		GLuint m_uiFirstIndex;
+		GLuint m_uiIndexCount;
+	} TPrimitive2D;
+
+	/**
+	 * Starts a primitive of the current layer and clip rectangle, its
+	 * vertices and indices are appended to m_meshData afterwards.
+	 */
+	TPrimitive2D& BeginPrimitive(GLint iTexture);
+	void EndPrimitive(TPrimitive2D& primitive);
+
+	GLint FindTexture(TextureHandle hTexture, GLuint uiFlags);
+	void AddQuad(const Vector4D& v4Rect, const Vector4D& v4TexRect, const Vector4D& v4Color, GLint iTexture);
+	void AddShapedText(const TShapedText& shapedText, bool bSDF, const Vector2D& v2Position, const Vector4D& v4Color);
+
+private:
+	GLint m_iViewportWidth;
+	GLint m_iViewportHeight;
+	GLuint64 m_ulFrameIndex;
+	GLint m_iLayer;
+
+	// x, y, width, height, entry 0 is the viewport
+	std::vector<Vector4D> m_vecClipRects;
+	std::vector<GLint> m_vecClipStack;
+
+	// recorded this frame, reused to avoid allocations
+	std::vector<TPrimitive2D> m_vecPrimitives;
+	std::vector<GLuint> m_vecOrder;
+	SMeshData2D m_meshData;
+	std::vector<TTexture2D> m_vecTextures;
+};
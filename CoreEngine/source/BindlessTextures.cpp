@@ -0,0 +1,331 @@
+#include "BindlessTextures.h"
+#include "GLResourceManager.h"
+#include "TextureManager.h"
+#include "Shader.h"
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+
+CBindlessTextures::CBindlessTextures()
+{
+	m_ulResidentBytes = 0;
+	m_uiTableBuffer = 0;
+	m_uiPlaceholder = 0;
+	m_ulPlaceholderHandle = 0;
+	m_bIsSupported = false;
+	m_stats = TBindlessStats{};
+}
+
+CBindlessTextures::~CBindlessTextures()
+{
+	Destroy();
+}
+
+bool CBindlessTextures::Initialize()
+{
+	Destroy();
+
+	// materials work without the extension, their IDs are just never sampled
+	m_poolMaterials.Initialize(BINDLESS_MAX_MATERIALS);
+	m_hDefaultMaterial = m_poolMaterials.Create(TBindlessMaterial{ TextureHandle() });
+
+	if (GLAD_GL_ARB_bindless_texture == 0)
+	{
+		syswarn("GL_ARB_bindless_texture is not supported, materials fall back to bound textures");
+		return (false);
+	}
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hTableBuffer = resourceManager.CreateBuffer(static_cast<GLsizeiptr>(BINDLESS_MAX_MATERIALS) * sizeof(GLuint64), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	const TBufferResource* pTableBuffer = resourceManager.GetBuffer(m_hTableBuffer);
+	if (pTableBuffer == nullptr)
+	{
+		syserr("Failed to create the bindless texture table");
+		Destroy();
+		return (false);
+	}
+
+	m_uiTableBuffer = pTableBuffer->m_uiBuffer;
+
+	// shared by every entry without a resident texture, never evicted
+	m_uiPlaceholder = CTextureManager::Instance().GetPlaceholder();
+	m_ulPlaceholderHandle = glGetTextureHandleARB(m_uiPlaceholder);
+	glMakeTextureHandleResidentARB(m_ulPlaceholderHandle);
+
+	m_vecIsUsed.assign(BINDLESS_MAX_MATERIALS, false);
+	m_vecTable.assign(BINDLESS_MAX_MATERIALS, m_ulPlaceholderHandle);
+	m_vecNextTable.assign(BINDLESS_MAX_MATERIALS, m_ulPlaceholderHandle);
+	glNamedBufferSubData(m_uiTableBuffer, 0, static_cast<GLsizeiptr>(m_vecTable.size() * sizeof(GLuint64)), m_vecTable.data());
+
+	m_bIsSupported = true;
+	return (true);
+}
+
+void CBindlessTextures::Destroy()
+{
+	// before the texture manager, the handles die with their textures
+	for (std::pair<const GLuint, TResidentTexture>& entry : m_mapTextures)
+	{
+		if (entry.second.m_bIsResident)
+		{
+			glMakeTextureHandleNonResidentARB(entry.second.m_ulHandle);
+		}
+	}
+	m_mapTextures.clear();
+	m_ulResidentBytes = 0;
+
+	if (m_ulPlaceholderHandle)
+	{
+		glMakeTextureHandleNonResidentARB(m_ulPlaceholderHandle);
+		m_ulPlaceholderHandle = 0;
+	}
+	m_uiPlaceholder = 0;
+
+	if (m_hTableBuffer.IsValid())
+	{
+		CGLResourceManager::Instance().DestroyBuffer(m_hTableBuffer);
+		m_hTableBuffer = BufferHandle();
+	}
+	m_uiTableBuffer = 0;
+
+	m_vecIsUsed.clear();
+	m_vecTable.clear();
+	m_vecNextTable.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexMaterials);
+		m_poolMaterials.Destroy();
+		m_hDefaultMaterial = MaterialHandle();
+		m_stats = TBindlessStats{};
+	}
+
+	m_bIsSupported = false;
+}
+
+bool CBindlessTextures::IsSupported() const
+{
+	return (m_bIsSupported);
+}
+
+MaterialHandle CBindlessTextures::CreateMaterial(TextureHandle hAlbedo)
+{
+	std::lock_guard<std::mutex> lock(m_mutexMaterials);
+
+	const MaterialHandle hMaterial = m_poolMaterials.Create(TBindlessMaterial{ hAlbedo });
+	if (hMaterial.IsValid() == false)
+	{
+		syserr("Material table is full");
+	}
+
+	return (hMaterial);
+}
+
+void CBindlessTextures::DestroyMaterial(MaterialHandle hMaterial)
+{
+	std::lock_guard<std::mutex> lock(m_mutexMaterials);
+
+	// draws still in flight keep the ID, Update() points it back at the placeholder
+	if (hMaterial != m_hDefaultMaterial)
+	{
+		m_poolMaterials.Remove(hMaterial);
+	}
+}
+
+GLuint CBindlessTextures::GetMaterialID(MaterialHandle hMaterial) const
+{
+	std::lock_guard<std::mutex> lock(m_mutexMaterials);
+
+	return m_poolMaterials.IsAlive(hMaterial) ? hMaterial.m_uiIndex : m_hDefaultMaterial.m_uiIndex;
+}
+
+void CBindlessTextures::Update(const TArenaVector<GLuint>& vecUsedMaterials, GLuint64 ulFrameIndex)
+{
+	ANUBIS_ZONE("BindlessTextures::Update");
+
+	if (m_bIsSupported == false)
+	{
+		return;
+	}
+
+	CTextureManager& textureManager = CTextureManager::Instance();
+	std::lock_guard<std::mutex> lock(m_mutexMaterials);
+
+	std::fill(m_vecIsUsed.begin(), m_vecIsUsed.end(), false);
+	for (GLuint uiMaterial : vecUsedMaterials)
+	{
+		if (uiMaterial < BINDLESS_MAX_MATERIALS)
+		{
+			m_vecIsUsed[uiMaterial] = true;
+		}
+	}
+
+	for (std::pair<const GLuint, TResidentTexture>& entry : m_mapTextures)
+	{
+		entry.second.m_bIsReferenced = false;
+	}
+
+	// handles for finished textures, the frame's textures have to be resident
+	m_poolMaterials.ForEach([&](MaterialHandle hMaterial, TBindlessMaterial& material)
+	{
+		const GLuint uiTexture = textureManager.GetTexture(material.m_hAlbedo);
+		if (uiTexture == m_uiPlaceholder)
+		{
+			return;
+		}
+
+		std::unordered_map<GLuint, TResidentTexture>::iterator it = m_mapTextures.find(uiTexture);
+		if (it == m_mapTextures.end() || it->second.m_hTexture != material.m_hAlbedo)
+		{
+			// a reused name is a new texture, the old handle died with the old one
+			if (it != m_mapTextures.end() && it->second.m_bIsResident)
+			{
+				m_ulResidentBytes -= it->second.m_ulBytes;
+			}
+
+			TResidentTexture texture{};
+			texture.m_hTexture = material.m_hAlbedo;
+			texture.m_ulHandle = glGetTextureHandleARB(uiTexture);
+			texture.m_ulBytes = textureManager.GetMemorySize(material.m_hAlbedo);
+			texture.m_ulLastUsedFrame = ulFrameIndex;
+			it = m_mapTextures.insert_or_assign(uiTexture, texture).first;
+		}
+
+		TResidentTexture& texture = it->second;
+		texture.m_bIsReferenced = true;
+
+		if (m_vecIsUsed[hMaterial.m_uiIndex])
+		{
+			texture.m_ulLastUsedFrame = ulFrameIndex;
+			MakeResident(texture);
+		}
+	});
+
+	// textures no material samples any more are forgotten, idle ones evicted
+	std::vector<TResidentTexture*> vecEvictable;
+	for (std::unordered_map<GLuint, TResidentTexture>::iterator it = m_mapTextures.begin(); it != m_mapTextures.end();)
+	{
+		TResidentTexture& texture = it->second;
+		if (texture.m_bIsReferenced == false)
+		{
+			// a destroyed texture took its residency with it
+			if (textureManager.GetState(texture.m_hTexture) == ETextureState::TEXTURE_STATE_LOAD_COMPLETE)
+			{
+				MakeNonResident(texture);
+			}
+			else if (texture.m_bIsResident)
+			{
+				m_ulResidentBytes -= texture.m_ulBytes;
+			}
+
+			it = m_mapTextures.erase(it);
+			continue;
+		}
+
+		if (texture.m_ulLastUsedFrame + BINDLESS_IDLE_FRAMES < ulFrameIndex)
+		{
+			MakeNonResident(texture);
+		}
+		else if (texture.m_bIsResident && texture.m_ulLastUsedFrame < ulFrameIndex)
+		{
+			vecEvictable.push_back(&texture);
+		}
+
+		++it;
+	}
+
+	// over budget, the least recently used go first, the frame's textures stay
+	if (m_ulResidentBytes > BINDLESS_VRAM_BUDGET)
+	{
+		std::sort(vecEvictable.begin(), vecEvictable.end(), [](const TResidentTexture* pLeft, const TResidentTexture* pRight) { return (pLeft->m_ulLastUsedFrame < pRight->m_ulLastUsedFrame); });
+
+		for (TResidentTexture* pTexture : vecEvictable)
+		{
+			if (m_ulResidentBytes <= BINDLESS_VRAM_BUDGET)
+			{
+				break;
+			}
+
+			MakeNonResident(*pTexture);
+		}
+	}
+
+	// destroyed materials and non resident textures read the placeholder
+	std::fill(m_vecNextTable.begin(), m_vecNextTable.end(), m_ulPlaceholderHandle);
+	m_poolMaterials.ForEach([&](MaterialHandle hMaterial, TBindlessMaterial& material)
+	{
+		std::unordered_map<GLuint, TResidentTexture>::const_iterator it = m_mapTextures.find(textureManager.GetTexture(material.m_hAlbedo));
+		if (it != m_mapTextures.end() && it->second.m_bIsResident)
+		{
+			m_vecNextTable[hMaterial.m_uiIndex] = it->second.m_ulHandle;
+		}
+	});
+
+	GLint iFirstChanged = BINDLESS_MAX_MATERIALS;
+	GLint iLastChanged = -1;
+	for (GLint i = 0; i < BINDLESS_MAX_MATERIALS; i++)
+	{
+		if (m_vecNextTable[i] != m_vecTable[i])
+		{
+			m_vecTable[i] = m_vecNextTable[i];
+			iFirstChanged = std::min(iFirstChanged, i);
+			iLastChanged = i;
+		}
+	}
+
+	// ordered with the draws that read it, no barrier needed
+	if (iLastChanged >= 0)
+	{
+		glNamedBufferSubData(m_uiTableBuffer, static_cast<GLintptr>(iFirstChanged * sizeof(GLuint64)), static_cast<GLsizeiptr>((iLastChanged - iFirstChanged + 1) * sizeof(GLuint64)), m_vecTable.data() + iFirstChanged);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDLESS_TABLE_BINDING, m_uiTableBuffer);
+
+	m_stats.m_uiMaterials = m_poolMaterials.GetAliveCount();
+	m_stats.m_uiTextures = static_cast<GLuint>(m_mapTextures.size());
+	m_stats.m_uiResidentTextures = static_cast<GLuint>(std::count_if(m_mapTextures.begin(), m_mapTextures.end(), [](const std::pair<const GLuint, TResidentTexture>& entry) { return (entry.second.m_bIsResident); }));
+	m_stats.m_ulResidentBytes = m_ulResidentBytes;
+}
+
+void CBindlessTextures::SetupShader(const CShader& shader, TextureHandle hFallback) const
+{
+	// the table itself is bound by Update()
+	if (m_bIsSupported)
+	{
+		shader.SetBool("bindlessTextures", true);
+		return;
+	}
+
+	shader.SetInt("albedoTexture", TEXTURE_ALBEDO_UNIT);
+	CTextureManager::Instance().Bind(hFallback, TEXTURE_ALBEDO_UNIT);
+}
+
+TBindlessStats CBindlessTextures::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutexMaterials);
+	return (m_stats);
+}
+
+void CBindlessTextures::MakeResident(TResidentTexture& texture)
+{
+	if (texture.m_bIsResident)
+	{
+		return;
+	}
+
+	glMakeTextureHandleResidentARB(texture.m_ulHandle);
+	texture.m_bIsResident = true;
+	m_ulResidentBytes += texture.m_ulBytes;
+}
+
+void CBindlessTextures::MakeNonResident(TResidentTexture& texture)
+{
+	if (texture.m_bIsResident == false)
+	{
+		return;
+	}
+
+	glMakeTextureHandleNonResidentARB(texture.m_ulHandle);
+	texture.m_bIsResident = false;
+	m_ulResidentBytes -= texture.m_ulBytes;
+}
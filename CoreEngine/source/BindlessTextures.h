@@ -0,0 +1,136 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <singleton.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "ResourcePool.h"
+#include "LinearAllocator.h"
+
+class CShader;
+
+enum EBindlessTextureData
+{
+	BINDLESS_MAX_MATERIALS = 1024,
+
+	// Shader storage binding of the handle table, see shader.frag
+	BINDLESS_TABLE_BINDING = 7,
+
+	// Resident texture memory, textures not drawn this frame are evicted
+	// least recently used first once it is exceeded
+	BINDLESS_VRAM_BUDGET = 256 * 1024 * 1024,
+
+	// Frames a texture stays resident after its last draw
+	BINDLESS_IDLE_FRAMES = 120,
+};
+
+struct SMaterialTag;
+typedef THandle<SMaterialTag> MaterialHandle;
+
+typedef struct SBindlessMaterial
+{
+	TextureHandle m_hAlbedo;	// sampled through the handle table at the material ID
+} TBindlessMaterial;
+
+typedef struct SBindlessStats
+{
+	GLuint m_uiMaterials;
+	GLuint m_uiTextures;			// with a handle
+	GLuint m_uiResidentTextures;
+	GLuint64 m_ulResidentBytes;
+} TBindlessStats;
+
+/**
+ * Bindless texture handles published in an SSBO indexed by material ID.
+ *
+ * A material ID is the index of its handle, written into TIndirectDrawData so
+ * draws with different textures share one multi draw. Update() gets a handle
+ * with glGetTextureHandleARB once the texture manager finished the texture,
+ * makes the textures of the frame's materials resident and evicts the ones
+ * idle for BINDLESS_IDLE_FRAMES or, past the VRAM budget, the least recently
+ * used. Entries of non resident textures point at the placeholder handle,
+ * which is always resident, so the shader never samples an invalid handle.
+ *
+ * Materials are created and destroyed from any thread, Initialize(),
+ * Destroy() and Update() need the GL context.
+ */
+class CBindlessTextures : public CSingleton<CBindlessTextures>
+{
+public:
+	CBindlessTextures();
+	~CBindlessTextures();
+
+	CBindlessTextures(const CBindlessTextures&) = delete;
+	CBindlessTextures& operator=(const CBindlessTextures&) = delete;
+
+	/**
+	 * @return false without GL_ARB_bindless_texture, shaders then sample the
+	 * texture bound to TEXTURE_ALBEDO_UNIT
+	 */
+	bool Initialize();
+	void Destroy();
+
+	bool IsSupported() const;
+
+	/**
+	 * @return Invalid handle if the table is full
+	 */
+	MaterialHandle CreateMaterial(TextureHandle hAlbedo);
+	void DestroyMaterial(MaterialHandle hMaterial);
+
+	/**
+	 * ID stored in the draw data, the untextured default material for
+	 * invalid handles.
+	 */
+	GLuint GetMaterialID(MaterialHandle hMaterial) const;
+
+	/**
+	 * Makes the textures of vecUsedMaterials resident, evicts and refreshes
+	 * the table, then binds it to BINDLESS_TABLE_BINDING.
+	 */
+	void Update(const TArenaVector<GLuint>& vecUsedMaterials, GLuint64 ulFrameIndex);
+
+	/**
+	 * Switches shader.frag to the table, or binds hFallback to
+	 * TEXTURE_ALBEDO_UNIT when bindless textures are not available.
+	 */
+	void SetupShader(const CShader& shader, TextureHandle hFallback) const;
+
+	TBindlessStats GetStats() const;
+
+protected:
+	typedef struct SResidentTexture
+	{
+		TextureHandle m_hTexture;	// a GL name reused by another texture gets a new entry
+		GLuint64 m_ulHandle;
+		GLuint64 m_ulBytes;
+		GLuint64 m_ulLastUsedFrame;
+		bool m_bIsResident;
+		bool m_bIsReferenced;		// by a material this frame
+	} TResidentTexture;
+
+	void MakeResident(TResidentTexture& texture);
+	void MakeNonResident(TResidentTexture& texture);
+
+private:
+	mutable std::mutex m_mutexMaterials;
+	TResourcePool<TBindlessMaterial, MaterialHandle> m_poolMaterials;
+	MaterialHandle m_hDefaultMaterial;	// ID 0, untextured draws
+
+	// Render thread only, keyed by GL texture name
+	std::unordered_map<GLuint, TResidentTexture> m_mapTextures;
+	GLuint64 m_ulResidentBytes;
+
+	// Handle per material ID, mirrored to the SSBO when an entry changes
+	std::vector<bool> m_vecIsUsed;
+	std::vector<GLuint64> m_vecTable;
+	std::vector<GLuint64> m_vecNextTable;
+	BufferHandle m_hTableBuffer;
+	GLuint m_uiTableBuffer;
+
+	GLuint m_uiPlaceholder;
+	GLuint64 m_ulPlaceholderHandle;
+	bool m_bIsSupported;
+	TBindlessStats m_stats;		// of the last Update()
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Fixed capacity FIFO queue shared between two threads.
+ * The lock is only held while an element is pushed or popped, never while
+ * the element itself is being worked on, so producer and consumer can run
+ * in parallel as long as the queue is neither full nor empty.
+ */
+template <typename T, size_t N> class TBoundedQueue
+{
+public:
+	TBoundedQueue()
+	{
+		m_stHead = 0;
+		m_stTail = 0;
+		m_stCount = 0;
+		m_bIsClosed = false;
+	}
+
+	/**
+	 * Pushes an element, blocks while the queue is full.
+	 *
+	 * @return false if the queue was closed while waiting
+	 */
+	bool Push(const T& value)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvNotFull.wait(lock, [this]() { return (m_stCount < N) || m_bIsClosed; });
+
+		if (m_bIsClosed)
+		{
+			return (false);
+		}
+
+		m_arrElements[m_stTail] = value;
+		m_stTail = (m_stTail + 1) % N;
+		m_stCount++;
+
+		lock.unlock();
+		m_cvNotEmpty.notify_one();
+		return (true);
+	}
+
+	/**
+	 * Pops the oldest element, blocks while the queue is empty.
+	 *
+	 * @return false if the queue was closed and nothing is left to pop
+	 */
+	bool Pop(T& value)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cvNotEmpty.wait(lock, [this]() { return (m_stCount > 0) || m_bIsClosed; });
+
+		if (m_stCount == 0)
+		{
+			return (false);
+		}
+
+		value = m_arrElements[m_stHead];
+		m_stHead = (m_stHead + 1) % N;
+		m_stCount--;
+
+		lock.unlock();
+		m_cvNotFull.notify_one();
+		return (true);
+	}
+
+	/**
+	 * Pops the oldest element without waiting.
+	 *
+	 * @return false if the queue is empty
+	 */
+	bool TryPop(T& value)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_stCount == 0)
+		{
+			return (false);
+		}
+
+		value = m_arrElements[m_stHead];
+		m_stHead = (m_stHead + 1) % N;
+		m_stCount--;
+
+		lock.unlock();
+		m_cvNotFull.notify_one();
+		return (true);
+	}
+
+	/**
+	 * Wakes up every waiting thread, further pushes fail and pops only drain
+	 * what is left in the queue.
+	 */
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bIsClosed = true;
+		}
+
+		m_cvNotEmpty.notify_all();
+		m_cvNotFull.notify_all();
+	}
+
+	/**
+	 * Reopens a closed queue and drops its content.
+	 */
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stHead = 0;
+		m_stTail = 0;
+		m_stCount = 0;
+		m_bIsClosed = false;
+	}
+
+	size_t GetCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return (m_stCount);
+	}
+
+private:
+	std::array<T, N> m_arrElements;
+	size_t m_stHead;
+	size_t m_stTail;
+	size_t m_stCount;
+	bool m_bIsClosed;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cvNotEmpty;
+	std::condition_variable m_cvNotFull;
+};
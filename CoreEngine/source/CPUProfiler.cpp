@@ -0,0 +1,342 @@
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+std::atomic<bool> CCPUProfiler::ms_bIsEnabled = false;
+
+static thread_local CZoneEventRing* tl_pZoneRing = nullptr;
+
+/*
+ * CZoneEventRing
+ */
+CZoneEventRing::CZoneEventRing(GLuint uiThreadIndex, const char* szThreadName)
+{
+	m_ulHead = 0;
+	m_ulCachedTail = 0;
+	m_ulTail = 0;
+	m_ulDropped = 0;
+	m_uiThreadIndex = uiThreadIndex;
+
+	SetName(szThreadName);
+}
+
+void CZoneEventRing::Drain(std::vector<TZoneEvent>* pVecEvents)
+{
+	const uint64_t ulHead = m_ulHead.load(std::memory_order_acquire);
+	const uint64_t ulTail = m_ulTail.load(std::memory_order_relaxed);
+
+	if (pVecEvents)
+	{
+		for (uint64_t ulIndex = ulTail; ulIndex < ulHead; ulIndex++)
+		{
+			pVecEvents->push_back(m_arrEvents[ulIndex & (CPU_PROFILER_RING_SIZE - 1)]);
+		}
+	}
+
+	m_ulTail.store(ulHead, std::memory_order_release);
+}
+
+void CZoneEventRing::SetName(const char* szThreadName)
+{
+	snprintf(m_szName, sizeof(m_szName), "%s", szThreadName);
+}
+
+const char* CZoneEventRing::GetName() const
+{
+	return (m_szName);
+}
+
+GLuint CZoneEventRing::GetThreadIndex() const
+{
+	return (m_uiThreadIndex);
+}
+
+uint64_t CZoneEventRing::GetDroppedCount() const
+{
+	return (m_ulDropped.load(std::memory_order_relaxed));
+}
+
+/*
+ * CCPUProfiler
+ */
+CCPUProfiler::CCPUProfiler()
+{
+	m_bIsCapturing = false;
+	m_ulCaptureStart = 0;
+	m_ulCalibrationTicks = 0;
+}
+
+CCPUProfiler::~CCPUProfiler()
+{
+	Destroy();
+}
+
+void CCPUProfiler::Initialize()
+{
+	m_ulCalibrationTicks = GetTimestamp();
+	m_calibrationTime = std::chrono::steady_clock::now();
+
+	ms_bIsEnabled = true;
+}
+
+void CCPUProfiler::Destroy()
+{
+	if (ms_bIsEnabled == false)
+	{
+		return;
+	}
+
+	ms_bIsEnabled = false;
+
+	std::lock_guard<std::mutex> lock(m_mutexThreads);
+
+	uint64_t ulDropped = 0;
+	for (const std::unique_ptr<CZoneEventRing>& pRing : m_vecRings)
+	{
+		ulDropped += pRing->GetDroppedCount();
+	}
+
+	if (ulDropped > 0)
+	{
+		syslog("CPU profiler dropped %llu zones, rings were not collected often enough", static_cast<unsigned long long>(ulDropped));
+	}
+
+	// thread_local ring pointers of exited threads are gone already, the
+	// remaining ones are never used again once profiling is disabled
+	m_vecCaptures.clear();
+}
+
+CZoneEventRing* CCPUProfiler::GetThreadRing()
+{
+	if (tl_pZoneRing == nullptr && IsEnabled())
+	{
+		tl_pZoneRing = Instance().RegisterThread();
+	}
+
+	return (tl_pZoneRing);
+}
+
+void CCPUProfiler::SetThreadName(const char* szThreadName)
+{
+	CZoneEventRing* pRing = GetThreadRing();
+	if (pRing)
+	{
+		pRing->SetName(szThreadName);
+	}
+}
+
+CZoneEventRing* CCPUProfiler::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(m_mutexThreads);
+
+	const GLuint uiThreadIndex = static_cast<GLuint>(m_vecRings.size());
+
+	char szName[CPU_PROFILER_THREAD_NAME_MAX];
+	snprintf(szName, sizeof(szName), "Thread %u", uiThreadIndex);
+
+	m_vecRings.push_back(std::make_unique<CZoneEventRing>(uiThreadIndex, szName));
+	m_vecCaptures.push_back(TThreadCapture{ m_vecRings.back().get(), {} });
+
+	return (m_vecRings.back().get());
+}
+
+void CCPUProfiler::Collect()
+{
+	std::lock_guard<std::mutex> lock(m_mutexThreads);
+
+	for (TThreadCapture& capture : m_vecCaptures)
+	{
+		capture.m_pRing->Drain(m_bIsCapturing ? &capture.m_vecEvents : nullptr);
+	}
+}
+
+void CCPUProfiler::StartCapture()
+{
+	// events recorded before the capture started are not part of it
+	Collect();
+
+	std::lock_guard<std::mutex> lock(m_mutexThreads);
+	for (TThreadCapture& capture : m_vecCaptures)
+	{
+		capture.m_vecEvents.clear();
+	}
+
+	m_ulCaptureStart = GetTimestamp();
+	m_bIsCapturing = true;
+
+	syslog("CPU profiler capture started");
+}
+
+bool CCPUProfiler::StopCapture(const std::string& stPath, ETraceFormat eFormat)
+{
+	if (m_bIsCapturing == false)
+	{
+		return (false);
+	}
+
+	Collect();
+	m_bIsCapturing = false;
+
+	std::lock_guard<std::mutex> lock(m_mutexThreads);
+
+	// zones open when the capture started (the frame that pressed F3, jobs on
+	// other threads) begin before it, they are cut at the capture start
+	size_t stEventCount = 0;
+	for (TThreadCapture& capture : m_vecCaptures)
+	{
+		std::vector<TZoneEvent>& vecEvents = capture.m_vecEvents;
+		vecEvents.erase(std::remove_if(vecEvents.begin(), vecEvents.end(), [this](const TZoneEvent& event) { return (event.m_ulEnd < m_ulCaptureStart); }), vecEvents.end());
+
+		for (TZoneEvent& event : vecEvents)
+		{
+			event.m_ulBegin = std::max(event.m_ulBegin, m_ulCaptureStart);
+		}
+
+		stEventCount += vecEvents.size();
+	}
+
+	if (stEventCount == 0)
+	{
+		syserr("CPU profiler capture is empty");
+		return (false);
+	}
+
+	const bool bSucceeded = (eFormat == TRACE_FORMAT_BINARY) ? WriteBinary(stPath) : WriteChromeTrace(stPath);
+	if (bSucceeded)
+	{
+		syslog("CPU profiler wrote %zu zones to %s", stEventCount, stPath.c_str());
+	}
+
+	for (TThreadCapture& capture : m_vecCaptures)
+	{
+		capture.m_vecEvents.clear();
+		capture.m_vecEvents.shrink_to_fit();
+	}
+
+	return (bSucceeded);
+}
+
+bool CCPUProfiler::IsCapturing() const
+{
+	return (m_bIsCapturing);
+}
+
+bool CCPUProfiler::WriteChromeTrace(const std::string& stPath) const
+{
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	const GLdouble dTicksPerMicrosecond = GetTickFrequency();
+
+	// complete events ("X"), timestamps in microseconds from the capture start
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+	bool bFirst = true;
+	for (const TThreadCapture& capture : m_vecCaptures)
+	{
+		file << (bFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << capture.m_pRing->GetThreadIndex() << ",\"args\":{\"name\":\"" << capture.m_pRing->GetName() << "\"}}";
+		bFirst = false;
+
+		for (const TZoneEvent& event : capture.m_vecEvents)
+		{
+			const GLdouble dStart = static_cast<GLdouble>(event.m_ulBegin - m_ulCaptureStart) / dTicksPerMicrosecond;
+			const GLdouble dDuration = static_cast<GLdouble>(event.m_ulEnd - event.m_ulBegin) / dTicksPerMicrosecond;
+
+			file << ",\n{\"name\":\"" << event.m_szName << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << capture.m_pRing->GetThreadIndex() << ",\"ts\":" << dStart << ",\"dur\":" << dDuration << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	return (file.good());
+}
+
+/**
+ * Layout, little endian:
+ *   char[4] "AZPF", uint32 version, double ticks per microsecond, uint64 capture start tick
+ *   uint32 name count, per name: uint32 length, chars
+ *   uint32 thread count, per thread: uint32 index, uint32 name length, chars,
+ *   uint64 event count, per event: uint32 name index, uint64 begin tick, uint64 end tick
+ */
+bool CCPUProfiler::WriteBinary(const std::string& stPath) const
+{
+	std::ofstream file(stPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	auto WriteValue = [&file](const auto& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	};
+
+	auto WriteString = [&file, &WriteValue](const char* szString)
+	{
+		const uint32_t uiLength = static_cast<uint32_t>(std::strlen(szString));
+		WriteValue(uiLength);
+		file.write(szString, uiLength);
+	};
+
+	// zone names are literals, identical pointers share one table entry
+	std::unordered_map<const char*, uint32_t> mNameIndices;
+	std::vector<const char*> vecNames;
+	for (const TThreadCapture& capture : m_vecCaptures)
+	{
+		for (const TZoneEvent& event : capture.m_vecEvents)
+		{
+			if (mNameIndices.emplace(event.m_szName, static_cast<uint32_t>(vecNames.size())).second)
+			{
+				vecNames.push_back(event.m_szName);
+			}
+		}
+	}
+
+	file.write("AZPF", 4);
+	WriteValue(static_cast<uint32_t>(1));
+	WriteValue(GetTickFrequency());
+	WriteValue(m_ulCaptureStart);
+
+	WriteValue(static_cast<uint32_t>(vecNames.size()));
+	for (const char* szName : vecNames)
+	{
+		WriteString(szName);
+	}
+
+	WriteValue(static_cast<uint32_t>(m_vecCaptures.size()));
+	for (const TThreadCapture& capture : m_vecCaptures)
+	{
+		WriteValue(static_cast<uint32_t>(capture.m_pRing->GetThreadIndex()));
+		WriteString(capture.m_pRing->GetName());
+		WriteValue(static_cast<uint64_t>(capture.m_vecEvents.size()));
+
+		for (const TZoneEvent& event : capture.m_vecEvents)
+		{
+			WriteValue(mNameIndices.at(event.m_szName));
+			WriteValue(event.m_ulBegin);
+			WriteValue(event.m_ulEnd);
+		}
+	}
+
+	return (file.good());
+}
+
+GLdouble CCPUProfiler::GetTickFrequency() const
+{
+	const uint64_t ulTicks = GetTimestamp() - m_ulCalibrationTicks;
+	const GLdouble dMicroseconds = std::chrono::duration<GLdouble, std::micro>(std::chrono::steady_clock::now() - m_calibrationTime).count();
+
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return (dMicroseconds > 0.0) ? static_cast<GLdouble>(ulTicks) / dMicroseconds : 1.0;
+#else
+	// steady_clock ticks already
+	return (static_cast<GLdouble>(std::chrono::steady_clock::period::den) / std::chrono::steady_clock::period::num / 1000000.0);
+#endif
+}
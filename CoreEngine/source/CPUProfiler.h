@@ -0,0 +1,232 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <singleton.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Zones cost two timestamps and a ring buffer write, define as 0 to compile them out
+#ifndef ANUBIS_PROFILE_ENABLED
+#define ANUBIS_PROFILE_ENABLED 1
+#endif
+
+enum ECPUProfilerData
+{
+	// Events buffered per thread between two collections, must be a power of two
+	CPU_PROFILER_RING_SIZE = 16384,
+
+	CPU_PROFILER_THREAD_NAME_MAX = 32,
+};
+
+enum ETraceFormat : GLubyte
+{
+	TRACE_FORMAT_CHROME_JSON,	// chrome://tracing, Perfetto
+	TRACE_FORMAT_BINARY,		// compact, see CCPUProfiler::WriteBinary
+};
+
+typedef struct SZoneEvent
+{
+	const char* m_szName;		// string literal, compared by pointer
+	uint64_t m_ulBegin;			// ticks
+	uint64_t m_ulEnd;
+} TZoneEvent;
+
+/**
+ * Single producer / single consumer ring of zone events.
+ * The owning thread pushes, the collector drains, neither ever blocks.
+ */
+class CZoneEventRing
+{
+public:
+	CZoneEventRing(GLuint uiThreadIndex, const char* szThreadName);
+
+	/**
+	 * @return false if the ring is full and the event was dropped
+	 */
+	bool Push(const TZoneEvent& event)
+	{
+		const uint64_t ulHead = m_ulHead.load(std::memory_order_relaxed);
+		if (ulHead - m_ulCachedTail >= CPU_PROFILER_RING_SIZE)
+		{
+			// refresh the collector position only when the ring looks full
+			m_ulCachedTail = m_ulTail.load(std::memory_order_acquire);
+			if (ulHead - m_ulCachedTail >= CPU_PROFILER_RING_SIZE)
+			{
+				m_ulDropped.fetch_add(1, std::memory_order_relaxed);
+				return (false);
+			}
+		}
+
+		m_arrEvents[ulHead & (CPU_PROFILER_RING_SIZE - 1)] = event;
+		m_ulHead.store(ulHead + 1, std::memory_order_release);
+		return (true);
+	}
+
+	/**
+	 * Moves every event pushed so far to vecEvents (collector thread only).
+	 */
+	void Drain(std::vector<TZoneEvent>* pVecEvents);
+
+	void SetName(const char* szThreadName);
+	const char* GetName() const;
+	GLuint GetThreadIndex() const;
+	uint64_t GetDroppedCount() const;
+
+private:
+	alignas(64) std::atomic<uint64_t> m_ulHead;
+	uint64_t m_ulCachedTail;
+	alignas(64) std::atomic<uint64_t> m_ulTail;
+	std::atomic<uint64_t> m_ulDropped;
+
+	GLuint m_uiThreadIndex;
+	char m_szName[CPU_PROFILER_THREAD_NAME_MAX];
+
+	TZoneEvent m_arrEvents[CPU_PROFILER_RING_SIZE];
+};
+
+/**
+ * Scoped CPU zone profiler.
+ * Every thread records into its own ring, created on the first zone it
+ * enters. The main thread collects the rings once per frame; while a capture
+ * is running the events are kept and written out when it stops.
+ *
+ * Must outlive every thread recording zones, it is created first in main().
+ */
+class CCPUProfiler : public CSingleton<CCPUProfiler>
+{
+public:
+	CCPUProfiler();
+	~CCPUProfiler();
+
+	CCPUProfiler(const CCPUProfiler&) = delete;
+	CCPUProfiler& operator=(const CCPUProfiler&) = delete;
+
+	void Initialize();
+	void Destroy();
+
+	static uint64_t GetTimestamp()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return (__rdtsc());
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	static bool IsEnabled()
+	{
+		return (ms_bIsEnabled.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * Ring of the calling thread, registered on first use.
+	 */
+	static CZoneEventRing* GetThreadRing();
+
+	/**
+	 * Names the calling thread in exported traces.
+	 */
+	static void SetThreadName(const char* szThreadName);
+
+	/**
+	 * Drains every thread ring, keeping the events only while capturing.
+	 * Called once per frame by the main thread.
+	 */
+	void Collect();
+
+	void StartCapture();
+
+	/**
+	 * Stops the capture and writes it to stPath.
+	 *
+	 * @return false if nothing was captured or the file could not be written
+	 */
+	bool StopCapture(const std::string& stPath, ETraceFormat eFormat = TRACE_FORMAT_CHROME_JSON);
+	bool IsCapturing() const;
+
+protected:
+	typedef struct SThreadCapture
+	{
+		CZoneEventRing* m_pRing;
+		std::vector<TZoneEvent> m_vecEvents;
+	} TThreadCapture;
+
+	CZoneEventRing* RegisterThread();
+
+	bool WriteChromeTrace(const std::string& stPath) const;
+	bool WriteBinary(const std::string& stPath) const;
+
+	/**
+	 * Ticks per microsecond, measured against steady_clock since Initialize().
+	 */
+	GLdouble GetTickFrequency() const;
+
+private:
+	static std::atomic<bool> ms_bIsEnabled;
+
+	// Rings are never released before the profiler, threads may exit any time
+	std::mutex m_mutexThreads;
+	std::vector<std::unique_ptr<CZoneEventRing>> m_vecRings;
+
+	std::vector<TThreadCapture> m_vecCaptures;
+	bool m_bIsCapturing;
+	uint64_t m_ulCaptureStart;
+
+	// Calibration of the timestamp counter
+	uint64_t m_ulCalibrationTicks;
+	std::chrono::steady_clock::time_point m_calibrationTime;
+};
+
+#if ANUBIS_PROFILE_ENABLED
+class CProfileZone
+{
+public:
+	explicit CProfileZone(const char* szName)
+	{
+		m_szName = szName;
+		m_ulBegin = CCPUProfiler::IsEnabled() ? CCPUProfiler::GetTimestamp() : 0;
+	}
+
+	~CProfileZone()
+	{
+		if (m_ulBegin == 0)
+		{
+			return;
+		}
+
+		const uint64_t ulEnd = CCPUProfiler::GetTimestamp();
+
+		CZoneEventRing* pRing = CCPUProfiler::GetThreadRing();
+		if (pRing)
+		{
+			pRing->Push(TZoneEvent{ m_szName, m_ulBegin, ulEnd });
+		}
+	}
+
+	CProfileZone(const CProfileZone&) = delete;
+	CProfileZone& operator=(const CProfileZone&) = delete;
+
+private:
+	const char* m_szName;
+	uint64_t m_ulBegin;
+};
+
+#define ANUBIS_ZONE_CONCAT_INNER(a, b) a##b
+#define ANUBIS_ZONE_CONCAT(a, b) ANUBIS_ZONE_CONCAT_INNER(a, b)
+#define ANUBIS_ZONE(name) CProfileZone ANUBIS_ZONE_CONCAT(profileZone_, __LINE__)(name)
+#define ANUBIS_THREAD_NAME(name) CCPUProfiler::SetThreadName(name)
+#else
+#define ANUBIS_ZONE(name)
+#define ANUBIS_THREAD_NAME(name)
+#endif
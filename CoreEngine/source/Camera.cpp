@@ -78,3 +78,35 @@ Matrix4 CCamera::GetViewProjectionMatrix() const
 {
 	return (GetProjectionMatrix() * GetViewMatrix());
 }
+
+
+void CCamera::SetPosition(const Vector3D& v3Position)
+{
+	m_v3Position = v3Position;
+}
+
+const Vector3D& CCamera::GetPosition() const
+{
+	return (m_v3Position);
+}
+
+void CCamera::LookAt(const Vector3D& v3Target)
+{
+	Vector3D v3Front = Vector3D(v3Target.x - m_v3Position.x, v3Target.y - m_v3Position.y, v3Target.z - m_v3Position.z);
+	if (v3Front.length() == 0.0f)
+	{
+		return;
+	}
+	m_v3Front = v3Front.normalize();
+
+	m_v3Right = m_v3Front.cross(m_v3WorldUp);
+	m_v3Right.normalize();
+
+	m_v3Up = m_v3Right.cross(m_v3Front);
+	m_v3Up.normalize();
+}
+
+const Vector3D& CCamera::GetFront() const
+{
+	return (m_v3Front);
+}
@@ -14,6 +14,15 @@ public:
 	Matrix4 GetProjectionMatrix() const;
 	Matrix4 GetViewProjectionMatrix() const;
 
+	void SetPosition(const Vector3D& v3Position);
+	const Vector3D& GetPosition() const;
+
+	/**
+	 * Turns the camera towards a world position, keeps the world up axis.
+	 */
+	void LookAt(const Vector3D& v3Target);
+	const Vector3D& GetFront() const;
+
 private:
 	Vector3D m_v3Position;
 	Vector3D m_v3Front;
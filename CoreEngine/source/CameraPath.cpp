@@ -0,0 +1,181 @@
+#include "CameraPath.h"
+#include <utils.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+/**
+ * Uniform Catmull-Rom between v3P1 and v3P2, fT in [0, 1].
+ */
+static Vector3D CatmullRom(const Vector3D& v3P0, const Vector3D& v3P1, const Vector3D& v3P2, const Vector3D& v3P3, GLfloat fT)
+{
+	const GLfloat fT2 = fT * fT;
+	const GLfloat fT3 = fT2 * fT;
+
+	const GLfloat fW0 = -0.5f * fT3 + fT2 - 0.5f * fT;
+	const GLfloat fW1 = 1.5f * fT3 - 2.5f * fT2 + 1.0f;
+	const GLfloat fW2 = -1.5f * fT3 + 2.0f * fT2 + 0.5f * fT;
+	const GLfloat fW3 = 0.5f * fT3 - 0.5f * fT2;
+
+	return Vector3D(
+		v3P0.x * fW0 + v3P1.x * fW1 + v3P2.x * fW2 + v3P3.x * fW3,
+		v3P0.y * fW0 + v3P1.y * fW1 + v3P2.y * fW2 + v3P3.y * fW3,
+		v3P0.z * fW0 + v3P1.z * fW1 + v3P2.z * fW2 + v3P3.z * fW3);
+}
+
+static nlohmann::json VectorToJSON(const Vector3D& v3Value)
+{
+	return nlohmann::json::array({ v3Value.x, v3Value.y, v3Value.z });
+}
+
+static Vector3D VectorFromJSON(const nlohmann::json& jsonValue)
+{
+	return Vector3D(jsonValue.at(0).get<GLfloat>(), jsonValue.at(1).get<GLfloat>(), jsonValue.at(2).get<GLfloat>());
+}
+
+void CCameraPath::Clear()
+{
+	m_vecKeyframes.clear();
+}
+
+void CCameraPath::AddKeyframe(GLfloat fTime, const Vector3D& v3Position, const Vector3D& v3Target)
+{
+	if (m_vecKeyframes.empty() == false && fTime < m_vecKeyframes.back().m_fTime)
+	{
+		syserr("Camera keyframe at %.3f is before the previous one at %.3f", fTime, m_vecKeyframes.back().m_fTime);
+		return;
+	}
+
+	m_vecKeyframes.push_back({ fTime, v3Position, v3Target });
+}
+
+bool CCameraPath::IsEmpty() const
+{
+	return (m_vecKeyframes.empty());
+}
+
+GLfloat CCameraPath::GetDuration() const
+{
+	return m_vecKeyframes.empty() ? 0.0f : m_vecKeyframes.back().m_fTime;
+}
+
+const std::vector<TCameraKeyframe>& CCameraPath::GetKeyframes() const
+{
+	return (m_vecKeyframes);
+}
+
+bool CCameraPath::Sample(GLfloat fTime, Vector3D& v3Position, Vector3D& v3Target) const
+{
+	if (m_vecKeyframes.empty())
+	{
+		return (false);
+	}
+
+	// first keyframe after fTime, clamps to both ends of the path
+	auto itNext = std::upper_bound(m_vecKeyframes.begin(), m_vecKeyframes.end(), fTime, [](GLfloat fValue, const TCameraKeyframe& keyframe)
+	{
+		return (fValue < keyframe.m_fTime);
+	});
+
+	if (itNext == m_vecKeyframes.begin() || itNext == m_vecKeyframes.end())
+	{
+		const TCameraKeyframe& keyframe = (itNext == m_vecKeyframes.begin()) ? m_vecKeyframes.front() : m_vecKeyframes.back();
+		v3Position = keyframe.m_v3Position;
+		v3Target = keyframe.m_v3Target;
+		return (true);
+	}
+
+	const size_t stIndex2 = static_cast<size_t>(itNext - m_vecKeyframes.begin());
+	const size_t stIndex1 = stIndex2 - 1;
+	const size_t stIndex0 = (stIndex1 > 0) ? stIndex1 - 1 : stIndex1;
+	const size_t stIndex3 = std::min(stIndex2 + 1, m_vecKeyframes.size() - 1);
+
+	const TCameraKeyframe& keyframe0 = m_vecKeyframes[stIndex0];
+	const TCameraKeyframe& keyframe1 = m_vecKeyframes[stIndex1];
+	const TCameraKeyframe& keyframe2 = m_vecKeyframes[stIndex2];
+	const TCameraKeyframe& keyframe3 = m_vecKeyframes[stIndex3];
+
+	const GLfloat fSpan = keyframe2.m_fTime - keyframe1.m_fTime;
+	const GLfloat fT = (fSpan > 0.0f) ? (fTime - keyframe1.m_fTime) / fSpan : 1.0f;
+
+	v3Position = CatmullRom(keyframe0.m_v3Position, keyframe1.m_v3Position, keyframe2.m_v3Position, keyframe3.m_v3Position, fT);
+	v3Target = CatmullRom(keyframe0.m_v3Target, keyframe1.m_v3Target, keyframe2.m_v3Target, keyframe3.m_v3Target, fT);
+	return (true);
+}
+
+bool CCameraPath::Load(const std::string& stPath)
+{
+	std::ifstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open camera path %s", stPath.c_str());
+		return (false);
+	}
+
+	const nlohmann::json jsonPath = nlohmann::json::parse(file, nullptr, false);
+	if (jsonPath.is_discarded() || jsonPath.contains("keyframes") == false)
+	{
+		syserr("%s is not a camera path", stPath.c_str());
+		return (false);
+	}
+
+	Clear();
+
+	try
+	{
+		for (const nlohmann::json& jsonKeyframe : jsonPath["keyframes"])
+		{
+			AddKeyframe(jsonKeyframe.at("time").get<GLfloat>(), VectorFromJSON(jsonKeyframe.at("position")), VectorFromJSON(jsonKeyframe.at("target")));
+		}
+	}
+	catch (const nlohmann::json::exception& e)
+	{
+		syserr("Invalid keyframe in %s: %s", stPath.c_str(), e.what());
+		Clear();
+		return (false);
+	}
+
+	syslog("Loaded camera path %s, %zu keyframes over %.2f s", stPath.c_str(), m_vecKeyframes.size(), GetDuration());
+	return (true);
+}
+
+bool CCameraPath::Save(const std::string& stPath) const
+{
+	nlohmann::json jsonKeyframes = nlohmann::json::array();
+	for (const TCameraKeyframe& keyframe : m_vecKeyframes)
+	{
+		jsonKeyframes.push_back({
+			{ "time", keyframe.m_fTime },
+			{ "position", VectorToJSON(keyframe.m_v3Position) },
+			{ "target", VectorToJSON(keyframe.m_v3Target) },
+		});
+	}
+
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file << nlohmann::json({ { "keyframes", jsonKeyframes } }).dump(1, '\t');
+	return (file.good());
+}
+
+CCameraPath CCameraPath::CreateOrbit(const Vector3D& v3Center, GLfloat fRadius, GLfloat fHeight, GLfloat fDuration, GLint iKeyframeCount)
+{
+	CCameraPath cameraPath;
+
+	const GLint iCount = std::max(iKeyframeCount, 2);
+	for (GLint i = 0; i < iCount; i++)
+	{
+		const GLfloat fFraction = static_cast<GLfloat>(i) / (iCount - 1);
+		const GLfloat fAngle = fFraction * 2.0f * static_cast<GLfloat>(M_PI);
+
+		const Vector3D v3Position(v3Center.x + std::cos(fAngle) * fRadius, v3Center.y + fHeight, v3Center.z + std::sin(fAngle) * fRadius);
+		cameraPath.AddKeyframe(fFraction * fDuration, v3Position, v3Center);
+	}
+
+	return (cameraPath);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <maths.h>
+#include <string>
+#include <vector>
+
+typedef struct SCameraKeyframe
+{
+	GLfloat m_fTime;		// seconds since the start of the path
+	Vector3D m_v3Position;
+	Vector3D m_v3Target;	// point the camera looks at
+} TCameraKeyframe;
+
+/**
+ * Timed camera keyframes, sampled with a Catmull-Rom spline.
+ * Used to fly the same camera motion on every run, the path is stored as JSON
+ * so it can be recorded once and replayed by the benchmarks.
+ */
+class CCameraPath
+{
+public:
+	CCameraPath() = default;
+	~CCameraPath() = default;
+
+	void Clear();
+
+	/**
+	 * Keyframes have to be added in increasing time order.
+	 */
+	void AddKeyframe(GLfloat fTime, const Vector3D& v3Position, const Vector3D& v3Target);
+
+	bool IsEmpty() const;
+	GLfloat GetDuration() const;
+	const std::vector<TCameraKeyframe>& GetKeyframes() const;
+
+	/**
+	 * Evaluates the path, times past the last keyframe hold the last pose.
+	 *
+	 * @return false if the path has no keyframes
+	 */
+	bool Sample(GLfloat fTime, Vector3D& v3Position, Vector3D& v3Target) const;
+
+	bool Load(const std::string& stPath);
+	bool Save(const std::string& stPath) const;
+
+	/**
+	 * Builds a circle around v3Center, looking at it, one lap over fDuration.
+	 */
+	static CCameraPath CreateOrbit(const Vector3D& v3Center, GLfloat fRadius, GLfloat fHeight, GLfloat fDuration, GLint iKeyframeCount);
+
+private:
+	std::vector<TCameraKeyframe> m_vecKeyframes;
+};
@@ -0,0 +1,59 @@
+#include "ClusterCuller.h"
+#include "GLResourceManager.h"
+#include "BindlessTextures.h"
+
+CClusterCuller::CClusterCuller() : CCullPass("cluster culling", 0)
+{
+}
+
+bool CClusterCuller::Cull(const TClusterBatch& batch, const Matrix4& mat4ViewProjection, const Vector3D& v3CameraPosition)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	CShader* pCullShader = resourceManager.GetShader(batch.m_hCullShader);
+	const TBufferResource* pMeshletBuffer = resourceManager.GetBuffer(batch.m_hMeshletBuffer);
+	if (pCullShader == nullptr || pCullShader->IsReady() == false || pMeshletBuffer == nullptr)
+	{
+		return (false);
+	}
+
+	if (batch.m_uiMeshletCount == 0 || Reserve(batch.m_uiMeshletCount) == false)
+	{
+		return (false);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_CULL_MESHLET_BINDING, pMeshletBuffer->m_uiBuffer);
+
+	// commands only, the draw reads no per cluster data
+	BeginCull(*pCullShader, mat4ViewProjection, CLUSTER_CULL_COMMAND_BINDING, 0, CLUSTER_CULL_COUNTER_BINDING);
+	pCullShader->SetInt("meshletCount", static_cast<GLint>(batch.m_uiMeshletCount));
+	pCullShader->SetMat4("meshletToWorld", batch.m_mat4MeshletToWorld);
+	pCullShader->SetVec3("cameraPosition", v3CameraPosition);
+
+	pCullShader->Dispatch((batch.m_uiMeshletCount + CLUSTER_CULL_GROUP_SIZE - 1) / CLUSTER_CULL_GROUP_SIZE);
+
+	EndCull(mat4ViewProjection);
+	return (true);
+}
+
+void CClusterCuller::Draw(const TClusterBatch& batch, const Matrix4& mat4ViewProjection)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	const TMeshResource* pMesh = resourceManager.GetMesh(batch.m_hMesh);
+	CShader* pShader = resourceManager.GetShader(batch.m_hShader);
+	if (pMesh == nullptr || pShader == nullptr || pShader->IsReady() == false || BeginDraw() == false)
+	{
+		return;
+	}
+
+	pShader->Use();
+	pShader->SetMat4("viewProjectionMatrix", mat4ViewProjection);
+	pShader->SetMat4("modelMatrix", batch.m_mat4Model);
+	CBindlessTextures::Instance().SetupShader(*pShader, TextureHandle());
+
+	// every command is the index range of one cluster, all with the same transform
+	glBindVertexArray(pMesh->m_uiVAO);
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, static_cast<GLsizei>(batch.m_uiMeshletCount), 0);
+	glBindVertexArray(0);
+
+	EndDraw();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CullPass.h"
+
+enum EClusterCullData
+{
+	CLUSTER_CULL_GROUP_SIZE = 64,		// local_size_x of cluster_cull.comp
+
+	// Shader storage bindings of cluster_cull.comp, after the ones of cull.comp
+	// and the texture tables
+	CLUSTER_CULL_MESHLET_BINDING = 9,
+	CLUSTER_CULL_COMMAND_BINDING = 10,
+	CLUSTER_CULL_COUNTER_BINDING = 11,
+};
+
+/**
+ * Backface, frustum and occlusion culling of the meshlets of a TClusterBatch
+ * in a compute pass. The surviving clusters are compacted into an indirect
+ * command buffer, one command per cluster drawing its index range, which
+ * glMultiDrawElementsIndirectCount consumes. Mesh shaders would cull and draw
+ * in one step, this runs on any GL 4.6 driver. Render thread only.
+ */
+class CClusterCuller : public CCullPass
+{
+public:
+	CClusterCuller();
+
+	/**
+	 * Runs the culling pass, the draw has to follow in the same frame. The
+	 * caller makes the outputs visible to the draw (COMMAND) and the counter
+	 * copy (BUFFER_UPDATE).
+	 *
+	 * @return false if the batch could not be culled
+	 */
+	bool Cull(const TClusterBatch& batch, const Matrix4& mat4ViewProjection, const Vector3D& v3CameraPosition);
+
+	/**
+	 * Draws the clusters that survived the last Cull().
+	 */
+	void Draw(const TClusterBatch& batch, const Matrix4& mat4ViewProjection);
+};
@@ -0,0 +1,532 @@
+#include "CompressedTexture.h"
+#include <utils.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+
+#if ANUBIS_WITH_COMPRESSONATOR
+#include <compressonator/include/cmp_compressonatorlib/compressonator.h>
+#pragma comment(lib, "CMP_Framework.lib")
+#endif
+
+// DDS
+static const uint32_t DDS_MAGIC = 0x20534444;			// "DDS "
+static const uint32_t DDS_HEADER_SIZE = 124;
+static const uint32_t DDS_DX10_HEADER_SIZE = 20;
+static const uint32_t DDS_PIXEL_FORMAT_OFFSET = 4 + 72;	// magic, then the header up to ddspf
+static const uint32_t DDSD_REQUIRED = 0x1 | 0x2 | 0x4 | 0x1000;	// caps, height, width, pixel format
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+// KTX2
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const uint32_t KTX2_LEVEL_INDEX_OFFSET = 80;
+static const uint32_t KTX2_LEVEL_INDEX_STRIDE = 24;		// offset, length, uncompressed length
+
+typedef struct SBlockFormat
+{
+	GLenum m_eFormat;
+	uint32_t m_uiDXGIFormat;
+	uint32_t m_uiVkFormat;
+} TBlockFormat;
+
+// The BC1 RGB variants map to the RGBA format, it decodes the same colors
+static const TBlockFormat s_arrBlockFormats[] =
+{
+	{ GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 71, 133 },
+	{ GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 72, 134 },
+	{ GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 131 },
+	{ GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 0, 132 },
+	{ GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 77, 137 },
+	{ GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 78, 138 },
+	{ GL_COMPRESSED_RED_RGTC1, 80, 139 },
+	{ GL_COMPRESSED_RG_RGTC2, 83, 141 },
+	{ GL_COMPRESSED_RGBA_BPTC_UNORM, 98, 145 },
+	{ GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 99, 146 },
+};
+
+static uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+	return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+static uint32_t ReadU32(const std::vector<uint8_t>& vecData, size_t stOffset)
+{
+	uint32_t uiValue = 0;
+	std::memcpy(&uiValue, vecData.data() + stOffset, sizeof(uiValue));
+	return (uiValue);
+}
+
+static uint64_t ReadU64(const std::vector<uint8_t>& vecData, size_t stOffset)
+{
+	uint64_t ulValue = 0;
+	std::memcpy(&ulValue, vecData.data() + stOffset, sizeof(ulValue));
+	return (ulValue);
+}
+
+static void WriteU32(std::vector<uint8_t>& vecData, uint32_t uiValue)
+{
+	const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&uiValue);
+	vecData.insert(vecData.end(), pBytes, pBytes + sizeof(uiValue));
+}
+
+bool CCompressedTexture::Load(const std::string& stPath, TCompressedImage& image)
+{
+	uint8_t arrSignature[sizeof(KTX2_IDENTIFIER)] = {};
+	std::ifstream file(stPath, std::ios::binary);
+	file.read(reinterpret_cast<char*>(arrSignature), sizeof(arrSignature));
+
+	if (std::memcmp(arrSignature, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+	{
+		return LoadKTX2(stPath, image);
+	}
+
+	return LoadDDS(stPath, image);
+}
+
+bool CCompressedTexture::LoadDDS(const std::string& stPath, TCompressedImage& image)
+{
+	if (ReadFile(stPath, image.m_vecData) == false)
+	{
+		return (false);
+	}
+
+	const std::vector<uint8_t>& vecData = image.m_vecData;
+	if (vecData.size() < 4 + DDS_HEADER_SIZE || ReadU32(vecData, 0) != DDS_MAGIC || ReadU32(vecData, 4) != DDS_HEADER_SIZE)
+	{
+		syserr("%s is not a DDS file", stPath.c_str());
+		return (false);
+	}
+
+	image.m_iHeight = static_cast<GLint>(ReadU32(vecData, 12));
+	image.m_iWidth = static_cast<GLint>(ReadU32(vecData, 16));
+	const GLint iLevels = std::max<GLint>(1, static_cast<GLint>(ReadU32(vecData, 28)));
+
+	const uint32_t uiFourCC = ReadU32(vecData, DDS_PIXEL_FORMAT_OFFSET + 8);
+	size_t stDataOffset = 4 + DDS_HEADER_SIZE;
+	image.m_eFormat = 0;
+
+	if (uiFourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (vecData.size() < stDataOffset + DDS_DX10_HEADER_SIZE)
+		{
+			syserr("%s has a truncated DX10 header", stPath.c_str());
+			return (false);
+		}
+
+		const uint32_t uiDXGIFormat = ReadU32(vecData, stDataOffset);
+		const uint32_t uiDimension = ReadU32(vecData, stDataOffset + 4);
+		const uint32_t uiArraySize = ReadU32(vecData, stDataOffset + 12);
+		if (uiDimension != DDS_DIMENSION_TEXTURE2D || uiArraySize > 1)
+		{
+			syserr("%s is not a single 2D texture", stPath.c_str());
+			return (false);
+		}
+
+		for (const TBlockFormat& format : s_arrBlockFormats)
+		{
+			if (format.m_uiDXGIFormat == uiDXGIFormat && uiDXGIFormat != 0)
+			{
+				image.m_eFormat = format.m_eFormat;
+				break;
+			}
+		}
+
+		stDataOffset += DDS_DX10_HEADER_SIZE;
+	}
+	else if (uiFourCC == MakeFourCC('D', 'X', 'T', '1'))
+	{
+		image.m_eFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	}
+	else if (uiFourCC == MakeFourCC('D', 'X', 'T', '5'))
+	{
+		image.m_eFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	else if (uiFourCC == MakeFourCC('A', 'T', 'I', '1') || uiFourCC == MakeFourCC('B', 'C', '4', 'U'))
+	{
+		image.m_eFormat = GL_COMPRESSED_RED_RGTC1;
+	}
+	else if (uiFourCC == MakeFourCC('A', 'T', 'I', '2') || uiFourCC == MakeFourCC('B', 'C', '5', 'U') || uiFourCC == MakeFourCC('A', '2', 'X', 'Y'))
+	{
+		image.m_eFormat = GL_COMPRESSED_RG_RGTC2;
+	}
+
+	if (image.m_eFormat == 0)
+	{
+		syserr("%s is not BC1, BC3, BC4, BC5 or BC7", stPath.c_str());
+		return (false);
+	}
+
+	return BuildLevels(image, iLevels, stDataOffset);
+}
+
+bool CCompressedTexture::LoadKTX2(const std::string& stPath, TCompressedImage& image)
+{
+	if (ReadFile(stPath, image.m_vecData) == false)
+	{
+		return (false);
+	}
+
+	const std::vector<uint8_t>& vecData = image.m_vecData;
+	if (vecData.size() < KTX2_LEVEL_INDEX_OFFSET || std::memcmp(vecData.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+	{
+		syserr("%s is not a KTX2 file", stPath.c_str());
+		return (false);
+	}
+
+	const uint32_t uiVkFormat = ReadU32(vecData, 12);
+	image.m_iWidth = static_cast<GLint>(ReadU32(vecData, 20));
+	image.m_iHeight = static_cast<GLint>(ReadU32(vecData, 24));
+	const uint32_t uiDepth = ReadU32(vecData, 28);
+	const uint32_t uiLayers = ReadU32(vecData, 32);
+	const uint32_t uiFaces = ReadU32(vecData, 36);
+	const GLint iLevels = std::max<GLint>(1, static_cast<GLint>(ReadU32(vecData, 40)));
+	const uint32_t uiSupercompression = ReadU32(vecData, 44);
+
+	if (uiDepth > 1 || uiLayers > 1 || uiFaces != 1)
+	{
+		syserr("%s is not a single 2D texture", stPath.c_str());
+		return (false);
+	}
+
+	if (IsValidLevelChain(image.m_iWidth, image.m_iHeight, iLevels) == false)
+	{
+		syserr("%s is an invalid %dx%d texture with %d levels", stPath.c_str(), image.m_iWidth, image.m_iHeight, iLevels);
+		return (false);
+	}
+
+	// Basis and zstd would need a transcoder on the load path
+	if (uiSupercompression != 0)
+	{
+		syserr("%s uses supercompression scheme %u, only plain block data is supported", stPath.c_str(), uiSupercompression);
+		return (false);
+	}
+
+	image.m_eFormat = 0;
+	for (const TBlockFormat& format : s_arrBlockFormats)
+	{
+		if (format.m_uiVkFormat == uiVkFormat)
+		{
+			image.m_eFormat = format.m_eFormat;
+			break;
+		}
+	}
+
+	if (image.m_eFormat == 0 || vecData.size() < KTX2_LEVEL_INDEX_OFFSET + static_cast<size_t>(iLevels) * KTX2_LEVEL_INDEX_STRIDE)
+	{
+		syserr("%s has an unsupported format %u or a truncated level index", stPath.c_str(), uiVkFormat);
+		return (false);
+	}
+
+	// levels are indexed largest first, whatever order they are stored in
+	image.m_vecLevels.clear();
+	for (GLint i = 0; i < iLevels; i++)
+	{
+		const size_t stIndex = KTX2_LEVEL_INDEX_OFFSET + static_cast<size_t>(i) * KTX2_LEVEL_INDEX_STRIDE;
+
+		TCompressedLevel level{};
+		level.m_iWidth = std::max(1, image.m_iWidth >> i);
+		level.m_iHeight = std::max(1, image.m_iHeight >> i);
+		level.m_stOffset = static_cast<size_t>(ReadU64(vecData, stIndex));
+		level.m_stSize = static_cast<size_t>(ReadU64(vecData, stIndex + 8));
+
+		if (level.m_stSize != GetLevelSize(image.m_eFormat, level.m_iWidth, level.m_iHeight) || level.m_stOffset + level.m_stSize > vecData.size())
+		{
+			syserr("%s level %d does not match its size", stPath.c_str(), i);
+			return (false);
+		}
+
+		image.m_vecLevels.push_back(level);
+	}
+
+	return (true);
+}
+
+bool CCompressedTexture::SaveDDS(const std::string& stPath, const TCompressedImage& image)
+{
+	uint32_t uiDXGIFormat = 0;
+	for (const TBlockFormat& format : s_arrBlockFormats)
+	{
+		if (format.m_eFormat == image.m_eFormat && format.m_uiDXGIFormat != 0)
+		{
+			uiDXGIFormat = format.m_uiDXGIFormat;
+			break;
+		}
+	}
+
+	if (uiDXGIFormat == 0 || image.m_vecLevels.empty())
+	{
+		syserr("Cannot write %s, format 0x%X is not supported", stPath.c_str(), image.m_eFormat);
+		return (false);
+	}
+
+	const uint32_t uiLevels = static_cast<uint32_t>(image.m_vecLevels.size());
+
+	std::vector<uint8_t> vecHeader;
+	WriteU32(vecHeader, DDS_MAGIC);
+	WriteU32(vecHeader, DDS_HEADER_SIZE);
+	WriteU32(vecHeader, DDSD_REQUIRED | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+	WriteU32(vecHeader, static_cast<uint32_t>(image.m_iHeight));
+	WriteU32(vecHeader, static_cast<uint32_t>(image.m_iWidth));
+	WriteU32(vecHeader, static_cast<uint32_t>(image.m_vecLevels[0].m_stSize));
+	WriteU32(vecHeader, 0);				// depth
+	WriteU32(vecHeader, uiLevels);
+	for (GLint i = 0; i < 11; i++)
+	{
+		WriteU32(vecHeader, 0);			// reserved
+	}
+
+	// pixel format, the DX10 header follows
+	WriteU32(vecHeader, 32);
+	WriteU32(vecHeader, DDPF_FOURCC);
+	WriteU32(vecHeader, MakeFourCC('D', 'X', '1', '0'));
+	for (GLint i = 0; i < 5; i++)
+	{
+		WriteU32(vecHeader, 0);			// bit count and masks
+	}
+
+	WriteU32(vecHeader, DDSCAPS_TEXTURE | (uiLevels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+	for (GLint i = 0; i < 4; i++)
+	{
+		WriteU32(vecHeader, 0);			// caps 2 to 4, reserved
+	}
+
+	WriteU32(vecHeader, uiDXGIFormat);
+	WriteU32(vecHeader, DDS_DIMENSION_TEXTURE2D);
+	WriteU32(vecHeader, 0);				// misc flags
+	WriteU32(vecHeader, 1);				// array size
+	WriteU32(vecHeader, 0);				// alpha mode unknown
+
+	std::ofstream file(stPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file.write(reinterpret_cast<const char*>(vecHeader.data()), static_cast<std::streamsize>(vecHeader.size()));
+	for (const TCompressedLevel& level : image.m_vecLevels)
+	{
+		file.write(reinterpret_cast<const char*>(image.m_vecData.data() + level.m_stOffset), static_cast<std::streamsize>(level.m_stSize));
+	}
+
+	return (file.good());
+}
+
+bool CCompressedTexture::Compress(const uint8_t* pPixels, GLint iWidth, GLint iHeight, GLubyte ubCompression, TCompressedImage& image)
+{
+#if ANUBIS_WITH_COMPRESSONATOR
+	CMP_FORMAT eDestination = CMP_FORMAT_Unknown;
+	switch (ubCompression)
+	{
+		case TEXTURE_COMPRESSION_BC1: eDestination = CMP_FORMAT_BC1; break;
+		case TEXTURE_COMPRESSION_BC3: eDestination = CMP_FORMAT_BC3; break;
+		case TEXTURE_COMPRESSION_BC4: eDestination = CMP_FORMAT_BC4; break;
+		case TEXTURE_COMPRESSION_BC5: eDestination = CMP_FORMAT_BC5; break;
+		case TEXTURE_COMPRESSION_BC7: eDestination = CMP_FORMAT_BC7; break;
+		default: return (false);
+	}
+
+	static std::once_flag s_initFramework;
+	std::call_once(s_initFramework, CMP_InitFramework);
+
+	CMP_MipSet sourceMipSet{};
+	if (CMP_CreateMipSet(&sourceMipSet, iWidth, iHeight, 1, CF_8bit, TT_2D) != CMP_OK)
+	{
+		syserr("Failed to allocate a %dx%d mip set", iWidth, iHeight);
+		return (false);
+	}
+
+	CMP_MipLevel* pLevel = nullptr;
+	CMP_GetMipLevel(&pLevel, &sourceMipSet, 0, 0);
+	std::memcpy(pLevel->m_pbData, pPixels, static_cast<size_t>(iWidth) * iHeight * 4);
+	sourceMipSet.m_format = CMP_FORMAT_RGBA_8888;
+
+	CMP_GenerateMIPLevels(&sourceMipSet, CMP_CalcMinMipSize(iHeight, iWidth, COMPRESSED_TEXTURE_MAX_LEVELS));
+
+	// 0.05 is the fastest setting, BC7 at full quality takes minutes for large images
+	KernelOptions options{};
+	options.format = eDestination;
+	options.fquality = 0.05f;
+	options.encodeWith = CMP_HPC;
+	options.threads = 0;
+
+	CMP_MipSet compressedMipSet{};
+	const CMP_ERROR eError = CMP_ProcessTexture(&sourceMipSet, &compressedMipSet, options, nullptr);
+	CMP_FreeMipSet(&sourceMipSet);
+	if (eError != CMP_OK)
+	{
+		syserr("Compressonator failed with error %d", static_cast<GLint>(eError));
+		CMP_FreeMipSet(&compressedMipSet);
+		return (false);
+	}
+
+	image.m_eFormat = GetFormat(ubCompression);
+	image.m_iWidth = iWidth;
+	image.m_iHeight = iHeight;
+	image.m_vecLevels.clear();
+	image.m_vecData.clear();
+
+	for (GLint i = 0; i < compressedMipSet.m_nMipLevels; i++)
+	{
+		CMP_GetMipLevel(&pLevel, &compressedMipSet, i, 0);
+
+		TCompressedLevel level{};
+		level.m_iWidth = pLevel->m_nWidth;
+		level.m_iHeight = pLevel->m_nHeight;
+		level.m_stOffset = image.m_vecData.size();
+		level.m_stSize = pLevel->m_dwLinearSize;
+		image.m_vecLevels.push_back(level);
+
+		image.m_vecData.insert(image.m_vecData.end(), pLevel->m_pbData, pLevel->m_pbData + pLevel->m_dwLinearSize);
+	}
+
+	CMP_FreeMipSet(&compressedMipSet);
+	return (image.m_vecLevels.empty() == false);
+#else
+	(void)pPixels;
+	(void)iWidth;
+	(void)iHeight;
+	(void)ubCompression;
+	(void)image;
+	return (false);
+#endif
+}
+
+bool CCompressedTexture::IsContainerPath(const std::string& stPath)
+{
+	const size_t stDot = stPath.find_last_of('.');
+	if (stDot == std::string::npos)
+	{
+		return (false);
+	}
+
+	std::string stExtension = stPath.substr(stDot + 1);
+	std::transform(stExtension.begin(), stExtension.end(), stExtension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return (stExtension == "dds") || (stExtension == "ktx2");
+}
+
+GLenum CCompressedTexture::GetFormat(GLubyte ubCompression)
+{
+	switch (ubCompression)
+	{
+		case TEXTURE_COMPRESSION_BC1: return (GL_COMPRESSED_RGBA_S3TC_DXT1_EXT);
+		case TEXTURE_COMPRESSION_BC3: return (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+		case TEXTURE_COMPRESSION_BC4: return (GL_COMPRESSED_RED_RGTC1);
+		case TEXTURE_COMPRESSION_BC5: return (GL_COMPRESSED_RG_RGTC2);
+		case TEXTURE_COMPRESSION_BC7: return (GL_COMPRESSED_RGBA_BPTC_UNORM);
+		default: return (GL_RGBA8);
+	}
+}
+
+const char* CCompressedTexture::GetName(GLubyte ubCompression)
+{
+	switch (ubCompression)
+	{
+		case TEXTURE_COMPRESSION_BC1: return ("bc1");
+		case TEXTURE_COMPRESSION_BC3: return ("bc3");
+		case TEXTURE_COMPRESSION_BC4: return ("bc4");
+		case TEXTURE_COMPRESSION_BC5: return ("bc5");
+		case TEXTURE_COMPRESSION_BC7: return ("bc7");
+		default: return ("none");
+	}
+}
+
+GLint CCompressedTexture::GetBlockBytes(GLenum eFormat)
+{
+	switch (eFormat)
+	{
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+			return (8);
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		case GL_COMPRESSED_RG_RGTC2:
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+		case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+			return (16);
+		default:
+			return (0);
+	}
+}
+
+size_t CCompressedTexture::GetLevelSize(GLenum eFormat, GLint iWidth, GLint iHeight)
+{
+	const GLint iBlockBytes = GetBlockBytes(eFormat);
+	if (iBlockBytes == 0)
+	{
+		return static_cast<size_t>(iWidth) * iHeight * 4;
+	}
+
+	const size_t stBlocksX = (iWidth + COMPRESSED_TEXTURE_BLOCK_SIZE - 1) / COMPRESSED_TEXTURE_BLOCK_SIZE;
+	const size_t stBlocksY = (iHeight + COMPRESSED_TEXTURE_BLOCK_SIZE - 1) / COMPRESSED_TEXTURE_BLOCK_SIZE;
+	return (stBlocksX * stBlocksY * iBlockBytes);
+}
+
+bool CCompressedTexture::ReadFile(const std::string& stPath, std::vector<uint8_t>& vecData)
+{
+	std::ifstream file(stPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s", stPath.c_str());
+		return (false);
+	}
+
+	vecData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return (true);
+}
+
+bool CCompressedTexture::IsValidLevelChain(GLint iWidth, GLint iHeight, GLint iLevels)
+{
+	if (iWidth <= 0 || iHeight <= 0 || iLevels <= 0)
+	{
+		return (false);
+	}
+
+	// a level past 1x1 would repeat it and its data would be read as the next texture
+	GLint iMaxLevels = 1;
+	for (GLint iSize = std::max(iWidth, iHeight); iSize > 1; iSize >>= 1)
+	{
+		iMaxLevels++;
+	}
+
+	return (iLevels <= std::min<GLint>(iMaxLevels, COMPRESSED_TEXTURE_MAX_LEVELS));
+}
+
+bool CCompressedTexture::BuildLevels(TCompressedImage& image, GLint iLevels, size_t stOffset)
+{
+	if (IsValidLevelChain(image.m_iWidth, image.m_iHeight, iLevels) == false)
+	{
+		syserr("Invalid compressed texture %dx%d with %d levels", image.m_iWidth, image.m_iHeight, iLevels);
+		return (false);
+	}
+
+	image.m_vecLevels.clear();
+	for (GLint i = 0; i < iLevels; i++)
+	{
+		TCompressedLevel level{};
+		level.m_iWidth = std::max(1, image.m_iWidth >> i);
+		level.m_iHeight = std::max(1, image.m_iHeight >> i);
+		level.m_stOffset = stOffset;
+		level.m_stSize = GetLevelSize(image.m_eFormat, level.m_iWidth, level.m_iHeight);
+
+		stOffset += level.m_stSize;
+		if (stOffset > image.m_vecData.size())
+		{
+			syserr("Compressed texture is truncated at level %d", i);
+			return (false);
+		}
+
+		image.m_vecLevels.push_back(level);
+	}
+
+	return (true);
+}
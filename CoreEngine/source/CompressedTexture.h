@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Transcoding PNG sources to BCn needs Compressonator, define as 1 with
+// CMP_Framework.lib in Extern/lib. Reading DDS and KTX2 works without it.
+#ifndef ANUBIS_WITH_COMPRESSONATOR
+#define ANUBIS_WITH_COMPRESSONATOR 0
+#endif
+
+enum ECompressedTextureData
+{
+	COMPRESSED_TEXTURE_BLOCK_SIZE = 4,		// pixels, every BCn format
+	COMPRESSED_TEXTURE_MAX_LEVELS = 16,
+};
+
+/**
+ * Block compressed format PNG sources are transcoded to.
+ */
+enum ETextureCompression : GLubyte
+{
+	TEXTURE_COMPRESSION_NONE,
+	TEXTURE_COMPRESSION_BC1,	// RGB + 1 bit alpha, 8 bytes per block
+	TEXTURE_COMPRESSION_BC3,	// RGBA, 16 bytes per block
+	TEXTURE_COMPRESSION_BC4,	// R, 8 bytes per block
+	TEXTURE_COMPRESSION_BC5,	// RG, normal maps, 16 bytes per block
+	TEXTURE_COMPRESSION_BC7,	// RGBA, best quality, 16 bytes per block
+};
+
+typedef struct SCompressedLevel
+{
+	GLint m_iWidth;
+	GLint m_iHeight;
+	size_t m_stOffset;			// into m_vecData
+	size_t m_stSize;
+} TCompressedLevel;
+
+/**
+ * Block compressed image with its mip chain, largest level first.
+ */
+typedef struct SCompressedImage
+{
+	GLenum m_eFormat;			// GL compressed internal format
+	GLint m_iWidth;
+	GLint m_iHeight;
+	std::vector<TCompressedLevel> m_vecLevels;
+	std::vector<uint8_t> m_vecData;
+} TCompressedImage;
+
+/**
+ * DDS / KTX2 containers of BC1, BC3, BC4, BC5 and BC7 textures, and the
+ * Compressonator based transcoder writing them.
+ *
+ * The vendored DDS_Helpers only read the top level and cannot write BC7,
+ * the containers are parsed and written here. Only 2D textures without
+ * supercompression are supported, the data is uploaded as stored.
+ */
+class CCompressedTexture
+{
+public:
+	/**
+	 * Picks the container from the file signature.
+	 */
+	static bool Load(const std::string& stPath, TCompressedImage& image);
+	static bool LoadDDS(const std::string& stPath, TCompressedImage& image);
+	static bool LoadKTX2(const std::string& stPath, TCompressedImage& image);
+
+	/**
+	 * Writes a DX10 DDS, the layout every DDS tool reads for BC7.
+	 */
+	static bool SaveDDS(const std::string& stPath, const TCompressedImage& image);
+
+	/**
+	 * Generates the mip chain of an RGBA8 image and block compresses it.
+	 *
+	 * @return Always false without ANUBIS_WITH_COMPRESSONATOR
+	 */
+	static bool Compress(const uint8_t* pPixels, GLint iWidth, GLint iHeight, GLubyte ubCompression, TCompressedImage& image);
+
+	/**
+	 * True for .dds and .ktx2 files.
+	 */
+	static bool IsContainerPath(const std::string& stPath);
+
+	static GLenum GetFormat(GLubyte ubCompression);
+	static const char* GetName(GLubyte ubCompression);
+
+	/**
+	 * Bytes per 4x4 block, 0 for formats that are not block compressed.
+	 */
+	static GLint GetBlockBytes(GLenum eFormat);
+
+	/**
+	 * Bytes of a level of the given size, GL_RGBA8 is handled too.
+	 */
+	static size_t GetLevelSize(GLenum eFormat, GLint iWidth, GLint iHeight);
+
+protected:
+	static bool ReadFile(const std::string& stPath, std::vector<uint8_t>& vecData);
+
+	/**
+	 * Checks a header size and that its mip chain ends at 1x1 at the latest,
+	 * floor(log2(max(width, height))) + 1 levels.
+	 */
+	static bool IsValidLevelChain(GLint iWidth, GLint iHeight, GLint iLevels);
+
+	/**
+	 * Lays out iLevels tightly packed levels starting at stOffset and checks
+	 * they fit in the file.
+	 */
+	static bool BuildLevels(TCompressedImage& image, GLint iLevels, size_t stOffset);
+};
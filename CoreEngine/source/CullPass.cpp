@@ -0,0 +1,204 @@
+#include "CullPass.h"
+#include "GLResourceManager.h"
+#include "IndirectDrawBuffer.h"
+#include "Frustum.h"
+#include <utils.h>
+
+CCullPass::CCullPass(const char* szName, GLsizeiptr iVisibleDataSize)
+{
+	m_szName = szName;
+	m_iVisibleDataSize = iVisibleDataSize;
+
+	m_uiCapacity = 0;
+	m_bIsCulled = false;
+
+	m_pReadback = nullptr;
+	m_lastCounters = TGPUCullCounters{};
+	m_bHasCounters = false;
+
+	m_pDepthPyramid = nullptr;
+	m_mat4PreviousViewProjection.InitIdentity();
+	m_bHasPreviousFrame = false;
+}
+
+CCullPass::~CCullPass()
+{
+	Destroy();
+}
+
+void CCullPass::Destroy()
+{
+	m_fenceRing.Reset();
+
+	if (m_hCommandBuffer.IsValid() || m_hReadbackBuffer.IsValid())
+	{
+		CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+		resourceManager.DestroyBuffer(m_hCommandBuffer);
+		resourceManager.DestroyBuffer(m_hVisibleDataBuffer);
+		resourceManager.DestroyBuffer(m_hCounterBuffer);
+		resourceManager.DestroyBuffer(m_hReadbackBuffer);
+	}
+
+	m_hCommandBuffer = BufferHandle();
+	m_hVisibleDataBuffer = BufferHandle();
+	m_hCounterBuffer = BufferHandle();
+	m_hReadbackBuffer = BufferHandle();
+	m_uiCapacity = 0;
+	m_bIsCulled = false;
+
+	m_pReadback = nullptr;
+}
+
+void CCullPass::SetDepthPyramid(const CDepthPyramid* pDepthPyramid)
+{
+	m_pDepthPyramid = pDepthPyramid;
+}
+
+bool CCullPass::Reserve(GLuint uiCount)
+{
+	if (uiCount <= m_uiCapacity)
+	{
+		return (true);
+	}
+
+	Destroy();
+
+	// everything may survive, the buffers hold the whole batch
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hCommandBuffer = resourceManager.CreateBuffer(static_cast<GLsizeiptr>(uiCount) * sizeof(TDrawElementsIndirectCommand), nullptr, 0);
+	m_hCounterBuffer = resourceManager.CreateBuffer(sizeof(TGPUCullCounters), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	if (m_iVisibleDataSize)
+	{
+		m_hVisibleDataBuffer = resourceManager.CreateBuffer(static_cast<GLsizeiptr>(uiCount) * m_iVisibleDataSize, nullptr, 0);
+	}
+
+	const GLbitfield uiReadFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	m_hReadbackBuffer = resourceManager.CreateBuffer(FRAME_PACKET_COUNT * sizeof(TGPUCullCounters), nullptr, uiReadFlags);
+
+	const TBufferResource* pReadbackBuffer = resourceManager.GetBuffer(m_hReadbackBuffer);
+	if (resourceManager.GetBuffer(m_hCommandBuffer) == nullptr || resourceManager.GetBuffer(m_hCounterBuffer) == nullptr ||
+		(m_iVisibleDataSize && resourceManager.GetBuffer(m_hVisibleDataBuffer) == nullptr) || pReadbackBuffer == nullptr)
+	{
+		syserr("Failed to create the %s buffers for %u survivors", m_szName, uiCount);
+		Destroy();
+		return (false);
+	}
+
+	m_pReadback = static_cast<const TGPUCullCounters*>(glMapNamedBufferRange(pReadbackBuffer->m_uiBuffer, 0, FRAME_PACKET_COUNT * sizeof(TGPUCullCounters), uiReadFlags));
+	if (m_pReadback == nullptr)
+	{
+		syserr("Failed to map the %s read back buffer", m_szName);
+		Destroy();
+		return (false);
+	}
+
+	m_uiCapacity = uiCount;
+	return (true);
+}
+
+void CCullPass::BeginCull(CShader& cullShader, const Matrix4& mat4ViewProjection, GLuint uiCommandBinding, GLuint uiVisibleDataBinding, GLuint uiCounterBinding)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	const GLuint uiCounterBuffer = resourceManager.GetBuffer(m_hCounterBuffer)->m_uiBuffer;
+
+	// the atomics start from zero every frame
+	glClearNamedBufferSubData(uiCounterBuffer, GL_R32UI, 0, sizeof(TGPUCullCounters), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uiCommandBinding, resourceManager.GetBuffer(m_hCommandBuffer)->m_uiBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uiCounterBinding, uiCounterBuffer);
+	if (m_iVisibleDataSize)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, uiVisibleDataBinding, resourceManager.GetBuffer(m_hVisibleDataBuffer)->m_uiBuffer);
+	}
+
+	CFrustum frustum;
+	frustum.Extract(mat4ViewProjection);
+
+	cullShader.Use();
+	cullShader.SetVec4Array("frustumPlanes", frustum.GetPlanes().data(), FRUSTUM_PLANE_COUNT);
+
+	// the pyramid was built from the previous frame, so is the projection used against it
+	const bool bOcclusionCulling = m_pDepthPyramid && m_pDepthPyramid->IsBuilt() && m_bHasPreviousFrame;
+	cullShader.SetBool("occlusionCulling", bOcclusionCulling);
+	if (bOcclusionCulling)
+	{
+		cullShader.SetMat4("previousViewProjection", m_mat4PreviousViewProjection);
+		cullShader.SetIVec2("depthSize", m_pDepthPyramid->GetDepthWidth(), m_pDepthPyramid->GetDepthHeight());
+		cullShader.SetInt("depthPyramidLevels", m_pDepthPyramid->GetLevelCount());
+		cullShader.SetInt("depthPyramid", CULL_PASS_DEPTH_PYRAMID_UNIT);
+		m_pDepthPyramid->BindTexture(CULL_PASS_DEPTH_PYRAMID_UNIT);
+	}
+}
+
+void CCullPass::EndCull(const Matrix4& mat4ViewProjection)
+{
+	m_mat4PreviousViewProjection = mat4ViewProjection;
+	m_bHasPreviousFrame = true;
+	m_bIsCulled = true;
+}
+
+bool CCullPass::BeginDraw()
+{
+	if (m_bIsCulled == false)
+	{
+		return (false);
+	}
+
+	// the commands of a failed or skipped culling pass are stale
+	m_bIsCulled = false;
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	if (m_iVisibleDataSize)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_DATA_BINDING, resourceManager.GetBuffer(m_hVisibleDataBuffer)->m_uiBuffer);
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, resourceManager.GetBuffer(m_hCommandBuffer)->m_uiBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, resourceManager.GetBuffer(m_hCounterBuffer)->m_uiBuffer);
+	return (true);
+}
+
+void CCullPass::EndDraw()
+{
+	// the slot is reused FRAME_PACKET_COUNT frames later, read it before overwriting
+	const GLuint uiSlot = m_fenceRing.GetSlot();
+	if (m_fenceRing.AcquireSlot())
+	{
+		m_lastCounters = m_pReadback[uiSlot];
+		m_bHasCounters = true;
+	}
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	const GLuint uiCounterBuffer = resourceManager.GetBuffer(m_hCounterBuffer)->m_uiBuffer;
+	const GLuint uiReadbackBuffer = resourceManager.GetBuffer(m_hReadbackBuffer)->m_uiBuffer;
+	glCopyNamedBufferSubData(uiCounterBuffer, uiReadbackBuffer, 0, static_cast<GLintptr>(uiSlot * sizeof(TGPUCullCounters)), sizeof(TGPUCullCounters));
+}
+
+GLuint CCullPass::GetCommandBuffer() const
+{
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(m_hCommandBuffer);
+	return (pBuffer ? pBuffer->m_uiBuffer : 0);
+}
+
+GLuint CCullPass::GetVisibleDataBuffer() const
+{
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(m_hVisibleDataBuffer);
+	return (pBuffer ? pBuffer->m_uiBuffer : 0);
+}
+
+GLuint CCullPass::GetCounterBuffer() const
+{
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(m_hCounterBuffer);
+	return (pBuffer ? pBuffer->m_uiBuffer : 0);
+}
+
+void CCullPass::EndFrame()
+{
+	m_fenceRing.EndFrame();
+}
+
+bool CCullPass::GetLastCounters(TGPUCullCounters& counters) const
+{
+	counters = m_lastCounters;
+	return (m_bHasCounters);
+}
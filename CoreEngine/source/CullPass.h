@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include "FramePacket.h"
+#include "DepthPyramid.h"
+#include "FenceRing.h"
+
+class CShader;
+
+enum ECullPassData
+{
+	// Unit of the depth pyramid while a culling pass runs, see cull_common.glsl
+	CULL_PASS_DEPTH_PYRAMID_UNIT = 0,
+};
+
+/**
+ * Written by the culling shaders, the draw count is the parameter of the multi draw.
+ */
+typedef struct SGPUCullCounters
+{
+	GLuint m_uiDrawCount;
+	GLuint m_uiTriangleCount;
+} TGPUCullCounters;
+
+/**
+ * Outputs and occlusion state shared by the compute cullers.
+ * Survivors are compacted into an indirect command buffer with an atomic
+ * counter which glMultiDrawElementsIndirectCount consumes, nothing goes back
+ * to the CPU except the counters, read a few frames later without stalling.
+ * Render thread only.
+ */
+class CCullPass
+{
+public:
+	CCullPass(const CCullPass&) = delete;
+	CCullPass& operator=(const CCullPass&) = delete;
+
+	void Destroy();
+
+	/**
+	 * Pyramid rebuilt after the draws of every frame, survivors hidden behind
+	 * the previous frame's depth are culled. nullptr disables occlusion culling.
+	 */
+	void SetDepthPyramid(const CDepthPyramid* pDepthPyramid);
+
+	/**
+	 * Grows the output buffers to hold uiCount survivors, done by Cull()
+	 * too. Call it before importing the buffers into a render graph.
+	 */
+	bool Reserve(GLuint uiCount);
+
+	/**
+	 * Fences the counter read back this frame and moves to the next slot.
+	 */
+	void EndFrame();
+
+	/**
+	 * Counters of the most recent frame the GPU finished, they trail the
+	 * submitted frames by up to FRAME_PACKET_COUNT frames.
+	 *
+	 * @return false until a first frame was read back
+	 */
+	bool GetLastCounters(TGPUCullCounters& counters) const;
+
+	// GL names of the culling outputs, 0 before the first Reserve()
+	GLuint GetCommandBuffer() const;
+	GLuint GetVisibleDataBuffer() const;
+	GLuint GetCounterBuffer() const;
+
+protected:
+	/**
+	 * @param szName Culler name for errors
+	 * @param iVisibleDataSize Bytes copied per survivor next to its command, 0 for none
+	 */
+	CCullPass(const char* szName, GLsizeiptr iVisibleDataSize);
+	~CCullPass();
+
+	/**
+	 * Clears the counters, binds the outputs and sets the frustum and
+	 * occlusion uniforms of cull_common.glsl. The cull program is left in use
+	 * for the uniforms of the caller.
+	 */
+	void BeginCull(CShader& cullShader, const Matrix4& mat4ViewProjection, GLuint uiCommandBinding, GLuint uiVisibleDataBinding, GLuint uiCounterBinding);
+
+	/**
+	 * Called once the pass is dispatched, the next frame tests against this projection.
+	 */
+	void EndCull(const Matrix4& mat4ViewProjection);
+
+	/**
+	 * Binds the commands and the draw count of the last culling pass.
+	 *
+	 * @return false if no pass ran since the last draw, its commands are stale
+	 */
+	bool BeginDraw();
+
+	/**
+	 * Copies the counters of the pass drawn into this frame's read back slot.
+	 */
+	void EndDraw();
+
+private:
+	const char* m_szName;
+	GLsizeiptr m_iVisibleDataSize;
+
+	// Survivors of the current frame, GPU only
+	BufferHandle m_hCommandBuffer;
+	BufferHandle m_hVisibleDataBuffer;
+	BufferHandle m_hCounterBuffer;
+	GLuint m_uiCapacity;
+	bool m_bIsCulled;				// culled since the last draw
+
+	// Counter read back, one slot per frame in flight
+	BufferHandle m_hReadbackBuffer;
+	const TGPUCullCounters* m_pReadback;
+	CFenceRing m_fenceRing;
+	TGPUCullCounters m_lastCounters;
+	bool m_bHasCounters;
+
+	// Occlusion culling, tested with the matrices the pyramid was rendered with
+	const CDepthPyramid* m_pDepthPyramid;
+	Matrix4 m_mat4PreviousViewProjection;
+	bool m_bHasPreviousFrame;
+};
@@ -0,0 +1,92 @@
+#include "CullingScene.h"
+#include "GLResourceManager.h"
+#include <utils.h>
+
+CCullingScene::CCullingScene()
+{
+	m_uiObjectCount = 0;
+}
+
+CCullingScene::~CCullingScene()
+{
+	Destroy();
+}
+
+void CCullingScene::Destroy()
+{
+	if (m_hObjectBuffer.IsValid() || m_hDrawDataBuffer.IsValid())
+	{
+		CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+		resourceManager.DestroyBuffer(m_hObjectBuffer);
+		resourceManager.DestroyBuffer(m_hDrawDataBuffer);
+		m_hObjectBuffer = BufferHandle();
+		m_hDrawDataBuffer = BufferHandle();
+	}
+
+	m_vecObjects.clear();
+	m_vecDrawData.clear();
+	m_uiObjectCount = 0;
+}
+
+GLuint CCullingScene::AddObject(const Vector3D& v3BoundsMin, const Vector3D& v3BoundsMax, const TDrawElementsIndirectCommand& command, const TIndirectDrawData& drawData)
+{
+	TCullObject object{};
+	object.m_v4BoundsMin = Vector4D(v3BoundsMin.x, v3BoundsMin.y, v3BoundsMin.z, 1.0f);
+	object.m_v4BoundsMax = Vector4D(v3BoundsMax.x, v3BoundsMax.y, v3BoundsMax.z, 1.0f);
+	object.m_uiIndexCount = command.m_uiCount;
+	object.m_uiFirstIndex = command.m_uiFirstIndex;
+	object.m_iBaseVertex = command.m_iBaseVertex;
+
+	m_vecObjects.push_back(object);
+	m_vecDrawData.push_back(drawData);
+
+	return static_cast<GLuint>(m_vecObjects.size() - 1);
+}
+
+bool CCullingScene::Upload()
+{
+	if (m_hObjectBuffer.IsValid())
+	{
+		syserr("Culling scene is already uploaded");
+		return (false);
+	}
+
+	if (m_vecObjects.empty())
+	{
+		return (true);
+	}
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hObjectBuffer = resourceManager.CreateBuffer(m_vecObjects.size() * sizeof(TCullObject), m_vecObjects.data(), 0);
+	m_hDrawDataBuffer = resourceManager.CreateBuffer(m_vecDrawData.size() * sizeof(TIndirectDrawData), m_vecDrawData.data(), 0);
+
+	if (m_hObjectBuffer.IsValid() == false || m_hDrawDataBuffer.IsValid() == false)
+	{
+		syserr("Failed to upload %zu culling objects", m_vecObjects.size());
+		Destroy();
+		return (false);
+	}
+
+	m_uiObjectCount = static_cast<GLuint>(m_vecObjects.size());
+	syslog("Culling scene uploaded with %u objects", m_uiObjectCount);
+
+	// the GPU copy is all that is needed from now on
+	std::vector<TCullObject>().swap(m_vecObjects);
+	std::vector<TIndirectDrawData>().swap(m_vecDrawData);
+	return (true);
+}
+
+GLuint CCullingScene::GetObjectCount() const
+{
+	return (m_uiObjectCount);
+}
+
+BufferHandle CCullingScene::GetObjectBuffer() const
+{
+	return (m_hObjectBuffer);
+}
+
+BufferHandle CCullingScene::GetDrawDataBuffer() const
+{
+	return (m_hDrawDataBuffer);
+}
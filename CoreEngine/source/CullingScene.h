@@ -0,0 +1,63 @@
+#pragma once
+
+#include <maths.h>
+#include <singleton.h>
+#include <vector>
+#include "FramePacket.h"
+
+/**
+ * Object as read by cull.comp, std430 layout.
+ */
+typedef struct SCullObject
+{
+	Vector4D m_v4BoundsMin;		// world space, w unused
+	Vector4D m_v4BoundsMax;
+	GLuint m_uiIndexCount;		// draw emitted when the object is visible
+	GLuint m_uiFirstIndex;
+	GLint m_iBaseVertex;
+	GLuint m_uiPadding;
+} TCullObject;
+
+static_assert(sizeof(TCullObject) == 48, "Cull object does not match the std430 layout");
+
+/**
+ * Static objects culled on the GPU: bounds, draw ranges and per draw data
+ * uploaded once, the CPU does no per object work after that.
+ * Filled while loading, the buffers are immutable once uploaded.
+ */
+class CCullingScene : public CSingleton<CCullingScene>
+{
+public:
+	CCullingScene();
+	~CCullingScene();
+
+	CCullingScene(const CCullingScene&) = delete;
+	CCullingScene& operator=(const CCullingScene&) = delete;
+
+	void Destroy();
+
+	/**
+	 * @param command Draw range of the object, instance fields are ignored
+	 * @return Index of the object
+	 */
+	GLuint AddObject(const Vector3D& v3BoundsMin, const Vector3D& v3BoundsMax, const TDrawElementsIndirectCommand& command, const TIndirectDrawData& drawData);
+
+	/**
+	 * Creates the GPU buffers, the GL context has to be current.
+	 * The CPU copies are released afterwards.
+	 */
+	bool Upload();
+
+	// Accessors
+	GLuint GetObjectCount() const;
+	BufferHandle GetObjectBuffer() const;
+	BufferHandle GetDrawDataBuffer() const;
+
+private:
+	std::vector<TCullObject> m_vecObjects;
+	std::vector<TIndirectDrawData> m_vecDrawData;
+
+	BufferHandle m_hObjectBuffer;
+	BufferHandle m_hDrawDataBuffer;
+	GLuint m_uiObjectCount;
+};
@@ -0,0 +1,216 @@
+#include "DepthPyramid.h"
+#include <utils.h>
+#include <algorithm>
+
+CDepthPyramid::CDepthPyramid()
+{
+	m_uiTexture = 0;
+	m_uiSampler = 0;
+	m_uiCounterBuffer = 0;
+
+	m_iLevelCount = 0;
+	m_iWidth = 0;
+	m_iHeight = 0;
+	m_iDepthWidth = 0;
+	m_iDepthHeight = 0;
+	m_bIsBuilt = false;
+}
+
+CDepthPyramid::~CDepthPyramid()
+{
+	Destroy();
+}
+
+bool CDepthPyramid::Resize(GLint iDepthWidth, GLint iDepthHeight)
+{
+	if (iDepthWidth == m_iDepthWidth && iDepthHeight == m_iDepthHeight && m_uiTexture)
+	{
+		return (true);
+	}
+
+	Destroy();
+
+	if (iDepthWidth <= 0 || iDepthHeight <= 0)
+	{
+		syserr("Invalid depth pyramid size %dx%d", iDepthWidth, iDepthHeight);
+		return (false);
+	}
+
+	m_iDepthWidth = iDepthWidth;
+	m_iDepthHeight = iDepthHeight;
+	m_iWidth = (iDepthWidth + 1) / 2;
+	m_iHeight = (iDepthHeight + 1) / 2;
+
+	// halving rounded up until 1x1
+	m_iLevelCount = 1;
+	for (GLint iSize = std::max(m_iWidth, m_iHeight); iSize > 1; iSize = (iSize + 1) / 2)
+	{
+		m_iLevelCount++;
+	}
+
+	if (m_iLevelCount > DEPTH_PYRAMID_MAX_LEVELS)
+	{
+		syserr("Depth buffer %dx%d is too large for a depth pyramid", iDepthWidth, iDepthHeight);
+		Destroy();
+		return (false);
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_uiTexture);
+	glTextureStorage2D(m_uiTexture, m_iLevelCount, GL_RG32F, m_iWidth, m_iHeight);
+
+	// texels are conservative bounds, blending them would break that
+	glCreateSamplers(1, &m_uiSampler);
+	glSamplerParameteri(m_uiSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glSamplerParameteri(m_uiSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(m_uiSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_uiSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	const GLuint uiZero = 0;
+	glCreateBuffers(1, &m_uiCounterBuffer);
+	glNamedBufferStorage(m_uiCounterBuffer, sizeof(GLuint), &uiZero, 0);
+
+	return (true);
+}
+
+void CDepthPyramid::Destroy()
+{
+	if (m_uiTexture)
+	{
+		glDeleteTextures(1, &m_uiTexture);
+		m_uiTexture = 0;
+	}
+
+	if (m_uiSampler)
+	{
+		glDeleteSamplers(1, &m_uiSampler);
+		m_uiSampler = 0;
+	}
+
+	if (m_uiCounterBuffer)
+	{
+		glDeleteBuffers(1, &m_uiCounterBuffer);
+		m_uiCounterBuffer = 0;
+	}
+
+	m_iLevelCount = 0;
+	m_iWidth = 0;
+	m_iHeight = 0;
+	m_iDepthWidth = 0;
+	m_iDepthHeight = 0;
+	m_bIsBuilt = false;
+}
+
+void CDepthPyramid::Build(CShader& pyramidShader, GLuint uiDepthTexture)
+{
+	if (m_uiTexture == 0 || uiDepthTexture == 0 || pyramidShader.IsReady() == false)
+	{
+		return;
+	}
+
+	pyramidShader.Use();
+	pyramidShader.SetInt("sourceTexture", DEPTH_PYRAMID_SOURCE_UNIT);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DEPTH_PYRAMID_COUNTER_BINDING, m_uiCounterBuffer);
+
+	// only texelFetch is used, no sampler state applies
+	glBindSampler(DEPTH_PYRAMID_SOURCE_UNIT, 0);
+
+	GLuint uiSource = uiDepthTexture;
+	GLint iSourceLevel = 0;
+	GLint iSourceWidth = m_iDepthWidth;
+	GLint iSourceHeight = m_iDepthHeight;
+
+	GLint iFirstLevel = 0;
+	while (iFirstLevel < m_iLevelCount)
+	{
+		const GLint iGroupsX = (iSourceWidth + DEPTH_PYRAMID_GROUP_TILE - 1) / DEPTH_PYRAMID_GROUP_TILE;
+		const GLint iGroupsY = (iSourceHeight + DEPTH_PYRAMID_GROUP_TILE - 1) / DEPTH_PYRAMID_GROUP_TILE;
+
+		GLint iLevels = std::min<GLint>(m_iLevelCount - iFirstLevel, DEPTH_PYRAMID_DISPATCH_LEVELS);
+
+		// the last workgroup reduces the whole sixth level alone, it has to fit in one tile
+		if (iGroupsX > DEPTH_PYRAMID_GROUP_TILE || iGroupsY > DEPTH_PYRAMID_GROUP_TILE)
+		{
+			iLevels = std::min<GLint>(iLevels, DEPTH_PYRAMID_GROUP_LEVELS);
+		}
+
+		glBindTextureUnit(DEPTH_PYRAMID_SOURCE_UNIT, uiSource);
+		for (GLint i = 0; i < iLevels; i++)
+		{
+			BindLevelImage(static_cast<GLuint>(i), iFirstLevel + i, GL_READ_WRITE);
+		}
+
+		pyramidShader.SetInt("sourceLevel", iSourceLevel);
+		pyramidShader.SetBool("sourceIsDepth", uiSource == uiDepthTexture);
+		pyramidShader.SetIVec2("sourceSize", iSourceWidth, iSourceHeight);
+		pyramidShader.SetInt("levelCount", iLevels);
+		pyramidShader.SetInt("groupCount", iGroupsX * iGroupsY);
+		pyramidShader.Dispatch(iGroupsX, iGroupsY);
+
+		iFirstLevel += iLevels;
+
+		// the next dispatch fetches what was just stored, the consumers of the
+		// finished pyramid issue their own barrier
+		if (iFirstLevel < m_iLevelCount)
+		{
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		}
+
+		uiSource = m_uiTexture;
+		iSourceLevel = iFirstLevel - 1;
+		iSourceWidth = (m_iWidth + (1 << iSourceLevel) - 1) >> iSourceLevel;
+		iSourceHeight = (m_iHeight + (1 << iSourceLevel) - 1) >> iSourceLevel;
+	}
+
+	m_bIsBuilt = true;
+}
+
+void CDepthPyramid::BindTexture(GLuint uiUnit) const
+{
+	glBindTextureUnit(uiUnit, m_uiTexture);
+	glBindSampler(uiUnit, m_uiSampler);
+}
+
+void CDepthPyramid::BindLevelImage(GLuint uiUnit, GLint iLevel, GLenum eAccess) const
+{
+	glBindImageTexture(uiUnit, m_uiTexture, iLevel, GL_FALSE, 0, eAccess, GL_RG32F);
+}
+
+bool CDepthPyramid::IsBuilt() const
+{
+	return (m_bIsBuilt);
+}
+
+GLuint CDepthPyramid::GetTexture() const
+{
+	return (m_uiTexture);
+}
+
+GLuint CDepthPyramid::GetSampler() const
+{
+	return (m_uiSampler);
+}
+
+GLint CDepthPyramid::GetLevelCount() const
+{
+	return (m_iLevelCount);
+}
+
+GLint CDepthPyramid::GetWidth() const
+{
+	return (m_iWidth);
+}
+
+GLint CDepthPyramid::GetHeight() const
+{
+	return (m_iHeight);
+}
+
+GLint CDepthPyramid::GetDepthWidth() const
+{
+	return (m_iDepthWidth);
+}
+
+GLint CDepthPyramid::GetDepthHeight() const
+{
+	return (m_iDepthHeight);
+}
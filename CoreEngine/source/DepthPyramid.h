@@ -0,0 +1,88 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "Shader.h"
+
+enum EDepthPyramidData
+{
+	DEPTH_PYRAMID_GROUP_SIZE = 256,			// local_size_x of depth_pyramid.comp
+	DEPTH_PYRAMID_GROUP_TILE = 64,			// source texels per axis reduced by one workgroup
+	DEPTH_PYRAMID_GROUP_LEVELS = 6,			// levels a workgroup writes on its own
+	DEPTH_PYRAMID_DISPATCH_LEVELS = 8,		// image units bound per dispatch, the GL minimum
+	DEPTH_PYRAMID_MAX_LEVELS = 16,
+
+	DEPTH_PYRAMID_SOURCE_UNIT = 0,
+	DEPTH_PYRAMID_COUNTER_BINDING = 6,
+};
+
+/**
+ * Min/max mip pyramid of a depth buffer, r holds the nearest and g the
+ * farthest depth of every texel's footprint.
+ *
+ * Level 0 is half the depth buffer rounded up, each level halves the previous
+ * one rounded up until 1x1, so texel (x, y) of level n covers the depth texels
+ * [x, y] * 2^(n + 1) to [x + 1, y + 1] * 2^(n + 1) - 1 for any size.
+ * It is built by depth_pyramid.comp in a single dispatch, larger pyramids need
+ * a second one for the levels past DEPTH_PYRAMID_DISPATCH_LEVELS.
+ * Render thread only.
+ */
+class CDepthPyramid
+{
+public:
+	CDepthPyramid();
+	~CDepthPyramid();
+
+	CDepthPyramid(const CDepthPyramid&) = delete;
+	CDepthPyramid& operator=(const CDepthPyramid&) = delete;
+
+	/**
+	 * Recreates the pyramid for a depth buffer of the given size,
+	 * the content is undefined until the next Build().
+	 */
+	bool Resize(GLint iDepthWidth, GLint iDepthHeight);
+	void Destroy();
+
+	/**
+	 * Reduces the depth texture, which has to be of the size given to Resize().
+	 * Consumers need a texture fetch barrier before reading the result.
+	 */
+	void Build(CShader& pyramidShader, GLuint uiDepthTexture);
+
+	/**
+	 * Binds the mip chain with its nearest mipmap nearest sampler.
+	 */
+	void BindTexture(GLuint uiUnit) const;
+
+	/**
+	 * Binds a single level as an rg32f image.
+	 *
+	 * @param eAccess GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+	 */
+	void BindLevelImage(GLuint uiUnit, GLint iLevel, GLenum eAccess) const;
+
+	/**
+	 * @return true once built since the last Resize()
+	 */
+	bool IsBuilt() const;
+
+	// Accessors
+	GLuint GetTexture() const;
+	GLuint GetSampler() const;
+	GLint GetLevelCount() const;
+	GLint GetWidth() const;
+	GLint GetHeight() const;
+	GLint GetDepthWidth() const;
+	GLint GetDepthHeight() const;
+
+private:
+	GLuint m_uiTexture;
+	GLuint m_uiSampler;
+	GLuint m_uiCounterBuffer;		// workgroups done, reset by the last one
+
+	GLint m_iLevelCount;
+	GLint m_iWidth;
+	GLint m_iHeight;
+	GLint m_iDepthWidth;
+	GLint m_iDepthHeight;
+	bool m_bIsBuilt;
+};
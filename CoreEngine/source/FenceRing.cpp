@@ -0,0 +1,67 @@
+#include "FenceRing.h"
+
+CFenceRing::CFenceRing()
+{
+	m_arrFences.fill(nullptr);
+	m_uiSlot = 0;
+	m_bSlotAcquired = false;
+}
+
+CFenceRing::~CFenceRing()
+{
+	Reset();
+}
+
+void CFenceRing::Reset()
+{
+	for (GLsync& pFence : m_arrFences)
+	{
+		if (pFence)
+		{
+			glDeleteSync(pFence);
+			pFence = nullptr;
+		}
+	}
+
+	m_uiSlot = 0;
+	m_bSlotAcquired = false;
+}
+
+bool CFenceRing::AcquireSlot()
+{
+	m_bSlotAcquired = true;
+
+	GLsync& pFence = m_arrFences[m_uiSlot];
+	if (pFence == nullptr)
+	{
+		return (false);
+	}
+
+	// the first call flushes so the fence is sure to signal, the others only wait
+	GLbitfield uiFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (glClientWaitSync(pFence, uiFlags, FENCE_RING_WAIT_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+	{
+		uiFlags = 0;
+	}
+
+	glDeleteSync(pFence);
+	pFence = nullptr;
+	return (true);
+}
+
+void CFenceRing::EndFrame()
+{
+	if (m_bSlotAcquired == false)
+	{
+		return;
+	}
+
+	m_arrFences[m_uiSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_uiSlot = (m_uiSlot + 1) % FRAME_PACKET_COUNT;
+	m_bSlotAcquired = false;
+}
+
+GLuint CFenceRing::GetSlot() const
+{
+	return (m_uiSlot);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include "FramePacket.h"
+
+enum EFenceRingData
+{
+	// Nanoseconds per glClientWaitSync call while a slot is still in use
+	FENCE_RING_WAIT_TIMEOUT = 1000000,
+};
+
+/**
+ * Fences of a buffer split into FRAME_PACKET_COUNT slots written round robin,
+ * the same slot is written again FRAME_PACKET_COUNT frames later and the
+ * wait for the GPU to be done with it is normally already over.
+ * Render thread only.
+ */
+class CFenceRing
+{
+public:
+	CFenceRing();
+	~CFenceRing();
+
+	CFenceRing(const CFenceRing&) = delete;
+	CFenceRing& operator=(const CFenceRing&) = delete;
+
+	/**
+	 * Drops the fences and goes back to the first slot.
+	 */
+	void Reset();
+
+	/**
+	 * Waits until the GPU is done with the current slot, it is written this frame.
+	 *
+	 * @return true if the slot was fenced before, its content from
+	 * FRAME_PACKET_COUNT frames ago can be read
+	 */
+	bool AcquireSlot();
+
+	/**
+	 * Fences the slot acquired this frame and moves to the next one.
+	 * Nothing happens if no slot was acquired.
+	 */
+	void EndFrame();
+
+	GLuint GetSlot() const;
+
+private:
+	std::array<GLsync, FRAME_PACKET_COUNT> m_arrFences;
+	GLuint m_uiSlot;
+	bool m_bSlotAcquired;
+};
@@ -0,0 +1,473 @@
+#include "FontAtlas.h"
+#include <utils.h>
+#include <algorithm>
+#include <cstring>
+
+#if ANUBIS_WITH_FREETYPE
+#pragma comment(lib, "freetype.lib")
+#endif
+
+// drawn for malformed UTF-8, FreeType falls back to the missing glyph if the font lacks it
+static const GLuint UTF8_REPLACEMENT_CHARACTER = 0xFFFD;
+
+static GLuint DecodeUTF8(std::string_view svText, size_t& stOffset)
+{
+	const GLubyte ubLead = static_cast<GLubyte>(svText[stOffset++]);
+	if (ubLead < 0x80)
+	{
+		return (ubLead);
+	}
+
+	GLint iContinuations = 0;
+	GLuint uiCodePoint = 0;
+	if ((ubLead & 0xE0) == 0xC0)
+	{
+		iContinuations = 1;
+		uiCodePoint = ubLead & 0x1F;
+	}
+	else if ((ubLead & 0xF0) == 0xE0)
+	{
+		iContinuations = 2;
+		uiCodePoint = ubLead & 0x0F;
+	}
+	else if ((ubLead & 0xF8) == 0xF0)
+	{
+		iContinuations = 3;
+		uiCodePoint = ubLead & 0x07;
+	}
+	else
+	{
+		return (UTF8_REPLACEMENT_CHARACTER);
+	}
+
+	for (GLint i = 0; i < iContinuations; i++)
+	{
+		if (stOffset >= svText.size() || (static_cast<GLubyte>(svText[stOffset]) & 0xC0) != 0x80)
+		{
+			return (UTF8_REPLACEMENT_CHARACTER);
+		}
+
+		uiCodePoint = (uiCodePoint << 6) | (static_cast<GLubyte>(svText[stOffset++]) & 0x3F);
+	}
+
+	return (uiCodePoint);
+}
+
+static uint64_t HashText(FontHandle hFont, std::string_view svText)
+{
+	// the same string in two fonts gets two entries
+	return (std::hash<std::string_view>{}(svText) ^ (static_cast<uint64_t>(hFont.m_uiIndex + 1) * 0x9E3779B97F4A7C15ull));
+}
+
+#if ANUBIS_WITH_FREETYPE
+// FreeType metrics are 26.6 fixed point
+static GLint RoundFixed(FT_Pos lValue)
+{
+	return (static_cast<GLint>((lValue + 32) >> 6));
+}
+#endif
+
+CFontAtlas::CFontAtlas()
+{
+	m_pLibrary = nullptr;
+	m_uiAtlasGeneration = 0;
+	m_uiAtlasResets = 0;
+	m_iDirtyBegin = FONT_ATLAS_SIZE;
+	m_iDirtyEnd = 0;
+	m_uiGlyphCount = 0;
+	m_uiTexture = 0;
+}
+
+CFontAtlas::~CFontAtlas()
+{
+	Destroy();
+}
+
+bool CFontAtlas::Initialize()
+{
+#if ANUBIS_WITH_FREETYPE
+	if (FT_Init_FreeType(&m_pLibrary) != 0)
+	{
+		syserr("Failed to initialize FreeType");
+		m_pLibrary = nullptr;
+		return (false);
+	}
+#endif
+
+	m_poolFonts.Initialize(FONT_MAX_FONTS);
+	m_skyline.Initialize(FONT_ATLAS_SIZE, FONT_ATLAS_SIZE);
+	m_vecPixels.assign(static_cast<size_t>(FONT_ATLAS_SIZE) * FONT_ATLAS_SIZE, 0);
+
+	// the empty atlas goes up with the first Update()
+	m_iDirtyBegin = 0;
+	m_iDirtyEnd = FONT_ATLAS_SIZE;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_uiTexture);
+	glTextureStorage2D(m_uiTexture, 1, GL_R8, FONT_ATLAS_SIZE, FONT_ATLAS_SIZE);
+	glTextureParameteri(m_uiTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_uiTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_uiTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_uiTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// sampled like any RGBA texture, the 2D shader multiplies it with the vertex color
+	const GLint arrSwizzle[4] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+	glTextureParameteriv(m_uiTexture, GL_TEXTURE_SWIZZLE_RGBA, arrSwizzle);
+
+	syslog("Font atlas of %dx%d texels", FONT_ATLAS_SIZE, FONT_ATLAS_SIZE);
+	return (true);
+}
+
+void CFontAtlas::Destroy()
+{
+#if ANUBIS_WITH_FREETYPE
+	m_poolFonts.ForEach([](FontHandle, TFont& font) { FT_Done_Face(font.m_pFace); });
+#endif
+	m_poolFonts.Destroy();
+	m_mShapedTexts.clear();
+
+#if ANUBIS_WITH_FREETYPE
+	if (m_pLibrary)
+	{
+		FT_Done_FreeType(m_pLibrary);
+		m_pLibrary = nullptr;
+	}
+#endif
+
+	if (m_uiTexture)
+	{
+		glDeleteTextures(1, &m_uiTexture);
+		m_uiTexture = 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexAtlas);
+	m_vecPixels.clear();
+	m_vecPixels.shrink_to_fit();
+	m_iDirtyBegin = FONT_ATLAS_SIZE;
+	m_iDirtyEnd = 0;
+	m_uiGlyphCount = 0;
+}
+
+FontHandle CFontAtlas::LoadFont(const std::string& stPath, GLint iPixelSize, bool bSDF)
+{
+#if ANUBIS_WITH_FREETYPE
+	FT_Face pFace = nullptr;
+	if (m_pLibrary == nullptr || FT_New_Face(m_pLibrary, stPath.c_str(), 0, &pFace) != 0)
+	{
+		syserr("Failed to load the font %s", stPath.c_str());
+		return (FontHandle());
+	}
+
+	if (FT_Set_Pixel_Sizes(pFace, 0, static_cast<FT_UInt>(iPixelSize)) != 0)
+	{
+		syserr("Font %s has no %d pixels size", stPath.c_str(), iPixelSize);
+		FT_Done_Face(pFace);
+		return (FontHandle());
+	}
+
+	const FontHandle hFont = m_poolFonts.Create();
+	TFont* pFont = m_poolFonts.Get(hFont);
+	if (pFont == nullptr)
+	{
+		syserr("Cannot load more than %d fonts", FONT_MAX_FONTS);
+		FT_Done_Face(pFace);
+		return (FontHandle());
+	}
+
+	pFont->m_pFace = pFace;
+	pFont->m_iPixelSize = iPixelSize;
+	pFont->m_iLineHeight = RoundFixed(pFace->size->metrics.height);
+	pFont->m_iAscender = RoundFixed(pFace->size->metrics.ascender);
+	pFont->m_bSDF = bSDF;
+	pFont->m_bHasKerning = FT_HAS_KERNING(pFace);
+
+	syslog("Loaded font %s at %d pixels%s", stPath.c_str(), iPixelSize, bSDF ? " as distance fields" : "");
+	return (hFont);
+#else
+	(void)iPixelSize;
+	(void)bSDF;
+	syserr("Cannot load the font %s, the engine was built without ANUBIS_WITH_FREETYPE", stPath.c_str());
+	return (FontHandle());
+#endif
+}
+
+void CFontAtlas::DestroyFont(FontHandle hFont)
+{
+	// its glyphs stay in the atlas until the next reset, its shaped strings until swept
+	TFont* pFont = m_poolFonts.Get(hFont);
+	if (pFont == nullptr)
+	{
+		return;
+	}
+
+	m_uiGlyphCount -= static_cast<GLuint>(pFont->m_mGlyphs.size());
+#if ANUBIS_WITH_FREETYPE
+	FT_Done_Face(pFont->m_pFace);
+#endif
+	m_poolFonts.Remove(hFont);
+}
+
+GLint CFontAtlas::GetLineHeight(FontHandle hFont) const
+{
+	const TFont* pFont = m_poolFonts.Get(hFont);
+	return (pFont ? pFont->m_iLineHeight : 0);
+}
+
+bool CFontAtlas::IsSDF(FontHandle hFont) const
+{
+	const TFont* pFont = m_poolFonts.Get(hFont);
+	return (pFont && pFont->m_bSDF);
+}
+
+// fonts only exist with FreeType, neither is called without it
+#if ANUBIS_WITH_FREETYPE
+const SCharacterInfo* CFontAtlas::GetGlyph(TFont& font, GLuint uiCodePoint, FT_UInt uiGlyphIndex)
+{
+	const auto it = font.m_mGlyphs.find(uiCodePoint);
+	if (it != font.m_mGlyphs.end())
+	{
+		return (&it->second);
+	}
+
+	if (FT_Load_Glyph(font.m_pFace, uiGlyphIndex, FT_LOAD_DEFAULT) != 0)
+	{
+		return (nullptr);
+	}
+
+	// blanks only advance, the distance field renderer rejects empty outlines
+	const FT_GlyphSlot pSlot = font.m_pFace->glyph;
+	const bool bIsBlank = (pSlot->format == FT_GLYPH_FORMAT_OUTLINE && pSlot->outline.n_points == 0);
+	if (bIsBlank == false && FT_Render_Glyph(pSlot, font.m_bSDF ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL) != 0)
+	{
+		return (nullptr);
+	}
+
+	SCharacterInfo glyph{};
+	glyph.m_iCharCode = static_cast<GLint>(uiCodePoint);
+	glyph.m_iWidth = bIsBlank ? 0 : static_cast<GLint>(pSlot->bitmap.width);
+	glyph.m_iHeight = bIsBlank ? 0 : static_cast<GLint>(pSlot->bitmap.rows);
+	glyph.m_iBearingX = pSlot->bitmap_left;
+	glyph.m_iBearingY = pSlot->bitmap_top;
+	glyph.m_iAdvance = RoundFixed(pSlot->advance.x);
+	glyph.m_pData = nullptr;
+
+	if (glyph.m_iWidth > 0 && glyph.m_iHeight > 0)
+	{
+		GLint iX = 0;
+		GLint iY = 0;
+		const GLint iPaddedWidth = glyph.m_iWidth + 2 * FONT_ATLAS_PADDING;
+		const GLint iPaddedHeight = glyph.m_iHeight + 2 * FONT_ATLAS_PADDING;
+		if (m_skyline.Allocate(iPaddedWidth, iPaddedHeight, iX, iY) == false)
+		{
+			// the caller sees the generation change and shapes its text again
+			ResetAtlas();
+			return (nullptr);
+		}
+
+		glyph.m_iXOffset = iX + FONT_ATLAS_PADDING;
+		glyph.m_iYOffset = iY + FONT_ATLAS_PADDING;
+
+		std::lock_guard<std::mutex> lock(m_mutexAtlas);
+		const FT_Bitmap& bitmap = pSlot->bitmap;
+		for (GLint iRow = 0; iRow < glyph.m_iHeight; iRow++)
+		{
+			std::memcpy(&m_vecPixels[static_cast<size_t>(glyph.m_iYOffset + iRow) * FONT_ATLAS_SIZE + glyph.m_iXOffset],
+				bitmap.buffer + static_cast<ptrdiff_t>(iRow) * bitmap.pitch, glyph.m_iWidth);
+		}
+
+		m_iDirtyBegin = std::min(m_iDirtyBegin, glyph.m_iYOffset);
+		m_iDirtyEnd = std::max(m_iDirtyEnd, glyph.m_iYOffset + glyph.m_iHeight);
+	}
+
+	m_uiGlyphCount++;
+	return (&font.m_mGlyphs.emplace(uiCodePoint, glyph).first->second);
+}
+
+#else
+const SCharacterInfo* CFontAtlas::GetGlyph(TFont&, GLuint, FT_UInt)
+{
+	return (nullptr);
+}
+#endif
+
+void CFontAtlas::ResetAtlas()
+{
+	syswarn("Font atlas is full after %u glyphs, starting over", m_uiGlyphCount);
+
+	m_skyline.Clear();
+	m_poolFonts.ForEach([](FontHandle, TFont& font) { font.m_mGlyphs.clear(); });
+	m_uiGlyphCount = 0;
+
+	// shaped strings check the generation before they are used again
+	m_uiAtlasGeneration++;
+	m_uiAtlasResets++;
+
+	std::lock_guard<std::mutex> lock(m_mutexAtlas);
+	std::fill(m_vecPixels.begin(), m_vecPixels.end(), static_cast<GLubyte>(0));
+	m_iDirtyBegin = 0;
+	m_iDirtyEnd = FONT_ATLAS_SIZE;
+}
+
+#if ANUBIS_WITH_FREETYPE
+void CFontAtlas::Shape(TFont& font, TShapedText& shapedText)
+{
+	const std::string_view svText = shapedText.m_stText;
+	const GLfloat fInverseSize = 1.0f / static_cast<GLfloat>(FONT_ATLAS_SIZE);
+
+	// a reset in the middle of the text dropped the glyphs placed before it, once more
+	// in the fresh atlas, text needing more than the whole atlas is left incomplete
+	for (GLint iAttempt = 0; iAttempt < 2; iAttempt++)
+	{
+		const GLuint uiGeneration = m_uiAtlasGeneration;
+		shapedText.m_vecGlyphs.clear();
+
+		GLfloat fPenX = 0.0f;
+		GLfloat fBaseline = static_cast<GLfloat>(font.m_iAscender);
+		GLfloat fWidth = 0.0f;
+		GLint iLines = 1;
+		FT_UInt uiPrevious = 0;
+
+		size_t stOffset = 0;
+		while (stOffset < svText.size() && uiGeneration == m_uiAtlasGeneration)
+		{
+			const GLuint uiCodePoint = DecodeUTF8(svText, stOffset);
+			if (uiCodePoint == '\n')
+			{
+				fWidth = std::max(fWidth, fPenX);
+				fPenX = 0.0f;
+				fBaseline += static_cast<GLfloat>(font.m_iLineHeight);
+				iLines++;
+				uiPrevious = 0;
+				continue;
+			}
+
+			if (uiCodePoint == '\r')
+			{
+				continue;
+			}
+
+			const FT_UInt uiGlyphIndex = FT_Get_Char_Index(font.m_pFace, uiCodePoint);
+			if (font.m_bHasKerning && uiPrevious && uiGlyphIndex)
+			{
+				FT_Vector kerning{};
+				if (FT_Get_Kerning(font.m_pFace, uiPrevious, uiGlyphIndex, FT_KERNING_DEFAULT, &kerning) == 0)
+				{
+					fPenX += static_cast<GLfloat>(kerning.x) / 64.0f;
+				}
+			}
+			uiPrevious = uiGlyphIndex;
+
+			const SCharacterInfo* pGlyph = GetGlyph(font, uiCodePoint, uiGlyphIndex);
+			if (pGlyph == nullptr)
+			{
+				continue;
+			}
+
+			if (pGlyph->m_iWidth > 0 && pGlyph->m_iHeight > 0)
+			{
+				TShapedGlyph shapedGlyph;
+				shapedGlyph.m_v4Rect = Vector4D(fPenX + static_cast<GLfloat>(pGlyph->m_iBearingX), fBaseline - static_cast<GLfloat>(pGlyph->m_iBearingY),
+					static_cast<GLfloat>(pGlyph->m_iWidth), static_cast<GLfloat>(pGlyph->m_iHeight));
+				shapedGlyph.m_v4TexRect = Vector4D(static_cast<GLfloat>(pGlyph->m_iXOffset) * fInverseSize, static_cast<GLfloat>(pGlyph->m_iYOffset) * fInverseSize,
+					static_cast<GLfloat>(pGlyph->m_iXOffset + pGlyph->m_iWidth) * fInverseSize, static_cast<GLfloat>(pGlyph->m_iYOffset + pGlyph->m_iHeight) * fInverseSize);
+				shapedText.m_vecGlyphs.push_back(shapedGlyph);
+			}
+
+			fPenX += static_cast<GLfloat>(pGlyph->m_iAdvance);
+		}
+
+		shapedText.m_v2Size = Vector2D(std::max(fWidth, fPenX), static_cast<GLfloat>(iLines * font.m_iLineHeight));
+		if (uiGeneration == m_uiAtlasGeneration)
+		{
+			break;
+		}
+	}
+
+	shapedText.m_uiAtlasGeneration = m_uiAtlasGeneration;
+}
+#else
+void CFontAtlas::Shape(TFont&, TShapedText& shapedText)
+{
+	shapedText.m_vecGlyphs.clear();
+	shapedText.m_v2Size = Vector2D(0.0f, 0.0f);
+	shapedText.m_uiAtlasGeneration = m_uiAtlasGeneration;
+}
+#endif
+
+void CFontAtlas::SweepShapeCache(GLuint64 ulFrameIndex)
+{
+	if (m_mShapedTexts.size() < FONT_SHAPE_CACHE_SIZE)
+	{
+		return;
+	}
+
+	// text of the current frame is never dropped, the cache may grow past its size instead
+	for (auto it = m_mShapedTexts.begin(); it != m_mShapedTexts.end();)
+	{
+		if (ulFrameIndex - it->second.m_ulLastUsedFrame >= FONT_SHAPE_IDLE_FRAMES)
+		{
+			it = m_mShapedTexts.erase(it);
+			continue;
+		}
+		++it;
+	}
+}
+
+const TShapedText* CFontAtlas::ShapeText(FontHandle hFont, std::string_view svText, GLuint64 ulFrameIndex)
+{
+	TFont* pFont = m_poolFonts.Get(hFont);
+	if (pFont == nullptr)
+	{
+		return (nullptr);
+	}
+
+	const uint64_t ulKey = HashText(hFont, svText);
+	auto it = m_mShapedTexts.find(ulKey);
+	if (it == m_mShapedTexts.end())
+	{
+		SweepShapeCache(ulFrameIndex);
+		it = m_mShapedTexts.emplace(ulKey, TShapedText{}).first;
+	}
+
+	// a new entry, a hash collision or glyphs of a cleared atlas
+	TShapedText& shapedText = it->second;
+	if (shapedText.m_hFont != hFont || shapedText.m_stText != svText || shapedText.m_uiAtlasGeneration != m_uiAtlasGeneration)
+	{
+		shapedText.m_stText.assign(svText);
+		shapedText.m_hFont = hFont;
+		Shape(*pFont, shapedText);
+	}
+
+	shapedText.m_ulLastUsedFrame = ulFrameIndex;
+	return (&shapedText);
+}
+
+void CFontAtlas::Update()
+{
+	std::lock_guard<std::mutex> lock(m_mutexAtlas);
+	if (m_uiTexture == 0 || m_iDirtyBegin >= m_iDirtyEnd)
+	{
+		return;
+	}
+
+	// whole rows, a row is 4 byte aligned and one call covers every glyph added since the last frame
+	glTextureSubImage2D(m_uiTexture, 0, 0, m_iDirtyBegin, FONT_ATLAS_SIZE, m_iDirtyEnd - m_iDirtyBegin, GL_RED, GL_UNSIGNED_BYTE,
+		m_vecPixels.data() + static_cast<size_t>(m_iDirtyBegin) * FONT_ATLAS_SIZE);
+
+	m_iDirtyBegin = FONT_ATLAS_SIZE;
+	m_iDirtyEnd = 0;
+}
+
+GLuint CFontAtlas::GetTexture() const
+{
+	return (m_uiTexture);
+}
+
+TFontAtlasStats CFontAtlas::GetStats() const
+{
+	TFontAtlasStats stats{};
+	stats.m_uiGlyphs = m_uiGlyphCount;
+	stats.m_uiShapedTexts = static_cast<GLuint>(m_mShapedTexts.size());
+	stats.m_uiAtlasResets = m_uiAtlasResets;
+	stats.m_fOccupancy = m_skyline.GetOccupancy();
+	return (stats);
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <singleton.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <EngineTypes.hpp>
+#include "ResourcePool.h"
+#include "SkylineAllocator.h"
+
+// Rasterizing glyphs needs FreeType, define as 1 with freetype.lib in
+// Extern/lib. Without it no font loads and no text is drawn.
+#ifndef ANUBIS_WITH_FREETYPE
+#define ANUBIS_WITH_FREETYPE 0
+#endif
+
+#if ANUBIS_WITH_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#else
+// the handles FreeType declares, the atlas keeps its layout without the library
+typedef struct FT_LibraryRec_* FT_Library;
+typedef struct FT_FaceRec_* FT_Face;
+typedef unsigned int FT_UInt;
+#endif
+
+enum EFontAtlasData
+{
+	// Texels per side of the shared R8 atlas
+	FONT_ATLAS_SIZE = 1024,
+
+	// Empty texels kept around every glyph, bilinear filtering never reads a neighbour
+	FONT_ATLAS_PADDING = 1,
+
+	FONT_MAX_FONTS = 16,
+
+	// Shaped strings kept before the idle ones are dropped
+	FONT_SHAPE_CACHE_SIZE = 1024,
+	FONT_SHAPE_IDLE_FRAMES = 120,
+
+	FONT_ATLAS_UNIT = 0,
+};
+
+struct SFontTag;
+typedef THandle<SFontTag> FontHandle;
+
+/**
+ * Quad of one glyph of a shaped string, relative to the top left of the text.
+ */
+typedef struct SShapedGlyph
+{
+	Vector4D m_v4Rect;			// x, y, width, height in pixels
+	Vector4D m_v4TexRect;		// atlas u0, v0, u1, v1
+} TShapedGlyph;
+
+typedef struct SShapedText
+{
+	std::string m_stText;		// the cache key is only a hash, compared on lookup
+	FontHandle m_hFont;
+	std::vector<TShapedGlyph> m_vecGlyphs;
+	Vector2D m_v2Size;			// pixels, widest line by line count times the line height
+	GLuint m_uiAtlasGeneration;	// glyphs of an older atlas are gone
+	GLuint64 m_ulLastUsedFrame;
+} TShapedText;
+
+typedef struct SFontAtlasStats
+{
+	GLuint m_uiGlyphs;			// rasterized into the current atlas
+	GLuint m_uiShapedTexts;
+	GLuint m_uiAtlasResets;		// times the atlas filled up since Initialize()
+	GLfloat m_fOccupancy;
+} TFontAtlasStats;
+
+/**
+ * Glyphs of every font in one texture, shaped strings ready to be drawn.
+ *
+ * A glyph is rasterized by FreeType the first time its code point is shaped,
+ * either as coverage or as a signed distance field (FT_RENDER_MODE_SDF) which
+ * stays sharp when scaled, and packed into the CPU copy of the atlas by a
+ * skyline allocator. The texture reads as white with the glyph in alpha,
+ * Update() uploads the rows written since the last call.
+ * When the atlas is full it is cleared and refilled with the glyphs used from
+ * then on, text drawn in the frame it happens may show wrong glyphs once.
+ *
+ * ShapeText() lays out a UTF-8 string with kerning and line breaks and keeps
+ * the result keyed by a hash of the text and font, so static and slowly
+ * changing text costs a lookup and a copy per frame. Strings not used for
+ * FONT_SHAPE_IDLE_FRAMES are dropped once the cache is over its size.
+ *
+ * Fonts are loaded and text is shaped on a single thread, Initialize(),
+ * Destroy() and Update() need the GL context.
+ */
+class CFontAtlas : public CSingleton<CFontAtlas>
+{
+public:
+	CFontAtlas();
+	~CFontAtlas();
+
+	CFontAtlas(const CFontAtlas&) = delete;
+	CFontAtlas& operator=(const CFontAtlas&) = delete;
+
+	bool Initialize();
+	void Destroy();
+
+	/**
+	 * @param iPixelSize Height of the em square in pixels
+	 * @param bSDF Distance field glyphs, for text drawn at other sizes
+	 * @return Invalid handle if the file is not a font FreeType can read,
+	 * always without ANUBIS_WITH_FREETYPE
+	 */
+	FontHandle LoadFont(const std::string& stPath, GLint iPixelSize, bool bSDF);
+	void DestroyFont(FontHandle hFont);
+
+	/**
+	 * @return Distance between two baselines in pixels, 0 for an invalid handle
+	 */
+	GLint GetLineHeight(FontHandle hFont) const;
+	bool IsSDF(FontHandle hFont) const;
+
+	/**
+	 * Lays the text out from the top left of its first line.
+	 *
+	 * @return Cached layout valid until a call for a later frame, nullptr
+	 * for an invalid handle
+	 */
+	const TShapedText* ShapeText(FontHandle hFont, std::string_view svText, GLuint64 ulFrameIndex);
+
+	/**
+	 * Uploads the atlas rows written since the last call, render thread.
+	 */
+	void Update();
+
+	GLuint GetTexture() const;
+	TFontAtlasStats GetStats() const;
+
+protected:
+	typedef struct SFont
+	{
+		FT_Face m_pFace;
+		GLint m_iPixelSize;
+		GLint m_iLineHeight;
+		GLint m_iAscender;
+		bool m_bSDF;
+		bool m_bHasKerning;
+		std::unordered_map<GLuint, SCharacterInfo> m_mGlyphs;	// by code point, the pixels live in the atlas
+	} TFont;
+
+	/**
+	 * Rasterizes the glyph into the atlas if it is not there yet.
+	 *
+	 * @return nullptr if FreeType failed or the atlas was full, it is reset then
+	 */
+	const SCharacterInfo* GetGlyph(TFont& font, GLuint uiCodePoint, FT_UInt uiGlyphIndex);
+
+	/**
+	 * Drops every glyph, shaped strings are laid out again on their next use
+	 * and the whole atlas is uploaded.
+	 */
+	void ResetAtlas();
+
+	void Shape(TFont& font, TShapedText& shapedText);
+	void SweepShapeCache(GLuint64 ulFrameIndex);
+
+private:
+	FT_Library m_pLibrary;
+	TResourcePool<TFont, FontHandle> m_poolFonts;
+
+	CSkylineAllocator m_skyline;
+	GLuint m_uiAtlasGeneration;
+	GLuint m_uiAtlasResets;
+
+	// CPU copy of the atlas, written while shaping, read by Update()
+	mutable std::mutex m_mutexAtlas;
+	std::vector<GLubyte> m_vecPixels;
+	GLint m_iDirtyBegin;		// first row not uploaded yet
+	GLint m_iDirtyEnd;			// one past the last one, empty when equal
+
+	std::unordered_map<uint64_t, TShapedText> m_mShapedTexts;
+	GLuint m_uiGlyphCount;
+
+	GLuint m_uiTexture;
+};
@@ -0,0 +1,109 @@
+#include "FrameCapture.h"
+#include <utils.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+void CFrameCapture::ReadFramebuffer(GLint iWidth, GLint iHeight, TCapturedImage& image)
+{
+	image.m_iWidth = iWidth;
+	image.m_iHeight = iHeight;
+	image.m_vecPixels.resize(static_cast<size_t>(iWidth) * iHeight * 3);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadnPixels(0, 0, iWidth, iHeight, GL_RGB, GL_UNSIGNED_BYTE, static_cast<GLsizei>(image.m_vecPixels.size()), image.m_vecPixels.data());
+
+	FlipRows(image);
+}
+
+void CFrameCapture::FlipRows(TCapturedImage& image)
+{
+	const size_t stRowSize = static_cast<size_t>(image.m_iWidth) * 3;
+	std::vector<uint8_t> vecRow(stRowSize);
+
+	for (GLint iRow = 0; iRow < image.m_iHeight / 2; iRow++)
+	{
+		uint8_t* pTop = image.m_vecPixels.data() + iRow * stRowSize;
+		uint8_t* pBottom = image.m_vecPixels.data() + (image.m_iHeight - 1 - iRow) * stRowSize;
+
+		std::memcpy(vecRow.data(), pTop, stRowSize);
+		std::memcpy(pTop, pBottom, stRowSize);
+		std::memcpy(pBottom, vecRow.data(), stRowSize);
+	}
+}
+
+bool CFrameCapture::SavePPM(const std::string& stPath, const TCapturedImage& image)
+{
+	std::ofstream file(stPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file << "P6\n" << image.m_iWidth << ' ' << image.m_iHeight << "\n255\n";
+	file.write(reinterpret_cast<const char*>(image.m_vecPixels.data()), image.m_vecPixels.size());
+
+	return (file.good());
+}
+
+bool CFrameCapture::LoadPPM(const std::string& stPath, TCapturedImage& image)
+{
+	std::ifstream file(stPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s", stPath.c_str());
+		return (false);
+	}
+
+	std::string stMagic;
+	GLint iMaxValue = 0;
+	file >> stMagic >> image.m_iWidth >> image.m_iHeight >> iMaxValue;
+	file.get(); // single whitespace before the pixel data
+
+	if (stMagic != "P6" || iMaxValue != 255 || image.m_iWidth <= 0 || image.m_iHeight <= 0)
+	{
+		syserr("%s is not an 8 bit binary PPM", stPath.c_str());
+		return (false);
+	}
+
+	image.m_vecPixels.resize(static_cast<size_t>(image.m_iWidth) * image.m_iHeight * 3);
+	file.read(reinterpret_cast<char*>(image.m_vecPixels.data()), image.m_vecPixels.size());
+
+	return (file.gcount() == static_cast<std::streamsize>(image.m_vecPixels.size()));
+}
+
+bool CFrameCapture::Compare(const TCapturedImage& imageA, const TCapturedImage& imageB, GLint iTolerance, TImageDifference& difference)
+{
+	difference = TImageDifference{};
+
+	if (imageA.m_iWidth != imageB.m_iWidth || imageA.m_iHeight != imageB.m_iHeight)
+	{
+		syserr("Image sizes differ, %dx%d vs %dx%d", imageA.m_iWidth, imageA.m_iHeight, imageB.m_iWidth, imageB.m_iHeight);
+		return (false);
+	}
+
+	GLdouble dSquaredSum = 0.0;
+	const size_t stPixelCount = imageA.m_vecPixels.size() / 3;
+
+	for (size_t stPixel = 0; stPixel < stPixelCount; stPixel++)
+	{
+		bool bDifferent = false;
+		for (size_t stChannel = 0; stChannel < 3; stChannel++)
+		{
+			const size_t stIndex = stPixel * 3 + stChannel;
+			const GLint iDifference = std::abs(static_cast<GLint>(imageA.m_vecPixels[stIndex]) - static_cast<GLint>(imageB.m_vecPixels[stIndex]));
+
+			difference.m_iMaxDifference = std::max(difference.m_iMaxDifference, iDifference);
+			dSquaredSum += static_cast<GLdouble>(iDifference) * iDifference;
+			bDifferent |= (iDifference > iTolerance);
+		}
+
+		difference.m_uiDifferentPixels += bDifferent ? 1 : 0;
+	}
+
+	difference.m_dRMSE = (stPixelCount > 0) ? std::sqrt(dSquaredSum / (stPixelCount * 3)) : 0.0;
+	return (true);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef struct SCapturedImage
+{
+	GLint m_iWidth;
+	GLint m_iHeight;
+	std::vector<uint8_t> m_vecPixels;	// RGB8, top row first
+} TCapturedImage;
+
+typedef struct SImageDifference
+{
+	GLint m_iMaxDifference;		// Largest difference of a single channel
+	GLdouble m_dRMSE;			// Root mean square error over all channels
+	GLuint m_uiDifferentPixels;	// Pixels with a channel above the tolerance
+} TImageDifference;
+
+/**
+ * Frame readback helpers for regression images.
+ * Images are stored as binary PPM, no image library is needed to write them
+ * and every image viewer / diff tool reads them.
+ */
+class CFrameCapture
+{
+public:
+	/**
+	 * Reads the color buffer of the bound read framebuffer.
+	 */
+	static void ReadFramebuffer(GLint iWidth, GLint iHeight, TCapturedImage& image);
+
+	/**
+	 * Flips GL's bottom-up rows into the top-down order of image files.
+	 */
+	static void FlipRows(TCapturedImage& image);
+
+	static bool SavePPM(const std::string& stPath, const TCapturedImage& image);
+	static bool LoadPPM(const std::string& stPath, TCapturedImage& image);
+
+	/**
+	 * Compares two images of the same size.
+	 *
+	 * @param iTolerance Channel difference still considered equal
+	 * @return false if the sizes do not match
+	 */
+	static bool Compare(const TCapturedImage& imageA, const TCapturedImage& imageB, GLint iTolerance, TImageDifference& difference);
+};
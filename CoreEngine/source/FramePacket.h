@@ -0,0 +1,269 @@
+#pragma once
+
+#include <maths.h>
+#include <array>
+#include <string>
+#include <vector>
+#include <EngineTypes.hpp>
+#include "ResourcePool.h"
+#include "LinearAllocator.h"
+
+enum EFramePacketData
+{
+	// Number of frame packets in flight, the main thread can build up to
+	// (FRAME_PACKET_COUNT - 1) frames ahead of the render thread.
+	FRAME_PACKET_COUNT = 3,
+
+	// Initial capacity of the draw list, grows once and is then reused
+	FRAME_PACKET_DRAW_RESERVE = 256,
+	FRAME_PACKET_INDIRECT_RESERVE = 1024,
+	FRAME_PACKET_2D_VERTEX_RESERVE = 16384,
+	FRAME_PACKET_2D_INDEX_RESERVE = 24576,
+
+	// Textures a single 2D draw samples, SVertex2D::iTextureIndex selects one, see batch2d.frag
+	BATCH_2D_TEXTURE_SLOTS = 8,
+	BATCH_2D_UNTEXTURED = -1,
+
+	// TTexture2D::m_uiFlags
+	BATCH_2D_TEXTURE_FONT_ATLAS = 1 << 0,	// the glyph atlas instead of m_hTexture
+	BATCH_2D_TEXTURE_SDF = 1 << 1,			// alpha is a distance field, not coverage
+};
+
+static_assert(static_cast<int>(FRAME_ARENA_COUNT) == static_cast<int>(FRAME_PACKET_COUNT), "The frame arena of a packet is reset when the packet comes back");
+
+typedef struct SDrawCommand
+{
+	ShaderHandle m_hShader;		// Program used for the draw
+	MeshHandle m_hMesh;			// Indexed mesh
+	Matrix4 m_mat4Model;		// Object to world transform
+	GLuint m_uiFirstIndex;		// Index range, a count of 0 draws the whole mesh
+	GLuint m_uiIndexCount;
+} TDrawCommand;
+
+/**
+ * Layout consumed by glMultiDrawElementsIndirect, do not reorder.
+ */
+typedef struct SDrawElementsIndirectCommand
+{
+	GLuint m_uiCount;			// indices
+	GLuint m_uiInstanceCount;
+	GLuint m_uiFirstIndex;
+	GLint m_iBaseVertex;
+	GLuint m_uiBaseInstance;
+} TDrawElementsIndirectCommand;
+
+/**
+ * Per draw data read by the shader through gl_DrawID, std430 layout.
+ */
+typedef struct SIndirectDrawData
+{
+	Matrix4 m_mat4Model;		// Object to world transform
+	GLuint m_uiMaterial;		// Index into the bindless texture table
+	GLuint m_arrPadding[3];
+} TIndirectDrawData;
+
+static_assert(sizeof(TDrawElementsIndirectCommand) == 20, "Indirect command does not match the GL layout");
+static_assert(sizeof(TIndirectDrawData) == 80, "Indirect draw data does not match the std430 layout");
+
+/**
+ * Draws sharing a shader and a mesh, submitted with a single multi draw call.
+ * Command i uses m_vecDrawData[i].
+ */
+typedef struct SIndirectBatch
+{
+	ShaderHandle m_hShader;
+	MeshHandle m_hMesh;			// Shared vertex / index buffers the commands index into
+	TextureHandle m_hTexture;	// Albedo, the placeholder is bound until it is loaded
+	TArenaVector<TDrawElementsIndirectCommand> m_vecCommands;
+	TArenaVector<TIndirectDrawData> m_vecDrawData;
+
+	void Reset()
+	{
+		m_hShader = ShaderHandle();
+		m_hMesh = MeshHandle();
+		m_hTexture = TextureHandle();
+		m_vecCommands.clear();
+		m_vecDrawData.clear();
+	}
+} TIndirectBatch;
+
+/**
+ * Static objects culled and compacted on the GPU, then drawn with
+ * glMultiDrawElementsIndirectCount. Only handles travel with the packet,
+ * the object data stays on the GPU.
+ */
+typedef struct SGPUCullBatch
+{
+	ShaderHandle m_hShader;			// Draw program, reads the surviving draw data through gl_DrawID
+	ShaderHandle m_hCullShader;		// cull.comp
+	MeshHandle m_hMesh;
+	TextureHandle m_hTexture;		// Albedo, the placeholder is bound until it is loaded
+	BufferHandle m_hObjectBuffer;	// TCullObject per object
+	BufferHandle m_hDrawDataBuffer;	// TIndirectDrawData per object
+	GLuint m_uiObjectCount;
+
+	void Reset()
+	{
+		m_hShader = ShaderHandle();
+		m_hCullShader = ShaderHandle();
+		m_hMesh = MeshHandle();
+		m_hTexture = TextureHandle();
+		m_hObjectBuffer = BufferHandle();
+		m_hDrawDataBuffer = BufferHandle();
+		m_uiObjectCount = 0;
+	}
+} TGPUCullBatch;
+
+/**
+ * Meshlets of a cooked mesh culled one by one on the GPU, the surviving
+ * clusters are drawn with glMultiDrawElementsIndirectCount.
+ */
+typedef struct SClusterBatch
+{
+	ShaderHandle m_hShader;			// Draw program, one model matrix for every cluster
+	ShaderHandle m_hCullShader;		// cluster_cull.comp
+	MeshHandle m_hMesh;
+	BufferHandle m_hMeshletBuffer;	// TMeshlet per cluster
+	GLuint m_uiMeshletCount;
+	Matrix4 m_mat4Model;			// Quantized positions to world
+	Matrix4 m_mat4MeshletToWorld;	// Meshlet bounds to world, translation only
+
+	void Reset()
+	{
+		m_hShader = ShaderHandle();
+		m_hCullShader = ShaderHandle();
+		m_hMesh = MeshHandle();
+		m_hMeshletBuffer = BufferHandle();
+		m_uiMeshletCount = 0;
+	}
+} TClusterBatch;
+
+/**
+ * Texture sampled by 2D draws, resolved by the render thread.
+ */
+typedef struct STexture2D
+{
+	TextureHandle m_hTexture;	// the placeholder is sampled until it is loaded
+	GLuint m_uiFlags;			// BATCH_2D_TEXTURE_*
+} TTexture2D;
+
+/**
+ * Index range drawn with one clip rectangle and up to BATCH_2D_TEXTURE_SLOTS
+ * textures, the vertices of the range select their slot.
+ */
+typedef struct SDraw2D
+{
+	GLuint m_uiFirstIndex;
+	GLuint m_uiIndexCount;
+	Vector4D m_v4ClipRect;		// x, y, width, height in pixels from the top left
+	std::array<GLint, BATCH_2D_TEXTURE_SLOTS> m_arrTextures;	// into TBatch2D::m_vecTextures, -1 for unused slots
+} TDraw2D;
+
+/**
+ * Quads, lines, meshes and text of a frame, sorted by layer, clip rectangle
+ * and texture. Positions are pixels from the top left of the viewport.
+ */
+typedef struct SBatch2D
+{
+	ShaderHandle m_hShader;
+	SMeshData2D m_meshData;
+	TArenaVector<TTexture2D> m_vecTextures;
+	TArenaVector<TDraw2D> m_vecDraws;
+
+	void Reset()
+	{
+		m_hShader = ShaderHandle();
+		m_meshData.vVertices.clear();
+		m_meshData.vIndices.clear();
+		m_vecTextures.clear();
+		m_vecDraws.clear();
+	}
+} TBatch2D;
+
+/**
+ * Everything the render thread needs to draw one frame.
+ * Filled by the main thread, consumed by the render thread, then handed back
+ * to the main thread to be reused for a later frame. The lists live in the
+ * frame arena of the frame they were built for, see SetArena().
+ */
+typedef struct SFramePacket
+{
+	GLuint64 m_ulFrameIndex;
+
+	// Framebuffer size the frame was simulated for
+	GLint m_iWidth;
+	GLint m_iHeight;
+
+	// Timing
+	GLfloat m_fTime;
+	GLfloat m_fDeltaTime;
+
+	// Camera
+	Matrix4 m_mat4View;
+	Matrix4 m_mat4Projection;
+	Matrix4 m_mat4ViewProjection;
+	Vector3D m_v3CameraPosition;
+
+	// Per frame uniform data
+	Vector4D m_v4ClearColor;
+
+	// Draw list
+	TArenaVector<TDrawCommand> m_vecDrawCommands;
+
+	// Geometry pool draws, one API call for all of them
+	TIndirectBatch m_indirectBatch;
+	TGPUCullBatch m_gpuCullBatch;
+	TClusterBatch m_clusterBatch;
+
+	// HUD and overlays, drawn after the scene
+	TBatch2D m_batch2D;
+
+	// Min/max depth pyramid built after the opaque draws, skipped when invalid
+	ShaderHandle m_hDepthPyramidShader;
+
+	// Material IDs drawn this frame, their textures are made resident
+	TArenaVector<GLuint> m_vecMaterials;
+
+	SFramePacket()
+	{
+		m_batch2D.m_meshData.vVertices.reserve(FRAME_PACKET_2D_VERTEX_RESERVE);
+		m_batch2D.m_meshData.vIndices.reserve(FRAME_PACKET_2D_INDEX_RESERVE);
+		Reset();
+	}
+
+	void Reset()
+	{
+		m_ulFrameIndex = 0;
+		m_iWidth = 0;
+		m_iHeight = 0;
+		m_fTime = 0.0f;
+		m_fDeltaTime = 0.0f;
+		m_v3CameraPosition = 0.0f;
+		m_v4ClearColor = Vector4D(0.0f, 0.0f, 0.0f, 1.0f);
+
+		// clear() keeps the capacity, no reallocation in steady state
+		m_vecDrawCommands.clear();
+		m_indirectBatch.Reset();
+		m_gpuCullBatch.Reset();
+		m_clusterBatch.Reset();
+		m_batch2D.Reset();
+		m_hDepthPyramidShader = ShaderHandle();
+		m_vecMaterials.clear();
+	}
+
+	/**
+	 * Moves the lists to pArena once the packet was reset, they keep the
+	 * capacity they grew to. Called with the current frame arena right after
+	 * CFrameAllocator::BeginFrame(), the arena of the frame that used the
+	 * packet before may already be reset.
+	 */
+	void SetArena(CLinearAllocator* pArena)
+	{
+		RebindArenaVector(m_vecDrawCommands, pArena, FRAME_PACKET_DRAW_RESERVE);
+		RebindArenaVector(m_indirectBatch.m_vecCommands, pArena, FRAME_PACKET_INDIRECT_RESERVE);
+		RebindArenaVector(m_indirectBatch.m_vecDrawData, pArena, FRAME_PACKET_INDIRECT_RESERVE);
+		RebindArenaVector(m_batch2D.m_vecTextures, pArena);
+		RebindArenaVector(m_batch2D.m_vecDraws, pArena);
+		RebindArenaVector(m_vecMaterials, pArena);
+	}
+} TFramePacket;
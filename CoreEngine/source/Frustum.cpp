@@ -0,0 +1,57 @@
+#include "Frustum.h"
+#include <cmath>
+
+CFrustum::CFrustum()
+{
+	m_arrPlanes.fill(Vector4D(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void CFrustum::Extract(const Matrix4& mat4ViewProjection)
+{
+	// rows of the column major matrix
+	Vector4D arrRows[4];
+	for (GLint iRow = 0; iRow < 4; iRow++)
+	{
+		arrRows[iRow] = Vector4D(mat4ViewProjection[0][iRow], mat4ViewProjection[1][iRow], mat4ViewProjection[2][iRow], mat4ViewProjection[3][iRow]);
+	}
+
+	for (GLint iPlane = 0; iPlane < FRUSTUM_PLANE_COUNT; iPlane++)
+	{
+		// -w <= x, y, z <= w, one plane per side of each axis
+		const Vector4D& v4Row = arrRows[iPlane / 2];
+		const GLfloat fSign = (iPlane % 2 == 0) ? 1.0f : -1.0f;
+
+		Vector4D v4Plane(arrRows[3].x + fSign * v4Row.x, arrRows[3].y + fSign * v4Row.y, arrRows[3].z + fSign * v4Row.z, arrRows[3].w + fSign * v4Row.w);
+
+		const GLfloat fLength = std::sqrt(v4Plane.x * v4Plane.x + v4Plane.y * v4Plane.y + v4Plane.z * v4Plane.z);
+		if (fLength > 0.0f)
+		{
+			v4Plane = Vector4D(v4Plane.x / fLength, v4Plane.y / fLength, v4Plane.z / fLength, v4Plane.w / fLength);
+		}
+
+		m_arrPlanes[iPlane] = v4Plane;
+	}
+}
+
+bool CFrustum::IsBoxVisible(const Vector3D& v3Min, const Vector3D& v3Max) const
+{
+	for (const Vector4D& v4Plane : m_arrPlanes)
+	{
+		// corner furthest along the plane normal
+		const GLfloat fX = (v4Plane.x >= 0.0f) ? v3Max.x : v3Min.x;
+		const GLfloat fY = (v4Plane.y >= 0.0f) ? v3Max.y : v3Min.y;
+		const GLfloat fZ = (v4Plane.z >= 0.0f) ? v3Max.z : v3Min.z;
+
+		if (v4Plane.x * fX + v4Plane.y * fY + v4Plane.z * fZ + v4Plane.w < 0.0f)
+		{
+			return (false);
+		}
+	}
+
+	return (true);
+}
+
+const std::array<Vector4D, FRUSTUM_PLANE_COUNT>& CFrustum::GetPlanes() const
+{
+	return (m_arrPlanes);
+}
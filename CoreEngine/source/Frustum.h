@@ -0,0 +1,37 @@
+#pragma once
+
+#include <maths.h>
+#include <array>
+
+enum EFrustumData
+{
+	FRUSTUM_PLANE_COUNT = 6,	// left, right, bottom, top, near, far
+};
+
+/**
+ * View frustum as six planes facing inwards, extracted from a view projection
+ * matrix (Gribb / Hartmann), so the planes are in the space the matrix transforms from.
+ */
+class CFrustum
+{
+public:
+	CFrustum();
+
+	void Extract(const Matrix4& mat4ViewProjection);
+
+	/**
+	 * Conservative box test, boxes close to a frustum corner may pass while
+	 * being outside.
+	 *
+	 * @return false only if the box is fully behind one of the planes
+	 */
+	bool IsBoxVisible(const Vector3D& v3Min, const Vector3D& v3Max) const;
+
+	/**
+	 * (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside, normalized.
+	 */
+	const std::array<Vector4D, FRUSTUM_PLANE_COUNT>& GetPlanes() const;
+
+private:
+	std::array<Vector4D, FRUSTUM_PLANE_COUNT> m_arrPlanes;
+};
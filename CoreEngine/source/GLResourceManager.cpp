@@ -0,0 +1,366 @@
+#include "GLResourceManager.h"
+#include <utils.h>
+
+CGLResourceManager::CGLResourceManager()
+{
+	m_lBufferMemory = 0;
+}
+
+CGLResourceManager::~CGLResourceManager()
+{
+	Destroy();
+}
+
+void CGLResourceManager::Initialize()
+{
+	m_poolShaders.Initialize(GL_RESOURCE_MAX_SHADERS);
+	m_poolBuffers.Initialize(GL_RESOURCE_MAX_BUFFERS);
+	m_poolMeshes.Initialize(GL_RESOURCE_MAX_MESHES);
+
+	m_vecQueuedObjects.reserve(64);
+}
+
+void CGLResourceManager::Destroy()
+{
+	if (m_poolShaders.GetCapacity() == 0)
+	{
+		return;
+	}
+
+	if (m_poolShaders.GetAliveCount() + m_poolBuffers.GetAliveCount() + m_poolMeshes.GetAliveCount() > 0)
+	{
+		syslog("Releasing leaked GL resources: %u shaders, %u buffers, %u meshes", m_poolShaders.GetAliveCount(), m_poolBuffers.GetAliveCount(), m_poolMeshes.GetAliveCount());
+	}
+
+	// Meshes first, they release their buffers
+	std::vector<MeshHandle> vecMeshes;
+	m_poolMeshes.ForEach([&vecMeshes](MeshHandle hMesh, TMeshResource&) { vecMeshes.push_back(hMesh); });
+	for (MeshHandle hMesh : vecMeshes)
+	{
+		DestroyMesh(hMesh);
+	}
+
+	std::vector<BufferHandle> vecBuffers;
+	m_poolBuffers.ForEach([&vecBuffers](BufferHandle hBuffer, TBufferResource&) { vecBuffers.push_back(hBuffer); });
+	for (BufferHandle hBuffer : vecBuffers)
+	{
+		DestroyBuffer(hBuffer);
+	}
+
+	std::vector<ShaderHandle> vecShaders;
+	m_poolShaders.ForEach([&vecShaders](ShaderHandle hShader, CShader&) { vecShaders.push_back(hShader); });
+	for (ShaderHandle hShader : vecShaders)
+	{
+		DestroyShader(hShader);
+	}
+
+	// nothing renders anymore, no need to wait on fences one by one
+	glFinish();
+	CollectGarbage(true);
+
+	m_poolShaders.Destroy();
+	m_poolBuffers.Destroy();
+	m_poolMeshes.Destroy();
+}
+
+ShaderHandle CGLResourceManager::CreateShader(const std::string& stName, const std::vector<std::string>& vecShaderPaths, const std::vector<std::string>& vecCommonPaths)
+{
+	ShaderHandle hShader = m_poolShaders.Create(stName);
+	CShader* pShader = m_poolShaders.Get(hShader);
+	if (pShader == nullptr)
+	{
+		syserr("Shader pool is full (%d), cannot create %s", GL_RESOURCE_MAX_SHADERS, stName.c_str());
+		return (ShaderHandle());
+	}
+
+	pShader->InitializeShader();
+
+	bool bSucceeded = true;
+	for (const std::string& stShaderPath : vecShaderPaths)
+	{
+		bSucceeded &= pShader->AttachShader(stShaderPath, vecCommonPaths);
+	}
+
+	if (bSucceeded == false || pShader->LinkProgram() == false)
+	{
+		syserr("Failed to build shader %s", stName.c_str());
+		DestroyShader(hShader);
+		return (ShaderHandle());
+	}
+
+	return (hShader);
+}
+
+CShader* CGLResourceManager::GetShader(ShaderHandle hShader)
+{
+	return (m_poolShaders.Get(hShader));
+}
+
+void CGLResourceManager::DestroyShader(ShaderHandle hShader)
+{
+	CShader* pShader = m_poolShaders.Get(hShader);
+	if (pShader == nullptr)
+	{
+		return;
+	}
+
+	// the destructor would delete the program immediately
+	const GLuint uiProgramID = pShader->ReleaseProgram();
+	if (uiProgramID)
+	{
+		QueueDeletion(GL_OBJECT_PROGRAM, uiProgramID);
+	}
+
+	m_poolShaders.Remove(hShader);
+}
+
+BufferHandle CGLResourceManager::CreateBuffer(GLsizeiptr lSize, const void* pData, GLbitfield uiFlags)
+{
+	TBufferResource buffer{};
+	buffer.m_lSize = lSize;
+	buffer.m_uiFlags = uiFlags;
+
+	BufferHandle hBuffer = m_poolBuffers.Create(buffer);
+	TBufferResource* pBuffer = m_poolBuffers.Get(hBuffer);
+	if (pBuffer == nullptr)
+	{
+		syserr("Buffer pool is full (%d)", GL_RESOURCE_MAX_BUFFERS);
+		return (BufferHandle());
+	}
+
+	glCreateBuffers(1, &pBuffer->m_uiBuffer);
+	glNamedBufferStorage(pBuffer->m_uiBuffer, lSize, pData, uiFlags);
+	m_lBufferMemory += lSize;
+
+	return (hBuffer);
+}
+
+TBufferResource* CGLResourceManager::GetBuffer(BufferHandle hBuffer)
+{
+	return (m_poolBuffers.Get(hBuffer));
+}
+
+void CGLResourceManager::DestroyBuffer(BufferHandle hBuffer)
+{
+	TBufferResource* pBuffer = m_poolBuffers.Get(hBuffer);
+	if (pBuffer == nullptr)
+	{
+		return;
+	}
+
+	if (pBuffer->m_uiBuffer)
+	{
+		QueueDeletion(GL_OBJECT_BUFFER, pBuffer->m_uiBuffer);
+		m_lBufferMemory -= pBuffer->m_lSize;
+	}
+
+	m_poolBuffers.Remove(hBuffer);
+}
+
+MeshHandle CGLResourceManager::CreateMesh(const TerrainVertex* pVertices, GLsizei iVertexCount, const GLuint* pIndices, GLsizei iIndexCount)
+{
+	TMeshResource mesh{};
+	if (CreateMeshBuffers(pVertices, iVertexCount, sizeof(TerrainVertex), pIndices, iIndexCount, mesh) == false)
+	{
+		return (MeshHandle());
+	}
+
+	// vertex array attributes
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 0);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v3Position)); // Position Attribute
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 0, 0);
+
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 1);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 1, 2, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v2TexCoords)); // textures coords Attribute
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 1, 0);
+
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 2);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 2, 3, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v3Normals)); // Normals Attribute
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 2, 0);
+
+	return (AddMesh(mesh));
+}
+
+MeshHandle CGLResourceManager::CreateQuantizedMesh(const TQuantizedVertex* pVertices, GLsizei iVertexCount, const GLuint* pIndices, GLsizei iIndexCount)
+{
+	TMeshResource mesh{};
+	if (CreateMeshBuffers(pVertices, iVertexCount, sizeof(TQuantizedVertex), pIndices, iIndexCount, mesh) == false)
+	{
+		return (MeshHandle());
+	}
+
+	// normalized integers, the attribute fetch converts them to floats
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 0);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(TQuantizedVertex, m_arrPosition));
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 0, 0);
+
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 1);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 1, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(TQuantizedVertex, m_arrTexCoord));
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 1, 0);
+
+	glEnableVertexArrayAttrib(mesh.m_uiVAO, 2);
+	glVertexArrayAttribFormat(mesh.m_uiVAO, 2, 3, GL_BYTE, GL_TRUE, offsetof(TQuantizedVertex, m_arrNormal));
+	glVertexArrayAttribBinding(mesh.m_uiVAO, 2, 0);
+
+	return (AddMesh(mesh));
+}
+
+bool CGLResourceManager::CreateMeshBuffers(const void* pVertices, GLsizei iVertexCount, GLsizei iVertexSize, const GLuint* pIndices, GLsizei iIndexCount, TMeshResource& mesh)
+{
+	mesh.m_iIndexCount = iIndexCount;
+	mesh.m_hVertexBuffer = CreateBuffer(static_cast<GLsizeiptr>(iVertexCount) * iVertexSize, pVertices, GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+	mesh.m_hIndexBuffer = CreateBuffer(static_cast<GLsizeiptr>(iIndexCount) * sizeof(GLuint), pIndices, GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+
+	const TBufferResource* pVertexBuffer = m_poolBuffers.Get(mesh.m_hVertexBuffer);
+	const TBufferResource* pIndexBuffer = m_poolBuffers.Get(mesh.m_hIndexBuffer);
+	if (pVertexBuffer == nullptr || pIndexBuffer == nullptr)
+	{
+		DestroyBuffer(mesh.m_hVertexBuffer);
+		DestroyBuffer(mesh.m_hIndexBuffer);
+		return (false);
+	}
+
+	// create Vertex Array
+	glCreateVertexArrays(1, &mesh.m_uiVAO);
+
+	// Attach Buffers to our Vertex Arrays
+	glVertexArrayVertexBuffer(mesh.m_uiVAO, 0, pVertexBuffer->m_uiBuffer, 0, iVertexSize); // attach vertex buffer
+	glVertexArrayElementBuffer(mesh.m_uiVAO, pIndexBuffer->m_uiBuffer); // element buffer
+	return (true);
+}
+
+MeshHandle CGLResourceManager::AddMesh(TMeshResource& mesh)
+{
+	MeshHandle hMesh = m_poolMeshes.Create(mesh);
+	if (hMesh.IsValid() == false)
+	{
+		syserr("Mesh pool is full (%d)", GL_RESOURCE_MAX_MESHES);
+		QueueDeletion(GL_OBJECT_VERTEX_ARRAY, mesh.m_uiVAO);
+		DestroyBuffer(mesh.m_hVertexBuffer);
+		DestroyBuffer(mesh.m_hIndexBuffer);
+	}
+
+	return (hMesh);
+}
+
+const TMeshResource* CGLResourceManager::GetMesh(MeshHandle hMesh) const
+{
+	return (m_poolMeshes.Get(hMesh));
+}
+
+void CGLResourceManager::DestroyMesh(MeshHandle hMesh)
+{
+	const TMeshResource* pMesh = m_poolMeshes.Get(hMesh);
+	if (pMesh == nullptr)
+	{
+		return;
+	}
+
+	if (pMesh->m_uiVAO)
+	{
+		QueueDeletion(GL_OBJECT_VERTEX_ARRAY, pMesh->m_uiVAO);
+	}
+
+	DestroyBuffer(pMesh->m_hVertexBuffer);
+	DestroyBuffer(pMesh->m_hIndexBuffer);
+
+	m_poolMeshes.Remove(hMesh);
+}
+
+void CGLResourceManager::EndFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexDeletion);
+		if (m_vecQueuedObjects.empty() == false)
+		{
+			TDeletionBatch batch{};
+			batch.m_pFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			batch.m_vecObjects.swap(m_vecQueuedObjects);
+			m_dequeDeletionBatches.push_back(std::move(batch));
+		}
+	}
+
+	CollectGarbage(false);
+}
+
+GLuint CGLResourceManager::GetPendingDeletionCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutexDeletion);
+
+	size_t stCount = m_vecQueuedObjects.size();
+	for (const TDeletionBatch& batch : m_dequeDeletionBatches)
+	{
+		stCount += batch.m_vecObjects.size();
+	}
+
+	return static_cast<GLuint>(stCount);
+}
+
+GLsizeiptr CGLResourceManager::GetBufferMemory() const
+{
+	return (m_lBufferMemory);
+}
+
+void CGLResourceManager::QueueDeletion(GLubyte ubType, GLuint uiName)
+{
+	std::lock_guard<std::mutex> lock(m_mutexDeletion);
+	m_vecQueuedObjects.push_back(TDeferredObject{ ubType, uiName });
+}
+
+void CGLResourceManager::DeleteObject(const TDeferredObject& object)
+{
+	switch (object.m_ubType)
+	{
+	case GL_OBJECT_PROGRAM:
+		glDeleteProgram(object.m_uiName);
+		break;
+	case GL_OBJECT_BUFFER:
+		glDeleteBuffers(1, &object.m_uiName);
+		break;
+	case GL_OBJECT_VERTEX_ARRAY:
+		glDeleteVertexArrays(1, &object.m_uiName);
+		break;
+	default:
+		syserr("Unknown deferred GL object type %u", object.m_ubType);
+		break;
+	}
+}
+
+void CGLResourceManager::CollectGarbage(bool bWaitAll)
+{
+	std::lock_guard<std::mutex> lock(m_mutexDeletion);
+
+	while (m_dequeDeletionBatches.empty() == false)
+	{
+		TDeletionBatch& batch = m_dequeDeletionBatches.front();
+
+		if (bWaitAll == false)
+		{
+			// poll only, a batch still in use stays for a later frame
+			const GLenum eResult = glClientWaitSync(batch.m_pFence, 0, 0);
+			if (eResult != GL_ALREADY_SIGNALED && eResult != GL_CONDITION_SATISFIED)
+			{
+				break;
+			}
+		}
+
+		for (const TDeferredObject& object : batch.m_vecObjects)
+		{
+			DeleteObject(object);
+		}
+
+		glDeleteSync(batch.m_pFence);
+		m_dequeDeletionBatches.pop_front();
+	}
+
+	// released after the last frame, nothing can reference them anymore
+	if (bWaitAll)
+	{
+		for (const TDeferredObject& object : m_vecQueuedObjects)
+		{
+			DeleteObject(object);
+		}
+
+		m_vecQueuedObjects.clear();
+	}
+}
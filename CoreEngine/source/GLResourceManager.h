@@ -0,0 +1,173 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <singleton.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ResourcePool.h"
+#include "Shader.h"
+
+enum EGLResourceData
+{
+	// Pool capacities, slots are allocated up front
+	GL_RESOURCE_MAX_SHADERS = 256,
+	GL_RESOURCE_MAX_BUFFERS = 4096,
+	GL_RESOURCE_MAX_MESHES = 2048,
+};
+
+enum EGLObjectType : GLubyte
+{
+	GL_OBJECT_PROGRAM,
+	GL_OBJECT_BUFFER,
+	GL_OBJECT_VERTEX_ARRAY,
+};
+
+typedef struct SBufferResource
+{
+	GLuint m_uiBuffer;			// OpenGL buffer name
+	GLsizeiptr m_lSize;			// Size of the storage in bytes
+	GLbitfield m_uiFlags;		// Flags the storage was created with
+} TBufferResource;
+
+/**
+ * Vertex of cooked meshes, 16 bytes instead of the 32 of TerrainVertex. The
+ * position is normalized to the mesh bounds, the model matrix scales it back.
+ */
+typedef struct SQuantizedVertex
+{
+	GLushort m_arrPosition[4];		// unorm16, w unused
+	GLbyte m_arrNormal[4];			// snorm8, w unused
+	GLushort m_arrTexCoord[2];		// half float
+} TQuantizedVertex;
+
+static_assert(sizeof(TQuantizedVertex) == 16, "Quantized vertex is expected to be 16 bytes");
+
+typedef struct SMeshResource
+{
+	GLuint m_uiVAO;					// Vertex array with both buffers attached
+	BufferHandle m_hVertexBuffer;
+	BufferHandle m_hIndexBuffer;
+	GLsizei m_iIndexCount;
+} TMeshResource;
+
+/**
+ * GL object waiting for the GPU to be done with it.
+ */
+typedef struct SDeferredObject
+{
+	GLubyte m_ubType;
+	GLuint m_uiName;
+} TDeferredObject;
+
+typedef struct SDeletionBatch
+{
+	GLsync m_pFence;							// Signaled once the frame that released the objects finished
+	std::vector<TDeferredObject> m_vecObjects;
+} TDeletionBatch;
+
+/**
+ * Owns every shader, buffer and mesh of the renderer.
+ * Objects live in fixed pools and are referenced through generational handles.
+ * Destroying a resource retires its handle right away, but the GL names are
+ * only deleted once a fence inserted after the last frame using them signaled.
+ *
+ * Pools are not thread safe, they are only used by the thread that owns the
+ * context (the main thread during startup / shutdown, the render thread in between).
+ */
+class CGLResourceManager : public CSingleton<CGLResourceManager>
+{
+public:
+	CGLResourceManager();
+	~CGLResourceManager();
+
+	CGLResourceManager(const CGLResourceManager&) = delete;
+	CGLResourceManager& operator=(const CGLResourceManager&) = delete;
+
+	void Initialize();
+
+	/**
+	 * Releases everything, the GL context has to be current.
+	 */
+	void Destroy();
+
+	/**
+	 * Compiles and links a program from the given shader files.
+	 *
+	 * @param vecCommonPaths Shared sources every stage gets after its #version line
+	 * @return Handle to the shader, invalid if compiling or linking failed
+	 */
+	ShaderHandle CreateShader(const std::string& stName, const std::vector<std::string>& vecShaderPaths, const std::vector<std::string>& vecCommonPaths = {});
+	CShader* GetShader(ShaderHandle hShader);
+	void DestroyShader(ShaderHandle hShader);
+
+	/**
+	 * Creates an immutable buffer storage.
+	 *
+	 * @param pData Optional initial content
+	 * @param uiFlags glNamedBufferStorage flags
+	 */
+	BufferHandle CreateBuffer(GLsizeiptr lSize, const void* pData, GLbitfield uiFlags);
+	TBufferResource* GetBuffer(BufferHandle hBuffer);
+	void DestroyBuffer(BufferHandle hBuffer);
+
+	/**
+	 * Creates an indexed mesh with the terrain vertex layout
+	 * (position, texture coords, normals).
+	 * Vertices and indices may be nullptr to only allocate the storage.
+	 */
+	MeshHandle CreateMesh(const TerrainVertex* pVertices, GLsizei iVertexCount, const GLuint* pIndices, GLsizei iIndexCount);
+
+	/**
+	 * Same attribute locations with the quantized layout, shaders read the
+	 * normalized values unchanged.
+	 */
+	MeshHandle CreateQuantizedMesh(const TQuantizedVertex* pVertices, GLsizei iVertexCount, const GLuint* pIndices, GLsizei iIndexCount);
+	const TMeshResource* GetMesh(MeshHandle hMesh) const;
+
+	/**
+	 * Destroys the mesh together with its buffers.
+	 */
+	void DestroyMesh(MeshHandle hMesh);
+
+	/**
+	 * Fences the objects released this frame and deletes the ones whose fence
+	 * already signaled. Called by the thread owning the context after a swap.
+	 */
+	void EndFrame();
+
+	GLuint GetPendingDeletionCount() const;
+
+	/**
+	 * Bytes of buffer storage currently alive, pending deletions excluded.
+	 */
+	GLsizeiptr GetBufferMemory() const;
+
+protected:
+	/**
+	 * Creates the buffers and the VAO, the caller describes the attributes.
+	 */
+	bool CreateMeshBuffers(const void* pVertices, GLsizei iVertexCount, GLsizei iVertexSize, const GLuint* pIndices, GLsizei iIndexCount, TMeshResource& mesh);
+	MeshHandle AddMesh(TMeshResource& mesh);
+
+	void QueueDeletion(GLubyte ubType, GLuint uiName);
+	void DeleteObject(const TDeferredObject& object);
+	void CollectGarbage(bool bWaitAll);
+
+private:
+	TResourcePool<CShader, ShaderHandle> m_poolShaders;
+	TResourcePool<TBufferResource, BufferHandle> m_poolBuffers;
+	TResourcePool<TMeshResource, MeshHandle> m_poolMeshes;
+
+	std::atomic<GLsizeiptr> m_lBufferMemory;
+
+	// Objects released since the last EndFrame(), not fenced yet
+	mutable std::mutex m_mutexDeletion;
+	std::vector<TDeferredObject> m_vecQueuedObjects;
+
+	// Oldest batch first, fences signal in submission order
+	std::deque<TDeletionBatch> m_dequeDeletionBatches;
+};
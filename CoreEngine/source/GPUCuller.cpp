@@ -0,0 +1,60 @@
+#include "GPUCuller.h"
+#include "GLResourceManager.h"
+#include "BindlessTextures.h"
+#include "VirtualTexture.h"
+
+CGPUCuller::CGPUCuller() : CCullPass("GPU culling", sizeof(TIndirectDrawData))
+{
+}
+
+bool CGPUCuller::Cull(const TGPUCullBatch& batch, const Matrix4& mat4ViewProjection)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	CShader* pCullShader = resourceManager.GetShader(batch.m_hCullShader);
+	const TBufferResource* pObjectBuffer = resourceManager.GetBuffer(batch.m_hObjectBuffer);
+	const TBufferResource* pDrawDataBuffer = resourceManager.GetBuffer(batch.m_hDrawDataBuffer);
+	if (pCullShader == nullptr || pCullShader->IsReady() == false || pObjectBuffer == nullptr || pDrawDataBuffer == nullptr)
+	{
+		return (false);
+	}
+
+	if (batch.m_uiObjectCount == 0 || Reserve(batch.m_uiObjectCount) == false)
+	{
+		return (false);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_OBJECT_BINDING, pObjectBuffer->m_uiBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_CULL_OBJECT_DATA_BINDING, pDrawDataBuffer->m_uiBuffer);
+
+	BeginCull(*pCullShader, mat4ViewProjection, GPU_CULL_COMMAND_BINDING, GPU_CULL_VISIBLE_DATA_BINDING, GPU_CULL_COUNTER_BINDING);
+	pCullShader->SetInt("objectCount", static_cast<GLint>(batch.m_uiObjectCount));
+
+	// the barrier before the draw comes from the render graph, it knows how the outputs are consumed
+	pCullShader->Dispatch((batch.m_uiObjectCount + GPU_CULL_GROUP_SIZE - 1) / GPU_CULL_GROUP_SIZE);
+
+	EndCull(mat4ViewProjection);
+	return (true);
+}
+
+void CGPUCuller::Draw(const TGPUCullBatch& batch, const Matrix4& mat4ViewProjection, GLuint64 ulFrameIndex)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	const TMeshResource* pMesh = resourceManager.GetMesh(batch.m_hMesh);
+	CShader* pShader = resourceManager.GetShader(batch.m_hShader);
+	if (pMesh == nullptr || pShader == nullptr || pShader->IsReady() == false || BeginDraw() == false)
+	{
+		return;
+	}
+
+	pShader->Use();
+	pShader->SetMat4("viewProjectionMatrix", mat4ViewProjection);
+	CBindlessTextures::Instance().SetupShader(*pShader, batch.m_hTexture);
+	CVirtualTexture::Instance().SetupShader(*pShader, ulFrameIndex);
+
+	// the draw count comes from the counter written by the culling pass
+	glBindVertexArray(pMesh->m_uiVAO);
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, static_cast<GLsizei>(batch.m_uiObjectCount), 0);
+	glBindVertexArray(0);
+
+	EndDraw();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CullPass.h"
+
+enum EGPUCullData
+{
+	GPU_CULL_GROUP_SIZE = 64,			// local_size_x of cull.comp
+
+	// Shader storage bindings of cull.comp, the draw data of the survivors is
+	// read back by the draw program at INDIRECT_DRAW_DATA_BINDING
+	GPU_CULL_OBJECT_BINDING = 1,
+	GPU_CULL_OBJECT_DATA_BINDING = 2,
+	GPU_CULL_COMMAND_BINDING = 3,
+	GPU_CULL_VISIBLE_DATA_BINDING = 4,
+	GPU_CULL_COUNTER_BINDING = 5,
+};
+
+/**
+ * Frustum and occlusion culling of a TGPUCullBatch in a compute pass.
+ * The draw data of every visible object is compacted next to its command.
+ * Render thread only.
+ */
+class CGPUCuller : public CCullPass
+{
+public:
+	CGPUCuller();
+
+	/**
+	 * Runs the culling pass, the draw has to follow in the same frame. No
+	 * barrier is issued, the caller makes the outputs visible to the draw
+	 * (COMMAND, SHADER_STORAGE) and the counter copy (BUFFER_UPDATE).
+	 *
+	 * @return false if the batch could not be culled
+	 */
+	bool Cull(const TGPUCullBatch& batch, const Matrix4& mat4ViewProjection);
+
+	/**
+	 * Draws the survivors of the last Cull(), the frame index moves the
+	 * virtual texture feedback pattern.
+	 */
+	void Draw(const TGPUCullBatch& batch, const Matrix4& mat4ViewProjection, GLuint64 ulFrameIndex);
+};
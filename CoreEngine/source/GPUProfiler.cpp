@@ -0,0 +1,286 @@
+#include "GPUProfiler.h"
+#include <utils.h>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+static GLdouble ElapsedMilliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<GLdouble, std::milli>(end - begin).count();
+}
+
+CGPUProfiler::CGPUProfiler()
+{
+	m_pCurrentSlot = nullptr;
+	m_iScopeDepth = 0;
+	m_bIsInitialized = false;
+	m_ulDroppedFrames = 0;
+
+	for (TFrameSlot& slot : m_arrSlots)
+	{
+		slot.m_ulFrameIndex = 0;
+		slot.m_uiScopeCount = 0;
+		slot.m_uiLastQuery = 0;
+		slot.m_bPending = false;
+		slot.m_arrQueries.fill(0);
+	}
+}
+
+CGPUProfiler::~CGPUProfiler()
+{
+	Destroy();
+}
+
+void CGPUProfiler::Initialize()
+{
+	if (m_bIsInitialized)
+	{
+		return;
+	}
+
+	for (TFrameSlot& slot : m_arrSlots)
+	{
+		glCreateQueries(GL_TIMESTAMP, static_cast<GLsizei>(slot.m_arrQueries.size()), slot.m_arrQueries.data());
+		slot.m_uiScopeCount = 0;
+		slot.m_uiLastQuery = 0;
+		slot.m_bPending = false;
+	}
+
+	m_bIsInitialized = true;
+}
+
+void CGPUProfiler::Destroy()
+{
+	if (m_bIsInitialized == false)
+	{
+		return;
+	}
+
+	if (m_ulDroppedFrames > 0)
+	{
+		syslog("GPU profiler dropped %llu frames whose queries were not ready in time", static_cast<unsigned long long>(m_ulDroppedFrames.load()));
+	}
+
+	for (TFrameSlot& slot : m_arrSlots)
+	{
+		glDeleteQueries(static_cast<GLsizei>(slot.m_arrQueries.size()), slot.m_arrQueries.data());
+		slot.m_arrQueries.fill(0);
+	}
+
+	m_pCurrentSlot = nullptr;
+	m_bIsInitialized = false;
+}
+
+void CGPUProfiler::BeginFrame(GLuint64 ulFrameIndex)
+{
+	if (m_bIsInitialized == false)
+	{
+		return;
+	}
+
+	TFrameSlot& slot = m_arrSlots[ulFrameIndex % GPU_PROFILER_FRAME_LATENCY];
+
+	// results of the frame that used this slot before, never wait for them
+	if (slot.m_bPending && ResolveSlot(slot) == false)
+	{
+		m_ulDroppedFrames++;
+	}
+
+	slot.m_ulFrameIndex = ulFrameIndex;
+	slot.m_uiScopeCount = 0;
+	slot.m_uiLastQuery = 0;
+	slot.m_bPending = false;
+
+	m_pCurrentSlot = &slot;
+	m_iScopeDepth = 0;
+}
+
+void CGPUProfiler::EndFrame()
+{
+	if (m_pCurrentSlot == nullptr)
+	{
+		return;
+	}
+
+	// close whatever was left open so the slot stays consistent
+	while (m_iScopeDepth > 0)
+	{
+		PopScope();
+	}
+
+	m_pCurrentSlot->m_bPending = (m_pCurrentSlot->m_uiScopeCount > 0);
+	m_pCurrentSlot = nullptr;
+}
+
+void CGPUProfiler::PushScope(const char* szName)
+{
+	if (m_pCurrentSlot == nullptr)
+	{
+		return;
+	}
+
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, szName);
+
+	// too deep or too many scopes, still balanced with PopScope() but not timed
+	if (m_iScopeDepth >= GPU_PROFILER_MAX_DEPTH)
+	{
+		m_iScopeDepth++;
+		return;
+	}
+
+	if (m_pCurrentSlot->m_uiScopeCount >= GPU_PROFILER_MAX_SCOPES)
+	{
+		m_arrScopeStack[m_iScopeDepth++] = GPU_PROFILER_MAX_SCOPES;
+		return;
+	}
+
+	const GLuint uiScope = m_pCurrentSlot->m_uiScopeCount++;
+
+	TScopeRecord& record = m_pCurrentSlot->m_arrScopes[uiScope];
+	record.m_szName = szName;
+	record.m_iDepth = m_iScopeDepth;
+	record.m_cpuBegin = std::chrono::steady_clock::now();
+
+	glQueryCounter(m_pCurrentSlot->m_arrQueries[uiScope * 2], GL_TIMESTAMP);
+
+	m_arrScopeStack[m_iScopeDepth++] = uiScope;
+}
+
+void CGPUProfiler::PopScope()
+{
+	if (m_pCurrentSlot == nullptr || m_iScopeDepth == 0)
+	{
+		return;
+	}
+
+	m_iScopeDepth--;
+
+	const GLuint uiScope = (m_iScopeDepth < GPU_PROFILER_MAX_DEPTH) ? m_arrScopeStack[m_iScopeDepth] : static_cast<GLuint>(GPU_PROFILER_MAX_SCOPES);
+	if (uiScope < GPU_PROFILER_MAX_SCOPES)
+	{
+		m_pCurrentSlot->m_uiLastQuery = uiScope * 2 + 1;
+		glQueryCounter(m_pCurrentSlot->m_arrQueries[m_pCurrentSlot->m_uiLastQuery], GL_TIMESTAMP);
+		m_pCurrentSlot->m_arrScopes[uiScope].m_cpuEnd = std::chrono::steady_clock::now();
+	}
+
+	glPopDebugGroup();
+}
+
+bool CGPUProfiler::ResolveSlot(TFrameSlot& slot)
+{
+	// timestamps complete in order, the end query issued last being ready means all are
+	const GLuint uiLastQuery = slot.m_arrQueries[slot.m_uiLastQuery];
+
+	GLint iAvailable = GL_FALSE;
+	glGetQueryObjectiv(uiLastQuery, GL_QUERY_RESULT_AVAILABLE, &iAvailable);
+	if (iAvailable == GL_FALSE)
+	{
+		return (false);
+	}
+
+	TGPUFrameResult frameResult{};
+	frameResult.m_ulFrameIndex = slot.m_ulFrameIndex;
+	frameResult.m_vecScopes.reserve(slot.m_uiScopeCount);
+
+	for (GLuint i = 0; i < slot.m_uiScopeCount; i++)
+	{
+		GLuint64 ulBegin = 0;
+		GLuint64 ulEnd = 0;
+		glGetQueryObjectui64v(slot.m_arrQueries[i * 2], GL_QUERY_RESULT, &ulBegin);
+		glGetQueryObjectui64v(slot.m_arrQueries[i * 2 + 1], GL_QUERY_RESULT, &ulEnd);
+
+		const TScopeRecord& record = slot.m_arrScopes[i];
+
+		TGPUScopeResult scopeResult{};
+		scopeResult.m_szName = record.m_szName;
+		scopeResult.m_iDepth = record.m_iDepth;
+		scopeResult.m_dGPUTime = static_cast<GLdouble>(ulEnd - ulBegin) / 1000000.0;
+		scopeResult.m_dCPUTime = ElapsedMilliseconds(record.m_cpuBegin, record.m_cpuEnd);
+		frameResult.m_vecScopes.push_back(scopeResult);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexHistory);
+	m_dequeHistory.push_back(std::move(frameResult));
+	if (m_dequeHistory.size() > GPU_PROFILER_HISTORY_SIZE)
+	{
+		m_dequeHistory.pop_front();
+	}
+
+	return (true);
+}
+
+bool CGPUProfiler::GetLastFrame(TGPUFrameResult& frameResult) const
+{
+	std::lock_guard<std::mutex> lock(m_mutexHistory);
+	if (m_dequeHistory.empty())
+	{
+		return (false);
+	}
+
+	frameResult = m_dequeHistory.back();
+	return (true);
+}
+
+bool CGPUProfiler::ExportCSV(const std::string& stPath) const
+{
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file << "frame,scope,depth,gpu_ms,cpu_ms\n";
+
+	std::lock_guard<std::mutex> lock(m_mutexHistory);
+	for (const TGPUFrameResult& frameResult : m_dequeHistory)
+	{
+		for (const TGPUScopeResult& scopeResult : frameResult.m_vecScopes)
+		{
+			file << frameResult.m_ulFrameIndex << ',' << scopeResult.m_szName << ',' << scopeResult.m_iDepth << ',' << scopeResult.m_dGPUTime << ',' << scopeResult.m_dCPUTime << '\n';
+		}
+	}
+
+	syslog("Exported %zu GPU profiler frames to %s", m_dequeHistory.size(), stPath.c_str());
+	return (true);
+}
+
+bool CGPUProfiler::ExportJSON(const std::string& stPath) const
+{
+	nlohmann::json jsonFrames = nlohmann::json::array();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexHistory);
+		for (const TGPUFrameResult& frameResult : m_dequeHistory)
+		{
+			nlohmann::json jsonScopes = nlohmann::json::array();
+			for (const TGPUScopeResult& scopeResult : frameResult.m_vecScopes)
+			{
+				jsonScopes.push_back({
+					{ "name", scopeResult.m_szName },
+					{ "depth", scopeResult.m_iDepth },
+					{ "gpu_ms", scopeResult.m_dGPUTime },
+					{ "cpu_ms", scopeResult.m_dCPUTime },
+				});
+			}
+
+			jsonFrames.push_back({ { "frame", frameResult.m_ulFrameIndex }, { "scopes", jsonScopes } });
+		}
+	}
+
+	std::ofstream file(stPath);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stPath.c_str());
+		return (false);
+	}
+
+	file << jsonFrames.dump(1, '\t');
+
+	syslog("Exported %zu GPU profiler frames to %s", jsonFrames.size(), stPath.c_str());
+	return (true);
+}
+
+GLuint64 CGPUProfiler::GetDroppedFrames() const
+{
+	return (m_ulDroppedFrames);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <singleton.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum EGPUProfilerData
+{
+	// Frames between issuing a timestamp and reading it back, reading earlier
+	// would stall the CPU until the GPU caught up
+	GPU_PROFILER_FRAME_LATENCY = 4,
+
+	GPU_PROFILER_MAX_SCOPES = 64,		// per frame
+	GPU_PROFILER_MAX_DEPTH = 16,
+
+	// Resolved frames kept for export
+	GPU_PROFILER_HISTORY_SIZE = 300,
+};
+
+typedef struct SGPUScopeResult
+{
+	const char* m_szName;
+	GLint m_iDepth;
+	GLdouble m_dGPUTime;	// ms
+	GLdouble m_dCPUTime;	// ms, time spent recording the scope on the render thread
+} TGPUScopeResult;
+
+typedef struct SGPUFrameResult
+{
+	GLuint64 m_ulFrameIndex;
+	std::vector<TGPUScopeResult> m_vecScopes;	// in the order they were opened
+} TGPUFrameResult;
+
+/**
+ * GPU timings based on GL_TIMESTAMP queries.
+ * Each frame records into its own slot of a query ring and is read back
+ * GPU_PROFILER_FRAME_LATENCY frames later, when the results are available
+ * without waiting. Scopes are also pushed as KHR_debug groups so graphics
+ * debuggers show the same names.
+ *
+ * Recording is render thread only, results can be read from any thread.
+ */
+class CGPUProfiler : public CSingleton<CGPUProfiler>
+{
+public:
+	CGPUProfiler();
+	~CGPUProfiler();
+
+	CGPUProfiler(const CGPUProfiler&) = delete;
+	CGPUProfiler& operator=(const CGPUProfiler&) = delete;
+
+	/**
+	 * Creates the query objects, the GL context has to be current.
+	 */
+	void Initialize();
+	void Destroy();
+
+	void BeginFrame(GLuint64 ulFrameIndex);
+	void EndFrame();
+
+	/**
+	 * Opens a named scope, szName has to outlive the profiler (string literal).
+	 */
+	void PushScope(const char* szName);
+	void PopScope();
+
+	/**
+	 * Copies the most recent resolved frame.
+	 *
+	 * @return false if no frame was resolved yet
+	 */
+	bool GetLastFrame(TGPUFrameResult& frameResult) const;
+
+	/**
+	 * Writes the recorded history, one row / object per scope and frame.
+	 */
+	bool ExportCSV(const std::string& stPath) const;
+	bool ExportJSON(const std::string& stPath) const;
+
+	GLuint64 GetDroppedFrames() const;
+
+protected:
+	typedef struct SScopeRecord
+	{
+		const char* m_szName;
+		GLint m_iDepth;
+		std::chrono::steady_clock::time_point m_cpuBegin;
+		std::chrono::steady_clock::time_point m_cpuEnd;
+	} TScopeRecord;
+
+	typedef struct SFrameSlot
+	{
+		GLuint64 m_ulFrameIndex;
+		GLuint m_uiScopeCount;
+		GLuint m_uiLastQuery;		// index of the end timestamp issued last, nested scopes end out of order
+		bool m_bPending;
+		std::array<TScopeRecord, GPU_PROFILER_MAX_SCOPES> m_arrScopes;
+		std::array<GLuint, GPU_PROFILER_MAX_SCOPES * 2> m_arrQueries;	// begin & end per scope
+	} TFrameSlot;
+
+	/**
+	 * Reads back a slot if all of its queries are available.
+	 *
+	 * @return false if the GPU has not finished the frame yet
+	 */
+	bool ResolveSlot(TFrameSlot& slot);
+
+private:
+	std::array<TFrameSlot, GPU_PROFILER_FRAME_LATENCY> m_arrSlots;
+	TFrameSlot* m_pCurrentSlot;
+
+	// Indices into the current slot of the scopes still open
+	std::array<GLuint, GPU_PROFILER_MAX_DEPTH> m_arrScopeStack;
+	GLint m_iScopeDepth;
+
+	bool m_bIsInitialized;
+	std::atomic<GLuint64> m_ulDroppedFrames;
+
+	mutable std::mutex m_mutexHistory;
+	std::deque<TGPUFrameResult> m_dequeHistory;
+};
+
+/**
+ * Scoped GPU timer, records nothing until the profiler was initialized.
+ */
+class CGPUScope
+{
+public:
+	explicit CGPUScope(const char* szName)
+	{
+		CGPUProfiler::Instance().PushScope(szName);
+	}
+
+	~CGPUScope()
+	{
+		CGPUProfiler::Instance().PopScope();
+	}
+
+	CGPUScope(const CGPUScope&) = delete;
+	CGPUScope& operator=(const CGPUScope&) = delete;
+};
+
+#define GPU_SCOPE_CONCAT_INNER(a, b) a##b
+#define GPU_SCOPE_CONCAT(a, b) GPU_SCOPE_CONCAT_INNER(a, b)
+#define GPU_SCOPE(name) CGPUScope GPU_SCOPE_CONCAT(gpuScope_, __LINE__)(name)
@@ -0,0 +1,100 @@
+#include "GeometryPool.h"
+#include "GLResourceManager.h"
+#include <utils.h>
+
+CGeometryPool::CGeometryPool()
+{
+	m_hMesh = MeshHandle();
+
+	m_uiVertexCapacity = 0;
+	m_uiIndexCapacity = 0;
+	m_uiVertexCount = 0;
+	m_uiIndexCount = 0;
+}
+
+CGeometryPool::~CGeometryPool()
+{
+	Destroy();
+}
+
+bool CGeometryPool::Initialize(GLuint uiVertexCapacity, GLuint uiIndexCapacity)
+{
+	Destroy();
+
+	// storage only, ranges are uploaded as they are allocated
+	m_hMesh = CGLResourceManager::Instance().CreateMesh(nullptr, uiVertexCapacity, nullptr, uiIndexCapacity);
+	if (m_hMesh.IsValid() == false)
+	{
+		syserr("Failed to create the geometry pool (%u vertices, %u indices)", uiVertexCapacity, uiIndexCapacity);
+		return (false);
+	}
+
+	m_uiVertexCapacity = uiVertexCapacity;
+	m_uiIndexCapacity = uiIndexCapacity;
+
+	syslog("Geometry pool created with %u vertices and %u indices", uiVertexCapacity, uiIndexCapacity);
+	return (true);
+}
+
+void CGeometryPool::Destroy()
+{
+	if (m_hMesh.IsValid())
+	{
+		CGLResourceManager::Instance().DestroyMesh(m_hMesh);
+		m_hMesh = MeshHandle();
+	}
+
+	m_uiVertexCapacity = 0;
+	m_uiIndexCapacity = 0;
+	m_uiVertexCount = 0;
+	m_uiIndexCount = 0;
+}
+
+GLint CGeometryPool::AllocateVertices(const TerrainVertex* pVertices, GLuint uiVertexCount)
+{
+	const TMeshResource* pMesh = CGLResourceManager::Instance().GetMesh(m_hMesh);
+	if (pMesh == nullptr || uiVertexCount > m_uiVertexCapacity - m_uiVertexCount)
+	{
+		syserr("Geometry pool is out of vertices (%u used, %u requested, %u capacity)", m_uiVertexCount, uiVertexCount, m_uiVertexCapacity);
+		return (-1);
+	}
+
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(pMesh->m_hVertexBuffer);
+	glNamedBufferSubData(pBuffer->m_uiBuffer, static_cast<GLintptr>(m_uiVertexCount) * sizeof(TerrainVertex), static_cast<GLsizeiptr>(uiVertexCount) * sizeof(TerrainVertex), pVertices);
+
+	const GLint iBaseVertex = static_cast<GLint>(m_uiVertexCount);
+	m_uiVertexCount += uiVertexCount;
+	return (iBaseVertex);
+}
+
+GLint CGeometryPool::AllocateIndices(const GLuint* pIndices, GLuint uiIndexCount)
+{
+	const TMeshResource* pMesh = CGLResourceManager::Instance().GetMesh(m_hMesh);
+	if (pMesh == nullptr || uiIndexCount > m_uiIndexCapacity - m_uiIndexCount)
+	{
+		syserr("Geometry pool is out of indices (%u used, %u requested, %u capacity)", m_uiIndexCount, uiIndexCount, m_uiIndexCapacity);
+		return (-1);
+	}
+
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(pMesh->m_hIndexBuffer);
+	glNamedBufferSubData(pBuffer->m_uiBuffer, static_cast<GLintptr>(m_uiIndexCount) * sizeof(GLuint), static_cast<GLsizeiptr>(uiIndexCount) * sizeof(GLuint), pIndices);
+
+	const GLint iFirstIndex = static_cast<GLint>(m_uiIndexCount);
+	m_uiIndexCount += uiIndexCount;
+	return (iFirstIndex);
+}
+
+MeshHandle CGeometryPool::GetMesh() const
+{
+	return (m_hMesh);
+}
+
+GLuint CGeometryPool::GetVertexCount() const
+{
+	return (m_uiVertexCount);
+}
+
+GLuint CGeometryPool::GetIndexCount() const
+{
+	return (m_uiIndexCount);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <maths.h>
+#include <singleton.h>
+#include "ResourcePool.h"
+
+enum EGeometryPoolData
+{
+	// Room left next to the terrain for static meshes
+	GEOMETRY_POOL_STATIC_VERTICES = 256 * 1024,
+	GEOMETRY_POOL_STATIC_INDICES = 1024 * 1024,
+};
+
+/**
+ * One large vertex buffer and one large index buffer with the common
+ * TerrainVertex layout, shared by the terrain and static meshes so everything
+ * can be drawn from a single VAO with multi draw indirect.
+ *
+ * Ranges are appended and live as long as the pool, there is no per range
+ * free. Uploads need the GL context, the pool is filled while loading.
+ */
+class CGeometryPool : public CSingleton<CGeometryPool>
+{
+public:
+	CGeometryPool();
+	~CGeometryPool();
+
+	CGeometryPool(const CGeometryPool&) = delete;
+	CGeometryPool& operator=(const CGeometryPool&) = delete;
+
+	bool Initialize(GLuint uiVertexCapacity, GLuint uiIndexCapacity);
+	void Destroy();
+
+	/**
+	 * Copies the vertices to the end of the vertex buffer.
+	 *
+	 * @return Base vertex of the range, -1 if the pool is full
+	 */
+	GLint AllocateVertices(const TerrainVertex* pVertices, GLuint uiVertexCount);
+
+	/**
+	 * Copies the indices to the end of the index buffer, indices are relative
+	 * to the base vertex of the draw.
+	 *
+	 * @return First index of the range, -1 if the pool is full
+	 */
+	GLint AllocateIndices(const GLuint* pIndices, GLuint uiIndexCount);
+
+	/**
+	 * Mesh owning the shared buffers and the VAO, used by indirect batches.
+	 */
+	MeshHandle GetMesh() const;
+
+	GLuint GetVertexCount() const;
+	GLuint GetIndexCount() const;
+
+private:
+	MeshHandle m_hMesh;
+
+	GLuint m_uiVertexCapacity;
+	GLuint m_uiIndexCapacity;
+	GLuint m_uiVertexCount;
+	GLuint m_uiIndexCount;
+};
@@ -0,0 +1,114 @@
+#include "IndirectDrawBuffer.h"
+#include "GLResourceManager.h"
+#include <utils.h>
+#include <algorithm>
+#include <cstring>
+
+CIndirectDrawBuffer::CIndirectDrawBuffer()
+{
+	m_pCommands = nullptr;
+	m_pDrawData = nullptr;
+
+	m_uiCapacity = 0;
+}
+
+CIndirectDrawBuffer::~CIndirectDrawBuffer()
+{
+	Destroy();
+}
+
+void CIndirectDrawBuffer::Destroy()
+{
+	m_fenceRing.Reset();
+
+	// deleting the buffers unmaps them, the resource manager waits for the GPU
+	if (m_hCommandBuffer.IsValid() || m_hDataBuffer.IsValid())
+	{
+		CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+		resourceManager.DestroyBuffer(m_hCommandBuffer);
+		resourceManager.DestroyBuffer(m_hDataBuffer);
+		m_hCommandBuffer = BufferHandle();
+		m_hDataBuffer = BufferHandle();
+	}
+
+	m_pCommands = nullptr;
+	m_pDrawData = nullptr;
+	m_uiCapacity = 0;
+}
+
+bool CIndirectDrawBuffer::Reserve(GLuint uiDrawCount)
+{
+	if (uiDrawCount <= m_uiCapacity)
+	{
+		return (true);
+	}
+
+	GLuint uiCapacity = std::max<GLuint>(m_uiCapacity, INDIRECT_DRAW_INITIAL_CAPACITY);
+	while (uiCapacity < uiDrawCount)
+	{
+		uiCapacity *= 2;
+	}
+	uiCapacity = (uiCapacity + INDIRECT_DRAW_CAPACITY_STEP - 1) / INDIRECT_DRAW_CAPACITY_STEP * INDIRECT_DRAW_CAPACITY_STEP;
+
+	// the old buffers stay alive until the frames using them completed
+	Destroy();
+
+	const GLbitfield uiFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr lCommandSize = static_cast<GLsizeiptr>(uiCapacity) * FRAME_PACKET_COUNT * sizeof(TDrawElementsIndirectCommand);
+	const GLsizeiptr lDataSize = static_cast<GLsizeiptr>(uiCapacity) * FRAME_PACKET_COUNT * sizeof(TIndirectDrawData);
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hCommandBuffer = resourceManager.CreateBuffer(lCommandSize, nullptr, uiFlags);
+	m_hDataBuffer = resourceManager.CreateBuffer(lDataSize, nullptr, uiFlags);
+
+	const TBufferResource* pCommandBuffer = resourceManager.GetBuffer(m_hCommandBuffer);
+	const TBufferResource* pDataBuffer = resourceManager.GetBuffer(m_hDataBuffer);
+	if (pCommandBuffer == nullptr || pDataBuffer == nullptr)
+	{
+		syserr("Failed to create the indirect draw buffers for %u draws", uiCapacity);
+		Destroy();
+		return (false);
+	}
+
+	m_pCommands = static_cast<TDrawElementsIndirectCommand*>(glMapNamedBufferRange(pCommandBuffer->m_uiBuffer, 0, lCommandSize, uiFlags));
+	m_pDrawData = static_cast<TIndirectDrawData*>(glMapNamedBufferRange(pDataBuffer->m_uiBuffer, 0, lDataSize, uiFlags));
+	if (m_pCommands == nullptr || m_pDrawData == nullptr)
+	{
+		syserr("Failed to map the indirect draw buffers");
+		Destroy();
+		return (false);
+	}
+
+	m_uiCapacity = uiCapacity;
+	sysdbg("Indirect draw buffers sized for %u draws per frame", uiCapacity);
+	return (true);
+}
+
+bool CIndirectDrawBuffer::Upload(const TIndirectBatch& batch, GLintptr& lCommandOffset)
+{
+	const GLuint uiDrawCount = static_cast<GLuint>(batch.m_vecCommands.size());
+	if (Reserve(uiDrawCount) == false)
+	{
+		return (false);
+	}
+
+	// the region was last used FRAME_PACKET_COUNT frames ago, this rarely blocks
+	m_fenceRing.AcquireSlot();
+
+	const size_t stFirstDraw = static_cast<size_t>(m_fenceRing.GetSlot()) * m_uiCapacity;
+	std::memcpy(static_cast<void*>(m_pCommands + stFirstDraw), batch.m_vecCommands.data(), uiDrawCount * sizeof(TDrawElementsIndirectCommand));
+	std::memcpy(static_cast<void*>(m_pDrawData + stFirstDraw), batch.m_vecDrawData.data(), uiDrawCount * sizeof(TIndirectDrawData));
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, resourceManager.GetBuffer(m_hCommandBuffer)->m_uiBuffer);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INDIRECT_DRAW_DATA_BINDING, resourceManager.GetBuffer(m_hDataBuffer)->m_uiBuffer,
+		static_cast<GLintptr>(stFirstDraw * sizeof(TIndirectDrawData)), static_cast<GLsizeiptr>(std::max<GLuint>(uiDrawCount, 1) * sizeof(TIndirectDrawData)));
+
+	lCommandOffset = static_cast<GLintptr>(stFirstDraw * sizeof(TDrawElementsIndirectCommand));
+	return (true);
+}
+
+void CIndirectDrawBuffer::EndFrame()
+{
+	m_fenceRing.EndFrame();
+}
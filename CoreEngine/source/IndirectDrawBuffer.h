@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "FramePacket.h"
+#include "FenceRing.h"
+
+enum EIndirectDrawData
+{
+	// Draws per frame region before the buffers grow
+	INDIRECT_DRAW_INITIAL_CAPACITY = 1024,
+
+	// Capacity granularity, keeps every region start aligned for SSBO binding
+	INDIRECT_DRAW_CAPACITY_STEP = 64,
+
+	// Shader storage binding of the per draw data, see indirect.vert
+	INDIRECT_DRAW_DATA_BINDING = 0,
+};
+
+/**
+ * Persistently mapped command buffer and per draw SSBO for multi draw indirect.
+ * Both are split into FRAME_PACKET_COUNT regions written round robin, a fence
+ * per region keeps the CPU from overwriting commands the GPU still reads.
+ * Render thread only.
+ */
+class CIndirectDrawBuffer
+{
+public:
+	CIndirectDrawBuffer();
+	~CIndirectDrawBuffer();
+
+	CIndirectDrawBuffer(const CIndirectDrawBuffer&) = delete;
+	CIndirectDrawBuffer& operator=(const CIndirectDrawBuffer&) = delete;
+
+	void Destroy();
+
+	/**
+	 * Copies the batch into the current region and binds it, the command
+	 * offset for glMultiDrawElementsIndirect is returned in lCommandOffset.
+	 *
+	 * @return false if the buffers could not be created
+	 */
+	bool Upload(const TIndirectBatch& batch, GLintptr& lCommandOffset);
+
+	/**
+	 * Fences the region written this frame and moves to the next one.
+	 */
+	void EndFrame();
+
+protected:
+	bool Reserve(GLuint uiDrawCount);
+
+private:
+	BufferHandle m_hCommandBuffer;
+	BufferHandle m_hDataBuffer;
+	TDrawElementsIndirectCommand* m_pCommands;
+	TIndirectDrawData* m_pDrawData;
+
+	GLuint m_uiCapacity;		// draws per region
+	CFenceRing m_fenceRing;		// one region per slot
+};
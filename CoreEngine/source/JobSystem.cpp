@@ -0,0 +1,512 @@
+#include "JobSystem.h"
+#include <utils.h>
+#include "CPUProfiler.h"
+#include <algorithm>
+
+// Index of the calling thread in CJobSystem::m_vecWorkers
+static thread_local GLint tl_iThreadIndex = JOB_INVALID_THREAD_INDEX;
+
+// xorshift state used to pick steal victims
+static thread_local GLuint tl_uiRandomState = 0;
+
+static GLuint NextRandom()
+{
+	if (tl_uiRandomState == 0)
+	{
+		tl_uiRandomState = static_cast<GLuint>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1u;
+	}
+
+	GLuint uiState = tl_uiRandomState;
+	uiState ^= uiState << 13;
+	uiState ^= uiState >> 17;
+	uiState ^= uiState << 5;
+	tl_uiRandomState = uiState;
+	return (uiState);
+}
+
+/*
+ * CJobDeque
+ */
+CJobDeque::CJobDeque()
+{
+	m_lTop = 0;
+	m_lBottom = 0;
+
+	for (std::atomic<SJob*>& pJob : m_apJobs)
+	{
+		pJob.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+bool CJobDeque::Push(SJob* pJob)
+{
+	const int64_t lBottom = m_lBottom.load(std::memory_order_relaxed);
+	const int64_t lTop = m_lTop.load(std::memory_order_acquire);
+
+	if (lBottom - lTop >= JOB_DEQUE_SIZE)
+	{
+		return (false);
+	}
+
+	// release publishes the job content to thieves that acquire m_lBottom
+	m_apJobs[lBottom & (JOB_DEQUE_SIZE - 1)].store(pJob, std::memory_order_relaxed);
+	m_lBottom.store(lBottom + 1, std::memory_order_release);
+	return (true);
+}
+
+SJob* CJobDeque::Pop()
+{
+	const int64_t lBottom = m_lBottom.load(std::memory_order_relaxed) - 1;
+	m_lBottom.store(lBottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t lTop = m_lTop.load(std::memory_order_relaxed);
+
+	if (lTop > lBottom)
+	{
+		// deque was empty
+		m_lBottom.store(lBottom + 1, std::memory_order_relaxed);
+		return (nullptr);
+	}
+
+	SJob* pJob = m_apJobs[lBottom & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (lTop != lBottom)
+	{
+		// more than one job left, no race with thieves possible
+		return (pJob);
+	}
+
+	// last job, race against thieves for it
+	if (m_lTop.compare_exchange_strong(lTop, lTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+	{
+		pJob = nullptr;
+	}
+
+	m_lBottom.store(lBottom + 1, std::memory_order_relaxed);
+	return (pJob);
+}
+
+SJob* CJobDeque::Steal()
+{
+	int64_t lTop = m_lTop.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t lBottom = m_lBottom.load(std::memory_order_acquire);
+
+	if (lTop >= lBottom)
+	{
+		return (nullptr);
+	}
+
+	SJob* pJob = m_apJobs[lTop & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+	if (m_lTop.compare_exchange_strong(lTop, lTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+	{
+		// another thread was faster
+		return (nullptr);
+	}
+
+	return (pJob);
+}
+
+int64_t CJobDeque::GetSize() const
+{
+	return (m_lBottom.load(std::memory_order_relaxed) - m_lTop.load(std::memory_order_relaxed));
+}
+
+/*
+ * CJobSystem
+ */
+CJobSystem::CJobSystem()
+{
+	m_bIsRunning = false;
+	m_pExternalJobPool = nullptr;
+	m_uiExternalAllocatedJobs = 0;
+	m_iRunningBackgroundJobs = 0;
+	m_iSleepingWorkers = 0;
+	m_uiWorkEpoch = 0;
+}
+
+CJobSystem::~CJobSystem()
+{
+	Destroy();
+}
+
+void CJobSystem::Initialize(GLuint uiWorkerCount)
+{
+	if (m_bIsRunning)
+	{
+		syserr("Job system is already initialized");
+		return;
+	}
+
+	if (uiWorkerCount == 0)
+	{
+		uiWorkerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_vecWorkers.reserve(uiWorkerCount);
+	for (GLuint i = 0; i < uiWorkerCount; i++)
+	{
+		SWorker* pWorker = new SWorker();
+		pWorker->m_pJobPool = new SJob[JOB_POOL_SIZE];
+		pWorker->m_uiAllocatedJobs = 0;
+		m_vecWorkers.push_back(pWorker);
+	}
+
+	m_pExternalJobPool = new SJob[JOB_POOL_SIZE];
+	m_uiExternalAllocatedJobs = 0;
+	m_vecExternalJobs.reserve(JOB_DEQUE_SIZE);
+
+	m_bIsRunning = true;
+
+	// The calling thread is worker 0, it does not get a thread of its own
+	tl_iThreadIndex = JOB_MAIN_THREAD_INDEX;
+
+	m_vecThreads.reserve(uiWorkerCount - 1);
+	for (GLuint i = 1; i < uiWorkerCount; i++)
+	{
+		m_vecThreads.emplace_back(&CJobSystem::WorkerLoop, this, static_cast<GLint>(i));
+	}
+
+	syslog("Job system initialized with %u workers", uiWorkerCount);
+}
+
+void CJobSystem::Destroy()
+{
+	if (m_bIsRunning == false)
+	{
+		return;
+	}
+
+	m_bIsRunning = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexSleep);
+		m_cvWake.notify_all();
+	}
+
+	for (std::thread& thread : m_vecThreads)
+	{
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+	m_vecThreads.clear();
+
+	for (SWorker* pWorker : m_vecWorkers)
+	{
+		delete[] pWorker->m_pJobPool;
+		delete pWorker;
+	}
+	m_vecWorkers.clear();
+
+	delete[] m_pExternalJobPool;
+	m_pExternalJobPool = nullptr;
+	m_vecExternalJobs.clear();
+
+	// the workers are joined, nothing runs them anymore
+	m_dequeBackgroundJobs.clear();
+	m_iRunningBackgroundJobs = 0;
+
+	tl_iThreadIndex = JOB_INVALID_THREAD_INDEX;
+}
+
+JobHandle CJobSystem::CreateJob(JobFunction pFunction, JobHandle pParent, const void* pData, size_t stDataSize)
+{
+	assert(stDataSize <= sizeof(SJob::m_aData));
+
+	if (pParent)
+	{
+		pParent->m_iUnfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	SJob* pJob = AllocateJob();
+	pJob->m_pFunction = pFunction;
+	pJob->m_pParent = pParent;
+	pJob->m_iUnfinishedJobs.store(1, std::memory_order_relaxed);
+	pJob->m_iContinuationCount.store(0, std::memory_order_relaxed);
+
+	if (pData && stDataSize > 0)
+	{
+		std::memcpy(pJob->m_aData, pData, stDataSize);
+	}
+
+	return (pJob);
+}
+
+bool CJobSystem::AddContinuation(JobHandle pAncestor, JobHandle pContinuation)
+{
+	const int32_t iSlot = pAncestor->m_iContinuationCount.fetch_add(1, std::memory_order_relaxed);
+	if (iSlot >= JOB_MAX_CONTINUATIONS)
+	{
+		pAncestor->m_iContinuationCount.fetch_sub(1, std::memory_order_relaxed);
+		syserr("Job has no continuation slot left");
+		return (false);
+	}
+
+	pAncestor->m_apContinuations[iSlot] = pContinuation;
+	return (true);
+}
+
+void CJobSystem::Run(JobHandle pJob)
+{
+	const GLint iThreadIndex = GetThreadIndex();
+
+	if (iThreadIndex == JOB_INVALID_THREAD_INDEX)
+	{
+		std::lock_guard<std::mutex> lock(m_mutexExternal);
+		m_vecExternalJobs.push_back(pJob);
+	}
+	else if (m_vecWorkers[iThreadIndex]->m_deque.Push(pJob) == false)
+	{
+		// deque is full, better run it now than drop it
+		Execute(pJob);
+		return;
+	}
+
+	WakeWorkers();
+}
+
+void CJobSystem::PushBackgroundJob(JobFunction pFunction, const void* pData, size_t stDataSize)
+{
+	assert(stDataSize <= sizeof(SBackgroundJob::m_aData));
+
+	SBackgroundJob job{};
+	job.m_pFunction = pFunction;
+	std::memcpy(job.m_aData, pData, stDataSize);
+
+	// worker 0 never takes background work, without other workers nobody would
+	if (m_bIsRunning == false || GetWorkerCount() <= 1)
+	{
+		job.m_pFunction(nullptr, job.m_aData);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexBackground);
+		m_dequeBackgroundJobs.push_back(job);
+	}
+
+	WakeWorkers();
+}
+
+bool CJobSystem::RunBackgroundJob()
+{
+	SBackgroundJob job;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexBackground);
+		if (m_dequeBackgroundJobs.empty() || m_iRunningBackgroundJobs >= JOB_MAX_BACKGROUND_JOBS)
+		{
+			return (false);
+		}
+
+		job = m_dequeBackgroundJobs.front();
+		m_dequeBackgroundJobs.pop_front();
+		m_iRunningBackgroundJobs++;
+	}
+
+	{
+		ANUBIS_ZONE("BackgroundJob");
+		job.m_pFunction(nullptr, job.m_aData);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutexBackground);
+	m_iRunningBackgroundJobs--;
+	return (true);
+}
+
+void CJobSystem::Wait(JobHandle pJob)
+{
+	while (IsFinished(pJob) == false)
+	{
+		SJob* pNextJob = GetJob();
+		if (pNextJob)
+		{
+			Execute(pNextJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool CJobSystem::IsFinished(JobHandle pJob) const
+{
+	return (pJob->m_iUnfinishedJobs.load(std::memory_order_acquire) <= 0);
+}
+
+GLuint CJobSystem::GetWorkerCount() const
+{
+	return static_cast<GLuint>(m_vecWorkers.size());
+}
+
+GLint CJobSystem::GetThreadIndex()
+{
+	return (tl_iThreadIndex);
+}
+
+GLuint CJobSystem::GetChunkSize(GLuint uiCount, GLuint uiMinChunk) const
+{
+	// Around four chunks per worker leaves room for balancing uneven chunks
+	const GLuint uiTargetChunks = std::max(1u, GetWorkerCount() * 4);
+	const GLuint uiChunkSize = (uiCount + uiTargetChunks - 1) / uiTargetChunks;
+
+	return std::max(std::max(1u, uiMinChunk), uiChunkSize);
+}
+
+SJob* CJobSystem::AllocateJob()
+{
+	const GLint iThreadIndex = GetThreadIndex();
+
+	if (iThreadIndex == JOB_INVALID_THREAD_INDEX)
+	{
+		const GLuint uiIndex = m_uiExternalAllocatedJobs.fetch_add(1, std::memory_order_relaxed);
+		return (&m_pExternalJobPool[uiIndex & (JOB_POOL_SIZE - 1)]);
+	}
+
+	// only the owning thread touches its pool, no synchronization needed
+	SWorker* pWorker = m_vecWorkers[iThreadIndex];
+	const GLuint uiIndex = pWorker->m_uiAllocatedJobs++;
+	return (&pWorker->m_pJobPool[uiIndex & (JOB_POOL_SIZE - 1)]);
+}
+
+SJob* CJobSystem::GetJob()
+{
+	const GLint iThreadIndex = GetThreadIndex();
+
+	// own work first, newest job is the most likely to be hot in cache
+	if (iThreadIndex != JOB_INVALID_THREAD_INDEX)
+	{
+		SJob* pJob = m_vecWorkers[iThreadIndex]->m_deque.Pop();
+		if (pJob)
+		{
+			return (pJob);
+		}
+	}
+
+	// jobs pushed by non worker threads
+	{
+		std::lock_guard<std::mutex> lock(m_mutexExternal);
+		if (m_vecExternalJobs.empty() == false)
+		{
+			SJob* pJob = m_vecExternalJobs.back();
+			m_vecExternalJobs.pop_back();
+			return (pJob);
+		}
+	}
+
+	// steal the oldest job of a random victim
+	const GLuint uiWorkerCount = GetWorkerCount();
+	if (uiWorkerCount == 0)
+	{
+		return (nullptr);
+	}
+
+	const GLuint uiVictim = NextRandom() % uiWorkerCount;
+	for (GLuint i = 0; i < uiWorkerCount; i++)
+	{
+		const GLuint uiIndex = (uiVictim + i) % uiWorkerCount;
+		if (static_cast<GLint>(uiIndex) == iThreadIndex)
+		{
+			continue;
+		}
+
+		SJob* pJob = m_vecWorkers[uiIndex]->m_deque.Steal();
+		if (pJob)
+		{
+			return (pJob);
+		}
+	}
+
+	return (nullptr);
+}
+
+void CJobSystem::Execute(SJob* pJob)
+{
+	ANUBIS_ZONE("Job");
+	pJob->m_pFunction(pJob, pJob->m_aData);
+	Finish(pJob);
+}
+
+void CJobSystem::Finish(SJob* pJob)
+{
+	const int32_t iUnfinishedJobs = pJob->m_iUnfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (iUnfinishedJobs != 0)
+	{
+		return;
+	}
+
+	const int32_t iContinuationCount = pJob->m_iContinuationCount.load(std::memory_order_relaxed);
+	for (int32_t i = 0; i < iContinuationCount; i++)
+	{
+		Run(pJob->m_apContinuations[i]);
+	}
+
+	if (pJob->m_pParent)
+	{
+		Finish(pJob->m_pParent);
+	}
+}
+
+void CJobSystem::WorkerLoop(GLint iThreadIndex)
+{
+	tl_iThreadIndex = iThreadIndex;
+
+#if ANUBIS_PROFILE_ENABLED
+	char szThreadName[CPU_PROFILER_THREAD_NAME_MAX];
+	snprintf(szThreadName, sizeof(szThreadName), "Worker %d", iThreadIndex);
+	ANUBIS_THREAD_NAME(szThreadName);
+#endif
+
+	GLuint uiIdleSpins = 0;
+	while (m_bIsRunning)
+	{
+		// read before looking for work, anything published later moves it
+		const GLuint uiEpoch = m_uiWorkEpoch.load();
+
+		SJob* pJob = GetJob();
+		if (pJob)
+		{
+			Execute(pJob);
+			uiIdleSpins = 0;
+			continue;
+		}
+
+		// frame work always comes first, it is checked again after every background job
+		if (RunBackgroundJob())
+		{
+			uiIdleSpins = 0;
+			continue;
+		}
+
+		// spin a little before going to sleep, new jobs usually come in bursts
+		if (++uiIdleSpins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutexSleep);
+		m_iSleepingWorkers++;
+		// a publisher either sees us sleeping and notifies under the lock, or
+		// moved the epoch before we checked it
+		m_cvWake.wait(lock, [this, uiEpoch]() { return m_bIsRunning == false || m_uiWorkEpoch.load() != uiEpoch; });
+		m_iSleepingWorkers--;
+		uiIdleSpins = 0;
+	}
+
+	tl_iThreadIndex = JOB_INVALID_THREAD_INDEX;
+}
+
+void CJobSystem::WakeWorkers()
+{
+	// sequentially consistent with the increment of a worker going to sleep,
+	// one of the two sides always sees the other
+	m_uiWorkEpoch.fetch_add(1);
+	if (m_iSleepingWorkers.load() > 0)
+	{
+		// taken so the notify cannot fall between the check and the wait of a worker
+		std::lock_guard<std::mutex> lock(m_mutexSleep);
+		m_cvWake.notify_one();
+	}
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <singleton.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+struct SJob;
+typedef void (*JobFunction)(SJob* pJob, const void* pData);
+
+enum EJobSystemData
+{
+	JOB_MAX_CONTINUATIONS = 4,
+
+	// Both must be powers of two
+	JOB_POOL_SIZE = 4096,		// jobs allocated per thread before the ring wraps around
+	JOB_DEQUE_SIZE = 4096,		// jobs queued per worker before Run() executes inline
+
+	// Background jobs running at the same time, the other workers stay free for the frame
+	JOB_MAX_BACKGROUND_JOBS = 2,
+
+	// Worker 0 is always the thread that initialized the job system
+	JOB_MAIN_THREAD_INDEX = 0,
+	JOB_INVALID_THREAD_INDEX = -1,
+};
+
+/**
+ * Unit of work, exactly two cache lines.
+ * A job counts itself plus every child that is still running, it is finished
+ * once that counter reaches zero. Continuations are run after it finishes.
+ */
+typedef struct alignas(64) SJob
+{
+	JobFunction m_pFunction;
+	SJob* m_pParent;
+	std::atomic<int32_t> m_iUnfinishedJobs;
+	std::atomic<int32_t> m_iContinuationCount;
+	SJob* m_apContinuations[JOB_MAX_CONTINUATIONS];
+	uint8_t m_aData[128 - sizeof(JobFunction) - sizeof(SJob*) - (2 * sizeof(std::atomic<int32_t>)) - (JOB_MAX_CONTINUATIONS * sizeof(SJob*))];
+} TJob;
+
+static_assert(sizeof(TJob) == 128, "SJob is expected to be two cache lines");
+
+// Jobs are referenced by pointer, a handle stays valid until the owning thread
+// allocated JOB_POOL_SIZE more jobs.
+typedef SJob* JobHandle;
+
+/**
+ * Chase-Lev work stealing deque.
+ * Only the owning worker pushes and pops at the bottom, any thread may steal
+ * from the top.
+ */
+class CJobDeque
+{
+public:
+	CJobDeque();
+
+	bool Push(SJob* pJob);
+	SJob* Pop();
+	SJob* Steal();
+
+	int64_t GetSize() const;
+
+private:
+	alignas(64) std::atomic<int64_t> m_lTop;
+	alignas(64) std::atomic<int64_t> m_lBottom;
+	std::atomic<SJob*> m_apJobs[JOB_DEQUE_SIZE];
+};
+
+class CJobSystem : public CSingleton<CJobSystem>
+{
+public:
+	CJobSystem();
+	~CJobSystem();
+
+	CJobSystem(const CJobSystem&) = delete;
+	CJobSystem& operator=(const CJobSystem&) = delete;
+
+	/**
+	 * Starts the worker threads, the calling thread becomes worker 0 and may
+	 * help executing jobs while it waits.
+	 *
+	 * @param uiWorkerCount Total workers including the caller, 0 for one per core
+	 */
+	void Initialize(GLuint uiWorkerCount = 0);
+	void Destroy();
+
+	/**
+	 * Creates a job that is not scheduled yet.
+	 *
+	 * @param pFunction Function executed by the job
+	 * @param pParent Optional parent, it will not finish before this job does
+	 * @param pData Optional payload copied into the job
+	 * @param stDataSize Size of pData, at most sizeof(SJob::m_aData)
+	 */
+	JobHandle CreateJob(JobFunction pFunction, JobHandle pParent = nullptr, const void* pData = nullptr, size_t stDataSize = 0);
+
+	/**
+	 * Creates a job running a callable stored inline in the job payload.
+	 */
+	template <typename TFunc>
+	JobHandle CreateLambdaJob(const TFunc& func, JobHandle pParent = nullptr)
+	{
+		static_assert(sizeof(TFunc) <= sizeof(SJob::m_aData), "Lambda captures too much to be stored in a job");
+		static_assert(std::is_trivially_copyable<TFunc>::value, "Lambda captures must be trivially copyable");
+
+		return CreateJob(&LambdaThunk<TFunc>, pParent, &func, sizeof(TFunc));
+	}
+
+	/**
+	 * Schedules pContinuation to run once pAncestor finished.
+	 * Must be called before pAncestor is run.
+	 *
+	 * @return false if pAncestor has no continuation slot left
+	 */
+	bool AddContinuation(JobHandle pAncestor, JobHandle pContinuation);
+
+	/**
+	 * Pushes a job to the calling thread's deque.
+	 */
+	void Run(JobHandle pJob);
+
+	/**
+	 * Queues a callable on the background lane, for long work like file
+	 * decoding. Only worker threads with nothing else to do pick it up, worker 0
+	 * and Wait() never do, so a frame never stalls behind it. There is no handle,
+	 * the callable signals its own completion. Jobs still queued on Destroy()
+	 * are dropped.
+	 * Runs inline if no worker thread besides the caller exists.
+	 */
+	template <typename TFunc>
+	void RunBackground(const TFunc& func)
+	{
+		static_assert(sizeof(TFunc) <= sizeof(SJob::m_aData), "Lambda captures too much to be stored in a job");
+		static_assert(std::is_trivially_copyable<TFunc>::value, "Lambda captures must be trivially copyable");
+
+		PushBackgroundJob(&LambdaThunk<TFunc>, &func, sizeof(TFunc));
+	}
+
+	/**
+	 * Waits for a job and its children, executing other jobs meanwhile.
+	 */
+	void Wait(JobHandle pJob);
+
+	bool IsFinished(JobHandle pJob) const;
+
+	/**
+	 * Creates a job calling func(uiStart, uiEnd) over [0, uiCount) split into
+	 * chunks, the range is halved recursively so idle workers can steal the
+	 * bigger halves first.
+	 *
+	 * @param uiMinChunk Smallest range handed to a single call, 0 for automatic
+	 */
+	template <typename TFunc>
+	JobHandle CreateParallelFor(GLuint uiCount, const TFunc& func, GLuint uiMinChunk = 0, JobHandle pParent = nullptr)
+	{
+		static_assert(sizeof(TParallelForData<TFunc>) <= sizeof(SJob::m_aData), "Lambda captures too much to be stored in a job");
+		static_assert(std::is_trivially_copyable<TFunc>::value, "Lambda captures must be trivially copyable");
+
+		TParallelForData<TFunc> data{ func, 0, uiCount, GetChunkSize(uiCount, uiMinChunk) };
+		return CreateJob(&ParallelForThunk<TFunc>, pParent, &data, sizeof(data));
+	}
+
+	/**
+	 * Runs func(uiStart, uiEnd) over [0, uiCount) on every worker and returns
+	 * once all chunks are done, the calling thread takes part in the work.
+	 */
+	template <typename TFunc>
+	void ParallelFor(GLuint uiCount, const TFunc& func, GLuint uiMinChunk = 0)
+	{
+		if (uiCount == 0)
+		{
+			return;
+		}
+
+		// not worth the scheduling overhead
+		if (GetChunkSize(uiCount, uiMinChunk) >= uiCount)
+		{
+			func(0, uiCount);
+			return;
+		}
+
+		JobHandle pJob = CreateParallelFor(uiCount, func, uiMinChunk);
+		Run(pJob);
+		Wait(pJob);
+	}
+
+	GLuint GetWorkerCount() const;
+
+	/**
+	 * Index of the calling worker, JOB_INVALID_THREAD_INDEX for threads not
+	 * owned by the job system (they still can run and wait on jobs).
+	 */
+	static GLint GetThreadIndex();
+
+protected:
+	template <typename TFunc>
+	struct TParallelForData
+	{
+		TFunc m_func;
+		GLuint m_uiStart;
+		GLuint m_uiCount;
+		GLuint m_uiChunkSize;
+	};
+
+	template <typename TFunc>
+	static void LambdaThunk(SJob* pJob, const void* pData)
+	{
+		(*static_cast<const TFunc*>(pData))();
+	}
+
+	template <typename TFunc>
+	static void ParallelForThunk(SJob* pJob, const void* pData)
+	{
+		const TParallelForData<TFunc>& data = *static_cast<const TParallelForData<TFunc>*>(pData);
+
+		if (data.m_uiCount > data.m_uiChunkSize)
+		{
+			// split in two halves, children keep pJob alive until they are done
+			const GLuint uiLeftCount = data.m_uiCount / 2;
+
+			TParallelForData<TFunc> leftData{ data.m_func, data.m_uiStart, uiLeftCount, data.m_uiChunkSize };
+			TParallelForData<TFunc> rightData{ data.m_func, data.m_uiStart + uiLeftCount, data.m_uiCount - uiLeftCount, data.m_uiChunkSize };
+
+			CJobSystem& jobSystem = CJobSystem::Instance();
+			jobSystem.Run(jobSystem.CreateJob(&ParallelForThunk<TFunc>, pJob, &leftData, sizeof(leftData)));
+			jobSystem.Run(jobSystem.CreateJob(&ParallelForThunk<TFunc>, pJob, &rightData, sizeof(rightData)));
+		}
+		else
+		{
+			data.m_func(data.m_uiStart, data.m_uiStart + data.m_uiCount);
+		}
+	}
+
+	GLuint GetChunkSize(GLuint uiCount, GLuint uiMinChunk) const;
+
+	SJob* AllocateJob();
+	SJob* GetJob();
+
+	void PushBackgroundJob(JobFunction pFunction, const void* pData, size_t stDataSize);
+
+	/**
+	 * Runs the oldest background job, false if there is none or
+	 * JOB_MAX_BACKGROUND_JOBS already run.
+	 */
+	bool RunBackgroundJob();
+	void Execute(SJob* pJob);
+	void Finish(SJob* pJob);
+
+	void WorkerLoop(GLint iThreadIndex);
+	void WakeWorkers();
+
+private:
+	// Per worker state, one cache line apart to avoid false sharing
+	struct alignas(64) SWorker
+	{
+		CJobDeque m_deque;
+		SJob* m_pJobPool;
+		GLuint m_uiAllocatedJobs;
+	};
+
+	// Stored by value, a queued job may wait longer than the job pools take to wrap
+	struct SBackgroundJob
+	{
+		JobFunction m_pFunction;
+		uint8_t m_aData[sizeof(SJob::m_aData)];
+	};
+
+	std::vector<SWorker*> m_vecWorkers;
+	std::vector<std::thread> m_vecThreads;
+	std::atomic<bool> m_bIsRunning;
+
+	// Jobs created & run by threads that are not workers (render thread, loaders, ...)
+	std::mutex m_mutexExternal;
+	std::vector<SJob*> m_vecExternalJobs;
+	SJob* m_pExternalJobPool;
+	std::atomic<GLuint> m_uiExternalAllocatedJobs;
+
+	// Background lane, FIFO
+	std::mutex m_mutexBackground;
+	std::deque<SBackgroundJob> m_dequeBackgroundJobs;
+	GLint m_iRunningBackgroundJobs;
+
+	// Sleeping idle workers, the epoch moves whenever work is published so a
+	// worker never sleeps on work pushed after it last looked
+	std::mutex m_mutexSleep;
+	std::condition_variable m_cvWake;
+	std::atomic<GLint> m_iSleepingWorkers;
+	std::atomic<GLuint> m_uiWorkEpoch;
+};
@@ -0,0 +1,270 @@
+#include "LinearAllocator.h"
+#include <utils.h>
+#include <cassert>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+
+static size_t AlignUp(size_t stValue, size_t stAlignment)
+{
+	return (stValue + (stAlignment - 1)) & ~(stAlignment - 1);
+}
+
+/*
+ * CLinearAllocator
+ */
+CLinearAllocator::CLinearAllocator()
+{
+	m_pMemory = nullptr;
+	m_stCapacity = 0;
+	m_stOffset = 0;
+	m_stHighWater = 0;
+	m_stAllocations = 0;
+	m_stOverflows = 0;
+	m_szName = "unknown";
+}
+
+CLinearAllocator::~CLinearAllocator()
+{
+	Destroy();
+}
+
+void CLinearAllocator::Initialize(size_t stCapacity, const char* szName)
+{
+	Destroy();
+
+	// the block itself is aligned on a cache line, so is the first allocation
+	m_stCapacity = AlignUp(stCapacity, 64);
+	m_pMemory = static_cast<uint8_t*>(::operator new(m_stCapacity, std::align_val_t(64)));
+	m_szName = szName;
+
+	m_stOffset = 0;
+	m_stHighWater = 0;
+	m_stAllocations = 0;
+	m_stOverflows = 0;
+
+#ifdef _DEBUG
+	std::memset(m_pMemory, ALLOCATOR_POISON_FREED, m_stCapacity);
+#endif
+}
+
+void CLinearAllocator::Destroy()
+{
+	if (m_pMemory == nullptr)
+	{
+		return;
+	}
+
+	if (m_stOverflows > 0)
+	{
+		syserr("Arena '%s' overflowed %zu times, high water %zu / %zu bytes", m_szName, m_stOverflows.load(), m_stHighWater.load(), m_stCapacity);
+	}
+
+	::operator delete(m_pMemory, std::align_val_t(64));
+	m_pMemory = nullptr;
+	m_stCapacity = 0;
+	m_stOffset = 0;
+}
+
+void* CLinearAllocator::Allocate(size_t stSize, size_t stAlignment)
+{
+	size_t stOffset = m_stOffset.load(std::memory_order_relaxed);
+	size_t stAlignedOffset = 0;
+	size_t stNewOffset = 0;
+
+	// lock-free bump, retried only when another thread allocated in between
+	do
+	{
+		stAlignedOffset = AlignUp(stOffset, stAlignment);
+		stNewOffset = stAlignedOffset + stSize;
+
+		if (stNewOffset > m_stCapacity)
+		{
+			return (nullptr);
+		}
+	} while (m_stOffset.compare_exchange_weak(stOffset, stNewOffset, std::memory_order_relaxed) == false);
+
+	m_stAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	size_t stHighWater = m_stHighWater.load(std::memory_order_relaxed);
+	while (stNewOffset > stHighWater && m_stHighWater.compare_exchange_weak(stHighWater, stNewOffset, std::memory_order_relaxed) == false)
+	{
+	}
+
+	void* pMemory = m_pMemory + stAlignedOffset;
+
+#ifdef _DEBUG
+	std::memset(pMemory, ALLOCATOR_POISON_ALLOCATED, stSize);
+#endif
+
+	return (pMemory);
+}
+
+void CLinearAllocator::Reset()
+{
+	FreeToMarker(0);
+	m_stAllocations = 0;
+}
+
+size_t CLinearAllocator::GetMarker() const
+{
+	return (m_stOffset.load(std::memory_order_relaxed));
+}
+
+void CLinearAllocator::FreeToMarker(size_t stMarker)
+{
+	const size_t stOffset = m_stOffset.load(std::memory_order_relaxed);
+	assert(stMarker <= stOffset);
+
+#ifdef _DEBUG
+	// catch anything still pointing into the released range
+	if (m_pMemory)
+	{
+		std::memset(m_pMemory + stMarker, ALLOCATOR_POISON_FREED, stOffset - stMarker);
+	}
+#endif
+
+	m_stOffset.store(stMarker, std::memory_order_relaxed);
+}
+
+bool CLinearAllocator::Owns(const void* pMemory) const
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pMemory);
+	return (pBytes >= m_pMemory) && (pBytes < m_pMemory + m_stCapacity);
+}
+
+void CLinearAllocator::AddOverflow()
+{
+	m_stOverflows.fetch_add(1, std::memory_order_relaxed);
+}
+
+TAllocatorStats CLinearAllocator::GetStats() const
+{
+	TAllocatorStats stats{};
+	stats.m_stCapacity = m_stCapacity;
+	stats.m_stUsed = m_stOffset.load(std::memory_order_relaxed);
+	stats.m_stHighWater = m_stHighWater.load(std::memory_order_relaxed);
+	stats.m_stAllocations = m_stAllocations.load(std::memory_order_relaxed);
+	stats.m_stOverflows = m_stOverflows.load(std::memory_order_relaxed);
+	return (stats);
+}
+
+const char* CLinearAllocator::GetName() const
+{
+	return (m_szName);
+}
+
+/*
+ * CFrameAllocator
+ */
+CFrameAllocator::CFrameAllocator()
+{
+	m_uiCurrentArena = 0;
+}
+
+CFrameAllocator::~CFrameAllocator()
+{
+	Destroy();
+}
+
+void CFrameAllocator::Initialize(size_t stArenaSize)
+{
+	for (CLinearAllocator& arena : m_arrArenas)
+	{
+		arena.Initialize(stArenaSize, "FrameArena");
+	}
+
+	m_uiCurrentArena = 0;
+}
+
+void CFrameAllocator::Destroy()
+{
+	const TAllocatorStats stats = GetStats();
+	if (stats.m_stCapacity > 0)
+	{
+		syslog("Frame arenas high water %zu / %zu bytes, %zu overflows", stats.m_stHighWater, stats.m_stCapacity, stats.m_stOverflows);
+	}
+
+	for (CLinearAllocator& arena : m_arrArenas)
+	{
+		arena.Destroy();
+	}
+}
+
+void CFrameAllocator::BeginFrame(GLuint64 ulFrameIndex)
+{
+	const GLuint uiArena = static_cast<GLuint>(ulFrameIndex % FRAME_ARENA_COUNT);
+
+	m_arrArenas[uiArena].Reset();
+	m_uiCurrentArena.store(uiArena, std::memory_order_release);
+}
+
+void* CFrameAllocator::Allocate(size_t stSize, size_t stAlignment)
+{
+	CLinearAllocator& arena = GetCurrentArena();
+
+	void* pMemory = arena.Allocate(stSize, stAlignment);
+	if (pMemory == nullptr)
+	{
+		arena.AddOverflow();
+	}
+
+	return (pMemory);
+}
+
+CLinearAllocator& CFrameAllocator::GetCurrentArena()
+{
+	return (m_arrArenas[m_uiCurrentArena.load(std::memory_order_acquire)]);
+}
+
+TAllocatorStats CFrameAllocator::GetStats() const
+{
+	// worst arena wins, they all have the same capacity
+	TAllocatorStats stats{};
+	for (const CLinearAllocator& arena : m_arrArenas)
+	{
+		const TAllocatorStats arenaStats = arena.GetStats();
+		stats.m_stCapacity = arenaStats.m_stCapacity;
+		stats.m_stUsed = std::max(stats.m_stUsed, arenaStats.m_stUsed);
+		stats.m_stHighWater = std::max(stats.m_stHighWater, arenaStats.m_stHighWater);
+		stats.m_stAllocations += arenaStats.m_stAllocations;
+		stats.m_stOverflows += arenaStats.m_stOverflows;
+	}
+
+	return (stats);
+}
+
+/*
+ * CScratchAllocator
+ */
+CLinearAllocator& CScratchAllocator::Get()
+{
+	// created on first use, released when the thread exits
+	static thread_local std::unique_ptr<CLinearAllocator> tl_pScratchArena;
+
+	if (tl_pScratchArena == nullptr)
+	{
+		tl_pScratchArena = std::make_unique<CLinearAllocator>();
+		tl_pScratchArena->Initialize(SCRATCH_ARENA_SIZE, "ScratchArena");
+	}
+
+	return (*tl_pScratchArena);
+}
+
+/*
+ * CScratchScope
+ */
+CScratchScope::CScratchScope() : m_allocator(CScratchAllocator::Get())
+{
+	m_stMarker = m_allocator.GetMarker();
+}
+
+CScratchScope::~CScratchScope()
+{
+	m_allocator.FreeToMarker(m_stMarker);
+}
+
+CLinearAllocator& CScratchScope::GetAllocator()
+{
+	return (m_allocator);
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <singleton.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+enum EAllocatorData
+{
+	ALLOCATOR_DEFAULT_ALIGNMENT = 16,
+
+	FRAME_ARENA_SIZE = 8 * 1024 * 1024,		// per buffered frame
+	FRAME_ARENA_COUNT = 3,					// one per frame packet, FramePacket.h checks it
+	SCRATCH_ARENA_SIZE = 1 * 1024 * 1024,	// per thread
+
+	// Debug fill patterns, fresh memory and memory released by a reset
+	ALLOCATOR_POISON_ALLOCATED = 0xCD,
+	ALLOCATOR_POISON_FREED = 0xDD,
+};
+
+typedef struct SAllocatorStats
+{
+	size_t m_stCapacity;		// Size of the arena in bytes
+	size_t m_stUsed;			// Bytes currently handed out
+	size_t m_stHighWater;		// Most bytes in use at once since Initialize(), resets keep it
+	size_t m_stAllocations;		// Allocations since the last reset
+	size_t m_stOverflows;		// Allocations that did not fit and went to the heap
+} TAllocatorStats;
+
+/**
+ * Bump allocator over a single memory block.
+ * Allocation is a lock-free pointer bump so several threads may share one
+ * arena, memory is only given back all at once by Reset() or FreeToMarker().
+ */
+class CLinearAllocator
+{
+public:
+	CLinearAllocator();
+	~CLinearAllocator();
+
+	CLinearAllocator(const CLinearAllocator&) = delete;
+	CLinearAllocator& operator=(const CLinearAllocator&) = delete;
+
+	void Initialize(size_t stCapacity, const char* szName);
+	void Destroy();
+
+	/**
+	 * Allocates memory from the arena.
+	 *
+	 * @return Aligned memory, or nullptr if the arena is exhausted
+	 */
+	void* Allocate(size_t stSize, size_t stAlignment = ALLOCATOR_DEFAULT_ALIGNMENT);
+
+	template <typename T>
+	T* AllocateArray(size_t stCount)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * stCount, alignof(T)));
+	}
+
+	/**
+	 * Releases every allocation, not thread safe.
+	 */
+	void Reset();
+
+	// Stack style usage, not thread safe
+	size_t GetMarker() const;
+	void FreeToMarker(size_t stMarker);
+
+	bool Owns(const void* pMemory) const;
+
+	void AddOverflow();
+	TAllocatorStats GetStats() const;
+	const char* GetName() const;
+
+private:
+	uint8_t* m_pMemory;
+	size_t m_stCapacity;
+	std::atomic<size_t> m_stOffset;
+	std::atomic<size_t> m_stHighWater;
+	std::atomic<size_t> m_stAllocations;
+	std::atomic<size_t> m_stOverflows;
+	const char* m_szName;
+};
+
+/**
+ * One linear arena per frame in flight.
+ * The arena of frame N is reset when frame N + FRAME_ARENA_COUNT begins,
+ * which is when the frame packet of frame N came back from the render thread,
+ * so frame data can be referenced from frame packets safely.
+ */
+class CFrameAllocator : public CSingleton<CFrameAllocator>
+{
+public:
+	CFrameAllocator();
+	~CFrameAllocator();
+
+	void Initialize(size_t stArenaSize = FRAME_ARENA_SIZE);
+	void Destroy();
+
+	/**
+	 * Switches to the arena of ulFrameIndex and resets it.
+	 * Called by the main thread once the frame packet was acquired.
+	 */
+	void BeginFrame(GLuint64 ulFrameIndex);
+
+	void* Allocate(size_t stSize, size_t stAlignment = ALLOCATOR_DEFAULT_ALIGNMENT);
+	CLinearAllocator& GetCurrentArena();
+
+	TAllocatorStats GetStats() const;
+
+private:
+	std::array<CLinearAllocator, FRAME_ARENA_COUNT> m_arrArenas;
+	std::atomic<GLuint> m_uiCurrentArena;
+};
+
+/**
+ * Per thread stack of temporary memory.
+ * Use CScratchScope to give everything allocated inside a scope back at once.
+ */
+class CScratchAllocator
+{
+public:
+	static CLinearAllocator& Get();
+};
+
+class CScratchScope
+{
+public:
+	CScratchScope();
+	~CScratchScope();
+
+	CScratchScope(const CScratchScope&) = delete;
+	CScratchScope& operator=(const CScratchScope&) = delete;
+
+	CLinearAllocator& GetAllocator();
+
+private:
+	CLinearAllocator& m_allocator;
+	size_t m_stMarker;
+};
+
+/**
+ * STL allocator on top of a linear arena.
+ * Deallocation is a no-op, when the arena is exhausted the allocation falls
+ * back to the heap and is freed normally. Without an arena every allocation
+ * goes to the heap. The arena follows the container when it is moved or
+ * swapped, so a container is moved to another arena by assigning it a new one.
+ */
+template <typename T> class TArenaAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	TArenaAllocator() : m_pArena(nullptr)
+	{
+	}
+
+	explicit TArenaAllocator(CLinearAllocator* pArena) : m_pArena(pArena)
+	{
+	}
+
+	template <typename U>
+	TArenaAllocator(const TArenaAllocator<U>& other) : m_pArena(other.GetArena())
+	{
+	}
+
+	T* allocate(size_t stCount)
+	{
+		void* pMemory = nullptr;
+		if (m_pArena)
+		{
+			pMemory = m_pArena->Allocate(sizeof(T) * stCount, alignof(T) > ALLOCATOR_DEFAULT_ALIGNMENT ? alignof(T) : static_cast<size_t>(ALLOCATOR_DEFAULT_ALIGNMENT));
+			if (pMemory == nullptr)
+			{
+				m_pArena->AddOverflow();
+			}
+		}
+
+		if (pMemory == nullptr)
+		{
+
+			// the plain operator new only guarantees __STDCPP_DEFAULT_NEW_ALIGNMENT__
+			if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+			{
+				pMemory = ::operator new(sizeof(T) * stCount, std::align_val_t(alignof(T)));
+			}
+			else
+			{
+				pMemory = ::operator new(sizeof(T) * stCount);
+			}
+		}
+
+		return static_cast<T*>(pMemory);
+	}
+
+	void deallocate(T* pMemory, size_t)
+	{
+		if (m_pArena == nullptr || m_pArena->Owns(pMemory) == false)
+		{
+			if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+			{
+				::operator delete(pMemory, std::align_val_t(alignof(T)));
+			}
+			else
+			{
+				::operator delete(pMemory);
+			}
+		}
+	}
+
+	CLinearAllocator* GetArena() const
+	{
+		return (m_pArena);
+	}
+
+	template <typename U>
+	bool operator==(const TArenaAllocator<U>& other) const
+	{
+		return (m_pArena == other.GetArena());
+	}
+
+	template <typename U>
+	bool operator!=(const TArenaAllocator<U>& other) const
+	{
+		return (m_pArena != other.GetArena());
+	}
+
+private:
+	CLinearAllocator* m_pArena;
+};
+
+template <typename T>
+using TArenaVector = std::vector<T, TArenaAllocator<T>>;
+
+/**
+ * Moves an emptied vec to pArena, reserving at least the capacity it had.
+ * The old storage is not read, it may belong to an arena already reset.
+ */
+template <typename T>
+void RebindArenaVector(TArenaVector<T>& vec, CLinearAllocator* pArena, size_t stMinCapacity = 0)
+{
+	const size_t stCapacity = std::max(vec.capacity(), stMinCapacity);
+
+	vec = TArenaVector<T>(TArenaAllocator<T>(pArena));
+	vec.reserve(stCapacity);
+}
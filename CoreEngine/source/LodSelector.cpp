@@ -0,0 +1,63 @@
+#include "LodSelector.h"
+#include <algorithm>
+
+// closer than the near plane the projection of the error makes no sense
+static const GLfloat LOD_MIN_DISTANCE = 0.1f;
+
+CLodSelector::CLodSelector()
+{
+	m_settings.m_fPixelError = 1.0f;
+	m_settings.m_fHysteresis = 0.25f;
+	m_fProjectionScale = 0.0f;
+}
+
+void CLodSelector::SetSettings(const TLodSettings& settings)
+{
+	m_settings.m_fPixelError = std::max(settings.m_fPixelError, 0.0f);
+	m_settings.m_fHysteresis = std::clamp(settings.m_fHysteresis, 0.0f, 1.0f);
+}
+
+const TLodSettings& CLodSelector::GetSettings() const
+{
+	return (m_settings);
+}
+
+void CLodSelector::SetProjection(const Matrix4& mat4Projection, GLint iViewportHeight)
+{
+	// [1][1] is cot(fov / 2), it maps y / d to [-1, 1], half the viewport
+	m_fProjectionScale = mat4Projection[1].y * static_cast<GLfloat>(iViewportHeight) * 0.5f;
+}
+
+GLint CLodSelector::SelectLod(const TMeshAsset& mesh, const Vector3D& v3Center, GLfloat fRadius, const Vector3D& v3CameraPosition, GLint iCurrentLod) const
+{
+	if (mesh.m_uiLodCount <= 1)
+	{
+		return (0);
+	}
+
+	const Vector3D v3ToCenter(v3Center.x - v3CameraPosition.x, v3Center.y - v3CameraPosition.y, v3Center.z - v3CameraPosition.z);
+	const GLfloat fDistance = std::max(v3ToCenter.length() - fRadius, LOD_MIN_DISTANCE);
+
+	const GLint iLodCount = static_cast<GLint>(mesh.m_uiLodCount);
+	GLint iLod = std::clamp(iCurrentLod, 0, iLodCount - 1);
+
+	// too coarse, finer levels until one is under the threshold
+	while (iLod > 0 && GetProjectedError(mesh.m_arrLods[iLod].m_fError, fDistance) > m_settings.m_fPixelError)
+	{
+		iLod--;
+	}
+
+	// coarser only with some margin, the errors grow with the level
+	const GLfloat fCoarserError = m_settings.m_fPixelError * (1.0f - m_settings.m_fHysteresis);
+	while (iLod + 1 < iLodCount && GetProjectedError(mesh.m_arrLods[iLod + 1].m_fError, fDistance) <= fCoarserError)
+	{
+		iLod++;
+	}
+
+	return (iLod);
+}
+
+GLfloat CLodSelector::GetProjectedError(GLfloat fError, GLfloat fDistance) const
+{
+	return (fError * m_fProjectionScale / std::max(fDistance, LOD_MIN_DISTANCE));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <maths.h>
+#include "MeshAsset.h"
+
+/**
+ * Thresholds of the level of detail selection, set by --lod-error and
+ * --lod-hysteresis.
+ */
+typedef struct SLodSettings
+{
+	GLfloat m_fPixelError;		// a level is drawn while its error covers fewer pixels
+	GLfloat m_fHysteresis;		// a coarser level has to stay under (1 - hysteresis) of the threshold
+} TLodSettings;
+
+/**
+ * Picks the level of detail of a cooked mesh from the size its simplification
+ * error projects to on screen.
+ *
+ * The error of a level is a distance in world units, seen from d units away it
+ * covers error * scale / d pixels where the scale comes from the vertical
+ * field of view and the viewport height. The nearest point of the bounding
+ * sphere is used, so the error is never underestimated.
+ *
+ * Switching to a finer level happens as soon as the current one is over the
+ * threshold, switching to a coarser one only well under it, an object sitting
+ * at the boundary does not change level every frame.
+ */
+class CLodSelector
+{
+public:
+	CLodSelector();
+
+	void SetSettings(const TLodSettings& settings);
+	const TLodSettings& GetSettings() const;
+
+	/**
+	 * Call when the projection or the viewport changes.
+	 */
+	void SetProjection(const Matrix4& mat4Projection, GLint iViewportHeight);
+
+	/**
+	 * @param v3Center World space bounding sphere of the mesh
+	 * @param iCurrentLod Level selected last frame
+	 * @return Level to draw, 0 is the full mesh
+	 */
+	GLint SelectLod(const TMeshAsset& mesh, const Vector3D& v3Center, GLfloat fRadius, const Vector3D& v3CameraPosition, GLint iCurrentLod) const;
+
+	GLfloat GetProjectedError(GLfloat fError, GLfloat fDistance) const;
+
+private:
+	TLodSettings m_settings;
+	GLfloat m_fProjectionScale;		// pixels covered by one world unit at distance 1
+};
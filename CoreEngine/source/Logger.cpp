@@ -0,0 +1,379 @@
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+
+std::atomic<CLogger*> CLogger::ms_pActiveLogger = nullptr;
+std::atomic<GLuint> CLogger::ms_uiActiveWriters = 0;
+
+static const char* GetLevelName(GLubyte ubLevel)
+{
+	switch (ubLevel)
+	{
+	case LOG_LEVEL_DEBUG:
+		return ("DEBUG");
+	case LOG_LEVEL_WARNING:
+		return ("WARN");
+	case LOG_LEVEL_ERROR:
+		return ("ERROR");
+	default:
+		return ("INFO");
+	}
+}
+
+static GLuint GetLogThreadID()
+{
+	static std::atomic<GLuint> s_uiNextThreadID = 0;
+	static thread_local GLuint tl_uiThreadID = s_uiNextThreadID++;
+	return (tl_uiThreadID);
+}
+
+void LogWrite(ELogLevel eLevel, const char* szFunction, const char* szFormat, ...)
+{
+	va_list args;
+	va_start(args, szFormat);
+
+	CLogger* pLogger = CLogger::AcquireActive();
+	if (pLogger)
+	{
+		pLogger->Write(eLevel, szFunction, szFormat, args);
+		CLogger::ReleaseActive();
+	}
+	else
+	{
+		char szMessage[LOGGER_MESSAGE_MAX];
+		vsnprintf(szMessage, sizeof(szMessage), szFormat, args);
+		CLogger::WriteDirect(eLevel, szFunction, szMessage);
+	}
+
+	va_end(args);
+}
+
+CLogger::CLogger()
+{
+	m_pRecords = nullptr;
+	m_stEnqueuePos = 0;
+	m_stDequeuePos = 0;
+
+#ifdef _DEBUG
+	m_ubMinLevel = LOG_LEVEL_DEBUG;
+#else
+	m_ubMinLevel = LOG_LEVEL_INFO;
+#endif
+
+	m_ulDropped = 0;
+	m_ulRateLimited = 0;
+	m_bIsRunning = false;
+	m_pFile = nullptr;
+
+	for (std::atomic<uint64_t>& bucket : m_arrRateBuckets)
+	{
+		bucket = 0;
+	}
+}
+
+CLogger::~CLogger()
+{
+	Destroy();
+}
+
+bool CLogger::Initialize(const std::string& stFilePath)
+{
+	if (m_bIsRunning)
+	{
+		return (true);
+	}
+
+	m_pRecords = new TLogRecord[LOGGER_RING_SIZE];
+	for (size_t i = 0; i < LOGGER_RING_SIZE; i++)
+	{
+		m_pRecords[i].m_stSequence.store(i, std::memory_order_relaxed);
+	}
+
+	m_stEnqueuePos = 0;
+	m_stDequeuePos = 0;
+	m_startTime = std::chrono::steady_clock::now();
+
+	if (stFilePath.empty() == false)
+	{
+#ifdef _MSC_VER
+		if (fopen_s(&m_pFile, stFilePath.c_str(), "w") != 0)
+		{
+			m_pFile = nullptr;
+		}
+#else
+		m_pFile = fopen(stFilePath.c_str(), "w");
+#endif
+		if (m_pFile == nullptr)
+		{
+			WriteDirect(LOG_LEVEL_ERROR, FUNCTION_NAME, ("Failed to open log file " + stFilePath).c_str());
+		}
+	}
+
+	m_bIsRunning = true;
+	m_writerThread = std::thread(&CLogger::WriterLoop, this);
+
+	ms_pActiveLogger = this;
+	return (true);
+}
+
+void CLogger::Destroy()
+{
+	if (m_bIsRunning == false)
+	{
+		return;
+	}
+
+	// new messages go straight to the console from now on, the ring stays
+	// alive until the threads that got the logger before are done pushing
+	ms_pActiveLogger.store(nullptr, std::memory_order_seq_cst);
+	while (ms_uiActiveWriters.load(std::memory_order_seq_cst) != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	m_bIsRunning = false;
+	if (m_writerThread.joinable())
+	{
+		m_writerThread.join();
+	}
+
+	// whatever got published while the writer was stopping
+	Flush();
+
+	if (m_ulDropped > 0 || m_ulRateLimited > 0)
+	{
+		char szMessage[128];
+		snprintf(szMessage, sizeof(szMessage), "%llu messages dropped, %llu rate limited", static_cast<unsigned long long>(m_ulDropped.load()), static_cast<unsigned long long>(m_ulRateLimited.load()));
+		WriteDirect(LOG_LEVEL_WARNING, FUNCTION_NAME, szMessage);
+	}
+
+	if (m_pFile)
+	{
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+
+	delete[] m_pRecords;
+	m_pRecords = nullptr;
+}
+
+void CLogger::SetMinLevel(ELogLevel eLevel)
+{
+	m_ubMinLevel = eLevel;
+}
+
+ELogLevel CLogger::GetMinLevel() const
+{
+	return static_cast<ELogLevel>(m_ubMinLevel.load());
+}
+
+bool CLogger::Write(ELogLevel eLevel, const char* szFunction, const char* szFormat, va_list args)
+{
+	if (eLevel < m_ubMinLevel.load(std::memory_order_relaxed))
+	{
+		return (false);
+	}
+
+	// errors are never muted
+	if (eLevel < LOG_LEVEL_ERROR && IsRateLimited(szFormat))
+	{
+		m_ulRateLimited.fetch_add(1, std::memory_order_relaxed);
+		return (false);
+	}
+
+	// format outside of the ring so the claimed slot is published right away
+	static thread_local char tl_szMessage[LOGGER_MESSAGE_MAX];
+
+	GLint iLength = vsnprintf(tl_szMessage, sizeof(tl_szMessage), szFormat, args);
+	if (iLength < 0)
+	{
+		return (false);
+	}
+
+	const size_t stLength = std::min(static_cast<size_t>(iLength), sizeof(tl_szMessage) - 1);
+	return Push(eLevel, szFunction, tl_szMessage, stLength);
+}
+
+CLogger* CLogger::AcquireActive()
+{
+	// counted before the load, Destroy() either sees the writer or the writer sees nullptr
+	ms_uiActiveWriters.fetch_add(1, std::memory_order_seq_cst);
+
+	CLogger* pLogger = ms_pActiveLogger.load(std::memory_order_seq_cst);
+	if (pLogger == nullptr)
+	{
+		ReleaseActive();
+	}
+
+	return (pLogger);
+}
+
+void CLogger::ReleaseActive()
+{
+	ms_uiActiveWriters.fetch_sub(1, std::memory_order_release);
+}
+
+void CLogger::WriteDirect(ELogLevel eLevel, const char* szFunction, const char* szMessage)
+{
+	FILE* pStream = (eLevel >= LOG_LEVEL_ERROR) ? stderr : stdout;
+	fprintf(pStream, "%s: %s\n", szFunction, szMessage);
+}
+
+bool CLogger::Push(ELogLevel eLevel, const char* szFunction, const char* szMessage, size_t stLength)
+{
+	// Bounded MPMC queue (D. Vyukov), every slot carries the position it is
+	// free to be written at, producers claim a position with a single CAS
+	TLogRecord* pRecord = nullptr;
+	size_t stPos = m_stEnqueuePos.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		pRecord = &m_pRecords[stPos & (LOGGER_RING_SIZE - 1)];
+
+		const size_t stSequence = pRecord->m_stSequence.load(std::memory_order_acquire);
+		const intptr_t lDiff = static_cast<intptr_t>(stSequence) - static_cast<intptr_t>(stPos);
+
+		if (lDiff == 0)
+		{
+			if (m_stEnqueuePos.compare_exchange_weak(stPos, stPos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (lDiff < 0)
+		{
+			// full, the writer is behind
+			m_ulDropped.fetch_add(1, std::memory_order_relaxed);
+			return (false);
+		}
+		else
+		{
+			stPos = m_stEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	pRecord->m_ubLevel = eLevel;
+	pRecord->m_uiThreadID = GetLogThreadID();
+	pRecord->m_dTime = std::chrono::duration<GLdouble>(std::chrono::steady_clock::now() - m_startTime).count();
+	pRecord->m_szFunction = szFunction;
+	std::memcpy(pRecord->m_szMessage, szMessage, stLength);
+	pRecord->m_szMessage[stLength] = '\0';
+
+	pRecord->m_stSequence.store(stPos + 1, std::memory_order_release);
+	return (true);
+}
+
+bool CLogger::IsRateLimited(const char* szFormat)
+{
+	// the format string identifies the call site well enough
+	const size_t stBucket = (reinterpret_cast<uintptr_t>(szFormat) >> 3) % LOGGER_RATE_BUCKETS;
+	const uint64_t ulSecond = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - m_startTime).count());
+
+	std::atomic<uint64_t>& bucket = m_arrRateBuckets[stBucket];
+	uint64_t ulValue = bucket.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		const uint64_t ulBucketSecond = ulValue >> 32;
+		const uint64_t ulCount = (ulBucketSecond == ulSecond) ? (ulValue & 0xFFFFFFFF) : 0;
+		if (ulCount >= LOGGER_RATE_LIMIT)
+		{
+			return (true);
+		}
+
+		if (bucket.compare_exchange_weak(ulValue, (ulSecond << 32) | (ulCount + 1), std::memory_order_relaxed))
+		{
+			return (false);
+		}
+	}
+}
+
+void CLogger::WriterLoop()
+{
+	uint64_t ulReportedLosses = 0;
+
+	while (m_bIsRunning)
+	{
+		if (Flush() == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOGGER_FLUSH_INTERVAL_MS));
+		}
+
+		// tell about lost messages once the flood is over
+		const uint64_t ulLosses = m_ulDropped.load(std::memory_order_relaxed) + m_ulRateLimited.load(std::memory_order_relaxed);
+		if (ulLosses != ulReportedLosses && m_stEnqueuePos.load(std::memory_order_relaxed) == m_stDequeuePos)
+		{
+			char szMessage[128];
+			snprintf(szMessage, sizeof(szMessage), "%llu messages dropped or rate limited so far", static_cast<unsigned long long>(ulLosses));
+			WriteDirect(LOG_LEVEL_WARNING, FUNCTION_NAME, szMessage);
+			ulReportedLosses = ulLosses;
+		}
+	}
+}
+
+size_t CLogger::Flush()
+{
+	// one write per stream and batch instead of two per message, the file
+	// gets every line in the order they were queued
+	static thread_local std::string tl_stOutBatch;
+	static thread_local std::string tl_stErrBatch;
+	static thread_local std::string tl_stFileBatch;
+	tl_stOutBatch.clear();
+	tl_stErrBatch.clear();
+	tl_stFileBatch.clear();
+
+	char szLine[LOGGER_MESSAGE_MAX + 128];
+
+	size_t stWritten = 0;
+	while (true)
+	{
+		TLogRecord& record = m_pRecords[m_stDequeuePos & (LOGGER_RING_SIZE - 1)];
+		if (record.m_stSequence.load(std::memory_order_acquire) != m_stDequeuePos + 1)
+		{
+			break;
+		}
+
+		const GLint iLength = snprintf(szLine, sizeof(szLine), "[%10.4f] [%s] [T%u] %s: %s\n", record.m_dTime, GetLevelName(record.m_ubLevel), record.m_uiThreadID, record.m_szFunction, record.m_szMessage);
+		if (iLength > 0)
+		{
+			const size_t stLineLength = std::min(static_cast<size_t>(iLength), sizeof(szLine) - 1);
+			std::string& stBatch = (record.m_ubLevel >= LOG_LEVEL_ERROR) ? tl_stErrBatch : tl_stOutBatch;
+			stBatch.append(szLine, stLineLength);
+
+			if (m_pFile)
+			{
+				tl_stFileBatch.append(szLine, stLineLength);
+			}
+		}
+
+		// hand the slot back to the producers, one lap later
+		record.m_stSequence.store(m_stDequeuePos + LOGGER_RING_SIZE, std::memory_order_release);
+		m_stDequeuePos++;
+		stWritten++;
+	}
+
+	if (stWritten == 0)
+	{
+		return (0);
+	}
+
+	if (tl_stOutBatch.empty() == false)
+	{
+		fwrite(tl_stOutBatch.data(), 1, tl_stOutBatch.size(), stdout);
+		fflush(stdout);
+	}
+
+	if (tl_stErrBatch.empty() == false)
+	{
+		fwrite(tl_stErrBatch.data(), 1, tl_stErrBatch.size(), stderr);
+		fflush(stderr);
+	}
+
+	if (m_pFile)
+	{
+		fwrite(tl_stFileBatch.data(), 1, tl_stFileBatch.size(), m_pFile);
+		fflush(m_pFile);
+	}
+
+	return (stWritten);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <utils.h>
+#include <singleton.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+enum ELoggerData
+{
+	// Records in flight, must be a power of two
+	LOGGER_RING_SIZE = 4096,
+
+	// Longest message kept, longer ones are truncated
+	LOGGER_MESSAGE_MAX = 480,
+
+	// Messages a single call site may log per second before it is muted
+	LOGGER_RATE_LIMIT = 64,
+	LOGGER_RATE_BUCKETS = 256,
+
+	// How long the writer sleeps when the ring is empty
+	LOGGER_FLUSH_INTERVAL_MS = 5,
+};
+
+typedef struct SLogRecord
+{
+	std::atomic<size_t> m_stSequence;	// ring slot state, see CLogger::Push
+	GLubyte m_ubLevel;
+	GLuint m_uiThreadID;
+	GLdouble m_dTime;					// seconds since the logger started
+	const char* m_szFunction;
+	char m_szMessage[LOGGER_MESSAGE_MAX];
+} TLogRecord;
+
+/**
+ * Asynchronous backend of the syslog / syserr macros.
+ * Callers format into a thread local buffer and push the record into a
+ * bounded multi producer ring without taking a lock, a background thread
+ * writes the records to stdout / stderr and the log file in batches.
+ * When the ring is full or a call site floods, messages are dropped and
+ * counted instead of blocking the caller.
+ *
+ * Messages logged while no logger exists are written synchronously.
+ */
+class CLogger : public CSingleton<CLogger>
+{
+public:
+	CLogger();
+	~CLogger();
+
+	CLogger(const CLogger&) = delete;
+	CLogger& operator=(const CLogger&) = delete;
+
+	/**
+	 * Starts the writer thread.
+	 *
+	 * @param stFilePath Optional log file, empty to only write to the console
+	 */
+	bool Initialize(const std::string& stFilePath = "");
+
+	/**
+	 * Writes every pending record and stops the writer thread.
+	 */
+	void Destroy();
+
+	void SetMinLevel(ELogLevel eLevel);
+	ELogLevel GetMinLevel() const;
+
+	/**
+	 * Formats and queues a message, never blocks.
+	 *
+	 * @return false if the message was filtered or dropped
+	 */
+	bool Write(ELogLevel eLevel, const char* szFunction, const char* szFormat, va_list args);
+
+	/**
+	 * Logger the macros currently write to, nullptr if none is running.
+	 * A non null logger stays alive until ReleaseActive(), Destroy() waits
+	 * for every caller that acquired it.
+	 */
+	static CLogger* AcquireActive();
+	static void ReleaseActive();
+
+	/**
+	 * Synchronous fallback, used before the logger started and after it stopped.
+	 */
+	static void WriteDirect(ELogLevel eLevel, const char* szFunction, const char* szMessage);
+
+protected:
+	bool Push(ELogLevel eLevel, const char* szFunction, const char* szMessage, size_t stLength);
+	bool IsRateLimited(const char* szFormat);
+
+	void WriterLoop();
+
+	/**
+	 * Writes every published record.
+	 *
+	 * @return Number of records written
+	 */
+	size_t Flush();
+
+private:
+	static std::atomic<CLogger*> ms_pActiveLogger;
+	static std::atomic<GLuint> ms_uiActiveWriters;	// between AcquireActive() and ReleaseActive()
+
+	TLogRecord* m_pRecords;
+	alignas(64) std::atomic<size_t> m_stEnqueuePos;
+	alignas(64) size_t m_stDequeuePos;
+
+	std::atomic<GLubyte> m_ubMinLevel;
+	std::atomic<uint64_t> m_ulDropped;
+	std::atomic<uint64_t> m_ulRateLimited;
+
+	// Per call site: current second in the high half, messages in the low half
+	std::atomic<uint64_t> m_arrRateBuckets[LOGGER_RATE_BUCKETS];
+
+	std::chrono::steady_clock::time_point m_startTime;
+	std::thread m_writerThread;
+	std::atomic<bool> m_bIsRunning;
+	FILE* m_pFile;
+};
@@ -0,0 +1,136 @@
+#include "MappedFile.h"
+#include <utils.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile()
+{
+	m_pData = nullptr;
+	m_stSize = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = nullptr;
+#else
+	m_iFile = -1;
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open(const std::string& stPath)
+{
+	Close();
+
+#if defined(_WIN32) || defined(_WIN64)
+	m_hFile = CreateFileA(stPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		syserr("Failed to open %s", stPath.c_str());
+		return (false);
+	}
+
+	LARGE_INTEGER size{};
+	if (GetFileSizeEx(m_hFile, &size) == FALSE || size.QuadPart == 0)
+	{
+		syserr("%s is empty", stPath.c_str());
+		Close();
+		return (false);
+	}
+
+	m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	m_pData = m_hMapping ? static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+	m_stSize = static_cast<size_t>(size.QuadPart);
+#else
+	m_iFile = open(stPath.c_str(), O_RDONLY);
+	if (m_iFile < 0)
+	{
+		syserr("Failed to open %s", stPath.c_str());
+		return (false);
+	}
+
+	struct stat fileStat{};
+	if (fstat(m_iFile, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		syserr("%s is empty", stPath.c_str());
+		Close();
+		return (false);
+	}
+
+	m_stSize = static_cast<size_t>(fileStat.st_size);
+	void* pData = mmap(nullptr, m_stSize, PROT_READ, MAP_PRIVATE, m_iFile, 0);
+	m_pData = (pData != MAP_FAILED) ? static_cast<const uint8_t*>(pData) : nullptr;
+#endif
+
+	if (m_pData == nullptr)
+	{
+		syserr("Failed to map %s", stPath.c_str());
+		Close();
+		return (false);
+	}
+
+	return (true);
+}
+
+void CMappedFile::Close()
+{
+#if defined(_WIN32) || defined(_WIN64)
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_pData)
+	{
+		munmap(const_cast<uint8_t*>(m_pData), m_stSize);
+	}
+
+	if (m_iFile >= 0)
+	{
+		close(m_iFile);
+		m_iFile = -1;
+	}
+#endif
+
+	m_pData = nullptr;
+	m_stSize = 0;
+}
+
+bool CMappedFile::IsOpen() const
+{
+	return (m_pData != nullptr);
+}
+
+const uint8_t* CMappedFile::GetData() const
+{
+	return (m_pData);
+}
+
+size_t CMappedFile::GetSize() const
+{
+	return (m_stSize);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Read only view of a whole file mapped into memory, the OS pages it in as
+ * it is read. The view is unmapped with the object.
+ */
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	CMappedFile(const CMappedFile&) = delete;
+	CMappedFile& operator=(const CMappedFile&) = delete;
+
+	bool Open(const std::string& stPath);
+	void Close();
+
+	bool IsOpen() const;
+	const uint8_t* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const uint8_t* m_pData;
+	size_t m_stSize;
+
+#if defined(_WIN32) || defined(_WIN64)
+	void* m_hFile;
+	void* m_hMapping;
+#else
+	int m_iFile;
+#endif
+};
@@ -0,0 +1,763 @@
+#include "MeshAsset.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <fstream>
+
+#if ANUBIS_WITH_MESH_COOKER
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#pragma comment(lib, "assimp-vc143-mt.lib")
+#endif
+
+#if ANUBIS_WITH_MESH_COOKER || ANUBIS_WITH_MESH_COMPRESSION
+#include <meshoptimizer/meshoptimizer.h>
+
+#pragma comment(lib, "meshoptimizer.lib")
+#endif
+
+#if ANUBIS_WITH_MESH_COMPRESSION
+#include <zlib/zlib.h>
+
+#pragma comment(lib, "zlib.lib")
+#endif
+
+#if ANUBIS_WITH_MESH_COOKER
+
+// a draw may touch 5% more vertices than the cache optimized order to draw front to back
+static const float MESH_OVERDRAW_THRESHOLD = 1.05f;
+
+// 0 optimizes the meshlets for vertex reuse only, 1 for backface culling only
+static const float MESH_MESHLET_CONE_WEIGHT = 0.25f;
+
+// relative to the mesh extent, the levels are only bounded by their triangle
+// count, the selector keeps their error on screen small
+static const float MESH_LOD_MAX_ERROR = 1.0f;
+
+static uint64_t AlignSection(uint64_t ulOffset)
+{
+	return ((ulOffset + MESH_ASSET_SECTION_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_ASSET_SECTION_ALIGNMENT - 1));
+}
+
+// pads up to ulOffset, the sections are written in file order
+static void WriteSection(std::ofstream& file, uint64_t ulOffset, const void* pData, size_t stSize)
+{
+	const char arrPadding[MESH_ASSET_SECTION_ALIGNMENT] = {};
+	const uint64_t ulPosition = static_cast<uint64_t>(file.tellp());
+	if (ulOffset > ulPosition)
+	{
+		file.write(arrPadding, static_cast<std::streamsize>(ulOffset - ulPosition));
+	}
+
+	file.write(static_cast<const char*>(pData), static_cast<std::streamsize>(stSize));
+}
+
+#if ANUBIS_WITH_MESH_COMPRESSION
+static bool PackChunk(const std::vector<uint8_t>& vecEncoded, GLuint uiFirstElement, GLuint uiElementCount, std::vector<TMeshAssetChunk>& vecChunks,
+	std::vector<std::vector<uint8_t>>& vecPacked)
+{
+	// the codecs leave byte patterns zlib still finds, the best level costs nothing at load
+	uLongf ulPackedSize = compressBound(static_cast<uLong>(vecEncoded.size()));
+	std::vector<uint8_t> vecData(ulPackedSize);
+	if (compress2(vecData.data(), &ulPackedSize, vecEncoded.data(), static_cast<uLong>(vecEncoded.size()), Z_BEST_COMPRESSION) != Z_OK)
+	{
+		return (false);
+	}
+	vecData.resize(ulPackedSize);
+
+	TMeshAssetChunk chunk{};
+	chunk.m_uiPackedSize = static_cast<uint32_t>(ulPackedSize);
+	chunk.m_uiEncodedSize = static_cast<uint32_t>(vecEncoded.size());
+	chunk.m_uiFirstElement = uiFirstElement;
+	chunk.m_uiElementCount = uiElementCount;
+	vecChunks.push_back(chunk);
+	vecPacked.push_back(std::move(vecData));
+	return (true);
+}
+#endif
+#endif
+
+#if ANUBIS_WITH_MESH_COMPRESSION
+static bool UnpackChunk(const uint8_t* pFile, const TMeshAssetChunk& chunk, std::vector<uint8_t>& vecEncoded)
+{
+	vecEncoded.resize(chunk.m_uiEncodedSize);
+
+	uLongf ulEncodedSize = chunk.m_uiEncodedSize;
+	return (uncompress(vecEncoded.data(), &ulEncodedSize, pFile + chunk.m_ulOffset, chunk.m_uiPackedSize) == Z_OK && ulEncodedSize == chunk.m_uiEncodedSize);
+}
+#endif
+
+bool CMeshAsset::Cook(const std::string& stSourcePath, const std::string& stCookedPath, bool bCompress)
+{
+	ANUBIS_ZONE("MeshAsset::Cook");
+
+#if ANUBIS_WITH_MESH_COOKER
+#if ANUBIS_WITH_MESH_COMPRESSION == 0
+	if (bCompress)
+	{
+		syswarn("The engine was built without ANUBIS_WITH_MESH_COMPRESSION, %s is cooked uncompressed", stCookedPath.c_str());
+		bCompress = false;
+	}
+#endif
+
+	std::vector<TerrainVertex> vecVertices;
+	std::vector<GLuint> vecIndices;
+	if (Import(stSourcePath, vecVertices, vecIndices) == false)
+	{
+		return (false);
+	}
+
+	std::vector<TMeshlet> vecMeshlets;
+	std::vector<TMeshLod> vecLods;
+	Optimize(vecVertices, vecIndices, vecMeshlets, vecLods);
+
+	TMeshAssetHeader header{};
+	header.m_uiMagic = MESH_ASSET_MAGIC;
+	header.m_uiVersion = MESH_ASSET_VERSION;
+	header.m_uiVertexCount = static_cast<uint32_t>(vecVertices.size());
+	header.m_uiIndexCount = static_cast<uint32_t>(vecIndices.size());
+	header.m_uiMeshletCount = static_cast<uint32_t>(vecMeshlets.size());
+	header.m_uiLodCount = static_cast<uint32_t>(vecLods.size());
+	std::copy(vecLods.begin(), vecLods.end(), header.m_arrLods);
+
+	for (GLint i = 0; i < 3; i++)
+	{
+		header.m_arrBoundsMin[i] = FLT_MAX;
+		header.m_arrBoundsMax[i] = -FLT_MAX;
+	}
+
+	for (const TerrainVertex& vertex : vecVertices)
+	{
+		const float arrPosition[3] = { vertex.m_v3Position.x, vertex.m_v3Position.y, vertex.m_v3Position.z };
+		for (GLint i = 0; i < 3; i++)
+		{
+			header.m_arrBoundsMin[i] = std::min(header.m_arrBoundsMin[i], arrPosition[i]);
+			header.m_arrBoundsMax[i] = std::max(header.m_arrBoundsMax[i], arrPosition[i]);
+		}
+	}
+
+	// the placement of the mesh starts at its bounds minimum, so do the meshlets
+	for (TMeshlet& meshlet : vecMeshlets)
+	{
+		for (GLint i = 0; i < 3; i++)
+		{
+			meshlet.m_arrCenter[i] -= header.m_arrBoundsMin[i];
+		}
+	}
+
+	// a flat mesh keeps a tiny extent so the positions do not divide by zero
+	float arrExtent[3];
+	for (GLint i = 0; i < 3; i++)
+	{
+		arrExtent[i] = std::max(header.m_arrBoundsMax[i] - header.m_arrBoundsMin[i], FLT_EPSILON);
+	}
+
+	std::vector<TQuantizedVertex> vecQuantized(vecVertices.size());
+	for (size_t i = 0; i < vecVertices.size(); i++)
+	{
+		const TerrainVertex& vertex = vecVertices[i];
+		TQuantizedVertex& quantized = vecQuantized[i];
+
+		quantized.m_arrPosition[0] = static_cast<GLushort>(meshopt_quantizeUnorm((vertex.m_v3Position.x - header.m_arrBoundsMin[0]) / arrExtent[0], 16));
+		quantized.m_arrPosition[1] = static_cast<GLushort>(meshopt_quantizeUnorm((vertex.m_v3Position.y - header.m_arrBoundsMin[1]) / arrExtent[1], 16));
+		quantized.m_arrPosition[2] = static_cast<GLushort>(meshopt_quantizeUnorm((vertex.m_v3Position.z - header.m_arrBoundsMin[2]) / arrExtent[2], 16));
+		quantized.m_arrPosition[3] = 0;
+
+		quantized.m_arrNormal[0] = static_cast<GLbyte>(meshopt_quantizeSnorm(vertex.m_v3Normals.x, 8));
+		quantized.m_arrNormal[1] = static_cast<GLbyte>(meshopt_quantizeSnorm(vertex.m_v3Normals.y, 8));
+		quantized.m_arrNormal[2] = static_cast<GLbyte>(meshopt_quantizeSnorm(vertex.m_v3Normals.z, 8));
+		quantized.m_arrNormal[3] = 0;
+
+		quantized.m_arrTexCoord[0] = meshopt_quantizeHalf(vertex.m_v2TexCoords.x);
+		quantized.m_arrTexCoord[1] = meshopt_quantizeHalf(vertex.m_v2TexCoords.y);
+	}
+
+	std::vector<TMeshAssetChunk> vecChunks;
+	std::vector<std::vector<uint8_t>> vecPacked;
+	if (bCompress && Compress(vecQuantized, vecIndices, header, vecChunks, vecPacked) == false)
+	{
+		syserr("Failed to compress %s", stSourcePath.c_str());
+		return (false);
+	}
+
+	uint64_t ulOffset = AlignSection(sizeof(TMeshAssetHeader));
+	if (bCompress)
+	{
+		header.m_ulChunkOffset = ulOffset;
+		ulOffset += vecChunks.size() * sizeof(TMeshAssetChunk);
+
+		// the zlib streams are read byte by byte, no alignment between them
+		for (TMeshAssetChunk& chunk : vecChunks)
+		{
+			chunk.m_ulOffset = ulOffset;
+			ulOffset += chunk.m_uiPackedSize;
+		}
+	}
+	else
+	{
+		header.m_ulVertexOffset = ulOffset;
+		header.m_ulIndexOffset = AlignSection(header.m_ulVertexOffset + vecQuantized.size() * sizeof(TQuantizedVertex));
+		ulOffset = header.m_ulIndexOffset + vecIndices.size() * sizeof(GLuint);
+	}
+	header.m_ulMeshletOffset = AlignSection(ulOffset);
+
+	std::ofstream file(stCookedPath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		syserr("Failed to open %s for writing", stCookedPath.c_str());
+		return (false);
+	}
+
+	WriteSection(file, 0, &header, sizeof(header));
+	if (bCompress)
+	{
+		WriteSection(file, header.m_ulChunkOffset, vecChunks.data(), vecChunks.size() * sizeof(TMeshAssetChunk));
+		for (size_t i = 0; i < vecChunks.size(); i++)
+		{
+			WriteSection(file, vecChunks[i].m_ulOffset, vecPacked[i].data(), vecPacked[i].size());
+		}
+	}
+	else
+	{
+		WriteSection(file, header.m_ulVertexOffset, vecQuantized.data(), vecQuantized.size() * sizeof(TQuantizedVertex));
+		WriteSection(file, header.m_ulIndexOffset, vecIndices.data(), vecIndices.size() * sizeof(GLuint));
+	}
+	WriteSection(file, header.m_ulMeshletOffset, vecMeshlets.data(), vecMeshlets.size() * sizeof(TMeshlet));
+
+	if (file.good() == false)
+	{
+		syserr("Failed to write %s", stCookedPath.c_str());
+		return (false);
+	}
+
+	syslog("Cooked %s to %s, %u vertices, %u triangles, %u meshlets", stSourcePath.c_str(), stCookedPath.c_str(), header.m_uiVertexCount, vecLods[0].m_uiIndexCount / 3,
+		header.m_uiMeshletCount);
+
+	if (bCompress)
+	{
+		const uint64_t ulRawSize = vecQuantized.size() * sizeof(TQuantizedVertex) + vecIndices.size() * sizeof(GLuint);
+		const uint64_t ulPackedSize = header.m_ulMeshletOffset - header.m_ulChunkOffset;
+		syslog("Vertex and index streams compressed from %llu to %llu bytes", static_cast<unsigned long long>(ulRawSize), static_cast<unsigned long long>(ulPackedSize));
+	}
+
+	for (size_t i = 1; i < vecLods.size(); i++)
+	{
+		syslog("LOD %zu: %u triangles, error %f", i, vecLods[i].m_uiIndexCount / 3, vecLods[i].m_fError);
+	}
+	return (true);
+#else
+	(void)stCookedPath;
+	(void)bCompress;
+	syserr("Cannot cook %s, the engine was built without ANUBIS_WITH_MESH_COOKER", stSourcePath.c_str());
+	return (false);
+#endif
+}
+
+bool CMeshAsset::Load(const std::string& stPath, TMeshAsset& mesh)
+{
+	ANUBIS_ZONE("MeshAsset::Load");
+
+	CMappedFile file;
+	if (file.Open(stPath) == false)
+	{
+		return (false);
+	}
+
+	if (file.GetSize() < sizeof(TMeshAssetHeader))
+	{
+		syserr("%s is not a mesh asset", stPath.c_str());
+		return (false);
+	}
+
+	const TMeshAssetHeader* pHeader = reinterpret_cast<const TMeshAssetHeader*>(file.GetData());
+	if (pHeader->m_uiMagic != MESH_ASSET_MAGIC)
+	{
+		syserr("%s is not a mesh asset", stPath.c_str());
+		return (false);
+	}
+
+	if (pHeader->m_uiVersion != MESH_ASSET_VERSION)
+	{
+		syserr("%s was cooked with version %u, version %u is expected, cook it again", stPath.c_str(), pHeader->m_uiVersion, MESH_ASSET_VERSION);
+		return (false);
+	}
+
+	// a truncated file would otherwise read past the mapping
+	const bool bIsCompressed = (pHeader->m_uiFlags & MESH_ASSET_FLAG_COMPRESSED) != 0;
+	const uint64_t ulVertexEnd = pHeader->m_ulVertexOffset + static_cast<uint64_t>(pHeader->m_uiVertexCount) * sizeof(TQuantizedVertex);
+	const uint64_t ulIndexEnd = pHeader->m_ulIndexOffset + static_cast<uint64_t>(pHeader->m_uiIndexCount) * sizeof(GLuint);
+	const uint64_t ulMeshletEnd = pHeader->m_ulMeshletOffset + static_cast<uint64_t>(pHeader->m_uiMeshletCount) * sizeof(TMeshlet);
+	const uint64_t ulChunkEnd = pHeader->m_ulChunkOffset + static_cast<uint64_t>(pHeader->m_uiVertexChunkCount + pHeader->m_uiIndexChunkCount) * sizeof(TMeshAssetChunk);
+	bool bIsValid = pHeader->m_uiIndexCount > 0 && ulMeshletEnd <= file.GetSize() && pHeader->m_ulMeshletOffset % MESH_ASSET_SECTION_ALIGNMENT == 0;
+
+	if (bIsCompressed)
+	{
+		bIsValid = bIsValid && ulChunkEnd <= file.GetSize() && pHeader->m_ulChunkOffset % MESH_ASSET_SECTION_ALIGNMENT == 0;
+	}
+	else
+	{
+		bIsValid = bIsValid && ulVertexEnd <= file.GetSize() && ulIndexEnd <= file.GetSize() &&
+			pHeader->m_ulVertexOffset % MESH_ASSET_SECTION_ALIGNMENT == 0 && pHeader->m_ulIndexOffset % MESH_ASSET_SECTION_ALIGNMENT == 0;
+	}
+
+	if (bIsValid == false)
+	{
+		syserr("%s is truncated or corrupted", stPath.c_str());
+		return (false);
+	}
+
+#if ANUBIS_WITH_MESH_COMPRESSION == 0
+	if (bIsCompressed)
+	{
+		syserr("%s has compressed streams, the engine was built without ANUBIS_WITH_MESH_COMPRESSION", stPath.c_str());
+		return (false);
+	}
+#endif
+
+	if (pHeader->m_uiLodCount == 0 || pHeader->m_uiLodCount > MESH_ASSET_MAX_LODS)
+	{
+		syserr("%s is truncated or corrupted", stPath.c_str());
+		return (false);
+	}
+
+	for (GLuint i = 0; i < pHeader->m_uiLodCount; i++)
+	{
+		const TMeshLod& lod = pHeader->m_arrLods[i];
+		if (lod.m_uiIndexCount == 0 || static_cast<uint64_t>(lod.m_uiFirstIndex) + lod.m_uiIndexCount > pHeader->m_uiIndexCount)
+		{
+			syserr("%s is truncated or corrupted", stPath.c_str());
+			return (false);
+		}
+	}
+
+	// the cluster commands draw these ranges as they are, nothing clamps them on the GPU
+	const TMeshlet* pMeshlets = reinterpret_cast<const TMeshlet*>(file.GetData() + pHeader->m_ulMeshletOffset);
+	for (GLuint i = 0; i < pHeader->m_uiMeshletCount; i++)
+	{
+		if (static_cast<uint64_t>(pMeshlets[i].m_uiFirstIndex) + pMeshlets[i].m_uiIndexCount > pHeader->m_uiIndexCount)
+		{
+			syserr("%s is truncated or corrupted", stPath.c_str());
+			return (false);
+		}
+	}
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	if (bIsCompressed)
+	{
+		// the buffers are filled through a mapping, nothing is staged in system memory
+		mesh.m_hMesh = resourceManager.CreateQuantizedMesh(nullptr, static_cast<GLsizei>(pHeader->m_uiVertexCount), nullptr, static_cast<GLsizei>(pHeader->m_uiIndexCount));
+	}
+	else
+	{
+		const TQuantizedVertex* pVertices = reinterpret_cast<const TQuantizedVertex*>(file.GetData() + pHeader->m_ulVertexOffset);
+		const GLuint* pIndices = reinterpret_cast<const GLuint*>(file.GetData() + pHeader->m_ulIndexOffset);
+		mesh.m_hMesh = resourceManager.CreateQuantizedMesh(pVertices, static_cast<GLsizei>(pHeader->m_uiVertexCount), pIndices, static_cast<GLsizei>(pHeader->m_uiIndexCount));
+	}
+
+	if (mesh.m_hMesh.IsValid() == false)
+	{
+		syserr("Failed to create the mesh of %s", stPath.c_str());
+		return (false);
+	}
+
+	if (bIsCompressed)
+	{
+		const TMeshResource* pMesh = resourceManager.GetMesh(mesh.m_hMesh);
+		const GLuint uiVertexBuffer = resourceManager.GetBuffer(pMesh->m_hVertexBuffer)->m_uiBuffer;
+		const GLuint uiIndexBuffer = resourceManager.GetBuffer(pMesh->m_hIndexBuffer)->m_uiBuffer;
+
+		const GLbitfield uiMapFlags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+		TQuantizedVertex* pVertices = static_cast<TQuantizedVertex*>(glMapNamedBufferRange(uiVertexBuffer, 0, static_cast<GLsizeiptr>(pHeader->m_uiVertexCount) * sizeof(TQuantizedVertex), uiMapFlags));
+		GLuint* pIndices = static_cast<GLuint*>(glMapNamedBufferRange(uiIndexBuffer, 0, static_cast<GLsizeiptr>(pHeader->m_uiIndexCount) * sizeof(GLuint), uiMapFlags));
+
+		const bool bIsDecoded = pVertices && pIndices && Decompress(file, *pHeader, pVertices, pIndices);
+
+		// a failed unmap loses the content, the mesh is useless then too
+		bool bIsUnmapped = true;
+		if (pVertices)
+		{
+			bIsUnmapped = (glUnmapNamedBuffer(uiVertexBuffer) == GL_TRUE);
+		}
+		if (pIndices)
+		{
+			bIsUnmapped = (glUnmapNamedBuffer(uiIndexBuffer) == GL_TRUE) && bIsUnmapped;
+		}
+		if (bIsDecoded == false || bIsUnmapped == false)
+		{
+			syserr("Failed to decompress %s", stPath.c_str());
+			resourceManager.DestroyMesh(mesh.m_hMesh);
+			mesh.m_hMesh = MeshHandle();
+			return (false);
+		}
+	}
+
+	// without its clusters the mesh is still drawn whole
+	if (pHeader->m_uiMeshletCount > 0)
+	{
+		mesh.m_hMeshletBuffer = resourceManager.CreateBuffer(static_cast<GLsizeiptr>(pHeader->m_uiMeshletCount) * sizeof(TMeshlet), pMeshlets, 0);
+		mesh.m_uiMeshletCount = resourceManager.GetBuffer(mesh.m_hMeshletBuffer) ? pHeader->m_uiMeshletCount : 0;
+	}
+
+	std::copy(pHeader->m_arrLods, pHeader->m_arrLods + pHeader->m_uiLodCount, mesh.m_arrLods);
+	mesh.m_uiLodCount = pHeader->m_uiLodCount;
+
+	mesh.m_uiVertexCount = pHeader->m_uiVertexCount;
+	mesh.m_uiIndexCount = pHeader->m_uiIndexCount;
+	mesh.m_v3BoundsMin = Vector3D(pHeader->m_arrBoundsMin[0], pHeader->m_arrBoundsMin[1], pHeader->m_arrBoundsMin[2]);
+	mesh.m_v3BoundsMax = Vector3D(pHeader->m_arrBoundsMax[0], pHeader->m_arrBoundsMax[1], pHeader->m_arrBoundsMax[2]);
+	return (true);
+}
+
+Matrix4 CMeshAsset::GetModelMatrix(const TMeshAsset& mesh, const Vector3D& v3Position)
+{
+	Matrix4 mat4Model;
+	mat4Model.InitIdentity();
+	mat4Model[0] = Vector4D(mesh.m_v3BoundsMax.x - mesh.m_v3BoundsMin.x, 0.0f, 0.0f, 0.0f);
+	mat4Model[1] = Vector4D(0.0f, mesh.m_v3BoundsMax.y - mesh.m_v3BoundsMin.y, 0.0f, 0.0f);
+	mat4Model[2] = Vector4D(0.0f, 0.0f, mesh.m_v3BoundsMax.z - mesh.m_v3BoundsMin.z, 0.0f);
+	mat4Model[3] = Vector4D(v3Position.x + mesh.m_v3BoundsMin.x, v3Position.y + mesh.m_v3BoundsMin.y, v3Position.z + mesh.m_v3BoundsMin.z, 1.0f);
+	return (mat4Model);
+}
+
+Matrix4 CMeshAsset::GetMeshletMatrix(const TMeshAsset& mesh, const Vector3D& v3Position)
+{
+	Matrix4 mat4Placement;
+	mat4Placement.InitIdentity();
+	mat4Placement[3] = Vector4D(v3Position.x + mesh.m_v3BoundsMin.x, v3Position.y + mesh.m_v3BoundsMin.y, v3Position.z + mesh.m_v3BoundsMin.z, 1.0f);
+	return (mat4Placement);
+}
+
+#if ANUBIS_WITH_MESH_COOKER
+bool CMeshAsset::Import(const std::string& stSourcePath, std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices)
+{
+	ANUBIS_ZONE("MeshAsset::Import");
+
+	// node transforms are baked in, the asset is drawn as one mesh
+	Assimp::Importer importer;
+	const aiScene* pScene = importer.ReadFile(stSourcePath, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals |
+		aiProcess_PreTransformVertices | aiProcess_SortByPType);
+	if (pScene == nullptr || pScene->mNumMeshes == 0)
+	{
+		syserr("Failed to import %s: %s", stSourcePath.c_str(), importer.GetErrorString());
+		return (false);
+	}
+
+	for (GLuint uiMesh = 0; uiMesh < pScene->mNumMeshes; uiMesh++)
+	{
+		// points and lines were sorted into meshes of their own
+		const aiMesh* pMesh = pScene->mMeshes[uiMesh];
+		if ((pMesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0)
+		{
+			continue;
+		}
+
+		const GLuint uiBaseVertex = static_cast<GLuint>(vecVertices.size());
+		for (GLuint i = 0; i < pMesh->mNumVertices; i++)
+		{
+			TerrainVertex vertex(pMesh->mVertices[i].x, pMesh->mVertices[i].y, pMesh->mVertices[i].z);
+			if (pMesh->HasNormals())
+			{
+				vertex.m_v3Normals = Vector3D(pMesh->mNormals[i].x, pMesh->mNormals[i].y, pMesh->mNormals[i].z);
+			}
+
+			if (pMesh->HasTextureCoords(0))
+			{
+				vertex.m_v2TexCoords = Vector2D(pMesh->mTextureCoords[0][i].x, pMesh->mTextureCoords[0][i].y);
+			}
+
+			vecVertices.push_back(vertex);
+		}
+
+		for (GLuint i = 0; i < pMesh->mNumFaces; i++)
+		{
+			const aiFace& face = pMesh->mFaces[i];
+			if (face.mNumIndices != 3)
+			{
+				continue;
+			}
+
+			vecIndices.push_back(uiBaseVertex + face.mIndices[0]);
+			vecIndices.push_back(uiBaseVertex + face.mIndices[1]);
+			vecIndices.push_back(uiBaseVertex + face.mIndices[2]);
+		}
+	}
+
+	if (vecIndices.empty())
+	{
+		syserr("%s has no triangles", stSourcePath.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+void CMeshAsset::Optimize(std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshlet>& vecMeshlets, std::vector<TMeshLod>& vecLods)
+{
+	ANUBIS_ZONE("MeshAsset::Optimize");
+
+	// vertices shared between the source meshes are merged first
+	std::vector<GLuint> vecRemap(vecVertices.size());
+	const size_t stUniqueVertices = meshopt_generateVertexRemap(vecRemap.data(), vecIndices.data(), vecIndices.size(), vecVertices.data(), vecVertices.size(), sizeof(TerrainVertex));
+
+	std::vector<TerrainVertex> vecUnique(stUniqueVertices);
+	meshopt_remapIndexBuffer(vecIndices.data(), vecIndices.data(), vecIndices.size(), vecRemap.data());
+	meshopt_remapVertexBuffer(vecUnique.data(), vecVertices.data(), vecVertices.size(), sizeof(TerrainVertex), vecRemap.data());
+
+	// the order matters, the overdraw pass keeps the cache order within its clusters
+	meshopt_optimizeVertexCache(vecIndices.data(), vecIndices.data(), vecIndices.size(), vecUnique.size());
+	meshopt_optimizeOverdraw(vecIndices.data(), vecIndices.data(), vecIndices.size(), &vecUnique[0].m_v3Position.x, vecUnique.size(), sizeof(TerrainVertex), MESH_OVERDRAW_THRESHOLD);
+
+	// clusters are built from the cache order, the fetch pass only renames vertices
+	// and sees every level so their vertices stay close together
+	BuildMeshlets(vecUnique, vecIndices, vecMeshlets);
+	BuildLods(vecUnique, vecIndices, vecLods);
+
+	vecVertices.resize(vecUnique.size());
+	const size_t stFetchedVertices = meshopt_optimizeVertexFetch(vecVertices.data(), vecIndices.data(), vecIndices.size(), vecUnique.data(), vecUnique.size(), sizeof(TerrainVertex));
+	vecVertices.resize(stFetchedVertices);
+}
+
+void CMeshAsset::BuildMeshlets(const std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshlet>& vecMeshlets)
+{
+	ANUBIS_ZONE("MeshAsset::BuildMeshlets");
+
+	const size_t stMaxMeshlets = meshopt_buildMeshletsBound(vecIndices.size(), MESH_ASSET_MESHLET_VERTICES, MESH_ASSET_MESHLET_TRIANGLES);
+	std::vector<meshopt_Meshlet> vecClusters(stMaxMeshlets);
+	std::vector<GLuint> vecClusterVertices(stMaxMeshlets * MESH_ASSET_MESHLET_VERTICES);
+	std::vector<GLubyte> vecClusterTriangles(stMaxMeshlets * MESH_ASSET_MESHLET_TRIANGLES * 3);
+
+	// the cone weight trades some vertex reuse for tighter normal cones
+	const size_t stMeshlets = meshopt_buildMeshlets(vecClusters.data(), vecClusterVertices.data(), vecClusterTriangles.data(), vecIndices.data(), vecIndices.size(),
+		&vecVertices[0].m_v3Position.x, vecVertices.size(), sizeof(TerrainVertex), MESH_ASSET_MESHLET_VERTICES, MESH_ASSET_MESHLET_TRIANGLES, MESH_MESHLET_CONE_WEIGHT);
+
+	// local triangle indices go back to mesh indices, a meshlet is a plain index range
+	std::vector<GLuint> vecMeshletIndices;
+	vecMeshletIndices.reserve(vecIndices.size());
+	vecMeshlets.resize(stMeshlets);
+
+	for (size_t i = 0; i < stMeshlets; i++)
+	{
+		const meshopt_Meshlet& cluster = vecClusters[i];
+		const GLuint* pClusterVertices = &vecClusterVertices[cluster.vertex_offset];
+		const GLubyte* pClusterTriangles = &vecClusterTriangles[cluster.triangle_offset];
+
+		const meshopt_Bounds bounds = meshopt_computeMeshletBounds(pClusterVertices, pClusterTriangles, cluster.triangle_count,
+			&vecVertices[0].m_v3Position.x, vecVertices.size(), sizeof(TerrainVertex));
+
+		TMeshlet& meshlet = vecMeshlets[i];
+		meshlet = TMeshlet{};
+		for (GLint j = 0; j < 3; j++)
+		{
+			meshlet.m_arrCenter[j] = bounds.center[j];
+			meshlet.m_arrConeAxis[j] = bounds.cone_axis[j];
+		}
+		meshlet.m_fRadius = bounds.radius;
+		meshlet.m_fConeCutoff = bounds.cone_cutoff;
+		meshlet.m_uiFirstIndex = static_cast<uint32_t>(vecMeshletIndices.size());
+		meshlet.m_uiIndexCount = cluster.triangle_count * 3;
+
+		for (GLuint j = 0; j < cluster.triangle_count * 3; j++)
+		{
+			vecMeshletIndices.push_back(pClusterVertices[pClusterTriangles[j]]);
+		}
+	}
+
+	vecIndices.swap(vecMeshletIndices);
+}
+
+void CMeshAsset::BuildLods(const std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshLod>& vecLods)
+{
+	ANUBIS_ZONE("MeshAsset::BuildLods");
+
+	const GLuint uiFullIndexCount = static_cast<GLuint>(vecIndices.size());
+	vecLods.push_back(TMeshLod{ 0, uiFullIndexCount, 0.0f, 0 });
+
+	// the simplifier works with errors relative to the mesh extent
+	const float* pPositions = &vecVertices[0].m_v3Position.x;
+	const float fErrorScale = meshopt_simplifyScale(pPositions, vecVertices.size(), sizeof(TerrainVertex));
+
+	// every level starts from the full mesh, its error is measured against it
+	const std::vector<GLuint> vecFull(vecIndices.begin(), vecIndices.end());
+	std::vector<GLuint> vecLod(vecFull.size());
+
+	size_t stTargetCount = vecFull.size();
+	while (vecLods.size() < MESH_ASSET_MAX_LODS)
+	{
+		stTargetCount = (stTargetCount / 6) * 3;
+		if (stTargetCount < MESH_ASSET_LOD_MIN_TRIANGLES * 3)
+		{
+			break;
+		}
+
+		float fError = 0.0f;
+		size_t stCount = meshopt_simplify(vecLod.data(), vecFull.data(), vecFull.size(), pPositions, vecVertices.size(), sizeof(TerrainVertex),
+			stTargetCount, MESH_LOD_MAX_ERROR, 0, &fError);
+
+		// open borders and seams lock the topology, the sloppy pass ignores it
+		if (stCount > stTargetCount + stTargetCount / 2)
+		{
+			stCount = meshopt_simplifySloppy(vecLod.data(), vecFull.data(), vecFull.size(), pPositions, vecVertices.size(), sizeof(TerrainVertex),
+				stTargetCount, MESH_LOD_MAX_ERROR, &fError);
+		}
+
+		// no progress over the previous level, a coarser target will not do better
+		const TMeshLod& previous = vecLods.back();
+		if (stCount == 0 || stCount >= previous.m_uiIndexCount)
+		{
+			break;
+		}
+
+		meshopt_optimizeVertexCache(vecLod.data(), vecLod.data(), stCount, vecVertices.size());
+
+		// the selector expects the errors to grow with the level
+		TMeshLod lod{};
+		lod.m_uiFirstIndex = static_cast<uint32_t>(vecIndices.size());
+		lod.m_uiIndexCount = static_cast<uint32_t>(stCount);
+		lod.m_fError = std::max(fError * fErrorScale, previous.m_fError);
+		vecLods.push_back(lod);
+
+		vecIndices.insert(vecIndices.end(), vecLod.begin(), vecLod.begin() + stCount);
+	}
+}
+
+bool CMeshAsset::Compress(const std::vector<TQuantizedVertex>& vecVertices, const std::vector<GLuint>& vecIndices, TMeshAssetHeader& header,
+	std::vector<TMeshAssetChunk>& vecChunks, std::vector<std::vector<uint8_t>>& vecPacked)
+{
+	ANUBIS_ZONE("MeshAsset::Compress");
+
+#if ANUBIS_WITH_MESH_COMPRESSION
+	std::vector<uint8_t> vecEncoded;
+	for (size_t stFirst = 0; stFirst < vecVertices.size(); stFirst += MESH_ASSET_CHUNK_VERTICES)
+	{
+		const size_t stCount = std::min<size_t>(MESH_ASSET_CHUNK_VERTICES, vecVertices.size() - stFirst);
+		vecEncoded.resize(meshopt_encodeVertexBufferBound(stCount, sizeof(TQuantizedVertex)));
+		vecEncoded.resize(meshopt_encodeVertexBuffer(vecEncoded.data(), vecEncoded.size(), &vecVertices[stFirst], stCount, sizeof(TQuantizedVertex)));
+
+		if (vecEncoded.empty() || PackChunk(vecEncoded, static_cast<GLuint>(stFirst), static_cast<GLuint>(stCount), vecChunks, vecPacked) == false)
+		{
+			return (false);
+		}
+	}
+	header.m_uiVertexChunkCount = static_cast<uint32_t>(vecChunks.size());
+
+	// whole triangles per chunk, the codec works on triangle lists
+	const size_t stChunkIndices = MESH_ASSET_CHUNK_TRIANGLES * 3;
+	for (size_t stFirst = 0; stFirst < vecIndices.size(); stFirst += stChunkIndices)
+	{
+		const size_t stCount = std::min(stChunkIndices, vecIndices.size() - stFirst);
+		vecEncoded.resize(meshopt_encodeIndexBufferBound(stCount, vecVertices.size()));
+		vecEncoded.resize(meshopt_encodeIndexBuffer(vecEncoded.data(), vecEncoded.size(), &vecIndices[stFirst], stCount));
+
+		if (vecEncoded.empty() || PackChunk(vecEncoded, static_cast<GLuint>(stFirst), static_cast<GLuint>(stCount), vecChunks, vecPacked) == false)
+		{
+			return (false);
+		}
+	}
+	header.m_uiIndexChunkCount = static_cast<uint32_t>(vecChunks.size()) - header.m_uiVertexChunkCount;
+
+	header.m_uiFlags |= MESH_ASSET_FLAG_COMPRESSED;
+	return (true);
+#else
+	(void)vecVertices;
+	(void)vecIndices;
+	(void)header;
+	(void)vecChunks;
+	(void)vecPacked;
+	return (false);
+#endif
+}
+#endif
+
+bool CMeshAsset::Decompress(const CMappedFile& file, const TMeshAssetHeader& header, TQuantizedVertex* pVertices, GLuint* pIndices)
+{
+	ANUBIS_ZONE("MeshAsset::Decompress");
+
+#if ANUBIS_WITH_MESH_COMPRESSION
+	const TMeshAssetChunk* pChunks = reinterpret_cast<const TMeshAssetChunk*>(file.GetData() + header.m_ulChunkOffset);
+	const GLuint uiChunkCount = header.m_uiVertexChunkCount + header.m_uiIndexChunkCount;
+
+	// every chunk has to stay inside the file and its stream, together they fill both
+	uint64_t ulVertices = 0;
+	uint64_t ulIndices = 0;
+	for (GLuint i = 0; i < uiChunkCount; i++)
+	{
+		const TMeshAssetChunk& chunk = pChunks[i];
+		const bool bIsIndex = (i >= header.m_uiVertexChunkCount);
+		const uint64_t ulElementEnd = static_cast<uint64_t>(chunk.m_uiFirstElement) + chunk.m_uiElementCount;
+
+		if (chunk.m_ulOffset + chunk.m_uiPackedSize > file.GetSize() || ulElementEnd > (bIsIndex ? header.m_uiIndexCount : header.m_uiVertexCount) ||
+			(bIsIndex && (chunk.m_uiFirstElement % 3 != 0 || chunk.m_uiElementCount % 3 != 0)))
+		{
+			return (false);
+		}
+
+		(bIsIndex ? ulIndices : ulVertices) += chunk.m_uiElementCount;
+	}
+
+	if (ulVertices != header.m_uiVertexCount || ulIndices != header.m_uiIndexCount)
+	{
+		return (false);
+	}
+
+	// a chunk is the smallest piece of work, the codecs are too fast for smaller ones
+	typedef struct SDecodeContext
+	{
+		const uint8_t* m_pFile;
+		const TMeshAssetChunk* m_pChunks;
+		GLuint m_uiVertexChunkCount;
+		TQuantizedVertex* m_pVertices;
+		GLuint* m_pIndices;
+		std::atomic<bool> m_bHasFailed;
+	} TDecodeContext;
+
+	TDecodeContext context{ file.GetData(), pChunks, header.m_uiVertexChunkCount, pVertices, pIndices, { false } };
+	TDecodeContext* pContext = &context;
+
+	CJobSystem::Instance().ParallelFor(uiChunkCount, [pContext](GLuint uiStart, GLuint uiEnd)
+	{
+		ANUBIS_ZONE("MeshAsset::DecodeChunks");
+
+		std::vector<uint8_t> vecEncoded;
+		for (GLuint i = uiStart; i < uiEnd; i++)
+		{
+			const TMeshAssetChunk& chunk = pContext->m_pChunks[i];
+			if (UnpackChunk(pContext->m_pFile, chunk, vecEncoded) == false)
+			{
+				pContext->m_bHasFailed.store(true, std::memory_order_relaxed);
+				continue;
+			}
+
+			int iResult = 0;
+			if (i < pContext->m_uiVertexChunkCount)
+			{
+				iResult = meshopt_decodeVertexBuffer(pContext->m_pVertices + chunk.m_uiFirstElement, chunk.m_uiElementCount, sizeof(TQuantizedVertex),
+					vecEncoded.data(), vecEncoded.size());
+			}
+			else
+			{
+				iResult = meshopt_decodeIndexBuffer(pContext->m_pIndices + chunk.m_uiFirstElement, chunk.m_uiElementCount, sizeof(GLuint),
+					vecEncoded.data(), vecEncoded.size());
+			}
+
+			if (iResult != 0)
+			{
+				pContext->m_bHasFailed.store(true, std::memory_order_relaxed);
+			}
+		}
+	}, 1);
+
+	return (context.m_bHasFailed.load(std::memory_order_relaxed) == false);
+#else
+	(void)file;
+	(void)header;
+	(void)pVertices;
+	(void)pIndices;
+	return (false);
+#endif
+}
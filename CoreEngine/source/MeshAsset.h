@@ -0,0 +1,213 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GLResourceManager.h"
+
+// Cooking needs Assimp and meshoptimizer, define as 1 with assimp-vc143-mt.lib
+// and meshoptimizer.lib in Extern/lib. Loading cooked files works without it.
+#ifndef ANUBIS_WITH_MESH_COOKER
+#define ANUBIS_WITH_MESH_COOKER 0
+#endif
+
+// Compressed streams need meshoptimizer and zlib, define as 1 with
+// meshoptimizer.lib and zlib.lib in Extern/lib. Without it compressed files
+// are rejected and the cooker writes uncompressed ones.
+#ifndef ANUBIS_WITH_MESH_COMPRESSION
+#define ANUBIS_WITH_MESH_COMPRESSION 0
+#endif
+
+enum EMeshAssetData
+{
+	MESH_ASSET_MAGIC = 0x48534D41,		// "AMSH"
+
+	// Bumped whenever the layout changes, older files have to be cooked again
+	MESH_ASSET_VERSION = 4,
+
+	// Sections start aligned so they can be uploaded straight from the mapping
+	MESH_ASSET_SECTION_ALIGNMENT = 16,
+
+	// Meshlet limits, small enough for the cone test to reject whole clusters.
+	// The triangle count is a multiple of 4 as meshoptimizer recommends.
+	MESH_ASSET_MESHLET_VERTICES = 64,
+	MESH_ASSET_MESHLET_TRIANGLES = 124,
+
+	// Every level halves the triangles of the full mesh, the chain stops
+	// earlier when a level would fall under the minimum
+	MESH_ASSET_MAX_LODS = 6,
+	MESH_ASSET_LOD_MIN_TRIANGLES = 32,
+
+	// Vertex and index streams are meshoptimizer encoded then deflated, in
+	// chunks decoded in parallel
+	MESH_ASSET_FLAG_COMPRESSED = 1 << 0,
+	MESH_ASSET_CHUNK_VERTICES = 16384,
+	MESH_ASSET_CHUNK_TRIANGLES = 16384,
+};
+
+/**
+ * Compressed run of vertices or indices. The zlib stream inflates to the
+ * meshoptimizer stream, which decodes to m_uiElementCount elements.
+ */
+typedef struct SMeshAssetChunk
+{
+	uint64_t m_ulOffset;			// bytes from the start of the file
+	uint32_t m_uiPackedSize;		// zlib stream
+	uint32_t m_uiEncodedSize;		// meshoptimizer stream
+	uint32_t m_uiFirstElement;		// first vertex or index
+	uint32_t m_uiElementCount;
+} TMeshAssetChunk;
+
+static_assert(sizeof(TMeshAssetChunk) == 24, "Mesh asset chunk layout changed, bump MESH_ASSET_VERSION");
+
+/**
+ * Index range of one level of detail. The error is the largest distance
+ * between the level and the full mesh, in the units of the source model.
+ */
+typedef struct SMeshLod
+{
+	uint32_t m_uiFirstIndex;
+	uint32_t m_uiIndexCount;
+	float m_fError;
+	uint32_t m_uiPadding;
+} TMeshLod;
+
+/**
+ * Start of an .amesh file. The vertex section holds TQuantizedVertex, the
+ * index section 32 bit indices of every level of detail one after the other,
+ * the full mesh first and grouped by meshlet. The meshlet section holds
+ * TMeshlet in the same order, only for the full mesh.
+ *
+ * Compressed files have no vertex and index section, the chunk table lists
+ * the vertex chunks then the index chunks, their data follows the table.
+ */
+typedef struct SMeshAssetHeader
+{
+	uint32_t m_uiMagic;
+	uint32_t m_uiVersion;
+	uint32_t m_uiVertexCount;
+	uint32_t m_uiIndexCount;
+	uint32_t m_uiMeshletCount;
+	uint32_t m_uiLodCount;
+	uint32_t m_uiFlags;				// MESH_ASSET_FLAG_*
+	uint32_t m_uiVertexChunkCount;
+	uint32_t m_uiIndexChunkCount;
+	uint32_t m_uiPadding;
+	uint64_t m_ulVertexOffset;		// bytes from the start of the file
+	uint64_t m_ulIndexOffset;
+	uint64_t m_ulMeshletOffset;
+	uint64_t m_ulChunkOffset;		// TMeshAssetChunk table
+	float m_arrBoundsMin[3];		// positions are normalized to these bounds
+	float m_arrBoundsMax[3];
+	TMeshLod m_arrLods[MESH_ASSET_MAX_LODS];	// full mesh first, errors grow
+} TMeshAssetHeader;
+
+static_assert(sizeof(TMeshAssetHeader) == 192, "Mesh asset header layout changed, bump MESH_ASSET_VERSION");
+
+/**
+ * Cluster of up to MESH_ASSET_MESHLET_TRIANGLES triangles, read by
+ * cluster_cull.comp in std430 layout. The bounds are in the units of the
+ * source model, relative to the mesh bounds minimum.
+ */
+typedef struct SMeshlet
+{
+	float m_arrCenter[3];			// bounding sphere
+	float m_fRadius;
+	float m_arrConeAxis[3];			// average normal direction
+	float m_fConeCutoff;			// cos of the half angle, 1 when the cone is degenerate
+	uint32_t m_uiFirstIndex;		// contiguous range of the index section
+	uint32_t m_uiIndexCount;
+	uint32_t m_arrPadding[2];
+} TMeshlet;
+
+static_assert(sizeof(TMeshlet) == 48, "Meshlet does not match the std430 layout");
+
+/**
+ * Cooked mesh uploaded to the GPU.
+ */
+typedef struct SMeshAsset
+{
+	MeshHandle m_hMesh;
+	GLuint m_uiVertexCount;
+	GLuint m_uiIndexCount;
+	Vector3D m_v3BoundsMin;
+	Vector3D m_v3BoundsMax;
+	BufferHandle m_hMeshletBuffer;	// TMeshlet per cluster
+	GLuint m_uiMeshletCount;
+	TMeshLod m_arrLods[MESH_ASSET_MAX_LODS];
+	GLuint m_uiLodCount;
+} TMeshAsset;
+
+/**
+ * Offline cook of models into .amesh files and their runtime loader.
+ *
+ * Cook() imports any format Assimp reads, flattens the node hierarchy into a
+ * single mesh, reorders it with meshoptimizer for the vertex cache, overdraw
+ * and vertex fetch, splits it into meshlets with their bounding sphere and
+ * normal cone, simplifies it into a chain of levels of detail, then
+ * quantizes the vertices to 16 bytes. Load() maps the file and hands the
+ * sections to GL as they are, there is nothing to parse.
+ *
+ * A compressed cook encodes the vertex and index streams with the
+ * meshoptimizer codecs and deflates them. Load() then maps the GPU buffers
+ * and the job threads inflate and decode the chunks straight into them.
+ */
+class CMappedFile;
+
+class CMeshAsset
+{
+public:
+	/**
+	 * Slow, Assimp parses the source and the optimizations are not cheap.
+	 *
+	 * @return Always false without ANUBIS_WITH_MESH_COOKER
+	 */
+	static bool Cook(const std::string& stSourcePath, const std::string& stCookedPath, bool bCompress);
+
+	/**
+	 * Needs the GL context.
+	 */
+	static bool Load(const std::string& stPath, TMeshAsset& mesh);
+
+	/**
+	 * Scales the normalized positions back to the bounds, then moves the mesh
+	 * to v3Position.
+	 */
+	static Matrix4 GetModelMatrix(const TMeshAsset& mesh, const Vector3D& v3Position);
+
+	/**
+	 * Moves the meshlet bounds to world space for the same v3Position, they
+	 * are not normalized so no scale is applied.
+	 */
+	static Matrix4 GetMeshletMatrix(const TMeshAsset& mesh, const Vector3D& v3Position);
+
+protected:
+	static bool Import(const std::string& stSourcePath, std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices);
+	static void Optimize(std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshlet>& vecMeshlets, std::vector<TMeshLod>& vecLods);
+
+	/**
+	 * Rewrites vecIndices meshlet after meshlet, each one a contiguous range,
+	 * so the whole mesh still draws with a single call.
+	 */
+	static void BuildMeshlets(const std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshlet>& vecMeshlets);
+
+	/**
+	 * Simplifies the full mesh in vecIndices and appends every level after it,
+	 * vecLods starts with the full mesh.
+	 */
+	static void BuildLods(const std::vector<TerrainVertex>& vecVertices, std::vector<GLuint>& vecIndices, std::vector<TMeshLod>& vecLods);
+
+	/**
+	 * Encodes and deflates the streams chunk by chunk, the chunk offsets are
+	 * left for the caller.
+	 */
+	static bool Compress(const std::vector<TQuantizedVertex>& vecVertices, const std::vector<GLuint>& vecIndices, TMeshAssetHeader& header,
+		std::vector<TMeshAssetChunk>& vecChunks, std::vector<std::vector<uint8_t>>& vecPacked);
+
+	/**
+	 * Runs on the job threads, the mesh buffers are mapped by the caller.
+	 */
+	static bool Decompress(const CMappedFile& file, const TMeshAssetHeader& header, TQuantizedVertex* pVertices, GLuint* pIndices);
+};
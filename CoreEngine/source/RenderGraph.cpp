@@ -0,0 +1,440 @@
+#include "RenderGraph.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+#include <chrono>
+
+CRenderGraph::CRenderGraph()
+{
+	m_vecPasses.reserve(RENDER_GRAPH_PASS_RESERVE);
+	m_vecResources.reserve(RENDER_GRAPH_RESOURCE_RESERVE);
+	m_vecOrder.reserve(RENDER_GRAPH_PASS_RESERVE);
+	m_vecStack.reserve(RENDER_GRAPH_PASS_RESERVE);
+	m_vecPending.reserve(RENDER_GRAPH_PASS_RESERVE);
+	m_vecScheduled.reserve(RENDER_GRAPH_PASS_RESERVE);
+
+	m_iPassCount = 0;
+	m_iResourceCount = 0;
+}
+
+CRenderGraph::~CRenderGraph()
+{
+}
+
+void CRenderGraph::Reset()
+{
+	// the slots are reinitialized once they are handed out again
+	m_iPassCount = 0;
+	m_iResourceCount = 0;
+	m_vecOrder.clear();
+}
+
+void CRenderGraph::Clear()
+{
+	Reset();
+	m_mapImportedStates.clear();
+}
+
+GLint CRenderGraph::ImportTexture(const char* szName, GLuint uiTexture)
+{
+	TResource& resource = AllocateResource();
+	resource.m_szName = szName;
+	resource.m_ubType = RENDER_RESOURCE_TEXTURE;
+	resource.m_bIsImported = true;
+	resource.m_uiName = uiTexture;
+	resource.m_iLastWriter = RENDER_GRAPH_INVALID;
+
+	return (m_iResourceCount - 1);
+}
+
+GLint CRenderGraph::ImportBuffer(const char* szName, GLuint uiBuffer)
+{
+	TResource& resource = AllocateResource();
+	resource.m_szName = szName;
+	resource.m_ubType = RENDER_RESOURCE_BUFFER;
+	resource.m_bIsImported = true;
+	resource.m_uiName = uiBuffer;
+	resource.m_iLastWriter = RENDER_GRAPH_INVALID;
+
+	return (m_iResourceCount - 1);
+}
+
+GLint CRenderGraph::CreateTexture(const char* szName, const TRenderTargetDesc& desc)
+{
+	TResource& resource = AllocateResource();
+	resource.m_szName = szName;
+	resource.m_ubType = RENDER_RESOURCE_TEXTURE;
+	resource.m_bIsImported = false;
+	resource.m_desc = desc;
+	resource.m_iLastWriter = RENDER_GRAPH_INVALID;
+
+	return (m_iResourceCount - 1);
+}
+
+GLint CRenderGraph::AddPass(const char* szName, TRenderPassFunction function)
+{
+	TPass& pass = AllocatePass();
+	pass.m_szName = szName;
+	pass.m_function = std::move(function);
+
+	return (m_iPassCount - 1);
+}
+
+CRenderGraph::TPass& CRenderGraph::AllocatePass()
+{
+	if (m_iPassCount == static_cast<GLint>(m_vecPasses.size()))
+	{
+		m_vecPasses.emplace_back();
+	}
+
+	TPass& pass = m_vecPasses[m_iPassCount++];
+	pass.m_szName = nullptr;
+	pass.m_vecAccesses.clear();
+	pass.m_vecProducers.clear();
+	pass.m_vecDependencies.clear();
+	pass.m_bHasSideEffects = false;
+	pass.m_bIsCulled = false;
+	pass.m_uiBarrierBits = 0;
+	pass.m_dCPUTime = 0.0;
+	return (pass);
+}
+
+CRenderGraph::TResource& CRenderGraph::AllocateResource()
+{
+	if (m_iResourceCount == static_cast<GLint>(m_vecResources.size()))
+	{
+		m_vecResources.emplace_back();
+	}
+
+	TResource& resource = m_vecResources[m_iResourceCount++];
+	resource.m_szName = nullptr;
+	resource.m_ubType = RENDER_RESOURCE_TEXTURE;
+	resource.m_bIsImported = false;
+	resource.m_uiName = 0;
+	resource.m_desc = TRenderTargetDesc{};
+	resource.m_hTarget = RenderTargetHandle();
+	resource.m_state = TResourceState{};
+	resource.m_iLastWriter = RENDER_GRAPH_INVALID;
+	resource.m_vecReaders.clear();
+	resource.m_iFirstUse = RENDER_GRAPH_INVALID;
+	resource.m_iLastUse = RENDER_GRAPH_INVALID;
+	return (resource);
+}
+
+void CRenderGraph::Read(GLint iPass, GLint iResource, GLubyte ubAccess)
+{
+	TPass& pass = m_vecPasses[iPass];
+	TResource& resource = m_vecResources[iResource];
+	pass.m_vecAccesses.push_back({ iResource, ubAccess, false });
+
+	// read after write
+	if (resource.m_iLastWriter != RENDER_GRAPH_INVALID && resource.m_iLastWriter != iPass)
+	{
+		AddDependency(pass, resource.m_iLastWriter);
+		pass.m_vecProducers.push_back(resource.m_iLastWriter);
+	}
+
+	resource.m_vecReaders.push_back(iPass);
+}
+
+void CRenderGraph::Write(GLint iPass, GLint iResource, GLubyte ubAccess)
+{
+	TPass& pass = m_vecPasses[iPass];
+	TResource& resource = m_vecResources[iResource];
+	pass.m_vecAccesses.push_back({ iResource, ubAccess, true });
+
+	// write after write and write after read, the previous version has to be consumed first
+	if (resource.m_iLastWriter != RENDER_GRAPH_INVALID && resource.m_iLastWriter != iPass)
+	{
+		AddDependency(pass, resource.m_iLastWriter);
+	}
+
+	for (GLint iReader : resource.m_vecReaders)
+	{
+		if (iReader != iPass)
+		{
+			AddDependency(pass, iReader);
+		}
+	}
+
+	// starts a new version
+	resource.m_iLastWriter = iPass;
+	resource.m_vecReaders.clear();
+}
+
+void CRenderGraph::SetSideEffects(GLint iPass)
+{
+	m_vecPasses[iPass].m_bHasSideEffects = true;
+}
+
+void CRenderGraph::AddDependency(TPass& pass, GLint iDependency) const
+{
+	if (std::find(pass.m_vecDependencies.begin(), pass.m_vecDependencies.end(), iDependency) == pass.m_vecDependencies.end())
+	{
+		pass.m_vecDependencies.push_back(iDependency);
+	}
+}
+
+void CRenderGraph::Compile()
+{
+	ANUBIS_ZONE("RenderGraph::Compile");
+
+	const GLint iPassCount = m_iPassCount;
+
+	// everything is culled unless something visible depends on it
+	std::vector<GLint>& vecStack = m_vecStack;
+	vecStack.clear();
+	for (GLint i = 0; i < iPassCount; i++)
+	{
+		TPass& pass = m_vecPasses[i];
+		pass.m_bIsCulled = true;
+
+		bool bIsRoot = pass.m_bHasSideEffects;
+		for (const TAccess& access : pass.m_vecAccesses)
+		{
+			bIsRoot = bIsRoot || (access.m_bIsWrite && m_vecResources[access.m_iResource].m_bIsImported);
+		}
+
+		if (bIsRoot)
+		{
+			pass.m_bIsCulled = false;
+			vecStack.push_back(i);
+		}
+	}
+
+	while (vecStack.empty() == false)
+	{
+		const GLint iPass = vecStack.back();
+		vecStack.pop_back();
+
+		for (GLint iProducer : m_vecPasses[iPass].m_vecProducers)
+		{
+			if (m_vecPasses[iProducer].m_bIsCulled)
+			{
+				m_vecPasses[iProducer].m_bIsCulled = false;
+				vecStack.push_back(iProducer);
+			}
+		}
+	}
+
+	// Kahn's algorithm, ready passes run in the order they were added
+	std::vector<GLint>& vecPending = m_vecPending;
+	vecPending.assign(iPassCount, 0);
+	for (GLint i = 0; i < iPassCount; i++)
+	{
+		for (GLint iDependency : m_vecPasses[i].m_vecDependencies)
+		{
+			vecPending[i] += m_vecPasses[iDependency].m_bIsCulled ? 0 : 1;
+		}
+	}
+
+	m_vecOrder.clear();
+	std::vector<bool>& vecScheduled = m_vecScheduled;
+	vecScheduled.assign(iPassCount, false);
+	for (;;)
+	{
+		GLint iReady = RENDER_GRAPH_INVALID;
+		for (GLint i = 0; i < iPassCount; i++)
+		{
+			if (vecScheduled[i] == false && m_vecPasses[i].m_bIsCulled == false && vecPending[i] == 0)
+			{
+				iReady = i;
+				break;
+			}
+		}
+
+		if (iReady == RENDER_GRAPH_INVALID)
+		{
+			break;
+		}
+
+		vecScheduled[iReady] = true;
+		m_vecOrder.push_back(iReady);
+
+		for (GLint i = 0; i < iPassCount; i++)
+		{
+			const std::vector<GLint>& vecDependencies = m_vecPasses[i].m_vecDependencies;
+			if (std::find(vecDependencies.begin(), vecDependencies.end(), iReady) != vecDependencies.end())
+			{
+				vecPending[i]--;
+			}
+		}
+	}
+
+	// dependencies only point to earlier passes, a cycle means a bug in the graph building
+	const GLint iAliveCount = static_cast<GLint>(std::count_if(m_vecPasses.begin(), m_vecPasses.begin() + iPassCount, [](const TPass& pass) { return (pass.m_bIsCulled == false); }));
+	if (static_cast<GLint>(m_vecOrder.size()) != iAliveCount)
+	{
+		syserr("Render graph has a cycle, %d passes skipped", iAliveCount - static_cast<GLint>(m_vecOrder.size()));
+	}
+
+	// transient lifetimes, first and last executed pass touching them
+	for (GLint i = 0; i < m_iResourceCount; i++)
+	{
+		TResource& resource = m_vecResources[i];
+		resource.m_iFirstUse = RENDER_GRAPH_INVALID;
+		resource.m_iLastUse = RENDER_GRAPH_INVALID;
+	}
+
+	for (GLint iPosition = 0; iPosition < static_cast<GLint>(m_vecOrder.size()); iPosition++)
+	{
+		for (const TAccess& access : m_vecPasses[m_vecOrder[iPosition]].m_vecAccesses)
+		{
+			TResource& resource = m_vecResources[access.m_iResource];
+			resource.m_iFirstUse = (resource.m_iFirstUse == RENDER_GRAPH_INVALID) ? iPosition : resource.m_iFirstUse;
+			resource.m_iLastUse = iPosition;
+		}
+	}
+}
+
+void CRenderGraph::Execute(CRenderTargetManager& renderTargetManager)
+{
+	ANUBIS_ZONE("RenderGraph::Execute");
+
+	for (GLint iPosition = 0; iPosition < static_cast<GLint>(m_vecOrder.size()); iPosition++)
+	{
+		TPass& pass = m_vecPasses[m_vecOrder[iPosition]];
+
+		// transient textures only exist between their first and last use
+		for (GLint i = 0; i < m_iResourceCount; i++)
+		{
+			TResource& resource = m_vecResources[i];
+			if (resource.m_bIsImported == false && resource.m_iFirstUse == iPosition)
+			{
+				resource.m_hTarget = renderTargetManager.AcquireTransient(resource.m_desc);
+				resource.m_uiName = renderTargetManager.GetColorTexture(resource.m_hTarget, 0);
+				resource.m_uiName = resource.m_uiName ? resource.m_uiName : renderTargetManager.GetDepthTexture(resource.m_hTarget);
+				resource.m_state = TResourceState{};
+			}
+		}
+
+		// one barrier for every access that would see a pending shader write
+		GLbitfield uiBarrierBits = 0;
+		for (const TAccess& access : pass.m_vecAccesses)
+		{
+			TResource& resource = m_vecResources[access.m_iResource];
+			const TResourceState& state = GetState(resource);
+			const GLbitfield uiAccessBits = GetAccessBits(access.m_ubAccess, resource.m_ubType);
+
+			if (state.m_bHasPendingWrite && (uiAccessBits & ~state.m_uiVisibleBits))
+			{
+				uiBarrierBits |= uiAccessBits;
+			}
+		}
+
+		if (uiBarrierBits)
+		{
+			glMemoryBarrier(uiBarrierBits);
+
+			// a barrier covers every earlier write, not only the ones of this pass
+			for (GLint i = 0; i < m_iResourceCount; i++)
+			{
+				m_vecResources[i].m_state.m_uiVisibleBits |= uiBarrierBits;
+			}
+			for (auto& [key, state] : m_mapImportedStates)
+			{
+				state.m_uiVisibleBits |= uiBarrierBits;
+			}
+		}
+		pass.m_uiBarrierBits = uiBarrierBits;
+
+		{
+			ANUBIS_ZONE(pass.m_szName);
+			CGPUScope gpuScope(pass.m_szName);
+
+			const auto timeBegin = std::chrono::steady_clock::now();
+			pass.m_function(*this);
+			pass.m_dCPUTime = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - timeBegin).count();
+		}
+
+		for (const TAccess& access : pass.m_vecAccesses)
+		{
+			if (access.m_bIsWrite && IsShaderWrite(access.m_ubAccess))
+			{
+				TResourceState& state = GetState(m_vecResources[access.m_iResource]);
+				state.m_bHasPendingWrite = true;
+				state.m_uiVisibleBits = 0;
+			}
+		}
+
+		for (GLint i = 0; i < m_iResourceCount; i++)
+		{
+			TResource& resource = m_vecResources[i];
+			if (resource.m_bIsImported == false && resource.m_iLastUse == iPosition)
+			{
+				renderTargetManager.ReleaseTransient(resource.m_hTarget);
+				resource.m_hTarget = RenderTargetHandle();
+				resource.m_uiName = 0;
+			}
+		}
+	}
+}
+
+GLuint CRenderGraph::GetTexture(GLint iResource) const
+{
+	return (m_vecResources[iResource].m_uiName);
+}
+
+GLuint CRenderGraph::GetBuffer(GLint iResource) const
+{
+	return (m_vecResources[iResource].m_uiName);
+}
+
+RenderTargetHandle CRenderGraph::GetRenderTarget(GLint iResource) const
+{
+	return (m_vecResources[iResource].m_hTarget);
+}
+
+void CRenderGraph::GetPassTimings(std::vector<TRenderPassTiming>& vecTimings) const
+{
+	vecTimings.clear();
+	for (GLint i = 0; i < m_iPassCount; i++)
+	{
+		const TPass& pass = m_vecPasses[i];
+		vecTimings.push_back({ pass.m_szName, pass.m_bIsCulled, pass.m_uiBarrierBits, pass.m_dCPUTime });
+	}
+}
+
+CRenderGraph::TResourceState& CRenderGraph::GetState(TResource& resource)
+{
+	if (resource.m_bIsImported)
+	{
+		return (m_mapImportedStates[{ resource.m_ubType, resource.m_uiName }]);
+	}
+
+	return (resource.m_state);
+}
+
+GLbitfield CRenderGraph::GetAccessBits(GLubyte ubAccess, GLubyte ubType)
+{
+	switch (ubAccess)
+	{
+		case RENDER_ACCESS_ATTACHMENT:
+			return (GL_FRAMEBUFFER_BARRIER_BIT);
+		case RENDER_ACCESS_TEXTURE_FETCH:
+			return (GL_TEXTURE_FETCH_BARRIER_BIT);
+		case RENDER_ACCESS_IMAGE:
+			return (GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		case RENDER_ACCESS_STORAGE_BUFFER:
+			return (GL_SHADER_STORAGE_BARRIER_BIT);
+		case RENDER_ACCESS_UNIFORM_BUFFER:
+			return (GL_UNIFORM_BARRIER_BIT);
+		case RENDER_ACCESS_INDIRECT:
+			return (GL_COMMAND_BARRIER_BIT);
+		case RENDER_ACCESS_VERTEX_BUFFER:
+			return (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+		case RENDER_ACCESS_INDEX_BUFFER:
+			return (GL_ELEMENT_ARRAY_BARRIER_BIT);
+		case RENDER_ACCESS_TRANSFER:
+			return (ubType == RENDER_RESOURCE_BUFFER) ? GL_BUFFER_UPDATE_BARRIER_BIT : (GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+		default:
+			return (GL_ALL_BARRIER_BITS);
+	}
+}
+
+bool CRenderGraph::IsShaderWrite(GLubyte ubAccess)
+{
+	// everything else is ordered by GL itself
+	return (ubAccess == RENDER_ACCESS_IMAGE) || (ubAccess == RENDER_ACCESS_STORAGE_BUFFER);
+}
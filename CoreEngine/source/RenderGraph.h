@@ -0,0 +1,190 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+#include "RenderTargetManager.h"
+
+enum ERenderGraphData
+{
+	RENDER_GRAPH_PASS_RESERVE = 32,
+	RENDER_GRAPH_RESOURCE_RESERVE = 64,
+	RENDER_GRAPH_INVALID = -1,
+};
+
+enum ERenderGraphResourceType : GLubyte
+{
+	RENDER_RESOURCE_TEXTURE,
+	RENDER_RESOURCE_BUFFER,
+};
+
+/**
+ * How a pass touches a resource, decides the barrier bits a later access
+ * needs after a shader wrote the resource.
+ */
+enum ERenderGraphAccess : GLubyte
+{
+	RENDER_ACCESS_ATTACHMENT,		// framebuffer color or depth attachment, blits
+	RENDER_ACCESS_TEXTURE_FETCH,	// sampled or texelFetch
+	RENDER_ACCESS_IMAGE,			// image load / store
+	RENDER_ACCESS_STORAGE_BUFFER,	// shader storage and atomics
+	RENDER_ACCESS_UNIFORM_BUFFER,
+	RENDER_ACCESS_INDIRECT,			// draw, dispatch and parameter buffers
+	RENDER_ACCESS_VERTEX_BUFFER,
+	RENDER_ACCESS_INDEX_BUFFER,
+	RENDER_ACCESS_TRANSFER,			// copies, clears and read backs
+};
+
+class CRenderGraph;
+typedef std::function<void(const CRenderGraph& graph)> TRenderPassFunction;
+
+typedef struct SRenderPassTiming
+{
+	const char* m_szName;
+	bool m_bIsCulled;
+	GLbitfield m_uiBarrierBits;		// glMemoryBarrier issued before the pass
+	GLdouble m_dCPUTime;			// ms, recording the pass, GPU time is in the profiler scope of the same name
+} TRenderPassTiming;
+
+/**
+ * Per frame graph of render passes.
+ *
+ * Passes declare which textures and buffers they read and write, Compile()
+ * orders them topologically, drops passes none of whose outputs are used and
+ * computes the first and last use of every transient texture. Execute() runs
+ * the passes, each in its own GPU profiler scope, issues the smallest
+ * glMemoryBarrier covering the shader writes the next pass depends on and
+ * gets transient textures from the render target manager only for their
+ * lifetime, so textures of passes that do not overlap are shared.
+ *
+ * Imported resources outlive the frame, passes writing them are always kept
+ * and their pending shader writes are tracked across frames. Passes and
+ * resources are recycled from frame to frame, after the first frames
+ * building and compiling the graph does not allocate.
+ * Render thread only.
+ */
+class CRenderGraph
+{
+public:
+	CRenderGraph();
+	~CRenderGraph();
+
+	CRenderGraph(const CRenderGraph&) = delete;
+	CRenderGraph& operator=(const CRenderGraph&) = delete;
+
+	/**
+	 * Starts a new frame, the imported resource states are kept.
+	 */
+	void Reset();
+
+	/**
+	 * Forgets the state of imported resources, call when they were recreated.
+	 */
+	void Clear();
+
+	// Resources, the names have to outlive the graph (string literals)
+	GLint ImportTexture(const char* szName, GLuint uiTexture);
+	GLint ImportBuffer(const char* szName, GLuint uiBuffer);
+	GLint CreateTexture(const char* szName, const TRenderTargetDesc& desc);
+
+	/**
+	 * @param szName Also names the profiler scopes, has to be a string literal
+	 * @return Index of the pass
+	 */
+	GLint AddPass(const char* szName, TRenderPassFunction function);
+	void Read(GLint iPass, GLint iResource, GLubyte ubAccess);
+	void Write(GLint iPass, GLint iResource, GLubyte ubAccess);
+
+	/**
+	 * Keeps the pass even if nothing reads what it writes, e.g. presenting.
+	 */
+	void SetSideEffects(GLint iPass);
+
+	void Compile();
+	void Execute(CRenderTargetManager& renderTargetManager);
+
+	// Resolving resources while a pass executes
+	GLuint GetTexture(GLint iResource) const;
+	GLuint GetBuffer(GLint iResource) const;
+	RenderTargetHandle GetRenderTarget(GLint iResource) const;
+
+	/**
+	 * Passes of the last executed frame in the order they were added.
+	 */
+	void GetPassTimings(std::vector<TRenderPassTiming>& vecTimings) const;
+
+protected:
+	typedef struct SResourceState
+	{
+		bool m_bHasPendingWrite;		// written by a shader, not visible to every access yet
+		GLbitfield m_uiVisibleBits;		// barriers issued since that write
+	} TResourceState;
+
+	typedef struct SResource
+	{
+		const char* m_szName;
+		GLubyte m_ubType;
+		bool m_bIsImported;
+		GLuint m_uiName;				// GL name, transient textures only get one while alive
+		TRenderTargetDesc m_desc;
+		RenderTargetHandle m_hTarget;
+		TResourceState m_state;			// transient resources, imported ones use the persistent map
+
+		// Graph building
+		GLint m_iLastWriter;
+		std::vector<GLint> m_vecReaders;	// of the current version
+
+		// Lifetime in execution order
+		GLint m_iFirstUse;
+		GLint m_iLastUse;
+	} TResource;
+
+	typedef struct SAccess
+	{
+		GLint m_iResource;
+		GLubyte m_ubAccess;
+		bool m_bIsWrite;
+	} TAccess;
+
+	typedef struct SPass
+	{
+		const char* m_szName;
+		TRenderPassFunction m_function;
+		std::vector<TAccess> m_vecAccesses;
+		std::vector<GLint> m_vecProducers;		// passes whose writes this one reads
+		std::vector<GLint> m_vecDependencies;	// passes that have to run before this one
+		bool m_bHasSideEffects;
+		bool m_bIsCulled;
+		GLbitfield m_uiBarrierBits;
+		GLdouble m_dCPUTime;
+	} TPass;
+
+	/**
+	 * Slot of the next pass or resource, the vectors they own keep their capacity.
+	 */
+	TPass& AllocatePass();
+	TResource& AllocateResource();
+
+	void AddDependency(TPass& pass, GLint iDependency) const;
+	TResourceState& GetState(TResource& resource);
+	static GLbitfield GetAccessBits(GLubyte ubAccess, GLubyte ubType);
+	static bool IsShaderWrite(GLubyte ubAccess);
+
+private:
+	// Only the first m_iPassCount and m_iResourceCount are part of the frame
+	std::vector<TPass> m_vecPasses;
+	std::vector<TResource> m_vecResources;
+	GLint m_iPassCount;
+	GLint m_iResourceCount;
+	std::vector<GLint> m_vecOrder;		// executed passes after Compile()
+
+	// Compile() scratch
+	std::vector<GLint> m_vecStack;
+	std::vector<GLint> m_vecPending;
+	std::vector<bool> m_vecScheduled;
+
+	// Imported resources by type and GL name, persists across frames
+	std::map<std::pair<GLubyte, GLuint>, TResourceState> m_mapImportedStates;
+};
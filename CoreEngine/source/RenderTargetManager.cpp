@@ -0,0 +1,525 @@
+#include "RenderTargetManager.h"
+#include <utils.h>
+#include <algorithm>
+#include <cmath>
+
+CRenderTargetManager::CRenderTargetManager()
+{
+	m_uiTextureCount = 0;
+	m_ulTextureBytes = 0;
+
+	m_iViewportWidth = 0;
+	m_iViewportHeight = 0;
+	m_ulFrame = 0;
+}
+
+CRenderTargetManager::~CRenderTargetManager()
+{
+	Destroy();
+}
+
+void CRenderTargetManager::Initialize()
+{
+	Destroy();
+	m_poolTargets.Initialize(RENDER_TARGET_MAX_TARGETS);
+}
+
+void CRenderTargetManager::Destroy()
+{
+	m_poolTargets.ForEach([this](RenderTargetHandle, TRenderTarget& target)
+	{
+		Release(target);
+	});
+	m_poolTargets.Destroy();
+
+	for (const auto& [arrTextures, uiFramebuffer] : m_mapFramebuffers)
+	{
+		glDeleteFramebuffers(1, &uiFramebuffer);
+	}
+	m_mapFramebuffers.clear();
+
+	for (const TPooledTexture& pooledTexture : m_vecPooledTextures)
+	{
+		glDeleteTextures(1, &pooledTexture.m_uiTexture);
+	}
+	m_vecPooledTextures.clear();
+
+	m_uiTextureCount = 0;
+	m_ulTextureBytes = 0;
+	m_iViewportWidth = 0;
+	m_iViewportHeight = 0;
+	m_ulFrame = 0;
+}
+
+void CRenderTargetManager::SetViewportSize(GLint iWidth, GLint iHeight)
+{
+	m_iViewportWidth = iWidth;
+	m_iViewportHeight = iHeight;
+}
+
+GLint CRenderTargetManager::GetViewportWidth() const
+{
+	return (m_iViewportWidth);
+}
+
+GLint CRenderTargetManager::GetViewportHeight() const
+{
+	return (m_iViewportHeight);
+}
+
+RenderTargetHandle CRenderTargetManager::CreateTarget(const TRenderTargetDesc& desc)
+{
+	if (desc.m_iColorCount < 0 || desc.m_iColorCount > RENDER_TARGET_MAX_COLOR_ATTACHMENTS || (desc.m_iColorCount == 0 && desc.m_eDepthFormat == GL_NONE))
+	{
+		syserr("Invalid render target description with %d color attachments", desc.m_iColorCount);
+		return RenderTargetHandle();
+	}
+
+	// multisampled textures have no mipmaps
+	if (desc.m_iSamples < 1 || (desc.m_iSamples > 1 && desc.m_iLevels > 1))
+	{
+		syserr("Invalid render target description with %d samples and %d levels", desc.m_iSamples, desc.m_iLevels);
+		return RenderTargetHandle();
+	}
+
+	TRenderTarget target{};
+	target.m_desc = desc;
+	target.m_bIsTransient = false;
+
+	// allocated on first use, the viewport may not be known yet
+	RenderTargetHandle hTarget = m_poolTargets.Create(target);
+	if (hTarget.IsValid() == false)
+	{
+		syserr("Render target pool is full (%u targets)", m_poolTargets.GetCapacity());
+	}
+
+	return (hTarget);
+}
+
+void CRenderTargetManager::DestroyTarget(RenderTargetHandle hTarget)
+{
+	TRenderTarget* pTarget = m_poolTargets.Get(hTarget);
+	if (pTarget == nullptr)
+	{
+		return;
+	}
+
+	Release(*pTarget);
+	m_poolTargets.Remove(hTarget);
+}
+
+RenderTargetHandle CRenderTargetManager::AcquireTransient(const TRenderTargetDesc& desc)
+{
+	RenderTargetHandle hTarget = CreateTarget(desc);
+
+	TRenderTarget* pTarget = m_poolTargets.Get(hTarget);
+	if (pTarget == nullptr)
+	{
+		return RenderTargetHandle();
+	}
+
+	pTarget->m_bIsTransient = true;
+	if (Allocate(*pTarget) == false)
+	{
+		m_poolTargets.Remove(hTarget);
+		return RenderTargetHandle();
+	}
+
+	return (hTarget);
+}
+
+void CRenderTargetManager::ReleaseTransient(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = m_poolTargets.Get(hTarget);
+	if (pTarget == nullptr || pTarget->m_bIsTransient == false)
+	{
+		return;
+	}
+
+	DestroyTarget(hTarget);
+}
+
+bool CRenderTargetManager::Bind(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	if (pTarget == nullptr || pTarget->m_uiFramebuffer == 0)
+	{
+		return (false);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, pTarget->m_uiFramebuffer);
+	glViewport(0, 0, pTarget->m_iWidth, pTarget->m_iHeight);
+	return (true);
+}
+
+void CRenderTargetManager::EndFrame()
+{
+	m_ulFrame++;
+
+	for (size_t i = 0; i < m_vecPooledTextures.size();)
+	{
+		const TPooledTexture& pooledTexture = m_vecPooledTextures[i];
+		if (pooledTexture.m_bInUse || m_ulFrame - pooledTexture.m_ulLastUsedFrame <= RENDER_TARGET_POOL_KEEP_FRAMES)
+		{
+			i++;
+			continue;
+		}
+
+		EvictFramebuffers(pooledTexture.m_uiTexture);
+		glDeleteTextures(1, &pooledTexture.m_uiTexture);
+
+		// order does not matter, swap with the last one
+		m_vecPooledTextures[i] = m_vecPooledTextures.back();
+		m_vecPooledTextures.pop_back();
+	}
+}
+
+GLuint CRenderTargetManager::GetFramebuffer(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	return pTarget ? pTarget->m_uiFramebuffer : 0;
+}
+
+GLuint CRenderTargetManager::GetColorTexture(RenderTargetHandle hTarget, GLint iIndex)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	if (pTarget == nullptr || iIndex < 0 || iIndex >= pTarget->m_desc.m_iColorCount)
+	{
+		return (0);
+	}
+
+	return (pTarget->m_arrTextures[iIndex]);
+}
+
+GLuint CRenderTargetManager::GetDepthTexture(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	return pTarget ? pTarget->m_arrTextures[RENDER_TARGET_MAX_COLOR_ATTACHMENTS] : 0;
+}
+
+GLint CRenderTargetManager::GetWidth(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	return pTarget ? pTarget->m_iWidth : 0;
+}
+
+GLint CRenderTargetManager::GetHeight(RenderTargetHandle hTarget)
+{
+	const TRenderTarget* pTarget = Resolve(hTarget);
+	return pTarget ? pTarget->m_iHeight : 0;
+}
+
+TRenderTargetStats CRenderTargetManager::GetStats() const
+{
+	TRenderTargetStats stats{};
+	stats.m_uiPooledTextureCount = static_cast<GLuint>(m_vecPooledTextures.size());
+	for (const TPooledTexture& pooledTexture : m_vecPooledTextures)
+	{
+		stats.m_ulPooledBytes += GetTextureBytes(pooledTexture.m_eFormat, pooledTexture.m_iWidth, pooledTexture.m_iHeight, pooledTexture.m_iLevels, pooledTexture.m_iSamples);
+	}
+
+	stats.m_uiTextureCount = m_uiTextureCount + stats.m_uiPooledTextureCount;
+	stats.m_ulBytes = m_ulTextureBytes + stats.m_ulPooledBytes;
+	return (stats);
+}
+
+CRenderTargetManager::TRenderTarget* CRenderTargetManager::Resolve(RenderTargetHandle hTarget)
+{
+	TRenderTarget* pTarget = m_poolTargets.Get(hTarget);
+	if (pTarget == nullptr)
+	{
+		return (nullptr);
+	}
+
+	// persistent targets follow the viewport lazily, transient ones only live for a frame
+	if (pTarget->m_bIsTransient == false)
+	{
+		GLint iWidth = 0;
+		GLint iHeight = 0;
+		ResolveSize(pTarget->m_desc, iWidth, iHeight);
+
+		if ((iWidth != pTarget->m_iWidth || iHeight != pTarget->m_iHeight || pTarget->m_uiFramebuffer == 0) && Allocate(*pTarget) == false)
+		{
+			return (nullptr);
+		}
+	}
+
+	return (pTarget);
+}
+
+void CRenderTargetManager::ResolveSize(const TRenderTargetDesc& desc, GLint& iWidth, GLint& iHeight) const
+{
+	if (desc.m_ubSizeMode == RENDER_TARGET_SIZE_ABSOLUTE)
+	{
+		iWidth = desc.m_iWidth;
+		iHeight = desc.m_iHeight;
+		return;
+	}
+
+	// never round a non empty viewport down to nothing
+	iWidth = (m_iViewportWidth > 0) ? std::max(1, static_cast<GLint>(std::lround(m_iViewportWidth * desc.m_fScale))) : 0;
+	iHeight = (m_iViewportHeight > 0) ? std::max(1, static_cast<GLint>(std::lround(m_iViewportHeight * desc.m_fScale))) : 0;
+}
+
+bool CRenderTargetManager::Allocate(TRenderTarget& target)
+{
+	Release(target);
+
+	GLint iWidth = 0;
+	GLint iHeight = 0;
+	ResolveSize(target.m_desc, iWidth, iHeight);
+	if (iWidth <= 0 || iHeight <= 0)
+	{
+		return (false);
+	}
+
+	const TRenderTargetDesc& desc = target.m_desc;
+	for (GLint i = 0; i < RENDER_TARGET_MAX_ATTACHMENTS; i++)
+	{
+		const GLenum eFormat = (i < RENDER_TARGET_MAX_COLOR_ATTACHMENTS) ? (i < desc.m_iColorCount ? desc.m_arrColorFormats[i] : GL_NONE) : desc.m_eDepthFormat;
+		if (eFormat == GL_NONE)
+		{
+			continue;
+		}
+
+		if (target.m_bIsTransient)
+		{
+			target.m_arrTextures[i] = AcquireTexture(eFormat, iWidth, iHeight, desc.m_iLevels, desc.m_iSamples);
+		}
+		else
+		{
+			target.m_arrTextures[i] = CreateTexture(eFormat, iWidth, iHeight, desc.m_iLevels, desc.m_iSamples);
+			m_uiTextureCount++;
+			m_ulTextureBytes += GetTextureBytes(eFormat, iWidth, iHeight, desc.m_iLevels, desc.m_iSamples);
+		}
+	}
+
+	target.m_iWidth = iWidth;
+	target.m_iHeight = iHeight;
+	target.m_uiFramebuffer = target.m_bIsTransient ? GetCachedFramebuffer(desc, target.m_arrTextures) : CreateFramebuffer(desc, target.m_arrTextures);
+
+	if (target.m_uiFramebuffer == 0)
+	{
+		Release(target);
+		return (false);
+	}
+
+	return (true);
+}
+
+void CRenderTargetManager::Release(TRenderTarget& target)
+{
+	for (GLint i = 0; i < RENDER_TARGET_MAX_ATTACHMENTS; i++)
+	{
+		GLuint& uiTexture = target.m_arrTextures[i];
+		if (uiTexture == 0)
+		{
+			continue;
+		}
+
+		if (target.m_bIsTransient)
+		{
+			ReleaseTexture(uiTexture);
+		}
+		else
+		{
+			const GLenum eFormat = (i < RENDER_TARGET_MAX_COLOR_ATTACHMENTS) ? target.m_desc.m_arrColorFormats[i] : target.m_desc.m_eDepthFormat;
+			m_uiTextureCount--;
+			m_ulTextureBytes -= GetTextureBytes(eFormat, target.m_iWidth, target.m_iHeight, target.m_desc.m_iLevels, target.m_desc.m_iSamples);
+			glDeleteTextures(1, &uiTexture);
+		}
+
+		uiTexture = 0;
+	}
+
+	// cached framebuffers stay valid as long as their textures exist
+	if (target.m_bIsTransient == false && target.m_uiFramebuffer)
+	{
+		glDeleteFramebuffers(1, &target.m_uiFramebuffer);
+	}
+
+	target.m_uiFramebuffer = 0;
+	target.m_iWidth = 0;
+	target.m_iHeight = 0;
+}
+
+GLuint CRenderTargetManager::AcquireTexture(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples)
+{
+	for (TPooledTexture& pooledTexture : m_vecPooledTextures)
+	{
+		if (pooledTexture.m_bInUse == false && pooledTexture.m_eFormat == eFormat && pooledTexture.m_iWidth == iWidth &&
+			pooledTexture.m_iHeight == iHeight && pooledTexture.m_iLevels == iLevels && pooledTexture.m_iSamples == iSamples)
+		{
+			pooledTexture.m_bInUse = true;
+			pooledTexture.m_ulLastUsedFrame = m_ulFrame;
+			return (pooledTexture.m_uiTexture);
+		}
+	}
+
+	TPooledTexture pooledTexture{};
+	pooledTexture.m_uiTexture = CreateTexture(eFormat, iWidth, iHeight, iLevels, iSamples);
+	pooledTexture.m_eFormat = eFormat;
+	pooledTexture.m_iWidth = iWidth;
+	pooledTexture.m_iHeight = iHeight;
+	pooledTexture.m_iLevels = iLevels;
+	pooledTexture.m_iSamples = iSamples;
+	pooledTexture.m_bInUse = true;
+	pooledTexture.m_ulLastUsedFrame = m_ulFrame;
+	m_vecPooledTextures.push_back(pooledTexture);
+
+	return (pooledTexture.m_uiTexture);
+}
+
+void CRenderTargetManager::ReleaseTexture(GLuint uiTexture)
+{
+	for (TPooledTexture& pooledTexture : m_vecPooledTextures)
+	{
+		if (pooledTexture.m_uiTexture == uiTexture)
+		{
+			pooledTexture.m_bInUse = false;
+			pooledTexture.m_ulLastUsedFrame = m_ulFrame;
+			return;
+		}
+	}
+}
+
+GLuint CRenderTargetManager::CreateFramebuffer(const TRenderTargetDesc& desc, const TAttachmentKey& arrTextures) const
+{
+	GLuint uiFramebuffer = 0;
+	glCreateFramebuffers(1, &uiFramebuffer);
+
+	std::array<GLenum, RENDER_TARGET_MAX_COLOR_ATTACHMENTS> arrDrawBuffers{};
+	for (GLint i = 0; i < desc.m_iColorCount; i++)
+	{
+		glNamedFramebufferTexture(uiFramebuffer, GL_COLOR_ATTACHMENT0 + i, arrTextures[i], 0);
+		arrDrawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+
+	if (desc.m_eDepthFormat != GL_NONE)
+	{
+		glNamedFramebufferTexture(uiFramebuffer, GetDepthAttachment(desc.m_eDepthFormat), arrTextures[RENDER_TARGET_MAX_COLOR_ATTACHMENTS], 0);
+	}
+
+	if (desc.m_iColorCount > 0)
+	{
+		glNamedFramebufferDrawBuffers(uiFramebuffer, desc.m_iColorCount, arrDrawBuffers.data());
+		glNamedFramebufferReadBuffer(uiFramebuffer, GL_COLOR_ATTACHMENT0);
+	}
+	else
+	{
+		// depth only
+		glNamedFramebufferDrawBuffer(uiFramebuffer, GL_NONE);
+		glNamedFramebufferReadBuffer(uiFramebuffer, GL_NONE);
+	}
+
+	const GLenum eStatus = glCheckNamedFramebufferStatus(uiFramebuffer, GL_FRAMEBUFFER);
+	if (eStatus != GL_FRAMEBUFFER_COMPLETE)
+	{
+		syserr("Render target framebuffer is incomplete (0x%x)", eStatus);
+		glDeleteFramebuffers(1, &uiFramebuffer);
+		return (0);
+	}
+
+	return (uiFramebuffer);
+}
+
+GLuint CRenderTargetManager::GetCachedFramebuffer(const TRenderTargetDesc& desc, const TAttachmentKey& arrTextures)
+{
+	const auto itFramebuffer = m_mapFramebuffers.find(arrTextures);
+	if (itFramebuffer != m_mapFramebuffers.end())
+	{
+		return (itFramebuffer->second);
+	}
+
+	const GLuint uiFramebuffer = CreateFramebuffer(desc, arrTextures);
+	if (uiFramebuffer)
+	{
+		m_mapFramebuffers.emplace(arrTextures, uiFramebuffer);
+	}
+
+	return (uiFramebuffer);
+}
+
+void CRenderTargetManager::EvictFramebuffers(GLuint uiTexture)
+{
+	for (auto itFramebuffer = m_mapFramebuffers.begin(); itFramebuffer != m_mapFramebuffers.end();)
+	{
+		const TAttachmentKey& arrTextures = itFramebuffer->first;
+		if (std::find(arrTextures.begin(), arrTextures.end(), uiTexture) == arrTextures.end())
+		{
+			++itFramebuffer;
+			continue;
+		}
+
+		glDeleteFramebuffers(1, &itFramebuffer->second);
+		itFramebuffer = m_mapFramebuffers.erase(itFramebuffer);
+	}
+}
+
+GLuint CRenderTargetManager::CreateTexture(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples)
+{
+	GLuint uiTexture = 0;
+
+	// resolved with a blit before anything samples it, no sampler state to set
+	if (iSamples > 1)
+	{
+		glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &uiTexture);
+		glTextureStorage2DMultisample(uiTexture, iSamples, eFormat, iWidth, iHeight, GL_TRUE);
+		return (uiTexture);
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &uiTexture);
+	glTextureStorage2D(uiTexture, std::max(iLevels, 1), eFormat, iWidth, iHeight);
+
+	// passes reading a target sample it filtered, never past the edge
+	glTextureParameteri(uiTexture, GL_TEXTURE_MIN_FILTER, iLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(uiTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(uiTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(uiTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	return (uiTexture);
+}
+
+GLuint64 CRenderTargetManager::GetTextureBytes(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples)
+{
+	GLuint64 ulTexelBytes = 4;
+	switch (eFormat)
+	{
+		case GL_R8:
+			ulTexelBytes = 1;
+			break;
+		case GL_R16F:
+		case GL_RG8:
+			ulTexelBytes = 2;
+			break;
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			ulTexelBytes = 8;
+			break;
+		case GL_RGBA32F:
+			ulTexelBytes = 16;
+			break;
+		default:
+			// RGBA8, RGB10_A2, R11F_G11F_B10F, RG16F, R32F, 32 bit depth
+			break;
+	}
+
+	GLuint64 ulBytes = 0;
+	for (GLint iLevel = 0; iLevel < std::max(iLevels, 1); iLevel++)
+	{
+		ulBytes += ulTexelBytes * std::max(iWidth >> iLevel, 1) * std::max(iHeight >> iLevel, 1);
+	}
+
+	return (ulBytes * std::max(iSamples, 1));
+}
+
+GLenum CRenderTargetManager::GetDepthAttachment(GLenum eFormat)
+{
+	if (eFormat == GL_DEPTH24_STENCIL8 || eFormat == GL_DEPTH32F_STENCIL8)
+	{
+		return (GL_DEPTH_STENCIL_ATTACHMENT);
+	}
+
+	return (GL_DEPTH_ATTACHMENT);
+}
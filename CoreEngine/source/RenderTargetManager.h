@@ -0,0 +1,189 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <array>
+#include <map>
+#include <vector>
+#include "ResourcePool.h"
+
+enum ERenderTargetData
+{
+	RENDER_TARGET_MAX_TARGETS = 256,
+	RENDER_TARGET_MAX_COLOR_ATTACHMENTS = 4,
+	RENDER_TARGET_MAX_ATTACHMENTS = RENDER_TARGET_MAX_COLOR_ATTACHMENTS + 1,	// colors then depth
+
+	// Pooled textures nobody acquired for this many frames are deleted,
+	// sizes left behind by a resize do not stay around
+	RENDER_TARGET_POOL_KEEP_FRAMES = 8,
+};
+
+enum ERenderTargetSizeMode : GLubyte
+{
+	RENDER_TARGET_SIZE_RELATIVE,	// fraction of the viewport, follows resizes
+	RENDER_TARGET_SIZE_ABSOLUTE,
+};
+
+/**
+ * Attachments of a render target, all of them share one size.
+ */
+typedef struct SRenderTargetDesc
+{
+	std::array<GLenum, RENDER_TARGET_MAX_COLOR_ATTACHMENTS> m_arrColorFormats;	// sized internal formats
+	GLint m_iColorCount;
+	GLenum m_eDepthFormat;		// GL_NONE without depth attachment
+	GLubyte m_ubSizeMode;
+	GLfloat m_fScale;			// relative size
+	GLint m_iWidth;				// absolute size
+	GLint m_iHeight;
+	GLint m_iLevels;
+	GLint m_iSamples;			// above 1 the attachments are multisampled and have a single level
+
+	SRenderTargetDesc()
+	{
+		m_arrColorFormats.fill(GL_NONE);
+		m_iColorCount = 0;
+		m_eDepthFormat = GL_NONE;
+		m_ubSizeMode = RENDER_TARGET_SIZE_RELATIVE;
+		m_fScale = 1.0f;
+		m_iWidth = 0;
+		m_iHeight = 0;
+		m_iLevels = 1;
+		m_iSamples = 1;
+	}
+} TRenderTargetDesc;
+
+typedef struct SRenderTargetStats
+{
+	GLuint m_uiTextureCount;		// persistent and pooled
+	GLuint m_uiPooledTextureCount;
+	GLuint64 m_ulBytes;				// estimated from the formats
+	GLuint64 m_ulPooledBytes;
+} TRenderTargetStats;
+
+/**
+ * Creates framebuffers and their attachments from descriptors.
+ *
+ * Persistent targets own their textures and are recreated lazily, on the first
+ * use after the viewport size changed. Transient targets only live between
+ * AcquireTransient() and ReleaseTransient() within a frame and take their
+ * textures from a pool keyed by format and size: a texture released by one
+ * pass is handed to the next pass asking for the same kind, so targets whose
+ * lifetimes do not overlap share memory and the pool stays at the peak number
+ * of simultaneously live targets.
+ * Render thread only.
+ */
+class CRenderTargetManager
+{
+public:
+	CRenderTargetManager();
+	~CRenderTargetManager();
+
+	CRenderTargetManager(const CRenderTargetManager&) = delete;
+	CRenderTargetManager& operator=(const CRenderTargetManager&) = delete;
+
+	void Initialize();
+	void Destroy();
+
+	/**
+	 * Size relative targets are resolved against, nothing is reallocated
+	 * until a target is used.
+	 */
+	void SetViewportSize(GLint iWidth, GLint iHeight);
+	GLint GetViewportWidth() const;
+	GLint GetViewportHeight() const;
+
+	/**
+	 * @return Handle to a target owning its textures, invalid if the pool is full
+	 */
+	RenderTargetHandle CreateTarget(const TRenderTargetDesc& desc);
+	void DestroyTarget(RenderTargetHandle hTarget);
+
+	/**
+	 * Gets a target with pooled attachments for the current frame, it has to
+	 * be released before EndFrame(). The content is undefined.
+	 */
+	RenderTargetHandle AcquireTransient(const TRenderTargetDesc& desc);
+
+	/**
+	 * Gives the attachments back to the pool, later passes of this frame may
+	 * reuse them. The handle is retired.
+	 */
+	void ReleaseTransient(RenderTargetHandle hTarget);
+
+	/**
+	 * Binds the framebuffer and sets the viewport to its size.
+	 *
+	 * @return false for a stale handle or an incomplete framebuffer
+	 */
+	bool Bind(RenderTargetHandle hTarget);
+
+	/**
+	 * Ages the texture pool, must be called once per frame.
+	 */
+	void EndFrame();
+
+	// Accessors, they allocate a persistent target whose size is out of date
+	GLuint GetFramebuffer(RenderTargetHandle hTarget);
+	GLuint GetColorTexture(RenderTargetHandle hTarget, GLint iIndex);
+	GLuint GetDepthTexture(RenderTargetHandle hTarget);
+	GLint GetWidth(RenderTargetHandle hTarget);
+	GLint GetHeight(RenderTargetHandle hTarget);
+
+	/**
+	 * Textures currently allocated, the pooled ones are shared by transient targets.
+	 */
+	TRenderTargetStats GetStats() const;
+
+protected:
+	typedef struct SRenderTarget
+	{
+		TRenderTargetDesc m_desc;
+		bool m_bIsTransient;
+		GLint m_iWidth;				// resolved size, 0 until allocated
+		GLint m_iHeight;
+		GLuint m_uiFramebuffer;		// owned by persistent targets, cached for transient ones
+		std::array<GLuint, RENDER_TARGET_MAX_ATTACHMENTS> m_arrTextures;
+	} TRenderTarget;
+
+	typedef struct SPooledTexture
+	{
+		GLuint m_uiTexture;
+		GLenum m_eFormat;
+		GLint m_iWidth;
+		GLint m_iHeight;
+		GLint m_iLevels;
+		GLint m_iSamples;
+		bool m_bInUse;
+		GLuint64 m_ulLastUsedFrame;
+	} TPooledTexture;
+
+	typedef std::array<GLuint, RENDER_TARGET_MAX_ATTACHMENTS> TAttachmentKey;
+
+	TRenderTarget* Resolve(RenderTargetHandle hTarget);
+	void ResolveSize(const TRenderTargetDesc& desc, GLint& iWidth, GLint& iHeight) const;
+	bool Allocate(TRenderTarget& target);
+	void Release(TRenderTarget& target);
+
+	GLuint AcquireTexture(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples);
+	void ReleaseTexture(GLuint uiTexture);
+
+	GLuint CreateFramebuffer(const TRenderTargetDesc& desc, const TAttachmentKey& arrTextures) const;
+	GLuint GetCachedFramebuffer(const TRenderTargetDesc& desc, const TAttachmentKey& arrTextures);
+	void EvictFramebuffers(GLuint uiTexture);
+
+	static GLuint CreateTexture(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples);
+	static GLuint64 GetTextureBytes(GLenum eFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLint iSamples);
+	static GLenum GetDepthAttachment(GLenum eFormat);
+
+private:
+	TResourcePool<TRenderTarget, RenderTargetHandle> m_poolTargets;
+	std::vector<TPooledTexture> m_vecPooledTextures;
+	std::map<TAttachmentKey, GLuint> m_mapFramebuffers;	// transient framebuffers by attachments
+
+	GLuint m_uiTextureCount;		// persistent targets only
+	GLuint64 m_ulTextureBytes;
+
+	GLint m_iViewportWidth;
+	GLint m_iViewportHeight;
+	GLuint64 m_ulFrame;
+};
@@ -0,0 +1,685 @@
+#include "RenderThread.h"
+#include "GLResourceManager.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include "FrameCapture.h"
+#include "TextureManager.h"
+#include "BindlessTextures.h"
+#include "VirtualTexture.h"
+#include "FontAtlas.h"
+#include <utils.h>
+#include <algorithm>
+
+CRenderThread::CRenderThread()
+{
+	m_pGLWindow = nullptr;
+	m_bIsRunning = false;
+	m_ulRenderedFrames = 0;
+	m_ulDrawCalls = 0;
+	m_ulTriangles = 0;
+
+	m_iViewportWidth = 0;
+	m_iViewportHeight = 0;
+
+	m_bIsOffscreen = false;
+	m_iSwapInterval = -1;
+	m_ulCaptureFrame = UINT64_MAX;
+	m_bHasCaptured = false;
+}
+
+CRenderThread::~CRenderThread()
+{
+	Stop();
+}
+
+bool CRenderThread::Start(GLFWwindow* pWindow)
+{
+	if (m_bIsRunning)
+	{
+		syserr("Render thread is already running");
+		return (false);
+	}
+
+	if (pWindow == nullptr)
+	{
+		syserr("Cannot start render thread without a window");
+		return (false);
+	}
+
+	m_pGLWindow = pWindow;
+	m_ulRenderedFrames = 0;
+	m_ulDrawCalls = 0;
+	m_ulTriangles = 0;
+
+	m_iViewportWidth = 0;
+	m_iViewportHeight = 0;
+
+	// all packets start free
+	m_queueFreePackets.Reset();
+	m_queueReadyPackets.Reset();
+	for (TFramePacket& packet : m_arrPackets)
+	{
+		m_queueFreePackets.Push(&packet);
+	}
+
+	m_bIsRunning = true;
+	m_thread = std::thread(&CRenderThread::RenderLoop, this);
+
+	syslog("Render thread started with %d frame packets", FRAME_PACKET_COUNT);
+	return (true);
+}
+
+void CRenderThread::Stop()
+{
+	if (m_bIsRunning == false)
+	{
+		return;
+	}
+
+	m_bIsRunning = false;
+
+	// Closing the ready queue lets the render thread finish what was already
+	// submitted, closing the free queue unblocks a waiting main thread.
+	m_queueReadyPackets.Close();
+	m_queueFreePackets.Close();
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	syslog("Render thread stopped after %llu frames", static_cast<unsigned long long>(m_ulRenderedFrames.load()));
+}
+
+bool CRenderThread::IsRunning() const
+{
+	return (m_bIsRunning);
+}
+
+void CRenderThread::SetOffscreen(bool bOffscreen)
+{
+	if (m_bIsRunning)
+	{
+		syserr("Cannot change the render target while the render thread is running");
+		return;
+	}
+
+	m_bIsOffscreen = bOffscreen;
+}
+
+bool CRenderThread::IsOffscreen() const
+{
+	return (m_bIsOffscreen);
+}
+
+void CRenderThread::SetSwapInterval(GLint iSwapInterval)
+{
+	if (m_bIsRunning)
+	{
+		syserr("Cannot change the swap interval while the render thread is running");
+		return;
+	}
+
+	m_iSwapInterval = iSwapInterval;
+}
+
+void CRenderThread::RequestCapture(GLuint64 ulFrameIndex, const std::string& stPath)
+{
+	std::lock_guard<std::mutex> lock(m_mutexCapture);
+	m_ulCaptureFrame = ulFrameIndex;
+	m_stCapturePath = stPath;
+	m_bHasCaptured = false;
+}
+
+bool CRenderThread::HasCaptured() const
+{
+	return (m_bHasCaptured);
+}
+
+TFramePacket* CRenderThread::AcquirePacket()
+{
+	TFramePacket* pPacket = nullptr;
+	if (m_queueFreePackets.Pop(pPacket) == false)
+	{
+		return (nullptr);
+	}
+
+	pPacket->Reset();
+	return (pPacket);
+}
+
+void CRenderThread::SubmitPacket(TFramePacket* pPacket)
+{
+	if (pPacket == nullptr)
+	{
+		return;
+	}
+
+	if (m_queueReadyPackets.Push(pPacket) == false)
+	{
+		// render thread is gone, give the packet back so it is not lost
+		m_queueFreePackets.Push(pPacket);
+	}
+}
+
+GLuint64 CRenderThread::GetRenderedFrames() const
+{
+	return (m_ulRenderedFrames);
+}
+
+TRenderStats CRenderThread::GetRenderStats() const
+{
+	TRenderStats stats{};
+	stats.m_ulFrames = m_ulRenderedFrames.load(std::memory_order_relaxed);
+	stats.m_ulDrawCalls = m_ulDrawCalls.load(std::memory_order_relaxed);
+	stats.m_ulTriangles = m_ulTriangles.load(std::memory_order_relaxed);
+	return (stats);
+}
+
+void CRenderThread::RenderLoop()
+{
+	ANUBIS_THREAD_NAME("Render");
+	glfwMakeContextCurrent(m_pGLWindow);
+
+	// the swap interval belongs to the context current on the calling thread
+	if (m_iSwapInterval >= 0 && m_bIsOffscreen == false)
+	{
+		glfwSwapInterval(m_iSwapInterval);
+	}
+
+	// the scene color outlives the frame for presenting and captures, the
+	// depth is a transient of the render graph attached by the Clear pass.
+	// Windowed frames are multisampled, offscreen ones stay single sampled
+	TRenderTargetDesc sceneDesc;
+	sceneDesc.m_arrColorFormats[0] = GL_RGBA8;
+	sceneDesc.m_iColorCount = 1;
+	sceneDesc.m_iSamples = m_bIsOffscreen ? 1 : RENDER_SCENE_SAMPLES;
+
+	m_renderTargetManager.Initialize();
+	m_hSceneTarget = m_renderTargetManager.CreateTarget(sceneDesc);
+
+	if (sceneDesc.m_iSamples > 1)
+	{
+		TRenderTargetDesc resolveDesc;
+		resolveDesc.m_arrColorFormats[0] = GL_RGBA8;
+		resolveDesc.m_iColorCount = 1;
+		m_hResolveTarget = m_renderTargetManager.CreateTarget(resolveDesc);
+	}
+
+	// occlusion culling tests against the pyramid of the previous frame
+	m_gpuCuller.SetDepthPyramid(&m_depthPyramid);
+	m_clusterCuller.SetDepthPyramid(&m_depthPyramid);
+
+	TFramePacket* pPacket = nullptr;
+	while (m_queueReadyPackets.Pop(pPacket))
+	{
+		CGPUProfiler::Instance().BeginFrame(pPacket->m_ulFrameIndex);
+		RenderPacket(*pPacket);
+		CGPUProfiler::Instance().EndFrame();
+
+		m_indirectDrawBuffer.EndFrame();
+		m_gpuCuller.EndFrame();
+		m_clusterCuller.EndFrame();
+		m_renderer2D.EndFrame();
+
+		CaptureIfRequested(*pPacket);
+
+		// nothing to present when rendering offscreen
+		if (m_bIsOffscreen == false)
+		{
+			ANUBIS_ZONE("RenderThread::SwapBuffers");
+			glfwSwapBuffers(m_pGLWindow);
+		}
+		m_ulRenderedFrames++;
+
+		// GL objects released during this frame are deleted once it completed
+		CGLResourceManager::Instance().EndFrame();
+		m_renderTargetManager.EndFrame();
+
+		m_queueFreePackets.Push(pPacket);
+	}
+
+	m_renderGraph.Clear();
+	m_renderTargetManager.Destroy();
+	m_hSceneTarget = RenderTargetHandle();
+	m_hResolveTarget = RenderTargetHandle();
+	m_depthPyramid.Destroy();
+	m_indirectDrawBuffer.Destroy();
+	m_gpuCuller.SetDepthPyramid(nullptr);
+	m_gpuCuller.Destroy();
+	m_clusterCuller.SetDepthPyramid(nullptr);
+	m_clusterCuller.Destroy();
+	m_renderer2D.Destroy();
+
+	// make sure every command reached the driver before giving the context back
+	glFinish();
+	glfwMakeContextCurrent(nullptr);
+}
+
+void CRenderThread::RenderPacket(const TFramePacket& packet)
+{
+	ANUBIS_ZONE("RenderThread::RenderPacket");
+	GPU_SCOPE("Frame");
+
+	// Framebuffer got resized by the main thread
+	if (packet.m_iWidth != m_iViewportWidth || packet.m_iHeight != m_iViewportHeight)
+	{
+		m_iViewportWidth = packet.m_iWidth;
+		m_iViewportHeight = packet.m_iHeight;
+
+		// viewport sized targets are reallocated on their next use
+		m_renderTargetManager.SetViewportSize(m_iViewportWidth, m_iViewportHeight);
+	}
+
+	// bound for the whole frame, the passes drawing into the scene rely on it
+	const GLuint uiPreviousPyramid = m_depthPyramid.GetTexture();
+	if (m_renderTargetManager.Bind(m_hSceneTarget))
+	{
+		m_depthPyramid.Resize(m_iViewportWidth, m_iViewportHeight);
+	}
+	else
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, m_iViewportWidth, m_iViewportHeight);
+		m_depthPyramid.Destroy();
+	}
+
+	const TGPUCullBatch& cullBatch = packet.m_gpuCullBatch;
+	const GLuint uiPreviousCommands = m_gpuCuller.GetCommandBuffer();
+	const bool bHasCullBatch = cullBatch.m_uiObjectCount && m_gpuCuller.Reserve(cullBatch.m_uiObjectCount);
+
+	const TClusterBatch& clusterBatch = packet.m_clusterBatch;
+	const GLuint uiPreviousClusterCommands = m_clusterCuller.GetCommandBuffer();
+	const bool bHasClusterBatch = clusterBatch.m_uiMeshletCount && m_clusterCuller.Reserve(clusterBatch.m_uiMeshletCount);
+
+	// the graph tracks imported resources by GL name, recreated ones start clean
+	if (m_depthPyramid.GetTexture() != uiPreviousPyramid || m_gpuCuller.GetCommandBuffer() != uiPreviousCommands ||
+		m_clusterCuller.GetCommandBuffer() != uiPreviousClusterCommands)
+	{
+		m_renderGraph.Clear();
+	}
+
+	m_renderGraph.Reset();
+
+	// uploads of the background loaded textures, within a per frame budget
+	GLint iPass = m_renderGraph.AddPass("TextureUpload", [](const CRenderGraph&) { CTextureManager::Instance().Update(); });
+	m_renderGraph.SetSideEffects(iPass);
+
+	// after the uploads, a texture finished this frame is sampled bindless right away
+	iPass = m_renderGraph.AddPass("TextureResidency", [&packet](const CRenderGraph&) { CBindlessTextures::Instance().Update(packet.m_vecMaterials, packet.m_ulFrameIndex); });
+	m_renderGraph.SetSideEffects(iPass);
+
+	// pages baked since the last frame are drawn this frame
+	iPass = m_renderGraph.AddPass("VirtualTextureUpdate", [&packet](const CRenderGraph&) { CVirtualTexture::Instance().Update(packet.m_ulFrameIndex, packet.m_v3CameraPosition); });
+	m_renderGraph.SetSideEffects(iPass);
+
+	const bool bIsMultisampled = m_hResolveTarget.IsValid();
+
+	TRenderTargetDesc sceneDepthDesc;
+	sceneDepthDesc.m_eDepthFormat = GL_DEPTH_COMPONENT32F;
+	sceneDepthDesc.m_iSamples = bIsMultisampled ? RENDER_SCENE_SAMPLES : 1;
+
+	const GLint iSceneColor = m_renderGraph.ImportTexture("SceneColor", m_renderTargetManager.GetColorTexture(m_hSceneTarget, 0));
+	const GLint iSceneDepth = m_renderGraph.CreateTexture("SceneDepth", sceneDepthDesc);
+	const GLint iDepthPyramid = m_renderGraph.ImportTexture("DepthPyramid", m_depthPyramid.GetTexture());
+	const GLint iFeedback = m_renderGraph.ImportBuffer("VirtualTextureFeedback", CVirtualTexture::Instance().GetFeedbackBuffer());
+
+	iPass = m_renderGraph.AddPass("Clear", [this, &packet, iSceneDepth](const CRenderGraph& graph)
+	{
+		// the pooled depth texture may differ from last frame's
+		const GLuint uiFramebuffer = m_renderTargetManager.GetFramebuffer(m_hSceneTarget);
+		if (uiFramebuffer)
+		{
+			glNamedFramebufferTexture(uiFramebuffer, GL_DEPTH_ATTACHMENT, graph.GetTexture(iSceneDepth), 0);
+		}
+
+		glClearColor(packet.m_v4ClearColor.x, packet.m_v4ClearColor.y, packet.m_v4ClearColor.z, packet.m_v4ClearColor.w);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	});
+	m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+	m_renderGraph.Write(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+
+	iPass = m_renderGraph.AddPass("DrawList", [this, &packet](const CRenderGraph&) { RenderDrawList(packet); });
+	m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+	m_renderGraph.Write(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+
+	if (packet.m_indirectBatch.m_vecCommands.empty() == false)
+	{
+		iPass = m_renderGraph.AddPass("IndirectBatch", [this, &packet](const CRenderGraph&) { RenderIndirectBatch(packet); });
+		m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iFeedback, RENDER_ACCESS_STORAGE_BUFFER);
+	}
+
+	if (bHasCullBatch)
+	{
+		const GLint iCommands = m_renderGraph.ImportBuffer("CullCommands", m_gpuCuller.GetCommandBuffer());
+		const GLint iVisibleData = m_renderGraph.ImportBuffer("CullVisibleData", m_gpuCuller.GetVisibleDataBuffer());
+		const GLint iCounters = m_renderGraph.ImportBuffer("CullCounters", m_gpuCuller.GetCounterBuffer());
+
+		// tests against the pyramid the previous frame built
+		iPass = m_renderGraph.AddPass("GPUCulling", [this, &packet](const CRenderGraph&) { m_gpuCuller.Cull(packet.m_gpuCullBatch, packet.m_mat4ViewProjection); });
+		m_renderGraph.Read(iPass, iDepthPyramid, RENDER_ACCESS_TEXTURE_FETCH);
+		m_renderGraph.Write(iPass, iCommands, RENDER_ACCESS_STORAGE_BUFFER);
+		m_renderGraph.Write(iPass, iVisibleData, RENDER_ACCESS_STORAGE_BUFFER);
+		m_renderGraph.Write(iPass, iCounters, RENDER_ACCESS_TRANSFER);
+		m_renderGraph.Write(iPass, iCounters, RENDER_ACCESS_STORAGE_BUFFER);
+
+		// the counters are the draw count and get copied for the read back
+		iPass = m_renderGraph.AddPass("GPUCullDraw", [this, &packet](const CRenderGraph&) { DrawGPUCullBatch(packet); });
+		m_renderGraph.Read(iPass, iCommands, RENDER_ACCESS_INDIRECT);
+		m_renderGraph.Read(iPass, iCounters, RENDER_ACCESS_INDIRECT);
+		m_renderGraph.Read(iPass, iCounters, RENDER_ACCESS_TRANSFER);
+		m_renderGraph.Read(iPass, iVisibleData, RENDER_ACCESS_STORAGE_BUFFER);
+		m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iFeedback, RENDER_ACCESS_STORAGE_BUFFER);
+	}
+
+	if (bHasClusterBatch)
+	{
+		const GLint iCommands = m_renderGraph.ImportBuffer("ClusterCommands", m_clusterCuller.GetCommandBuffer());
+		const GLint iCounters = m_renderGraph.ImportBuffer("ClusterCounters", m_clusterCuller.GetCounterBuffer());
+
+		// one thread per meshlet, the survivors become one command each
+		iPass = m_renderGraph.AddPass("ClusterCulling", [this, &packet](const CRenderGraph&)
+		{
+			m_clusterCuller.Cull(packet.m_clusterBatch, packet.m_mat4ViewProjection, packet.m_v3CameraPosition);
+		});
+		m_renderGraph.Read(iPass, iDepthPyramid, RENDER_ACCESS_TEXTURE_FETCH);
+		m_renderGraph.Write(iPass, iCommands, RENDER_ACCESS_STORAGE_BUFFER);
+		m_renderGraph.Write(iPass, iCounters, RENDER_ACCESS_TRANSFER);
+		m_renderGraph.Write(iPass, iCounters, RENDER_ACCESS_STORAGE_BUFFER);
+
+		iPass = m_renderGraph.AddPass("ClusterDraw", [this, &packet](const CRenderGraph&) { DrawClusterBatch(packet); });
+		m_renderGraph.Read(iPass, iCommands, RENDER_ACCESS_INDIRECT);
+		m_renderGraph.Read(iPass, iCounters, RENDER_ACCESS_INDIRECT);
+		m_renderGraph.Read(iPass, iCounters, RENDER_ACCESS_TRANSFER);
+		m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+	}
+
+	// the terrain draws set the bits of the pages they wanted, read back a few frames later
+	iPass = m_renderGraph.AddPass("VirtualTextureFeedback", [&packet](const CRenderGraph&) { CVirtualTexture::Instance().CopyFeedback(packet.m_ulFrameIndex); });
+	m_renderGraph.Read(iPass, iFeedback, RENDER_ACCESS_TRANSFER);
+	m_renderGraph.Write(iPass, iFeedback, RENDER_ACCESS_TRANSFER);
+	m_renderGraph.SetSideEffects(iPass);
+
+	// opaque pass done, next frame's occlusion culling reads this depth
+	if (m_depthPyramid.GetTexture())
+	{
+		// the pyramid samples a single sampled depth, the resolve keeps one sample per pixel
+		GLint iPyramidSource = iSceneDepth;
+		if (bIsMultisampled)
+		{
+			TRenderTargetDesc resolvedDepthDesc;
+			resolvedDepthDesc.m_eDepthFormat = GL_DEPTH_COMPONENT32F;
+			iPyramidSource = m_renderGraph.CreateTexture("ResolvedDepth", resolvedDepthDesc);
+
+			iPass = m_renderGraph.AddPass("ResolveDepth", [this, iPyramidSource](const CRenderGraph& graph)
+			{
+				ResolveSceneTarget(graph.GetRenderTarget(iPyramidSource), GL_DEPTH_BUFFER_BIT);
+			});
+			m_renderGraph.Read(iPass, iSceneDepth, RENDER_ACCESS_ATTACHMENT);
+			m_renderGraph.Write(iPass, iPyramidSource, RENDER_ACCESS_ATTACHMENT);
+		}
+
+		iPass = m_renderGraph.AddPass("DepthPyramid", [this, &packet, iPyramidSource](const CRenderGraph& graph) { BuildDepthPyramid(packet, graph.GetTexture(iPyramidSource)); });
+		m_renderGraph.Read(iPass, iPyramidSource, RENDER_ACCESS_TEXTURE_FETCH);
+		m_renderGraph.Write(iPass, iDepthPyramid, RENDER_ACCESS_IMAGE);
+	}
+
+	// HUD and overlays over the scene, glyphs shaped while the packet was built are uploaded first
+	if (packet.m_batch2D.m_vecDraws.empty() == false)
+	{
+		const bool bUsesFontAtlas = std::any_of(packet.m_batch2D.m_vecTextures.begin(), packet.m_batch2D.m_vecTextures.end(),
+			[](const TTexture2D& texture) { return ((texture.m_uiFlags & BATCH_2D_TEXTURE_FONT_ATLAS) != 0); });
+
+		GLint iGlyphAtlas = RENDER_GRAPH_INVALID;
+		if (bUsesFontAtlas)
+		{
+			iGlyphAtlas = m_renderGraph.ImportTexture("GlyphAtlas", CFontAtlas::Instance().GetTexture());
+			iPass = m_renderGraph.AddPass("TextUpload", [](const CRenderGraph&) { CFontAtlas::Instance().Update(); });
+			m_renderGraph.Write(iPass, iGlyphAtlas, RENDER_ACCESS_TRANSFER);
+		}
+
+		iPass = m_renderGraph.AddPass("Batch2D", [this, &packet](const CRenderGraph&) { DrawBatch2D(packet); });
+		m_renderGraph.Write(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+		if (bUsesFontAtlas)
+		{
+			m_renderGraph.Read(iPass, iGlyphAtlas, RENDER_ACCESS_TEXTURE_FETCH);
+		}
+	}
+
+	// after the overlays, presenting and captures read the resolved color
+	GLint iPresentColor = iSceneColor;
+	if (bIsMultisampled)
+	{
+		iPresentColor = m_renderGraph.ImportTexture("ResolvedColor", m_renderTargetManager.GetColorTexture(m_hResolveTarget, 0));
+		iPass = m_renderGraph.AddPass("Resolve", [this](const CRenderGraph&) { ResolveSceneTarget(m_hResolveTarget, GL_COLOR_BUFFER_BIT); });
+		m_renderGraph.Read(iPass, iSceneColor, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.Write(iPass, iPresentColor, RENDER_ACCESS_ATTACHMENT);
+	}
+
+	if (m_bIsOffscreen == false)
+	{
+		iPass = m_renderGraph.AddPass("Present", [this](const CRenderGraph&) { PresentSceneTarget(); });
+		m_renderGraph.Read(iPass, iPresentColor, RENDER_ACCESS_ATTACHMENT);
+		m_renderGraph.SetSideEffects(iPass);
+	}
+
+	m_renderGraph.Compile();
+	m_renderGraph.Execute(m_renderTargetManager);
+
+	// the depth went back to the pool, later frames or passes may hand it out again
+	const GLuint uiSceneFramebuffer = m_renderTargetManager.GetFramebuffer(m_hSceneTarget);
+	if (uiSceneFramebuffer)
+	{
+		glNamedFramebufferTexture(uiSceneFramebuffer, GL_DEPTH_ATTACHMENT, 0, 0);
+	}
+}
+
+void CRenderThread::RenderDrawList(const TFramePacket& packet)
+{
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+
+	ShaderHandle hCurrentShader;
+	CShader* pCurrentShader = nullptr;
+	GLuint64 ulDrawCalls = 0;
+	GLuint64 ulTriangles = 0;
+	for (const TDrawCommand& drawCmd : packet.m_vecDrawCommands)
+	{
+		// resources destroyed after the packet was built resolve to nullptr
+		const TMeshResource* pMesh = resourceManager.GetMesh(drawCmd.m_hMesh);
+		if (pMesh == nullptr)
+		{
+			continue;
+		}
+
+		// only switch programs when the shader changes between draws
+		if (drawCmd.m_hShader != hCurrentShader)
+		{
+			CShader* pShader = resourceManager.GetShader(drawCmd.m_hShader);
+			if (pShader == nullptr || pShader->IsReady() == false)
+			{
+				continue;
+			}
+
+			hCurrentShader = drawCmd.m_hShader;
+			pCurrentShader = pShader;
+			pCurrentShader->Use();
+			pCurrentShader->SetMat4("viewProjectionMatrix", packet.m_mat4ViewProjection);
+
+			// untextured, the default material samples the placeholder
+			CBindlessTextures::Instance().SetupShader(*pCurrentShader, TextureHandle());
+		}
+
+		pCurrentShader->SetMat4("modelMatrix", drawCmd.m_mat4Model);
+
+		// a level of detail of the mesh, or all of it
+		const GLsizei iIndexCount = drawCmd.m_uiIndexCount ? static_cast<GLsizei>(drawCmd.m_uiIndexCount) : pMesh->m_iIndexCount;
+		const GLuint uiFirstIndex = drawCmd.m_uiIndexCount ? drawCmd.m_uiFirstIndex : 0;
+
+		glBindVertexArray(pMesh->m_uiVAO);
+		glDrawElements(GL_TRIANGLES, iIndexCount, GL_UNSIGNED_INT, reinterpret_cast<const void*>(static_cast<uintptr_t>(uiFirstIndex) * sizeof(GLuint)));
+
+		ulDrawCalls++;
+		ulTriangles += iIndexCount / 3;
+	}
+
+	glBindVertexArray(0);
+
+	// single writer, relaxed is enough for statistics
+	m_ulDrawCalls.fetch_add(ulDrawCalls, std::memory_order_relaxed);
+	m_ulTriangles.fetch_add(ulTriangles, std::memory_order_relaxed);
+}
+
+void CRenderThread::RenderIndirectBatch(const TFramePacket& packet)
+{
+	const TIndirectBatch& batch = packet.m_indirectBatch;
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	const TMeshResource* pMesh = resourceManager.GetMesh(batch.m_hMesh);
+	CShader* pShader = resourceManager.GetShader(batch.m_hShader);
+	if (pMesh == nullptr || pShader == nullptr || pShader->IsReady() == false)
+	{
+		return;
+	}
+
+	GLintptr lCommandOffset = 0;
+	if (m_indirectDrawBuffer.Upload(batch, lCommandOffset) == false)
+	{
+		return;
+	}
+
+	pShader->Use();
+	pShader->SetMat4("viewProjectionMatrix", packet.m_mat4ViewProjection);
+	CBindlessTextures::Instance().SetupShader(*pShader, batch.m_hTexture);
+	CVirtualTexture::Instance().SetupShader(*pShader, packet.m_ulFrameIndex);
+
+	// every command indexes into the shared buffers, gl_DrawID selects the draw data
+	glBindVertexArray(pMesh->m_uiVAO);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(lCommandOffset), static_cast<GLsizei>(batch.m_vecCommands.size()), 0);
+	glBindVertexArray(0);
+
+	GLuint64 ulTriangles = 0;
+	for (const TDrawElementsIndirectCommand& command : batch.m_vecCommands)
+	{
+		ulTriangles += static_cast<GLuint64>(command.m_uiCount / 3) * command.m_uiInstanceCount;
+	}
+
+	// one API call no matter how many commands
+	m_ulDrawCalls.fetch_add(1, std::memory_order_relaxed);
+	m_ulTriangles.fetch_add(ulTriangles, std::memory_order_relaxed);
+}
+
+void CRenderThread::DrawGPUCullBatch(const TFramePacket& packet)
+{
+	// does nothing if the culling pass failed
+	m_gpuCuller.Draw(packet.m_gpuCullBatch, packet.m_mat4ViewProjection, packet.m_ulFrameIndex);
+
+	// the visible triangles are only known to the GPU, use the latest count read back
+	TGPUCullCounters counters{};
+	if (m_gpuCuller.GetLastCounters(counters))
+	{
+		m_ulTriangles.fetch_add(counters.m_uiTriangleCount, std::memory_order_relaxed);
+	}
+
+	m_ulDrawCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CRenderThread::DrawClusterBatch(const TFramePacket& packet)
+{
+	m_clusterCuller.Draw(packet.m_clusterBatch, packet.m_mat4ViewProjection);
+
+	// one multi draw, the drawn clusters and triangles trail by a few frames
+	TGPUCullCounters counters{};
+	if (m_clusterCuller.GetLastCounters(counters))
+	{
+		m_ulTriangles.fetch_add(counters.m_uiTriangleCount, std::memory_order_relaxed);
+	}
+
+	m_ulDrawCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CRenderThread::BuildDepthPyramid(const TFramePacket& packet, GLuint uiDepthTexture)
+{
+	CShader* pShader = CGLResourceManager::Instance().GetShader(packet.m_hDepthPyramidShader);
+	if (pShader == nullptr || uiDepthTexture == 0)
+	{
+		return;
+	}
+
+	m_depthPyramid.Build(*pShader, uiDepthTexture);
+}
+
+void CRenderThread::DrawBatch2D(const TFramePacket& packet)
+{
+	const GLuint uiDrawCount = m_renderer2D.Draw(packet.m_batch2D, m_iViewportWidth, m_iViewportHeight);
+	if (uiDrawCount)
+	{
+		m_ulDrawCalls.fetch_add(uiDrawCount, std::memory_order_relaxed);
+		m_ulTriangles.fetch_add(packet.m_batch2D.m_meshData.vIndices.size() / 3, std::memory_order_relaxed);
+	}
+}
+
+void CRenderThread::ResolveSceneTarget(RenderTargetHandle hTarget, GLbitfield uiMask)
+{
+	const GLuint uiSceneFramebuffer = m_renderTargetManager.GetFramebuffer(m_hSceneTarget);
+	const GLuint uiFramebuffer = m_renderTargetManager.GetFramebuffer(hTarget);
+	if (uiSceneFramebuffer == 0 || uiFramebuffer == 0)
+	{
+		return;
+	}
+
+	// color samples are averaged, depth has to be blitted with GL_NEAREST
+	glBlitNamedFramebuffer(uiSceneFramebuffer, uiFramebuffer, 0, 0, m_iViewportWidth, m_iViewportHeight,
+		0, 0, m_iViewportWidth, m_iViewportHeight, uiMask, GL_NEAREST);
+}
+
+void CRenderThread::PresentSceneTarget()
+{
+	// a multisampled scene was resolved by the graph before
+	const GLuint uiFramebuffer = m_renderTargetManager.GetFramebuffer(m_hResolveTarget.IsValid() ? m_hResolveTarget : m_hSceneTarget);
+	if (uiFramebuffer == 0)
+	{
+		return;
+	}
+
+	glBlitNamedFramebuffer(uiFramebuffer, 0, 0, 0, m_iViewportWidth, m_iViewportHeight,
+		0, 0, m_iViewportWidth, m_iViewportHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void CRenderThread::CaptureIfRequested(const TFramePacket& packet)
+{
+	std::lock_guard<std::mutex> lock(m_mutexCapture);
+	if (packet.m_ulFrameIndex != m_ulCaptureFrame)
+	{
+		return;
+	}
+
+	// the scene target holds the frame whether it was presented or not,
+	// a multisampled one cannot be read back and was resolved by the graph
+	const GLuint uiFramebuffer = m_renderTargetManager.GetFramebuffer(m_hResolveTarget.IsValid() ? m_hResolveTarget : m_hSceneTarget);
+	if (uiFramebuffer != 0)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, uiFramebuffer);
+	}
+	else
+	{
+		// read before the swap, the back buffer is undefined afterwards
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glReadBuffer(GL_BACK);
+	}
+
+	TCapturedImage image{};
+	CFrameCapture::ReadFramebuffer(m_iViewportWidth, m_iViewportHeight, image);
+
+	if (CFrameCapture::SavePPM(m_stCapturePath, image))
+	{
+		syslog("Captured frame %llu to %s", static_cast<unsigned long long>(packet.m_ulFrameIndex), m_stCapturePath.c_str());
+		m_bHasCaptured = true;
+	}
+
+	m_ulCaptureFrame = UINT64_MAX;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "BoundedQueue.h"
+#include "FramePacket.h"
+#include "RenderTargetManager.h"
+#include "IndirectDrawBuffer.h"
+#include "GPUCuller.h"
+#include "ClusterCuller.h"
+#include "DepthPyramid.h"
+#include "Renderer2D.h"
+#include "RenderGraph.h"
+
+enum ERenderThreadData
+{
+	// Windowed frames, resolved before they are presented
+	RENDER_SCENE_SAMPLES = 4,
+};
+
+typedef struct SRenderStats
+{
+	GLuint64 m_ulFrames;		// frames rendered
+	GLuint64 m_ulDrawCalls;		// summed over all frames
+	GLuint64 m_ulTriangles;
+} TRenderStats;
+
+/**
+ * Owns the OpenGL context and draws the frame packets produced by the main thread.
+ *
+ * The main thread acquires a free packet, fills it and submits it, the render
+ * thread draws it, swaps buffers and gives the packet back. With
+ * FRAME_PACKET_COUNT packets the simulation of frame N+1 overlaps rendering of
+ * frame N, and the main thread blocks only when it runs too far ahead.
+ */
+class CRenderThread
+{
+public:
+	CRenderThread();
+	~CRenderThread();
+
+	CRenderThread(const CRenderThread&) = delete;
+	CRenderThread& operator=(const CRenderThread&) = delete;
+
+	/**
+	 * Starts the render thread, the context of pWindow must not be current
+	 * on any other thread when calling this.
+	 *
+	 * @param pWindow Window whose context the render thread takes over
+	 * @return true if the thread was started
+	 */
+	bool Start(GLFWwindow* pWindow);
+
+	/**
+	 * Frames stay in the scene framebuffer instead of being blitted to the
+	 * window, nothing is presented. Must be set before Start().
+	 */
+	void SetOffscreen(bool bOffscreen);
+	bool IsOffscreen() const;
+
+	/**
+	 * Swap interval applied once the render thread owns the context,
+	 * 0 disables vsync, -1 keeps the driver default. Must be set before Start().
+	 */
+	void SetSwapInterval(GLint iSwapInterval);
+
+	/**
+	 * Saves the frame with the given index as a PPM image once it is rendered.
+	 */
+	void RequestCapture(GLuint64 ulFrameIndex, const std::string& stPath);
+	bool HasCaptured() const;
+
+	/**
+	 * Drains the submitted packets, stops the render thread and releases the
+	 * context so it can be made current again by the caller.
+	 */
+	void Stop();
+
+	bool IsRunning() const;
+
+	/**
+	 * Gets a packet to fill for the next frame.
+	 * Blocks while all packets are in flight.
+	 *
+	 * @return Reset packet, or nullptr if the render thread is stopping
+	 */
+	TFramePacket* AcquirePacket();
+
+	/**
+	 * Hands a filled packet over to the render thread.
+	 */
+	void SubmitPacket(TFramePacket* pPacket);
+
+	/**
+	 * Number of frames fully rendered and presented so far.
+	 */
+	GLuint64 GetRenderedFrames() const;
+
+	/**
+	 * Totals since Start(), can be read from any thread.
+	 */
+	TRenderStats GetRenderStats() const;
+
+protected:
+	void RenderLoop();
+	void RenderPacket(const TFramePacket& packet);
+
+	// Render graph passes
+	void RenderDrawList(const TFramePacket& packet);
+	void RenderIndirectBatch(const TFramePacket& packet);
+	void DrawGPUCullBatch(const TFramePacket& packet);
+	void DrawClusterBatch(const TFramePacket& packet);
+	void BuildDepthPyramid(const TFramePacket& packet, GLuint uiDepthTexture);
+	void DrawBatch2D(const TFramePacket& packet);
+
+	/**
+	 * Blits the multisampled scene into a single sampled target of the same size.
+	 */
+	void ResolveSceneTarget(RenderTargetHandle hTarget, GLbitfield uiMask);
+	void PresentSceneTarget();
+	void CaptureIfRequested(const TFramePacket& packet);
+
+private:
+	GLFWwindow* m_pGLWindow;
+	std::thread m_thread;
+	std::atomic<bool> m_bIsRunning;
+	std::atomic<GLuint64> m_ulRenderedFrames;
+	std::atomic<GLuint64> m_ulDrawCalls;
+	std::atomic<GLuint64> m_ulTriangles;
+
+	// Render thread only state
+	GLint m_iViewportWidth;
+	GLint m_iViewportHeight;
+
+	bool m_bIsOffscreen;
+	GLint m_iSwapInterval;
+	CRenderTargetManager m_renderTargetManager;
+	RenderTargetHandle m_hSceneTarget;
+	RenderTargetHandle m_hResolveTarget;	// only with a multisampled scene, presented and captured
+	CDepthPyramid m_depthPyramid;
+	CIndirectDrawBuffer m_indirectDrawBuffer;
+	CGPUCuller m_gpuCuller;
+	CClusterCuller m_clusterCuller;
+	CRenderer2D m_renderer2D;
+	CRenderGraph m_renderGraph;
+
+	// Pending frame capture
+	std::mutex m_mutexCapture;
+	GLuint64 m_ulCaptureFrame;
+	std::string m_stCapturePath;
+	std::atomic<bool> m_bHasCaptured;
+
+	std::array<TFramePacket, FRAME_PACKET_COUNT> m_arrPackets;
+	TBoundedQueue<TFramePacket*, FRAME_PACKET_COUNT> m_queueFreePackets;
+	TBoundedQueue<TFramePacket*, FRAME_PACKET_COUNT> m_queueReadyPackets;
+};
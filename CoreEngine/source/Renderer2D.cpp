@@ -0,0 +1,232 @@
+#include "Renderer2D.h"
+#include "GLResourceManager.h"
+#include "TextureManager.h"
+#include "FontAtlas.h"
+#include <utils.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+CRenderer2D::CRenderer2D()
+{
+	m_pVertices = nullptr;
+	m_pIndices = nullptr;
+	m_uiVAO = 0;
+
+	m_uiProgram = 0;
+	m_iTextureModesLocation = -1;
+
+	m_uiVertexCapacity = 0;
+	m_uiIndexCapacity = 0;
+}
+
+CRenderer2D::~CRenderer2D()
+{
+	Destroy();
+}
+
+void CRenderer2D::Destroy()
+{
+	m_fenceRing.Reset();
+
+	// deleting the buffers unmaps them, the resource manager waits for the GPU
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	if (m_hVertexBuffer.IsValid())
+	{
+		resourceManager.DestroyBuffer(m_hVertexBuffer);
+		m_hVertexBuffer = BufferHandle();
+	}
+
+	if (m_hIndexBuffer.IsValid())
+	{
+		resourceManager.DestroyBuffer(m_hIndexBuffer);
+		m_hIndexBuffer = BufferHandle();
+	}
+
+	if (m_uiVAO)
+	{
+		glDeleteVertexArrays(1, &m_uiVAO);
+		m_uiVAO = 0;
+	}
+
+	m_pVertices = nullptr;
+	m_pIndices = nullptr;
+	m_uiVertexCapacity = 0;
+	m_uiIndexCapacity = 0;
+}
+
+bool CRenderer2D::Reserve(GLuint uiVertexCount, GLuint uiIndexCount)
+{
+	if (uiVertexCount <= m_uiVertexCapacity && uiIndexCount <= m_uiIndexCapacity)
+	{
+		return (true);
+	}
+
+	GLuint uiVertexCapacity = std::max<GLuint>(m_uiVertexCapacity, RENDERER_2D_INITIAL_CAPACITY);
+	while (uiVertexCapacity < uiVertexCount)
+	{
+		uiVertexCapacity *= 2;
+	}
+
+	GLuint uiIndexCapacity = std::max<GLuint>(m_uiIndexCapacity, RENDERER_2D_INITIAL_CAPACITY + RENDERER_2D_INITIAL_CAPACITY / 2);
+	while (uiIndexCapacity < uiIndexCount)
+	{
+		uiIndexCapacity *= 2;
+	}
+
+	// the old buffers stay alive until the frames using them completed
+	Destroy();
+
+	const GLbitfield uiFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr lVertexSize = static_cast<GLsizeiptr>(uiVertexCapacity) * FRAME_PACKET_COUNT * sizeof(SVertex2D);
+	const GLsizeiptr lIndexSize = static_cast<GLsizeiptr>(uiIndexCapacity) * FRAME_PACKET_COUNT * sizeof(GLuint);
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hVertexBuffer = resourceManager.CreateBuffer(lVertexSize, nullptr, uiFlags);
+	m_hIndexBuffer = resourceManager.CreateBuffer(lIndexSize, nullptr, uiFlags);
+
+	const TBufferResource* pVertexBuffer = resourceManager.GetBuffer(m_hVertexBuffer);
+	const TBufferResource* pIndexBuffer = resourceManager.GetBuffer(m_hIndexBuffer);
+	if (pVertexBuffer == nullptr || pIndexBuffer == nullptr)
+	{
+		syserr("Failed to create the 2D buffers for %u vertices", uiVertexCapacity);
+		Destroy();
+		return (false);
+	}
+
+	m_pVertices = static_cast<SVertex2D*>(glMapNamedBufferRange(pVertexBuffer->m_uiBuffer, 0, lVertexSize, uiFlags));
+	m_pIndices = static_cast<GLuint*>(glMapNamedBufferRange(pIndexBuffer->m_uiBuffer, 0, lIndexSize, uiFlags));
+	if (m_pVertices == nullptr || m_pIndices == nullptr)
+	{
+		syserr("Failed to map the 2D buffers");
+		Destroy();
+		return (false);
+	}
+
+	// SVertex2D, the vertex buffer offset moves to the region every frame
+	glCreateVertexArrays(1, &m_uiVAO);
+
+	glEnableVertexArrayAttrib(m_uiVAO, 0);
+	glVertexArrayAttribFormat(m_uiVAO, 0, 2, GL_FLOAT, GL_FALSE, offsetof(SVertex2D, v2Position));
+	glVertexArrayAttribBinding(m_uiVAO, 0, 0);
+
+	glEnableVertexArrayAttrib(m_uiVAO, 1);
+	glVertexArrayAttribFormat(m_uiVAO, 1, 2, GL_FLOAT, GL_FALSE, offsetof(SVertex2D, v2TexCoord));
+	glVertexArrayAttribBinding(m_uiVAO, 1, 0);
+
+	glEnableVertexArrayAttrib(m_uiVAO, 2);
+	glVertexArrayAttribFormat(m_uiVAO, 2, 4, GL_FLOAT, GL_FALSE, offsetof(SVertex2D, v4Color));
+	glVertexArrayAttribBinding(m_uiVAO, 2, 0);
+
+	glEnableVertexArrayAttrib(m_uiVAO, 3);
+	glVertexArrayAttribIFormat(m_uiVAO, 3, 1, GL_INT, offsetof(SVertex2D, iTextureIndex));
+	glVertexArrayAttribBinding(m_uiVAO, 3, 0);
+
+	glVertexArrayElementBuffer(m_uiVAO, pIndexBuffer->m_uiBuffer);
+
+	m_uiVertexCapacity = uiVertexCapacity;
+	m_uiIndexCapacity = uiIndexCapacity;
+	sysdbg("2D buffers sized for %u vertices and %u indices per frame", uiVertexCapacity, uiIndexCapacity);
+	return (true);
+}
+
+GLuint CRenderer2D::Draw(const TBatch2D& batch, GLint iViewportWidth, GLint iViewportHeight)
+{
+	const GLuint uiVertexCount = static_cast<GLuint>(batch.m_meshData.vVertices.size());
+	const GLuint uiIndexCount = static_cast<GLuint>(batch.m_meshData.vIndices.size());
+	CShader* pShader = CGLResourceManager::Instance().GetShader(batch.m_hShader);
+	if (batch.m_vecDraws.empty() || uiIndexCount == 0 || pShader == nullptr || pShader->IsReady() == false)
+	{
+		return (0);
+	}
+
+	if (Reserve(uiVertexCount, uiIndexCount) == false)
+	{
+		return (0);
+	}
+
+	// the region was last used FRAME_PACKET_COUNT frames ago, this rarely blocks
+	m_fenceRing.AcquireSlot();
+
+	const size_t stFirstVertex = static_cast<size_t>(m_fenceRing.GetSlot()) * m_uiVertexCapacity;
+	const size_t stFirstIndex = static_cast<size_t>(m_fenceRing.GetSlot()) * m_uiIndexCapacity;
+	std::memcpy(static_cast<void*>(m_pVertices + stFirstVertex), batch.m_meshData.vVertices.data(), uiVertexCount * sizeof(SVertex2D));
+	std::memcpy(m_pIndices + stFirstIndex, batch.m_meshData.vIndices.data(), uiIndexCount * sizeof(GLuint));
+
+	// the indices of the batch start at the first vertex of the region
+	glVertexArrayVertexBuffer(m_uiVAO, 0, CGLResourceManager::Instance().GetBuffer(m_hVertexBuffer)->m_uiBuffer,
+		static_cast<GLintptr>(stFirstVertex * sizeof(SVertex2D)), sizeof(SVertex2D));
+
+	pShader->Use();
+	pShader->SetVec2("viewportSize", static_cast<GLfloat>(iViewportWidth), static_cast<GLfloat>(iViewportHeight));
+
+	// looked up again only when the shader was recreated
+	if (pShader->GetProgramID() != m_uiProgram)
+	{
+		m_uiProgram = pShader->GetProgramID();
+		m_iTextureModesLocation = glGetUniformLocation(m_uiProgram, "textureModes");
+	}
+
+	// over the finished scene, in the order End() sorted the batch
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_SCISSOR_TEST);
+
+	glBindVertexArray(m_uiVAO);
+
+	CTextureManager& textureManager = CTextureManager::Instance();
+	GLuint uiDrawCount = 0;
+
+	// -1 never matches, the first draw always uploads its modes
+	std::array<GLint, BATCH_2D_TEXTURE_SLOTS> arrUploadedModes;
+	arrUploadedModes.fill(-1);
+
+	for (const TDraw2D& draw : batch.m_vecDraws)
+	{
+		std::array<GLint, BATCH_2D_TEXTURE_SLOTS> arrModes{};
+		for (GLint i = 0; i < BATCH_2D_TEXTURE_SLOTS; i++)
+		{
+			const GLint iTexture = draw.m_arrTextures[i];
+			if (iTexture == BATCH_2D_UNTEXTURED)
+			{
+				continue;
+			}
+
+			// the glyph atlas is not a managed texture
+			const TTexture2D& texture = batch.m_vecTextures[iTexture];
+			const GLuint uiTexture = (texture.m_uiFlags & BATCH_2D_TEXTURE_FONT_ATLAS) ? CFontAtlas::Instance().GetTexture() : textureManager.GetTexture(texture.m_hTexture);
+			glBindTextureUnit(i, uiTexture);
+			arrModes[i] = (texture.m_uiFlags & BATCH_2D_TEXTURE_SDF) ? 1 : 0;
+		}
+
+		if (arrModes != arrUploadedModes)
+		{
+			glUniform1iv(m_iTextureModesLocation, BATCH_2D_TEXTURE_SLOTS, arrModes.data());
+			arrUploadedModes = arrModes;
+		}
+
+		// clip rectangles grow down from the top left, the scissor box up from the bottom left
+		const GLint iX = static_cast<GLint>(draw.m_v4ClipRect.x);
+		const GLint iY = static_cast<GLint>(draw.m_v4ClipRect.y);
+		const GLint iWidth = static_cast<GLint>(draw.m_v4ClipRect.z + 0.5f);
+		const GLint iHeight = static_cast<GLint>(draw.m_v4ClipRect.w + 0.5f);
+		glScissor(iX, iViewportHeight - (iY + iHeight), iWidth, iHeight);
+
+		const GLintptr lIndexOffset = static_cast<GLintptr>((stFirstIndex + draw.m_uiFirstIndex) * sizeof(GLuint));
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(draw.m_uiIndexCount), GL_UNSIGNED_INT, reinterpret_cast<const void*>(lIndexOffset));
+		uiDrawCount++;
+	}
+
+	glBindVertexArray(0);
+
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	return (uiDrawCount);
+}
+
+void CRenderer2D::EndFrame()
+{
+	m_fenceRing.EndFrame();
+}
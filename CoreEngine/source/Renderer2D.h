@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "FramePacket.h"
+#include "FenceRing.h"
+
+enum ERenderer2DData
+{
+	// Vertices per frame region before the buffers grow, indices get one and a half times as many
+	RENDERER_2D_INITIAL_CAPACITY = 16384,
+};
+
+/**
+ * Draws the 2D batch of a frame, one glDrawElements per TDraw2D.
+ *
+ * Vertices and indices go to persistently mapped buffers split into
+ * FRAME_PACKET_COUNT regions written round robin, a fence per region keeps
+ * the CPU from overwriting geometry the GPU still reads. The textures of a
+ * draw are bound to units 0 to BATCH_2D_TEXTURE_SLOTS - 1, the vertices pick
+ * one by SVertex2D::iTextureIndex. Render thread only.
+ */
+class CRenderer2D
+{
+public:
+	CRenderer2D();
+	~CRenderer2D();
+
+	CRenderer2D(const CRenderer2D&) = delete;
+	CRenderer2D& operator=(const CRenderer2D&) = delete;
+
+	void Destroy();
+
+	/**
+	 * Blends the batch over the bound framebuffer, depth testing is off and
+	 * every draw is scissored to its clip rectangle.
+	 *
+	 * @return Number of draw calls issued
+	 */
+	GLuint Draw(const TBatch2D& batch, GLint iViewportWidth, GLint iViewportHeight);
+
+	/**
+	 * Fences the region written this frame and moves to the next one.
+	 */
+	void EndFrame();
+
+protected:
+	bool Reserve(GLuint uiVertexCount, GLuint uiIndexCount);
+
+private:
+	BufferHandle m_hVertexBuffer;
+	BufferHandle m_hIndexBuffer;
+	SVertex2D* m_pVertices;
+	GLuint* m_pIndices;
+	GLuint m_uiVAO;
+
+	// The samplers are bound by the shader itself, only the modes change per draw
+	GLuint m_uiProgram;				// program m_iTextureModesLocation belongs to
+	GLint m_iTextureModesLocation;
+
+	GLuint m_uiVertexCapacity;	// per region
+	GLuint m_uiIndexCapacity;
+	CFenceRing m_fenceRing;		// one region per slot
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Index into a resource pool plus the generation of the slot at creation time.
+ * Once the resource is destroyed the slot generation changes, so an old
+ * handle can never silently resolve to whatever reuses the slot.
+ * Generation 0 is never handed out, a default handle is invalid.
+ */
+template <typename TTag> struct THandle
+{
+	GLuint m_uiIndex;
+	GLuint m_uiGeneration;
+
+	THandle()
+	{
+		m_uiIndex = 0;
+		m_uiGeneration = 0;
+	}
+
+	THandle(GLuint uiIndex, GLuint uiGeneration)
+	{
+		m_uiIndex = uiIndex;
+		m_uiGeneration = uiGeneration;
+	}
+
+	bool IsValid() const
+	{
+		return (m_uiGeneration != 0);
+	}
+
+	bool operator==(const THandle& other) const
+	{
+		return (m_uiIndex == other.m_uiIndex) && (m_uiGeneration == other.m_uiGeneration);
+	}
+
+	bool operator!=(const THandle& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Renderer resource handles
+struct SShaderTag;
+struct SBufferTag;
+struct SMeshTag;
+struct SRenderTargetTag;
+struct STextureTag;
+
+typedef THandle<SShaderTag> ShaderHandle;
+typedef THandle<SBufferTag> BufferHandle;
+typedef THandle<SMeshTag> MeshHandle;
+typedef THandle<SRenderTargetTag> RenderTargetHandle;
+typedef THandle<STextureTag> TextureHandle;
+
+/**
+ * Fixed capacity pool storing its objects in one contiguous array.
+ * Free slots are recycled through a free list, objects never move so
+ * pointers returned by Get() stay valid until the object is destroyed.
+ */
+template <typename T, typename THandleType> class TResourcePool
+{
+public:
+	TResourcePool()
+	{
+		m_pStorage = nullptr;
+		m_uiCapacity = 0;
+		m_uiHighestIndex = 0;
+		m_uiAliveCount = 0;
+	}
+
+	~TResourcePool()
+	{
+		Destroy();
+	}
+
+	TResourcePool(const TResourcePool&) = delete;
+	TResourcePool& operator=(const TResourcePool&) = delete;
+
+	void Initialize(GLuint uiCapacity)
+	{
+		Destroy();
+
+		m_uiCapacity = uiCapacity;
+		m_pStorage = static_cast<T*>(::operator new(sizeof(T) * uiCapacity, std::align_val_t(alignof(T) > 16 ? alignof(T) : 16)));
+		m_vecGenerations.assign(uiCapacity, 1);
+		m_vecAlive.assign(uiCapacity, false);
+		m_vecFreeList.reserve(uiCapacity);
+		m_uiHighestIndex = 0;
+		m_uiAliveCount = 0;
+	}
+
+	void Destroy()
+	{
+		if (m_pStorage == nullptr)
+		{
+			return;
+		}
+
+		for (GLuint i = 0; i < m_uiHighestIndex; i++)
+		{
+			if (m_vecAlive[i])
+			{
+				m_pStorage[i].~T();
+			}
+		}
+
+		::operator delete(m_pStorage, std::align_val_t(alignof(T) > 16 ? alignof(T) : 16));
+		m_pStorage = nullptr;
+		m_uiCapacity = 0;
+		m_uiHighestIndex = 0;
+		m_uiAliveCount = 0;
+
+		m_vecGenerations.clear();
+		m_vecAlive.clear();
+		m_vecFreeList.clear();
+	}
+
+	/**
+	 * Constructs a new object in the pool.
+	 *
+	 * @return Handle to the object, invalid if the pool is full
+	 */
+	template <typename... TArgs>
+	THandleType Create(TArgs&&... args)
+	{
+		GLuint uiIndex = 0;
+		if (m_vecFreeList.empty() == false)
+		{
+			uiIndex = m_vecFreeList.back();
+			m_vecFreeList.pop_back();
+		}
+		else if (m_uiHighestIndex < m_uiCapacity)
+		{
+			// grow the used range, keeps live objects packed at the front
+			uiIndex = m_uiHighestIndex++;
+		}
+		else
+		{
+			return THandleType();
+		}
+
+		new (&m_pStorage[uiIndex]) T(std::forward<TArgs>(args)...);
+		m_vecAlive[uiIndex] = true;
+		m_uiAliveCount++;
+
+		return THandleType(uiIndex, m_vecGenerations[uiIndex]);
+	}
+
+	/**
+	 * Destroys the object and retires the handle.
+	 *
+	 * @return false if the handle was stale
+	 */
+	bool Remove(THandleType handle)
+	{
+		if (IsAlive(handle) == false)
+		{
+			return (false);
+		}
+
+		m_pStorage[handle.m_uiIndex].~T();
+		m_vecAlive[handle.m_uiIndex] = false;
+		m_uiAliveCount--;
+
+		// skip 0 on wrap around, it marks invalid handles
+		GLuint& uiGeneration = m_vecGenerations[handle.m_uiIndex];
+		uiGeneration = (uiGeneration + 1 == 0) ? 1 : uiGeneration + 1;
+
+		m_vecFreeList.push_back(handle.m_uiIndex);
+		return (true);
+	}
+
+	bool IsAlive(THandleType handle) const
+	{
+		return (handle.m_uiIndex < m_uiHighestIndex) && m_vecAlive[handle.m_uiIndex] && (m_vecGenerations[handle.m_uiIndex] == handle.m_uiGeneration);
+	}
+
+	/**
+	 * Resolves a handle.
+	 * A frame packet still in flight may legally hold a handle that was
+	 * destroyed meanwhile, callers skip the object when nullptr is returned.
+	 *
+	 * @return Object, or nullptr for an invalid or stale handle
+	 */
+	T* Get(THandleType handle)
+	{
+		if (IsAlive(handle) == false)
+		{
+			return (nullptr);
+		}
+
+		return (&m_pStorage[handle.m_uiIndex]);
+	}
+
+	const T* Get(THandleType handle) const
+	{
+		if (IsAlive(handle) == false)
+		{
+			return (nullptr);
+		}
+
+		return (&m_pStorage[handle.m_uiIndex]);
+	}
+
+	/**
+	 * Calls func(handle, object) for every live object in storage order.
+	 */
+	template <typename TFunc>
+	void ForEach(TFunc func)
+	{
+		for (GLuint i = 0; i < m_uiHighestIndex; i++)
+		{
+			if (m_vecAlive[i])
+			{
+				func(THandleType(i, m_vecGenerations[i]), m_pStorage[i]);
+			}
+		}
+	}
+
+	GLuint GetAliveCount() const
+	{
+		return (m_uiAliveCount);
+	}
+
+	GLuint GetCapacity() const
+	{
+		return (m_uiCapacity);
+	}
+
+private:
+	T* m_pStorage;
+	GLuint m_uiCapacity;
+	GLuint m_uiHighestIndex;
+	GLuint m_uiAliveCount;
+
+	std::vector<GLuint> m_vecGenerations;
+	std::vector<bool> m_vecAlive;
+	std::vector<GLuint> m_vecFreeList;
+};
@@ -49,9 +49,10 @@ void CShader::InitializeShader()
  * Shader type is automatically detected from file extension.
  *
  * @param stShaderPath Path to shader file (.vert, .frag, .geom, etc.)
+ * @param vecCommonPaths Shared sources inserted after the #version line, in order
  * @return true if successfully compiled and attached, false otherwise
  */
-bool CShader::AttachShader(const std::string& stShaderPath)
+bool CShader::AttachShader(const std::string& stShaderPath, const std::vector<std::string>& vecCommonPaths)
 {
 	// Validate program state
 	if (!m_bIsInitialized)
@@ -65,12 +66,6 @@ bool CShader::AttachShader(const std::string& stShaderPath)
 		return false;
 	}
 
-	if (m_bIsCompute)
-	{
-		// IDK YET
-		return (false);
-	}
-
 	// Load shader source from file
 	std::string shaderCode = LoadShaderFromFile(stShaderPath);
 	if (shaderCode.empty())
@@ -79,6 +74,11 @@ bool CShader::AttachShader(const std::string& stShaderPath)
 		return (false);
 	}
 
+	if (PrependCommonSources(shaderCode, vecCommonPaths) == false)
+	{
+		return (false);
+	}
+
 	// Determine shader type from file extension
 	TShaderType shaderType = GetShaderType(stShaderPath);
 	if (shaderType.m_uiType == 0)
@@ -87,6 +87,14 @@ bool CShader::AttachShader(const std::string& stShaderPath)
 		return false;
 	}
 
+	// A compute program holds the compute stage only
+	const bool bIsCompute = (shaderType.m_uiType == GL_COMPUTE_SHADER);
+	if (m_bIsCompute || (bIsCompute && m_vecShaders.empty() == false))
+	{
+		syserr("Cannot attach shader '%s': compute shaders cannot be combined with other stages in '%s'", GetShaderName(stShaderPath).c_str(), m_stName.c_str());
+		return (false);
+	}
+
 	// Compile shader
 	GLuint uiShaderID = glCreateShader(shaderType.m_uiType);
 	const char* shaderCodeStr = shaderCode.c_str();
@@ -103,6 +111,7 @@ bool CShader::AttachShader(const std::string& stShaderPath)
 	// Attach to program
 	glAttachShader(m_uiProgramID, uiShaderID);
 	m_vecShaders.push_back(uiShaderID);
+	m_bIsCompute = bIsCompute;
 
 	syslog("Successfully Attached shader: %s", GetShaderName(stShaderPath).c_str());
 	return (true);
@@ -178,6 +187,32 @@ void CShader::Use()
 	glUseProgram(m_uiProgramID);
 }
 
+/**
+ * Runs a compute program, it has to be in use.
+ *
+ * @param uiGroupsX, uiGroupsY, uiGroupsZ Work groups along each axis
+ */
+void CShader::Dispatch(GLuint uiGroupsX, GLuint uiGroupsY, GLuint uiGroupsZ)
+{
+	if (m_bIsCompute == false || IsReady() == false)
+	{
+		syserr("Cannot dispatch program '%s': not a linked compute program", m_stName.c_str());
+		return;
+	}
+
+	glDispatchCompute(uiGroupsX, uiGroupsY, uiGroupsZ);
+}
+
+/**
+ * Checks if the program is a compute program.
+ *
+ * @return true if a compute shader is attached
+ */
+bool CShader::IsCompute() const
+{
+	return (m_bIsCompute);
+}
+
 /**
  * Gets the OpenGL program ID.
  *
@@ -208,6 +243,23 @@ const std::string& CShader::GetName() const
 	return (m_stName);
 }
 
+/**
+ * Gives up ownership of the program object without deleting it.
+ * Used when the deletion has to wait until the GPU is done with the program.
+ *
+ * @return Program ID, the caller is responsible for deleting it
+ */
+GLuint CShader::ReleaseProgram()
+{
+	const GLuint uiProgramID = m_uiProgramID;
+
+	m_uiProgramID = 0;
+	m_bIsInitialized = false;
+	m_bIsLinked = false;
+
+	return (uiProgramID);
+}
+
 /**
  * Loads shader source code from a file.
  *
@@ -247,6 +299,50 @@ std::string CShader::LoadShaderFromFile(const std::string& stShaderPath)
 	return (shaderCode);
 }
 
+/**
+ * Inserts the shared sources after the #version line of a shader.
+ * A #line directive keeps the error lines of the shader itself.
+ *
+ * @param stShaderCode Shader source, modified in place
+ * @param vecCommonPaths Paths of the shared sources
+ * @return false if a shared source could not be loaded
+ */
+bool CShader::PrependCommonSources(std::string& stShaderCode, const std::vector<std::string>& vecCommonPaths)
+{
+	if (vecCommonPaths.empty())
+	{
+		return (true);
+	}
+
+	// #version has to stay the first statement
+	size_t uiVersionEnd = 0;
+	size_t uiVersionLine = 1;
+	if (stShaderCode.compare(0, 8, "#version") == 0)
+	{
+		uiVersionEnd = stShaderCode.find('\n');
+		uiVersionEnd = (uiVersionEnd == std::string::npos) ? stShaderCode.size() : uiVersionEnd + 1;
+		uiVersionLine = 2;
+	}
+
+	std::string stCommonCode;
+	for (const std::string& stCommonPath : vecCommonPaths)
+	{
+		const std::string stSource = LoadShaderFromFile(stCommonPath);
+		if (stSource.empty())
+		{
+			syserr("Failed to load common shader file: %s", stCommonPath.c_str());
+			return (false);
+		}
+
+		stCommonCode += stSource;
+		stCommonCode += '\n';
+	}
+
+	stCommonCode += "#line " + std::to_string(uiVersionLine) + "\n";
+	stShaderCode.insert(uiVersionEnd, stCommonCode);
+	return (true);
+}
+
 /**
  * Checks for shader compilation or program linking errors.
  * Prints detailed error messages if compilation/linking fails.
@@ -370,9 +466,9 @@ TShaderType CShader::GetShaderType(const std::string& stShaderPath)
  * @param name: The name of the uniform variable in the shader.
  * @param value: The boolean value to be set.
  */
-void CShader::SetBool(const std::string& name, bool value) const
+void CShader::SetBool(const GLchar* name, bool value) const
 {
-	GLuint iboolLoc = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iboolLoc = glGetUniformLocation(GetProgramID(), name);
 	glUniform1i(iboolLoc, (GLuint)value);
 }
 
@@ -386,9 +482,9 @@ void CShader::SetBool(const std::string& name, bool value) const
  * @param value: The integer value to be set.
  *
  */
-void CShader::SetInt(const std::string& name, GLint value) const
+void CShader::SetInt(const GLchar* name, GLint value) const
 {
-	GLuint iIntLoc = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iIntLoc = glGetUniformLocation(GetProgramID(), name);
 	glUniform1i(iIntLoc, value);
 }
 
@@ -403,10 +499,13 @@ void CShader::SetInt(const std::string& name, GLint value) const
  * @param value: The integer value to be set.
  *
  */
-void CShader::SetIntArray(const std::string& name, GLint index, GLint value) const
+void CShader::SetIntArray(const GLchar* name, GLint index, GLint value) const
 {
-	std::string fullName = name + "[" + std::to_string(index) + "]";
-	GLuint iIntLoc = glGetUniformLocation(GetProgramID(), fullName.c_str());
+	// built on the stack, this is called per frame
+	GLchar szFullName[SHADER_UNIFORM_NAME_MAX];
+	snprintf(szFullName, sizeof(szFullName), "%s[%d]", name, index);
+
+	GLuint iIntLoc = glGetUniformLocation(GetProgramID(), szFullName);
 	glUniform1i(iIntLoc, value);
 }
 
@@ -420,9 +519,9 @@ void CShader::SetIntArray(const std::string& name, GLint index, GLint value) con
  * @param value: The float value to be set.
  *
  */
-void CShader::SetFloat(const std::string& name, GLfloat value) const
+void CShader::SetFloat(const GLchar* name, GLfloat value) const
 {
-	GLuint iFloatLoc = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iFloatLoc = glGetUniformLocation(GetProgramID(), name);
 	glUniform1f(iFloatLoc, value);
 }
 
@@ -437,9 +536,9 @@ void CShader::SetFloat(const std::string& name, GLfloat value) const
  * @param value2: The second float value (y-component).
  *
  */
-void CShader::Set2Float(const std::string& name, GLfloat value1, GLfloat value2) const
+void CShader::Set2Float(const GLchar* name, GLfloat value1, GLfloat value2) const
 {
-	GLuint iFloatLoc = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iFloatLoc = glGetUniformLocation(GetProgramID(), name);
 	glUniform2f(iFloatLoc, value1, value2);
 }
 
@@ -453,12 +552,25 @@ void CShader::Set2Float(const std::string& name, GLfloat value1, GLfloat value2)
  * @param x: The x-component of the vector.
  * @param y: The y-component of the vector.
  */
-void CShader::SetVec2(const std::string& name, GLfloat x, GLfloat y) const
+void CShader::SetVec2(const GLchar* name, GLfloat x, GLfloat y) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform2f(iVectorLocation, x, y);
 }
 
+/**
+ * Sets an integer 2D vector uniform in the shader program.
+ *
+ * @param name: The name of the uniform variable in the shader.
+ * @param x: The x-component of the vector.
+ * @param y: The y-component of the vector.
+ */
+void CShader::SetIVec2(const GLchar* name, GLint x, GLint y) const
+{
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
+	glUniform2i(iVectorLocation, x, y);
+}
+
 /**
  * Sets a 3D vector uniform in the shader program using individual components.
  *
@@ -470,9 +582,9 @@ void CShader::SetVec2(const std::string& name, GLfloat x, GLfloat y) const
  * @param y: The y-component of the vector.
  * @param z: The z-component of the vector.
  */
-void CShader::SetVec3(const std::string& name, GLfloat x, GLfloat y, GLfloat z) const
+void CShader::SetVec3(const GLchar* name, GLfloat x, GLfloat y, GLfloat z) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform3f(iVectorLocation, x, y, z);
 }
 
@@ -488,13 +600,13 @@ void CShader::SetVec3(const std::string& name, GLfloat x, GLfloat y, GLfloat z)
  * @param z: The z-component of the vector.
  * @param w: The w-component of the vector.
  */
-void CShader::SetVec4(const std::string& name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
+void CShader::SetVec4(const GLchar* name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform4f(iVectorLocation, x, y, z, w);
 }
 
-void CShader::SetSampler2D(const std::string& name, GLuint iTextureID, GLint iTexValue) const
+void CShader::SetSampler2D(const GLchar* name, GLuint iTextureID, GLint iTexValue) const
 {
 	if (IsGLVersionHigher(4, 5))
 	{
@@ -509,7 +621,7 @@ void CShader::SetSampler2D(const std::string& name, GLuint iTextureID, GLint iTe
 	SetInt(name, iTexValue);
 }
 
-void CShader::SetSampler3D(const std::string& name, GLuint iTexValue, GLint iTextureID) const
+void CShader::SetSampler3D(const GLchar* name, GLuint iTexValue, GLint iTextureID) const
 {
 	if (IsGLVersionHigher(4, 5))
 	{
@@ -534,13 +646,13 @@ void CShader::SetSampler3D(const std::string& name, GLuint iTexValue, GLint iTex
  * @param value: The unsigned integer64 value of texture Handler.
  *
  */
-void CShader::SetBindlessSampler2D(const std::string& name, GLuint64 value) const
+void CShader::SetBindlessSampler2D(const GLchar* name, GLuint64 value) const
 {
-	GLint iIntLoc = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLint iIntLoc = glGetUniformLocation(GetProgramID(), name);
 
 	if (iIntLoc == -1)
 	{
-		syserr("[Shader] Warning: Uniform '%s' not found or optimized out.", name.c_str());
+		syserr("[Shader] Warning: Uniform '%s' not found or optimized out.", name);
 		return;
 	}
 
@@ -556,9 +668,9 @@ void CShader::SetBindlessSampler2D(const std::string& name, GLuint64 value) cons
  * @param name: The name of the uniform variable in the shader.
  * @param vec2: The 2D GLM vector to be set.
  */
-void CShader::SetVec2(const std::string& name, const glm::vec2& vec2) const
+void CShader::SetVec2(const GLchar* name, const glm::vec2& vec2) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform2fv(iVectorLocation, 1, glm::value_ptr(vec2));
 }
 
@@ -571,9 +683,9 @@ void CShader::SetVec2(const std::string& name, const glm::vec2& vec2) const
  * @param name: The name of the uniform variable in the shader.
  * @param vec3: The 3D GLM vector to be set.
  */
-void CShader::SetVec3(const std::string& name, const glm::vec3& vec3) const
+void CShader::SetVec3(const GLchar* name, const glm::vec3& vec3) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform3fv(iVectorLocation, 1, glm::value_ptr(vec3));
 }
 
@@ -586,9 +698,9 @@ void CShader::SetVec3(const std::string& name, const glm::vec3& vec3) const
  * @param name: The name of the uniform variable in the shader.
  * @param vec4: The 4D GLM vector to be set.
  */
-void CShader::SetVec4(const std::string& name, const glm::vec4& vec4) const
+void CShader::SetVec4(const GLchar* name, const glm::vec4& vec4) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform3fv(iVectorLocation, 1, glm::value_ptr(vec4));
 }
 
@@ -601,9 +713,9 @@ void CShader::SetVec4(const std::string& name, const glm::vec4& vec4) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 2x2 GLM matrix to be set.
  */
-void CShader::SetMat2(const std::string& name, const glm::mat2& matrix) const
+void CShader::SetMat2(const GLchar* name, const glm::mat2& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix2fv(iMatLocation, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
@@ -616,9 +728,9 @@ void CShader::SetMat2(const std::string& name, const glm::mat2& matrix) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 3x3 GLM matrix to be set.
  */
-void CShader::SetMat3(const std::string& name, const glm::mat3& matrix) const
+void CShader::SetMat3(const GLchar* name, const glm::mat3& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix3fv(iMatLocation, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
@@ -631,9 +743,9 @@ void CShader::SetMat3(const std::string& name, const glm::mat3& matrix) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 4x4 GLM matrix to be set.
  */
-void CShader::SetMat4(const std::string& name, const glm::mat4& matrix) const
+void CShader::SetMat4(const GLchar* name, const glm::mat4& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix4fv(iMatLocation, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
@@ -646,9 +758,9 @@ void CShader::SetMat4(const std::string& name, const glm::mat4& matrix) const
  * @param name: The name of the uniform variable in the shader.
  * @param vec2: The 2D vector to be set.
  */
-void CShader::SetVec2(const std::string& name, const Vector2D& vec2) const
+void CShader::SetVec2(const GLchar* name, const Vector2D& vec2) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform2fv(iVectorLocation, 1, vec2);
 }
 
@@ -661,9 +773,9 @@ void CShader::SetVec2(const std::string& name, const Vector2D& vec2) const
  * @param name: The name of the uniform variable in the shader.
  * @param vec3: The 3D vector to be set.
  */
-void CShader::SetVec3(const std::string& name, const Vector3D& vec3) const
+void CShader::SetVec3(const GLchar* name, const Vector3D& vec3) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform3fv(iVectorLocation, 1, vec3);
 }
 
@@ -676,12 +788,25 @@ void CShader::SetVec3(const std::string& name, const Vector3D& vec3) const
  * @param name: The name of the uniform variable in the shader.
  * @param vec4: The 4D vector to be set.
  */
-void CShader::SetVec4(const std::string& name, const Vector4D& vec4) const
+void CShader::SetVec4(const GLchar* name, const Vector4D& vec4) const
 {
-	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniform4fv(iVectorLocation, 1, vec4);
 }
 
+/**
+ * Sets a vec4 array uniform in the shader program.
+ *
+ * @param name: The name of the uniform array in the shader.
+ * @param pVectors: The values, stored contiguously.
+ * @param iCount: The number of elements to set.
+ */
+void CShader::SetVec4Array(const GLchar* name, const Vector4D* pVectors, GLsizei iCount) const
+{
+	GLuint iVectorLocation = glGetUniformLocation(GetProgramID(), name);
+	glUniform4fv(iVectorLocation, iCount, &pVectors[0].x);
+}
+
 /**
  * Sets a 2x2 matrix uniform in the shader program.
  *
@@ -691,9 +816,9 @@ void CShader::SetVec4(const std::string& name, const Vector4D& vec4) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 2x2 matrix to be set.
  */
-void CShader::SetMat2(const std::string& name, const Matrix2& matrix) const
+void CShader::SetMat2(const GLchar* name, const Matrix2& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix2fv(iMatLocation, 1, GL_FALSE,(const GLfloat*)matrix);
 }
 
@@ -706,9 +831,9 @@ void CShader::SetMat2(const std::string& name, const Matrix2& matrix) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 3x3 matrix to be set.
  */
-void CShader::SetMat3(const std::string& name, const Matrix3& matrix) const
+void CShader::SetMat3(const GLchar* name, const Matrix3& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix3fv(iMatLocation, 1, GL_FALSE, (const GLfloat*)matrix);
 }
 
@@ -721,8 +846,8 @@ void CShader::SetMat3(const std::string& name, const Matrix3& matrix) const
  * @param name: The name of the uniform variable in the shader.
  * @param matrix: The 4x4 matrix to be set.
  */
-void CShader::SetMat4(const std::string& name, const Matrix4& matrix) const
+void CShader::SetMat4(const GLchar* name, const Matrix4& matrix) const
 {
-	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name.c_str());
+	GLuint iMatLocation = glGetUniformLocation(GetProgramID(), name);
 	glUniformMatrix4fv(iMatLocation, 1, GL_FALSE, (const GLfloat*)matrix);
 }
\ No newline at end of file
@@ -6,6 +6,12 @@
 #include <glm/glm.hpp>
 #include <maths.h>
 
+enum EShaderData
+{
+	// Longest uniform name (including array subscript) built at runtime
+	SHADER_UNIFORM_NAME_MAX = 128,
+};
+
 typedef struct SShaderType
 {
 	std::string m_stName;
@@ -55,9 +61,10 @@ public:
 	 * Shader type is automatically detected from file extension.
 	 *
 	 * @param stShaderPath Path to shader file (.vert, .frag, .geom, etc.)
+	 * @param vecCommonPaths Shared sources inserted after the #version line, in order
 	 * @return true if successfully compiled and attached, false otherwise
 	 */
-	bool AttachShader(const std::string& stShaderPath);
+	bool AttachShader(const std::string& stShaderPath, const std::vector<std::string>& vecCommonPaths = {});
 
 	/**
 	 * Links all attached shaders into a complete program.
@@ -73,6 +80,20 @@ public:
 	 */
 	void Use();
 
+	/**
+	 * Runs a compute program, it has to be in use.
+	 *
+	 * @param uiGroupsX, uiGroupsY, uiGroupsZ Work groups along each axis
+	 */
+	void Dispatch(GLuint uiGroupsX, GLuint uiGroupsY = 1, GLuint uiGroupsZ = 1);
+
+	/**
+	 * Checks if the program is a compute program.
+	 *
+	 * @return true if a compute shader is attached
+	 */
+	bool IsCompute() const;
+
 	/**
 	 * Gets the OpenGL program ID.
 	 *
@@ -94,6 +115,14 @@ public:
 	 */
 	const std::string& GetName() const;
 
+	/**
+	 * Gives up ownership of the program object without deleting it.
+	 * Used when the deletion has to wait until the GPU is done with the program.
+	 *
+	 * @return Program ID, the caller is responsible for deleting it
+	 */
+	GLuint ReleaseProgram();
+
 private:
 	/**
 	 * Loads shader source code from a file.
@@ -103,6 +132,16 @@ private:
 	 */
 	std::string LoadShaderFromFile(const std::string& stShaderPath);
 
+	/**
+	 * Inserts the shared sources after the #version line of a shader.
+	 * A #line directive keeps the error lines of the shader itself.
+	 *
+	 * @param stShaderCode Shader source, modified in place
+	 * @param vecCommonPaths Paths of the shared sources
+	 * @return false if a shared source could not be loaded
+	 */
+	bool PrependCommonSources(std::string& stShaderCode, const std::vector<std::string>& vecCommonPaths);
+
 	/**
 	 * Checks for shader compilation or program linking errors.
 	 * Prints detailed error messages if compilation/linking fails.
@@ -141,33 +180,35 @@ private:
 
 public:
 	/* general utility uniform functions */
-	void SetBool(const std::string& name, bool value) const;
-	void SetInt(const std::string& name, GLint value) const;
-	void SetIntArray(const std::string& name, GLint index, GLint value) const;
-	void SetFloat(const std::string& name, GLfloat value) const;
-	void Set2Float(const std::string& name, GLfloat value1, GLfloat value2) const;
-	void SetVec2(const std::string& name, GLfloat x, GLfloat y) const;
-	void SetVec3(const std::string& name, GLfloat x, GLfloat y, GLfloat z) const;
-	void SetVec4(const std::string& name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
-	void SetSampler2D(const std::string& name, GLuint iTextureID, GLint iTexValue) const;
-	void SetSampler3D(const std::string& name, GLuint iTextureID, GLint iTexValue) const;
-	void SetBindlessSampler2D(const std::string& name, GLuint64 value) const;
+	void SetBool(const GLchar* name, bool value) const;
+	void SetInt(const GLchar* name, GLint value) const;
+	void SetIntArray(const GLchar* name, GLint index, GLint value) const;
+	void SetFloat(const GLchar* name, GLfloat value) const;
+	void Set2Float(const GLchar* name, GLfloat value1, GLfloat value2) const;
+	void SetVec2(const GLchar* name, GLfloat x, GLfloat y) const;
+	void SetIVec2(const GLchar* name, GLint x, GLint y) const;
+	void SetVec3(const GLchar* name, GLfloat x, GLfloat y, GLfloat z) const;
+	void SetVec4(const GLchar* name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
+	void SetSampler2D(const GLchar* name, GLuint iTextureID, GLint iTexValue) const;
+	void SetSampler3D(const GLchar* name, GLuint iTextureID, GLint iTexValue) const;
+	void SetBindlessSampler2D(const GLchar* name, GLuint64 value) const;
 
 	/* glm utility uniform functions */
-	void SetVec2(const std::string& name, const glm::vec2& vec2) const;
-	void SetVec3(const std::string& name, const glm::vec3& vec3) const;
-	void SetVec4(const std::string& name, const glm::vec4& vec4) const;
-	void SetMat2(const std::string& name, const glm::mat2& matrix) const;
-	void SetMat3(const std::string& name, const glm::mat3& matrix) const;
-	void SetMat4(const std::string& name, const glm::mat4& matrix) const;
+	void SetVec2(const GLchar* name, const glm::vec2& vec2) const;
+	void SetVec3(const GLchar* name, const glm::vec3& vec3) const;
+	void SetVec4(const GLchar* name, const glm::vec4& vec4) const;
+	void SetMat2(const GLchar* name, const glm::mat2& matrix) const;
+	void SetMat3(const GLchar* name, const glm::mat3& matrix) const;
+	void SetMat4(const GLchar* name, const glm::mat4& matrix) const;
 
 	/* my math utility uniform functions */
-	void SetVec2(const std::string& name, const Vector2D& vec2) const;
-	void SetVec3(const std::string& name, const Vector3D& vec3) const;
-	void SetVec4(const std::string& name, const Vector4D& vec4) const;
-	void SetMat2(const std::string& name, const Matrix2& matrix) const;
-	void SetMat3(const std::string& name, const Matrix3& matrix) const;
-	void SetMat4(const std::string& name, const Matrix4& matrix) const;
+	void SetVec2(const GLchar* name, const Vector2D& vec2) const;
+	void SetVec3(const GLchar* name, const Vector3D& vec3) const;
+	void SetVec4(const GLchar* name, const Vector4D& vec4) const;
+	void SetVec4Array(const GLchar* name, const Vector4D* pVectors, GLsizei iCount) const;
+	void SetMat2(const GLchar* name, const Matrix2& matrix) const;
+	void SetMat3(const GLchar* name, const Matrix3& matrix) const;
+	void SetMat4(const GLchar* name, const Matrix4& matrix) const;
 
 private:
 	std::string m_stName;               // Program name for debugging
@@ -0,0 +1,138 @@
+#include "SkylineAllocator.h"
+#include <algorithm>
+#include <climits>
+
+CSkylineAllocator::CSkylineAllocator()
+{
+	m_iWidth = 0;
+	m_iHeight = 0;
+	m_lUsedArea = 0;
+}
+
+void CSkylineAllocator::Initialize(GLint iWidth, GLint iHeight)
+{
+	m_iWidth = iWidth;
+	m_iHeight = iHeight;
+	Clear();
+}
+
+void CSkylineAllocator::Clear()
+{
+	// one segment at the bottom spanning the whole width
+	m_vecSegments.clear();
+	m_vecSegments.push_back(TSkylineSegment{ 0, 0, m_iWidth });
+	m_lUsedArea = 0;
+}
+
+GLint CSkylineAllocator::Fit(size_t stSegment, GLint iWidth, GLint iHeight) const
+{
+	const GLint iX = m_vecSegments[stSegment].m_iX;
+	if (iX + iWidth > m_iWidth)
+	{
+		return (-1);
+	}
+
+	// the rectangle rests on the highest segment it spans
+	GLint iY = 0;
+	GLint iRemaining = iWidth;
+	for (size_t i = stSegment; iRemaining > 0; i++)
+	{
+		iY = std::max(iY, m_vecSegments[i].m_iY);
+		if (iY + iHeight > m_iHeight)
+		{
+			return (-1);
+		}
+
+		iRemaining -= m_vecSegments[i].m_iWidth;
+	}
+
+	return (iY);
+}
+
+bool CSkylineAllocator::Allocate(GLint iWidth, GLint iHeight, GLint& iX, GLint& iY)
+{
+	if (iWidth <= 0 || iHeight <= 0)
+	{
+		return (false);
+	}
+
+	// lowest top first, then the narrowest segment to keep wide ones for wide rectangles
+	size_t stBest = m_vecSegments.size();
+	GLint iBestTop = INT_MAX;
+	GLint iBestWidth = INT_MAX;
+	for (size_t i = 0; i < m_vecSegments.size(); i++)
+	{
+		const GLint iFitY = Fit(i, iWidth, iHeight);
+		if (iFitY < 0)
+		{
+			continue;
+		}
+
+		const GLint iTop = iFitY + iHeight;
+		if (iTop < iBestTop || (iTop == iBestTop && m_vecSegments[i].m_iWidth < iBestWidth))
+		{
+			stBest = i;
+			iBestTop = iTop;
+			iBestWidth = m_vecSegments[i].m_iWidth;
+			iY = iFitY;
+		}
+	}
+
+	if (stBest == m_vecSegments.size())
+	{
+		return (false);
+	}
+
+	iX = m_vecSegments[stBest].m_iX;
+
+	// the new segment covers the rectangle, the ones under it shrink or go away
+	m_vecSegments.insert(m_vecSegments.begin() + stBest, TSkylineSegment{ iX, iBestTop, iWidth });
+
+	const GLint iRight = iX + iWidth;
+	size_t i = stBest + 1;
+	while (i < m_vecSegments.size() && m_vecSegments[i].m_iX < iRight)
+	{
+		TSkylineSegment& segment = m_vecSegments[i];
+		const GLint iShrink = iRight - segment.m_iX;
+		if (segment.m_iWidth <= iShrink)
+		{
+			m_vecSegments.erase(m_vecSegments.begin() + i);
+			continue;
+		}
+
+		segment.m_iX += iShrink;
+		segment.m_iWidth -= iShrink;
+		break;
+	}
+
+	// neighbours at the same height become one segment
+	for (i = 0; i + 1 < m_vecSegments.size();)
+	{
+		if (m_vecSegments[i].m_iY == m_vecSegments[i + 1].m_iY)
+		{
+			m_vecSegments[i].m_iWidth += m_vecSegments[i + 1].m_iWidth;
+			m_vecSegments.erase(m_vecSegments.begin() + i + 1);
+			continue;
+		}
+		i++;
+	}
+
+	m_lUsedArea += static_cast<GLint64>(iWidth) * iHeight;
+	return (true);
+}
+
+GLint CSkylineAllocator::GetWidth() const
+{
+	return (m_iWidth);
+}
+
+GLint CSkylineAllocator::GetHeight() const
+{
+	return (m_iHeight);
+}
+
+GLfloat CSkylineAllocator::GetOccupancy() const
+{
+	const GLint64 lArea = static_cast<GLint64>(m_iWidth) * m_iHeight;
+	return (lArea > 0 ? static_cast<GLfloat>(m_lUsedArea) / static_cast<GLfloat>(lArea) : 0.0f);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Rectangle packer for texture atlases. The free space is tracked as a
+ * skyline, the top edge of the packed rectangles seen from the bottom of the
+ * atlas, one segment per distinct height. A rectangle goes where it raises
+ * the skyline the least (bottom left heuristic), narrow segments left under
+ * it are wasted. Cheap enough to pack glyphs one by one as they show up.
+ *
+ * y grows away from the origin row, like texture rows.
+ */
+class CSkylineAllocator
+{
+public:
+	CSkylineAllocator();
+
+	void Initialize(GLint iWidth, GLint iHeight);
+
+	/**
+	 * Forgets every rectangle.
+	 */
+	void Clear();
+
+	/**
+	 * @return false if the rectangle fits nowhere, the atlas is full
+	 */
+	bool Allocate(GLint iWidth, GLint iHeight, GLint& iX, GLint& iY);
+
+	GLint GetWidth() const;
+	GLint GetHeight() const;
+
+	/**
+	 * Fraction of the atlas covered by rectangles.
+	 */
+	GLfloat GetOccupancy() const;
+
+protected:
+	/**
+	 * @return y of a rectangle starting at the segment, -1 if it does not fit
+	 */
+	GLint Fit(size_t stSegment, GLint iWidth, GLint iHeight) const;
+
+private:
+	typedef struct SSkylineSegment
+	{
+		GLint m_iX;
+		GLint m_iY;			// first free row above the segment
+		GLint m_iWidth;
+	} TSkylineSegment;
+
+	std::vector<TSkylineSegment> m_vecSegments;		// sorted by x, no gaps
+	GLint m_iWidth;
+	GLint m_iHeight;
+	GLint64 m_lUsedArea;
+};
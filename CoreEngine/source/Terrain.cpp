@@ -0,0 +1,181 @@
+#include "Terrain.h"
+#include "GeometryPool.h"
+#include "JobSystem.h"
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+
+CTerrain::CTerrain()
+{
+	Initialize();
+}
+
+CTerrain::~CTerrain()
+{
+	Clear();
+}
+
+void CTerrain::Initialize()
+{
+	m_vecPatches.clear();
+	m_iPatchesX = 0;
+	m_iPatchesZ = 0;
+	m_iFirstIndex = -1;
+	m_uiMaterial = 0;
+}
+
+void CTerrain::Clear()
+{
+	// the geometry pool owns the GPU data, it is released with the pool
+	Initialize();
+}
+
+bool CTerrain::InitializeTerrain(GLint iCellsX, GLint iCellsZ, GLuint uiSeed)
+{
+	ANUBIS_ZONE("Terrain::Build");
+
+	if (iCellsX <= 0 || iCellsZ <= 0)
+	{
+		syserr("Invalid terrain size %dx%d", iCellsX, iCellsZ);
+		return (false);
+	}
+
+	Clear();
+
+	m_iPatchesX = (iCellsX + PATCH_XSIZE - 1) / PATCH_XSIZE;
+	m_iPatchesZ = (iCellsZ + PATCH_ZSIZE - 1) / PATCH_ZSIZE;
+	if (m_iPatchesX * PATCH_XSIZE != iCellsX || m_iPatchesZ * PATCH_ZSIZE != iCellsZ)
+	{
+		syslog("Terrain size %dx%d rounded up to %dx%d cells", iCellsX, iCellsZ, m_iPatchesX * PATCH_XSIZE, m_iPatchesZ * PATCH_ZSIZE);
+	}
+
+	const GLuint uiPatchCount = static_cast<GLuint>(m_iPatchesX * m_iPatchesZ);
+	m_vecPatches.resize(uiPatchCount);
+
+	// CPU side data is only needed until the upload, megabytes for large
+	// grids, too big for the scratch arena and built once at load
+	std::vector<TerrainVertex> vecVertices;
+	std::vector<GLuint> vecIndices;
+	vecVertices.resize(static_cast<size_t>(uiPatchCount) * PATCH_VERTEX_COUNT);
+
+	// Patches are independent, build them on the job system
+	CTerrainPatch* pPatches = m_vecPatches.data();
+	TerrainVertex* pVertices = vecVertices.data();
+	const GLint iPatchesX = m_iPatchesX;
+
+	CJobSystem::Instance().ParallelFor(uiPatchCount, [pPatches, pVertices, iPatchesX, uiSeed](GLuint uiStart, GLuint uiEnd)
+	{
+		for (GLuint i = uiStart; i < uiEnd; i++)
+		{
+			const GLint iOriginX = (static_cast<GLint>(i) % iPatchesX) * PATCH_XSIZE;
+			const GLint iOriginZ = (static_cast<GLint>(i) / iPatchesX) * PATCH_ZSIZE;
+			pPatches[i].InitializePatch(iOriginX, iOriginZ, uiSeed, pVertices + static_cast<size_t>(i) * PATCH_VERTEX_COUNT);
+		}
+	}, TERRAIN_PATCHES_PER_JOB);
+
+	CTerrainPatch::InitializeIndices(vecIndices);
+
+	// one upload for the whole grid, patch i starts PATCH_VERTEX_COUNT vertices after patch i - 1
+	CGeometryPool& geometryPool = CGeometryPool::Instance();
+	const GLint iBaseVertex = geometryPool.AllocateVertices(vecVertices.data(), static_cast<GLuint>(vecVertices.size()));
+	m_iFirstIndex = geometryPool.AllocateIndices(vecIndices.data(), static_cast<GLuint>(vecIndices.size()));
+
+	if (iBaseVertex < 0 || m_iFirstIndex < 0)
+	{
+		syserr("Failed to upload the terrain to the geometry pool");
+		Clear();
+		return (false);
+	}
+
+	for (GLuint i = 0; i < uiPatchCount; i++)
+	{
+		m_vecPatches[i].SetBaseVertex(iBaseVertex + static_cast<GLint>(i * PATCH_VERTEX_COUNT));
+	}
+
+	syslog("Terrain built with %u patches", uiPatchCount);
+	return (true);
+}
+
+void CTerrain::GetRequiredGeometry(GLint iCellsX, GLint iCellsZ, GLuint& uiVertexCount, GLuint& uiIndexCount)
+{
+	const GLuint uiPatchesX = static_cast<GLuint>(std::max(iCellsX, 0) + PATCH_XSIZE - 1) / PATCH_XSIZE;
+	const GLuint uiPatchesZ = static_cast<GLuint>(std::max(iCellsZ, 0) + PATCH_ZSIZE - 1) / PATCH_ZSIZE;
+
+	uiVertexCount = uiPatchesX * uiPatchesZ * PATCH_VERTEX_COUNT;
+	uiIndexCount = PATCH_INDEX_COUNT;
+}
+
+void CTerrain::SetMaterial(GLuint uiMaterial)
+{
+	m_uiMaterial = uiMaterial;
+}
+
+GLuint CTerrain::BuildDrawCommands(const CFrustum& frustum, TIndirectBatch& batch) const
+{
+	ANUBIS_ZONE("Terrain::BuildDrawCommands");
+
+	if (m_iFirstIndex < 0)
+	{
+		return (0);
+	}
+
+	GLuint uiVisibleCount = 0;
+	for (const CTerrainPatch& patch : m_vecPatches)
+	{
+		if (frustum.IsBoxVisible(patch.GetBoundsMin(), patch.GetBoundsMax()) == false)
+		{
+			continue;
+		}
+
+		TDrawElementsIndirectCommand command{};
+		command.m_uiCount = PATCH_INDEX_COUNT;
+		command.m_uiInstanceCount = 1;
+		command.m_uiFirstIndex = static_cast<GLuint>(m_iFirstIndex);
+		command.m_iBaseVertex = patch.GetBaseVertex();
+		command.m_uiBaseInstance = 0;
+
+		batch.m_vecCommands.push_back(command);
+		batch.m_vecDrawData.push_back(TIndirectDrawData{ patch.GetModelMatrix(), m_uiMaterial, {} });
+		uiVisibleCount++;
+	}
+
+	return (uiVisibleCount);
+}
+
+void CTerrain::AddToCullingScene(CCullingScene& cullingScene) const
+{
+	if (m_iFirstIndex < 0)
+	{
+		return;
+	}
+
+	for (const CTerrainPatch& patch : m_vecPatches)
+	{
+		TDrawElementsIndirectCommand command{};
+		command.m_uiCount = PATCH_INDEX_COUNT;
+		command.m_uiFirstIndex = static_cast<GLuint>(m_iFirstIndex);
+		command.m_iBaseVertex = patch.GetBaseVertex();
+
+		cullingScene.AddObject(patch.GetBoundsMin(), patch.GetBoundsMax(), command, TIndirectDrawData{ patch.GetModelMatrix(), m_uiMaterial, {} });
+	}
+}
+
+GLuint CTerrain::GetMaterial() const
+{
+	return (m_uiMaterial);
+}
+
+GLuint CTerrain::GetPatchCount() const
+{
+	return static_cast<GLuint>(m_vecPatches.size());
+}
+
+GLint CTerrain::GetPatchesX() const
+{
+	return (m_iPatchesX);
+}
+
+GLint CTerrain::GetPatchesZ() const
+{
+	return (m_iPatchesZ);
+}
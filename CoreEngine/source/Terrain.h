@@ -0,0 +1,70 @@
+#pragma once
+
+#include <maths.h>
+#include <vector>
+#include "TerrainPatch.h"
+#include "FramePacket.h"
+#include "Frustum.h"
+#include "CullingScene.h"
+
+/**
+ * Grid of terrain patches stored in the geometry pool.
+ * All patches share one index range, each visible patch becomes one indirect
+ * command so the whole terrain is drawn with a single multi draw call.
+ */
+class CTerrain
+{
+public:
+	CTerrain();
+	~CTerrain();
+
+	void Initialize();
+	void Clear();
+
+	/**
+	 * Builds the patches and uploads them to the geometry pool.
+	 * The size is rounded up to whole patches.
+	 *
+	 * @param uiSeed 0 builds a flat terrain, anything else a deterministic heightmap
+	 */
+	bool InitializeTerrain(GLint iCellsX, GLint iCellsZ, GLuint uiSeed);
+
+	/**
+	 * Geometry pool storage InitializeTerrain needs for the given size.
+	 */
+	static void GetRequiredGeometry(GLint iCellsX, GLint iCellsZ, GLuint& uiVertexCount, GLuint& uiIndexCount);
+
+	/**
+	 * Material ID written into the draw data of every patch, set before the
+	 * patches are added to the culling scene.
+	 */
+	void SetMaterial(GLuint uiMaterial);
+
+	/**
+	 * Appends one command per patch intersecting the frustum.
+	 *
+	 * @return Number of commands added
+	 */
+	GLuint BuildDrawCommands(const CFrustum& frustum, TIndirectBatch& batch) const;
+
+	/**
+	 * Adds every patch to the scene so it can be culled on the GPU instead.
+	 */
+	void AddToCullingScene(CCullingScene& cullingScene) const;
+
+	// Accessors
+	GLuint GetMaterial() const;
+	GLuint GetPatchCount() const;
+	GLint GetPatchesX() const;
+	GLint GetPatchesZ() const;
+
+private:
+	std::vector<CTerrainPatch> m_vecPatches;
+	GLint m_iPatchesX;
+	GLint m_iPatchesZ;
+
+	// shared index pattern in the geometry pool
+	GLint m_iFirstIndex;
+
+	GLuint m_uiMaterial;
+};
@@ -1,4 +1,8 @@
 #include "TerrainPatch.h"
+#include <utils.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 
 CTerrainPatch::CTerrainPatch()
 {
@@ -13,135 +17,173 @@ CTerrainPatch::~CTerrainPatch()
 void CTerrainPatch::Initialize()
 {
 	// patch properties
-	m_iPatchWidth = 0;
-	m_iPatchDepth = 0;
+	m_iOriginX = 0;
+	m_iOriginZ = 0;
 
-	// OpenGL properties
-	m_uiVAO = 0;
-	m_uiVBO = 0;
-	m_uiEBO = 0;
+	m_iBaseVertex = -1;
+
+	m_mat4Model.InitIdentity();
+	m_v3BoundsMin = 0.0f;
+	m_v3BoundsMax = 0.0f;
 }
 
 void CTerrainPatch::Clear()
 {
-	// patch properties
-	m_iPatchWidth = 0;
-	m_iPatchDepth = 0;
-
-	// OpenGL properties
-	if (m_uiVAO)
-	{
-		glDeleteVertexArrays(1, &m_uiVAO);
-		m_uiVAO = 0;
-	}
-	if (m_uiVBO)
-	{
-		glDeleteBuffers(1, &m_uiVBO);
-		m_uiVBO = 0;
-	}
-	if (m_uiEBO)
-	{
-		glDeleteBuffers(1, &m_uiEBO);
-		m_uiEBO = 0;
-	}
-
-	m_vecVertices.clear();
-	m_vecIndices.clear();
+	// the vertices belong to the geometry pool, nothing to release
+	Initialize();
 }
 
-void CTerrainPatch::InitializePatch()
+void CTerrainPatch::InitializePatch(GLint iOriginX, GLint iOriginZ, GLuint uiSeed, TerrainVertex* pVertices)
 {
-	m_iPatchWidth = ETerrainData::PATCH_XSIZE + 1;
-	m_iPatchDepth = ETerrainData::PATCH_ZSIZE + 1;
+	m_iOriginX = iOriginX;
+	m_iOriginZ = iOriginZ;
 
-	InitializeVertices();
-	InitializeIndices();
+	const GLfloat fOriginX = static_cast<GLfloat>(iOriginX * CELL_SCALE);
+	const GLfloat fOriginZ = static_cast<GLfloat>(iOriginZ * CELL_SCALE);
 
-	InitializeOpenGLData();
-}
+	GLfloat fMinY = 0.0f;
+	GLfloat fMaxY = 0.0f;
 
-void CTerrainPatch::InitializeVertices()
-{
-	m_vecVertices.reserve(PATCH_VERTEX_COUNT);
-
-	for (GLint iZ = 0; iZ < m_iPatchDepth; iZ++)
+	for (GLint iZ = 0; iZ <= PATCH_ZSIZE; iZ++)
 	{
-		for (GLint iX = 0; iX < m_iPatchWidth; iX++)
+		for (GLint iX = 0; iX <= PATCH_XSIZE; iX++)
 		{
 			GLfloat fX = static_cast<GLfloat>(iX * CELL_SCALE);
-			GLfloat fY = 0.0f;
 			GLfloat fZ = static_cast<GLfloat>(iZ * CELL_SCALE);
 
+			// sampled in world space so neighbouring patches share their edges
+			GLfloat fY = SampleHeight(fOriginX + fX, fOriginZ + fZ, uiSeed);
 
-			TerrainVertex vertex{};
+			TerrainVertex& vertex = pVertices[iZ * (PATCH_XSIZE + 1) + iX];
 			vertex.m_v3Position = Vector3D(fX, fY, fZ);
-			vertex.m_v2TexCoords = Vector2D(iX / PATCH_XSIZE, iZ / PATCH_ZSIZE);
+			vertex.m_v2TexCoords = Vector2D(static_cast<GLfloat>(iX) / static_cast<GLfloat>(PATCH_XSIZE), static_cast<GLfloat>(iZ) / static_cast<GLfloat>(PATCH_ZSIZE));
 			vertex.m_v3Normals = Vector3D(0.0f);
-				
-			m_vecVertices.push_back(vertex);
+
+			fMinY = (iX == 0 && iZ == 0) ? fY : std::min(fMinY, fY);
+			fMaxY = (iX == 0 && iZ == 0) ? fY : std::max(fMaxY, fY);
 		}
 	}
 
-	assert(m_vecVertices.size() == PATCH_VERTEX_COUNT);
+	m_mat4Model.InitIdentity();
+	m_mat4Model[3] = Vector4D(fOriginX, 0.0f, fOriginZ, 1.0f);
+
+	m_v3BoundsMin = Vector3D(fOriginX, fMinY, fOriginZ);
+	m_v3BoundsMax = Vector3D(fOriginX + PATCH_XSIZE * CELL_SCALE, fMaxY, fOriginZ + PATCH_ZSIZE * CELL_SCALE);
 }
 
-void CTerrainPatch::InitializeIndices()
+void CTerrainPatch::SetBaseVertex(GLint iBaseVertex)
 {
-	m_vecIndices.reserve(PATCH_XSIZE * PATCH_ZSIZE * 6);
+	m_iBaseVertex = iBaseVertex;
+}
 
-	for (GLint iZ = 0; iZ < m_iPatchDepth - 1; iZ++)
-	{
-		for (GLint iX = 0; iX < m_iPatchWidth - 1; iX++)
-		{
-			GLint iTopLeft = iZ * m_iPatchWidth + iX;
-			GLint iTopRight = iZ * m_iPatchWidth + (iX + 1);
-			GLint iBottomLeft = (iZ + 1) * m_iPatchWidth + iX;
-			GLint iBottomRight = (iZ + 1) * m_iPatchWidth + (iX + 1);
+GLint CTerrainPatch::GetBaseVertex() const
+{
+	return (m_iBaseVertex);
+}
 
-			// First Triangle
-			m_vecIndices.push_back(iTopLeft);
-			m_vecIndices.push_back(iBottomLeft);
-			m_vecIndices.push_back(iTopRight);
+const Matrix4& CTerrainPatch::GetModelMatrix() const
+{
+	return (m_mat4Model);
+}
 
-			// Second Triangle
-			m_vecIndices.push_back(iTopRight);
-			m_vecIndices.push_back(iBottomLeft);
-			m_vecIndices.push_back(iBottomRight);
-		}
-	}
+const Vector3D& CTerrainPatch::GetBoundsMin() const
+{
+	return (m_v3BoundsMin);
+}
+
+const Vector3D& CTerrainPatch::GetBoundsMax() const
+{
+	return (m_v3BoundsMax);
+}
+
+/**
+ * Integer hash of a lattice point, gives the same value on every platform.
+ */
+static GLuint HashLattice(GLint iX, GLint iZ, GLuint uiSeed)
+{
+	GLuint uiHash = uiSeed * 0x9E3779B9u;
+	uiHash ^= static_cast<GLuint>(iX) * 0x85EBCA6Bu;
+	uiHash = (uiHash << 13) | (uiHash >> 19);
+	uiHash ^= static_cast<GLuint>(iZ) * 0xC2B2AE35u;
+	uiHash ^= uiHash >> 16;
+	uiHash *= 0x7FEB352Du;
+	uiHash ^= uiHash >> 15;
+	uiHash *= 0x846CA68Bu;
+	uiHash ^= uiHash >> 16;
+	return (uiHash);
+}
+
+static GLfloat ValueNoise(GLfloat fX, GLfloat fZ, GLuint uiSeed)
+{
+	const GLfloat fCellX = std::floor(fX);
+	const GLfloat fCellZ = std::floor(fZ);
+	const GLint iX = static_cast<GLint>(fCellX);
+	const GLint iZ = static_cast<GLint>(fCellZ);
+
+	// smoothstep between the four corners
+	GLfloat fU = fX - fCellX;
+	GLfloat fV = fZ - fCellZ;
+	fU = fU * fU * (3.0f - 2.0f * fU);
+	fV = fV * fV * (3.0f - 2.0f * fV);
+
+	const GLfloat fScale = 1.0f / 4294967295.0f;
+	const GLfloat f00 = HashLattice(iX, iZ, uiSeed) * fScale;
+	const GLfloat f10 = HashLattice(iX + 1, iZ, uiSeed) * fScale;
+	const GLfloat f01 = HashLattice(iX, iZ + 1, uiSeed) * fScale;
+	const GLfloat f11 = HashLattice(iX + 1, iZ + 1, uiSeed) * fScale;
+
+	const GLfloat fTop = f00 + (f10 - f00) * fU;
+	const GLfloat fBottom = f01 + (f11 - f01) * fU;
+	return (fTop + (fBottom - fTop) * fV);
 }
 
-void CTerrainPatch::InitializeOpenGLData()
+GLfloat CTerrainPatch::SampleHeight(GLfloat fX, GLfloat fZ, GLuint uiSeed)
 {
-	// create Vertex Array
-	glCreateVertexArrays(1, &m_uiVAO);
+	if (uiSeed == 0)
+	{
+		return (0.0f);
+	}
 
-	// create vertex buffer object
-	glCreateBuffers(1, &m_uiVBO);
+	// fractal sum of value noise, each octave doubles the frequency and halves the amplitude
+	GLfloat fHeight = 0.0f;
+	GLfloat fAmplitude = 0.5f;
+	GLfloat fFrequency = 1.0f / static_cast<GLfloat>(TERRAIN_NOISE_PERIOD);
 
-	const GLsizeiptr vertexBufferSize = m_vecVertices.size() * sizeof(TerrainVertex);
-	glNamedBufferStorage(m_uiVBO, vertexBufferSize, m_vecVertices.data(), GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+	for (GLint iOctave = 0; iOctave < TERRAIN_NOISE_OCTAVES; iOctave++)
+	{
+		fHeight += ValueNoise(fX * fFrequency, fZ * fFrequency, uiSeed + iOctave) * fAmplitude;
+		fAmplitude *= 0.5f;
+		fFrequency *= 2.0f;
+	}
 
-	// create element buffer object
-	glCreateBuffers(1, &m_uiEBO);
+	return (fHeight * static_cast<GLfloat>(TERRAIN_HEIGHT_SCALE));
+}
 
-	const GLsizeiptr indexBufferSize = m_vecIndices.size() * sizeof(GLuint);
-	glNamedBufferStorage(m_uiEBO, indexBufferSize, m_vecIndices.data(), GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+void CTerrainPatch::InitializeIndices(std::vector<GLuint>& vecIndices)
+{
+	const GLint iPatchWidth = PATCH_XSIZE + 1;
+	vecIndices.reserve(PATCH_INDEX_COUNT);
 
-	// Attach Buffers to our Vertex Arrays
-	glVertexArrayVertexBuffer(m_uiVAO, 0, m_uiVBO, 0, sizeof(TerrainVertex)); // attach vertex buffer
-	glVertexArrayElementBuffer(m_uiVAO, m_uiEBO); // element buffer
+	for (GLint iZ = 0; iZ < PATCH_ZSIZE; iZ++)
+	{
+		for (GLint iX = 0; iX < PATCH_XSIZE; iX++)
+		{
+			GLint iTopLeft = iZ * iPatchWidth + iX;
+			GLint iTopRight = iZ * iPatchWidth + (iX + 1);
+			GLint iBottomLeft = (iZ + 1) * iPatchWidth + iX;
+			GLint iBottomRight = (iZ + 1) * iPatchWidth + (iX + 1);
 
-	// vertex array attributes
-	glEnableVertexArrayAttrib(m_uiVAO, 0);
-	glVertexArrayAttribFormat(m_uiVAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v3Position)); // Position Attribute
-	glVertexArrayAttribBinding(m_uiVAO, 0, 0);
+			// First Triangle
+			vecIndices.push_back(iTopLeft);
+			vecIndices.push_back(iBottomLeft);
+			vecIndices.push_back(iTopRight);
 
-	glEnableVertexArrayAttrib(m_uiVAO, 1);
-	glVertexArrayAttribFormat(m_uiVAO, 1, 2, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v2TexCoords)); // textures coords Attribute
-	glVertexArrayAttribBinding(m_uiVAO, 1, 0);
+			// Second Triangle
+			vecIndices.push_back(iTopRight);
+			vecIndices.push_back(iBottomLeft);
+			vecIndices.push_back(iBottomRight);
+		}
+	}
 
-	glEnableVertexArrayAttrib(m_uiVAO, 2);
-	glVertexArrayAttribFormat(m_uiVAO, 2, 3, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, m_v3Normals)); // Normals Attribute
-	glVertexArrayAttribBinding(m_uiVAO, 2, 0);
+	assert(vecIndices.size() == PATCH_INDEX_COUNT);
 }
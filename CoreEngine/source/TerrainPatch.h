@@ -9,10 +9,24 @@ enum ETerrainData
 	PATCH_ZSIZE = 16,
 
 	PATCH_VERTEX_COUNT = (PATCH_XSIZE + 1) * (PATCH_ZSIZE + 1),
+	PATCH_INDEX_COUNT = PATCH_XSIZE * PATCH_ZSIZE * 6,
 
 	CELL_SCALE = 2,
+
+	// Smallest amount of patches generated by a single job
+	TERRAIN_PATCHES_PER_JOB = 4,
+
+	// Procedural heightmap, only used with a non zero seed
+	TERRAIN_HEIGHT_SCALE = 48,		// world units between the lowest and highest point
+	TERRAIN_NOISE_PERIOD = 64,		// cells per lattice step of the first octave
+	TERRAIN_NOISE_OCTAVES = 5,
 };
 
+/**
+ * PATCH_XSIZE x PATCH_ZSIZE cells of the terrain grid.
+ * The vertices live in the geometry pool, every patch uses the same index
+ * pattern and only differs by its base vertex and model matrix.
+ */
 class CTerrainPatch
 {
 public:
@@ -22,24 +36,44 @@ public:
 	void Initialize();
 	void Clear();
 
-	void InitializePatch();
+	/**
+	 * Fills the PATCH_VERTEX_COUNT vertices of the patch, positions are
+	 * relative to the patch origin which is placed by the model matrix.
+	 *
+	 * @param iOriginX, iOriginZ First cell of the patch in the terrain grid
+	 * @param uiSeed 0 builds a flat patch, anything else a deterministic heightmap
+	 * @param pVertices Destination for the patch vertices
+	 */
+	void InitializePatch(GLint iOriginX, GLint iOriginZ, GLuint uiSeed, TerrainVertex* pVertices);
+
+	/**
+	 * Index pattern shared by all patches, relative to the base vertex.
+	 */
+	static void InitializeIndices(std::vector<GLuint>& vecIndices);
+
+	/**
+	 * Height of the procedural heightmap, the same seed always gives the same terrain.
+	 */
+	static GLfloat SampleHeight(GLfloat fX, GLfloat fZ, GLuint uiSeed);
+
+	void SetBaseVertex(GLint iBaseVertex);
 
-protected:
-	void InitializeVertices();
-	void InitializeIndices();
-	void InitializeOpenGLData();
+	// Accessors
+	GLint GetBaseVertex() const;
+	const Matrix4& GetModelMatrix() const;
+	const Vector3D& GetBoundsMin() const;
+	const Vector3D& GetBoundsMax() const;
 
 private:
 	// patch properties
-	GLint m_iPatchWidth;
-	GLint m_iPatchDepth;
+	GLint m_iOriginX;
+	GLint m_iOriginZ;
 
-	// OpenGL properties
-	GLuint m_uiVAO;
-	GLuint m_uiVBO;
-	GLuint m_uiEBO;
+	// first vertex in the geometry pool
+	GLint m_iBaseVertex;
 
-	// patch vertex data
-	std::vector<TerrainVertex> m_vecVertices;
-	std::vector<GLuint> m_vecIndices;
+	// world placement, the bounds are in world space
+	Matrix4 m_mat4Model;
+	Vector3D m_v3BoundsMin;
+	Vector3D m_v3BoundsMax;
 };
\ No newline at end of file
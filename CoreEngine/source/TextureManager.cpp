@@ -0,0 +1,685 @@
+#include "TextureManager.h"
+#include "GLResourceManager.h"
+#include "CPUProfiler.h"
+#include "JobSystem.h"
+#include <utils.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+CTextureManager::CTextureManager()
+{
+	m_bIsRunning = false;
+	m_ubCompression = ANUBIS_WITH_COMPRESSONATOR ? TEXTURE_COMPRESSION_BC7 : TEXTURE_COMPRESSION_NONE;
+
+	m_uiStagingBuffer = 0;
+	m_pStaging = nullptr;
+	m_arrSlotFences.fill(nullptr);
+
+	m_uiPlaceholder = 0;
+	m_uiLoadedTextures = 0;
+	m_uiPendingJobs = 0;
+	m_ulUploadedBytes = 0;
+}
+
+CTextureManager::~CTextureManager()
+{
+	Destroy();
+}
+
+bool CTextureManager::Initialize()
+{
+	Destroy();
+
+	m_poolTextures.Initialize(TEXTURE_MAX_TEXTURES);
+
+	// white, untextured materials look the same while their texture loads
+	const GLubyte arrWhite[TEXTURE_DECODE_CHANNELS] = { 255, 255, 255, 255 };
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_uiPlaceholder);
+	glTextureStorage2D(m_uiPlaceholder, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(m_uiPlaceholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, arrWhite);
+
+	// written by the decode jobs, read by the uploads issued after they queued a band
+	const GLbitfield uiMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hStagingBuffer = resourceManager.CreateBuffer(static_cast<GLsizeiptr>(TEXTURE_STAGING_SLOT_COUNT) * TEXTURE_STAGING_SLOT_SIZE, nullptr, uiMapFlags);
+
+	const TBufferResource* pStagingBuffer = resourceManager.GetBuffer(m_hStagingBuffer);
+	if (pStagingBuffer == nullptr)
+	{
+		syserr("Failed to create the texture staging buffer");
+		Destroy();
+		return (false);
+	}
+
+	m_uiStagingBuffer = pStagingBuffer->m_uiBuffer;
+	m_pStaging = static_cast<GLubyte*>(glMapNamedBufferRange(m_uiStagingBuffer, 0, pStagingBuffer->m_lSize, uiMapFlags));
+	if (m_pStaging == nullptr)
+	{
+		syserr("Failed to map the texture staging buffer");
+		Destroy();
+		return (false);
+	}
+
+	for (GLint i = TEXTURE_STAGING_SLOT_COUNT - 1; i >= 0; i--)
+	{
+		m_vecFreeSlots.push_back(i);
+	}
+
+	// decodes go to the background lane, a worker waiting in ParallelFor never
+	// picks one up and stalls the main thread for the whole image
+	m_bIsRunning = true;
+	return (true);
+}
+
+void CTextureManager::Destroy()
+{
+	{
+		// taking the locks makes sure no job misses the wake up
+		std::lock_guard<std::mutex> lockTextures(m_mutexTextures);
+		std::lock_guard<std::mutex> lockStaging(m_mutexStaging);
+		m_bIsRunning = false;
+	}
+	m_cvStaging.notify_all();
+
+	{
+		// queued jobs point at this manager, they return right away once they run
+		std::unique_lock<std::mutex> lock(m_mutexTextures);
+		m_cvJobs.wait(lock, [this]() { return (m_uiPendingJobs == 0); });
+	}
+
+	for (GLsync& pFence : m_arrSlotFences)
+	{
+		if (pFence)
+		{
+			glDeleteSync(pFence);
+			pFence = nullptr;
+		}
+	}
+
+	m_dequeBands.clear();
+	m_vecFreeSlots.clear();
+	m_dequeDecodeRequests.clear();
+	m_dequeTranscodeRequests.clear();
+
+	m_poolTextures.ForEach([this](TextureHandle, TTextureResource& texture)
+	{
+		if (texture.m_uiTexture)
+		{
+			m_vecReleasedTextures.push_back(texture.m_uiTexture);
+		}
+	});
+	m_poolTextures.Destroy();
+	m_uiLoadedTextures = 0;
+
+	if (m_vecReleasedTextures.empty() == false)
+	{
+		glDeleteTextures(static_cast<GLsizei>(m_vecReleasedTextures.size()), m_vecReleasedTextures.data());
+		m_vecReleasedTextures.clear();
+	}
+
+	if (m_uiPlaceholder)
+	{
+		glDeleteTextures(1, &m_uiPlaceholder);
+		m_uiPlaceholder = 0;
+	}
+
+	if (m_hStagingBuffer.IsValid())
+	{
+		CGLResourceManager::Instance().DestroyBuffer(m_hStagingBuffer);
+		m_hStagingBuffer = BufferHandle();
+	}
+	m_uiStagingBuffer = 0;
+	m_pStaging = nullptr;
+	m_ulUploadedBytes = 0;
+}
+
+TextureHandle CTextureManager::LoadTexture(const std::string& stPath)
+{
+	TextureHandle hTexture;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+		TTextureResource texture{};
+		texture.m_stPath = stPath;
+		texture.m_eState = ETextureState::TEXTURE_STATE_AWAITING_LOAD;
+		texture.m_eDataType = EImageDataType::IMAGE_UNDEFINED;
+		texture.m_image.m_stName = stPath;
+
+		hTexture = m_poolTextures.Create(std::move(texture));
+		if (hTexture.IsValid() == false)
+		{
+			syserr("Texture pool is full, %s is not loaded", stPath.c_str());
+			return (hTexture);
+		}
+
+		m_dequeDecodeRequests.push_back(hTexture);
+		m_uiPendingJobs++;
+	}
+
+	CJobSystem::Instance().RunBackground([this]() { RunRequest(); });
+	return (hTexture);
+}
+
+void CTextureManager::DestroyTexture(TextureHandle hTexture)
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	// decodes and bands still in flight find the handle stale and drop their work
+	TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	if (pTexture == nullptr)
+	{
+		return;
+	}
+
+	if (pTexture->m_uiTexture)
+	{
+		m_vecReleasedTextures.push_back(pTexture->m_uiTexture);
+	}
+
+	if (pTexture->m_eState == ETextureState::TEXTURE_STATE_LOAD_COMPLETE)
+	{
+		m_uiLoadedTextures--;
+	}
+
+	m_poolTextures.Remove(hTexture);
+}
+
+void CTextureManager::SetCompression(GLubyte ubCompression)
+{
+#if ANUBIS_WITH_COMPRESSONATOR
+	m_ubCompression = ubCompression;
+#else
+	// nothing to transcode with, sources stay RGBA8 and no cache is written
+	if (ubCompression != TEXTURE_COMPRESSION_NONE)
+	{
+		sysdbg("Texture compression %s needs ANUBIS_WITH_COMPRESSONATOR, textures stay uncompressed", CCompressedTexture::GetName(ubCompression));
+	}
+	m_ubCompression = TEXTURE_COMPRESSION_NONE;
+#endif
+}
+
+GLubyte CTextureManager::GetCompression() const
+{
+	return (m_ubCompression);
+}
+
+ETextureState CTextureManager::GetState(TextureHandle hTexture) const
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	const TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	return pTexture ? pTexture->m_eState : ETextureState::TEXTURE_STATE_UNDEFINED;
+}
+
+void CTextureManager::Update()
+{
+	ANUBIS_ZONE("TextureManager::Update");
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexTextures);
+		if (m_vecReleasedTextures.empty() == false)
+		{
+			// GL keeps them alive for the commands already submitted
+			glDeleteTextures(static_cast<GLsizei>(m_vecReleasedTextures.size()), m_vecReleasedTextures.data());
+			m_vecReleasedTextures.clear();
+		}
+	}
+
+	RecycleStagingSlots();
+
+	GLint64 lBudget = TEXTURE_UPLOAD_BUDGET;
+	while (lBudget > 0)
+	{
+		TStagingBand band{};
+		{
+			std::lock_guard<std::mutex> lock(m_mutexStaging);
+			if (m_dequeBands.empty())
+			{
+				break;
+			}
+
+			band = m_dequeBands.front();
+			m_dequeBands.pop_front();
+		}
+
+		UploadBand(band);
+		lBudget -= band.m_iSize;
+	}
+}
+
+GLuint CTextureManager::GetTexture(TextureHandle hTexture) const
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	const TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	if (pTexture == nullptr || pTexture->m_eState != ETextureState::TEXTURE_STATE_LOAD_COMPLETE)
+	{
+		return (m_uiPlaceholder);
+	}
+
+	return (pTexture->m_uiTexture);
+}
+
+GLuint CTextureManager::GetPlaceholder() const
+{
+	return (m_uiPlaceholder);
+}
+
+void CTextureManager::Bind(TextureHandle hTexture, GLuint uiUnit) const
+{
+	glBindTextureUnit(uiUnit, GetTexture(hTexture));
+}
+
+GLuint64 CTextureManager::GetMemorySize(TextureHandle hTexture) const
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	const TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	if (pTexture == nullptr || pTexture->m_eState != ETextureState::TEXTURE_STATE_LOAD_COMPLETE)
+	{
+		return (0);
+	}
+
+	// generated mipmaps add a third to the top level, stored ones are counted already
+	if (pTexture->m_eDataType == EImageDataType::IMAGE_UNCOMPRESSED)
+	{
+		return (pTexture->m_ulTotalBytes * 4 / 3);
+	}
+
+	return (pTexture->m_ulTotalBytes);
+}
+
+TTextureStats CTextureManager::GetStats() const
+{
+	TTextureStats stats{};
+	{
+		std::lock_guard<std::mutex> lock(m_mutexTextures);
+		stats.m_uiTextures = m_poolTextures.GetAliveCount();
+		stats.m_uiLoadedTextures = m_uiLoadedTextures;
+		stats.m_uiPendingTranscodes = static_cast<GLuint>(m_dequeTranscodeRequests.size());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStaging);
+		stats.m_uiFreeStagingSlots = static_cast<GLuint>(m_vecFreeSlots.size());
+	}
+
+	stats.m_ulUploadedBytes = m_ulUploadedBytes.load(std::memory_order_relaxed);
+	return (stats);
+}
+
+void CTextureManager::RunRequest()
+{
+	TextureHandle hTexture;
+	std::string stPath;
+	bool bHasRequest = false;
+	bool bIsTranscode = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexTextures);
+		if (m_bIsRunning)
+		{
+			// a transcode takes seconds, it never delays a texture waiting to be seen
+			if (m_dequeDecodeRequests.empty() == false)
+			{
+				hTexture = m_dequeDecodeRequests.front();
+				m_dequeDecodeRequests.pop_front();
+
+				// destroyed before its turn
+				TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+				if (pTexture)
+				{
+					pTexture->m_eState = ETextureState::TEXTURE_STATE_LOADING;
+					stPath = pTexture->m_stPath;
+					bHasRequest = true;
+				}
+			}
+			else if (m_dequeTranscodeRequests.empty() == false)
+			{
+				stPath = m_dequeTranscodeRequests.front();
+				m_dequeTranscodeRequests.pop_front();
+				bHasRequest = true;
+				bIsTranscode = true;
+			}
+		}
+	}
+
+	if (bHasRequest && bIsTranscode)
+	{
+		TranscodeTexture(stPath);
+	}
+	else if (bHasRequest)
+	{
+		DecodeTexture(hTexture, stPath);
+	}
+
+	// notified under the lock, Destroy() may free the manager right after
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+	m_uiPendingJobs--;
+	m_cvJobs.notify_all();
+}
+
+void CTextureManager::DecodeTexture(TextureHandle hTexture, const std::string& stPath)
+{
+	ANUBIS_ZONE("TextureManager::Decode");
+
+	const GLubyte ubCompression = m_ubCompression;
+	const bool bIsContainer = CCompressedTexture::IsContainerPath(stPath);
+	const std::string stCachePath = GetCachePath(stPath, ubCompression);
+
+	std::string stCompressedPath;
+	if (bIsContainer)
+	{
+		stCompressedPath = stPath;
+	}
+	else if (ubCompression != TEXTURE_COMPRESSION_NONE && IsCacheValid(stPath, stCachePath))
+	{
+		stCompressedPath = stCachePath;
+	}
+
+	if (stCompressedPath.empty() == false)
+	{
+		TCompressedImage compressed{};
+		if (CCompressedTexture::Load(stCompressedPath, compressed))
+		{
+			GLuint64 ulTotalBytes = 0;
+			for (const TCompressedLevel& level : compressed.m_vecLevels)
+			{
+				ulTotalBytes += level.m_stSize;
+			}
+
+			const GLint iLevels = static_cast<GLint>(compressed.m_vecLevels.size());
+			if (PrepareTexture(hTexture, EImageDataType::IMAGE_COMPRESSED, compressed.m_eFormat, compressed.m_iWidth, compressed.m_iHeight, iLevels, ulTotalBytes) == false)
+			{
+				return;
+			}
+
+			for (GLint i = 0; i < iLevels; i++)
+			{
+				const TCompressedLevel& level = compressed.m_vecLevels[i];
+				if (StageLevel(hTexture, i, compressed.m_eFormat, level.m_iWidth, level.m_iHeight, compressed.m_vecData.data() + level.m_stOffset) == false)
+				{
+					break;
+				}
+			}
+
+			return;
+		}
+
+		// a broken cache falls back to the source, the transcode rewrites it
+		if (bIsContainer)
+		{
+			SetState(hTexture, ETextureState::TEXTURE_STATE_UNDEFINED);
+			return;
+		}
+	}
+
+	SImageData image{};
+	image.m_stName = stPath;
+
+	stbi_uc* pPixels = stbi_load(stPath.c_str(), &image.m_iWidth, &image.m_iHeight, &image.m_iChannels, TEXTURE_DECODE_CHANNELS);
+	if (pPixels == nullptr)
+	{
+		syserr("Failed to decode %s: %s", stPath.c_str(), stbi_failure_reason());
+		SetState(hTexture, ETextureState::TEXTURE_STATE_UNDEFINED);
+		return;
+	}
+
+	GLint iLevels = 1;
+	while ((std::max(image.m_iWidth, image.m_iHeight) >> iLevels) > 0)
+	{
+		iLevels++;
+	}
+
+	const GLuint64 ulTotalBytes = CCompressedTexture::GetLevelSize(GL_RGBA8, image.m_iWidth, image.m_iHeight);
+	if (PrepareTexture(hTexture, EImageDataType::IMAGE_UNCOMPRESSED, GL_RGBA8, image.m_iWidth, image.m_iHeight, iLevels, ulTotalBytes))
+	{
+		StageLevel(hTexture, 0, GL_RGBA8, image.m_iWidth, image.m_iHeight, pPixels);
+	}
+
+	stbi_image_free(pPixels);
+
+	if (ubCompression != TEXTURE_COMPRESSION_NONE)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutexTextures);
+			if (m_bIsRunning == false || std::find(m_dequeTranscodeRequests.begin(), m_dequeTranscodeRequests.end(), stPath) != m_dequeTranscodeRequests.end())
+			{
+				return;
+			}
+
+			m_dequeTranscodeRequests.push_back(stPath);
+			m_uiPendingJobs++;
+		}
+
+		CJobSystem::Instance().RunBackground([this]() { RunRequest(); });
+	}
+}
+
+void CTextureManager::TranscodeTexture(const std::string& stPath)
+{
+	ANUBIS_ZONE("TextureManager::Transcode");
+
+	const GLubyte ubCompression = m_ubCompression;
+	const std::string stCachePath = GetCachePath(stPath, ubCompression);
+	if (ubCompression == TEXTURE_COMPRESSION_NONE || IsCacheValid(stPath, stCachePath))
+	{
+		return;
+	}
+
+	GLint iWidth = 0;
+	GLint iHeight = 0;
+	GLint iChannels = 0;
+	stbi_uc* pPixels = stbi_load(stPath.c_str(), &iWidth, &iHeight, &iChannels, TEXTURE_DECODE_CHANNELS);
+	if (pPixels == nullptr)
+	{
+		return;
+	}
+
+	TCompressedImage compressed{};
+	const bool bIsCompressed = CCompressedTexture::Compress(pPixels, iWidth, iHeight, ubCompression, compressed);
+	stbi_image_free(pPixels);
+
+	// written aside and renamed, a load never sees half a file
+	const std::string stTempPath = stCachePath + ".tmp";
+	if (bIsCompressed && CCompressedTexture::SaveDDS(stTempPath, compressed))
+	{
+		std::error_code error;
+		std::filesystem::rename(stTempPath, stCachePath, error);
+		if (error)
+		{
+			syserr("Failed to write %s: %s", stCachePath.c_str(), error.message().c_str());
+			std::filesystem::remove(stTempPath, error);
+			return;
+		}
+
+		syslog("Transcoded %s to %s", stPath.c_str(), CCompressedTexture::GetName(ubCompression));
+	}
+}
+
+void CTextureManager::SetState(TextureHandle hTexture, ETextureState eState)
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	if (pTexture)
+	{
+		pTexture->m_eState = eState;
+	}
+}
+
+bool CTextureManager::PrepareTexture(TextureHandle hTexture, EImageDataType eDataType, GLenum eInternalFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLuint64 ulTotalBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	TTextureResource* pTexture = m_poolTextures.Get(hTexture);
+	if (pTexture == nullptr)
+	{
+		return (false);
+	}
+
+	pTexture->m_image.m_iWidth = iWidth;
+	pTexture->m_image.m_iHeight = iHeight;
+	pTexture->m_image.m_iChannels = TEXTURE_DECODE_CHANNELS;
+	pTexture->m_image.m_pData = nullptr;
+	pTexture->m_eDataType = eDataType;
+	pTexture->m_eInternalFormat = eInternalFormat;
+	pTexture->m_iLevels = iLevels;
+	pTexture->m_ulTotalBytes = ulTotalBytes;
+	return (true);
+}
+
+bool CTextureManager::StageLevel(TextureHandle hTexture, GLint iLevel, GLenum eFormat, GLint iWidth, GLint iHeight, const uint8_t* pData)
+{
+	// a band covers whole rows of pixels, or of blocks for compressed formats
+	const bool bIsCompressed = CCompressedTexture::GetBlockBytes(eFormat) != 0;
+	const GLint iUnitRows = bIsCompressed ? COMPRESSED_TEXTURE_BLOCK_SIZE : 1;
+	const size_t stUnitSize = CCompressedTexture::GetLevelSize(eFormat, iWidth, std::min(iHeight, iUnitRows));
+	const GLint iUnitCount = (iHeight + iUnitRows - 1) / iUnitRows;
+	const GLint iUnitsPerSlot = static_cast<GLint>(TEXTURE_STAGING_SLOT_SIZE / stUnitSize);
+	if (iUnitsPerSlot == 0)
+	{
+		syserr("Level %d is %d pixels wide, a row does not fit in a staging slot", iLevel, iWidth);
+		SetState(hTexture, ETextureState::TEXTURE_STATE_UNDEFINED);
+		return (false);
+	}
+
+	for (GLint iFirstUnit = 0; iFirstUnit < iUnitCount; iFirstUnit += iUnitsPerSlot)
+	{
+		const GLint iSlot = AcquireStagingSlot();
+		if (iSlot == TEXTURE_INVALID_SLOT)
+		{
+			return (false);
+		}
+
+		const GLint iUnits = std::min(iUnitsPerSlot, iUnitCount - iFirstUnit);
+		const size_t stSize = static_cast<size_t>(iUnits) * stUnitSize;
+		std::memcpy(m_pStaging + static_cast<size_t>(iSlot) * TEXTURE_STAGING_SLOT_SIZE, pData + static_cast<size_t>(iFirstUnit) * stUnitSize, stSize);
+
+		const GLint iFirstRow = iFirstUnit * iUnitRows;
+		const GLint iRowCount = std::min(iUnits * iUnitRows, iHeight - iFirstRow);
+		{
+			std::lock_guard<std::mutex> lock(m_mutexStaging);
+			m_dequeBands.push_back({ hTexture, iSlot, iLevel, iFirstRow, iRowCount, static_cast<GLsizei>(stSize) });
+		}
+	}
+
+	return (true);
+}
+
+std::string CTextureManager::GetCachePath(const std::string& stPath, GLubyte ubCompression) const
+{
+	return stPath + "." + CCompressedTexture::GetName(ubCompression) + ".dds";
+}
+
+bool CTextureManager::IsCacheValid(const std::string& stPath, const std::string& stCachePath) const
+{
+	std::error_code error;
+	const std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(stPath, error);
+	if (error)
+	{
+		return (false);
+	}
+
+	const std::filesystem::file_time_type cacheTime = std::filesystem::last_write_time(stCachePath, error);
+	return (error.value() == 0) && (cacheTime >= sourceTime);
+}
+
+GLint CTextureManager::AcquireStagingSlot()
+{
+	std::unique_lock<std::mutex> lock(m_mutexStaging);
+	m_cvStaging.wait(lock, [this]() { return (m_bIsRunning == false || m_vecFreeSlots.empty() == false); });
+	if (m_bIsRunning == false)
+	{
+		return (TEXTURE_INVALID_SLOT);
+	}
+
+	const GLint iSlot = m_vecFreeSlots.back();
+	m_vecFreeSlots.pop_back();
+	return (iSlot);
+}
+
+void CTextureManager::ReleaseStagingSlot(GLint iSlot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStaging);
+		m_vecFreeSlots.push_back(iSlot);
+	}
+
+	m_cvStaging.notify_one();
+}
+
+void CTextureManager::RecycleStagingSlots()
+{
+	for (GLint i = 0; i < TEXTURE_STAGING_SLOT_COUNT; i++)
+	{
+		GLsync& pFence = m_arrSlotFences[i];
+		if (pFence == nullptr)
+		{
+			continue;
+		}
+
+		// polled, a copy still running keeps its slot until a later frame
+		const GLenum eResult = glClientWaitSync(pFence, 0, 0);
+		if (eResult == GL_ALREADY_SIGNALED || eResult == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync(pFence);
+			pFence = nullptr;
+			ReleaseStagingSlot(i);
+		}
+	}
+}
+
+void CTextureManager::UploadBand(const TStagingBand& band)
+{
+	std::lock_guard<std::mutex> lock(m_mutexTextures);
+
+	// destroyed while the band was queued, the GPU never saw the slot
+	TTextureResource* pTexture = m_poolTextures.Get(band.m_hTexture);
+	if (pTexture == nullptr)
+	{
+		ReleaseStagingSlot(band.m_iSlot);
+		return;
+	}
+
+	const SImageData& image = pTexture->m_image;
+	if (pTexture->m_uiTexture == 0)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &pTexture->m_uiTexture);
+		glTextureStorage2D(pTexture->m_uiTexture, pTexture->m_iLevels, pTexture->m_eInternalFormat, image.m_iWidth, image.m_iHeight);
+		glTextureParameteri(pTexture->m_uiTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(pTexture->m_uiTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(pTexture->m_uiTexture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(pTexture->m_uiTexture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+
+	// the pixels argument is an offset into the bound unpack buffer, the copy runs asynchronously
+	const GLintptr lOffset = static_cast<GLintptr>(band.m_iSlot) * TEXTURE_STAGING_SLOT_SIZE;
+	const GLint iLevelWidth = std::max(1, image.m_iWidth >> band.m_iLevel);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uiStagingBuffer);
+	if (pTexture->m_eDataType == EImageDataType::IMAGE_COMPRESSED)
+	{
+		glCompressedTextureSubImage2D(pTexture->m_uiTexture, band.m_iLevel, 0, band.m_iFirstRow, iLevelWidth, band.m_iRowCount, pTexture->m_eInternalFormat, band.m_iSize, reinterpret_cast<const void*>(lOffset));
+	}
+	else
+	{
+		glTextureSubImage2D(pTexture->m_uiTexture, band.m_iLevel, 0, band.m_iFirstRow, iLevelWidth, band.m_iRowCount, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(lOffset));
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	m_arrSlotFences[band.m_iSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_ulUploadedBytes.fetch_add(static_cast<GLuint64>(band.m_iSize), std::memory_order_relaxed);
+
+	pTexture->m_ulUploadedBytes += band.m_iSize;
+	if (pTexture->m_ulUploadedBytes == pTexture->m_ulTotalBytes)
+	{
+		if (pTexture->m_eDataType == EImageDataType::IMAGE_UNCOMPRESSED)
+		{
+			glGenerateTextureMipmap(pTexture->m_uiTexture);
+		}
+
+		pTexture->m_eState = ETextureState::TEXTURE_STATE_LOAD_COMPLETE;
+		m_uiLoadedTextures++;
+	}
+}
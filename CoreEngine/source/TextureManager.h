@@ -0,0 +1,202 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <singleton.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <EngineEnums.hpp>
+#include <EngineTypes.hpp>
+#include "ResourcePool.h"
+#include "CompressedTexture.h"
+
+enum ETextureManagerData
+{
+	TEXTURE_MAX_TEXTURES = 1024,
+
+	// Every image is decoded to RGBA8, block compressed files are uploaded as stored
+	TEXTURE_DECODE_CHANNELS = 4,
+
+	// One persistently mapped PBO split into slots, an image larger than a
+	// slot is uploaded in bands of rows
+	TEXTURE_STAGING_SLOT_COUNT = 8,
+	TEXTURE_STAGING_SLOT_SIZE = 4 * 1024 * 1024,
+
+	// Staged bytes uploaded per frame
+	TEXTURE_UPLOAD_BUDGET = 16 * 1024 * 1024,
+
+	TEXTURE_ALBEDO_UNIT = 0,
+	TEXTURE_INVALID_SLOT = -1,
+};
+
+typedef struct STextureResource
+{
+	std::string m_stPath;
+	ETextureState m_eState;
+	SImageData m_image;			// size of the decoded image, the pixels only live in the decode job
+	EImageDataType m_eDataType;	// IMAGE_UNCOMPRESSED gets its mipmaps generated, IMAGE_COMPRESSED brings them
+	GLenum m_eInternalFormat;
+	GLint m_iLevels;
+	GLuint m_uiTexture;			// created with the first uploaded band, 0 before
+	GLuint64 m_ulTotalBytes;	// every level, the texture is complete once they are uploaded
+	GLuint64 m_ulUploadedBytes;
+} TTextureResource;
+
+typedef struct STextureStats
+{
+	GLuint m_uiTextures;
+	GLuint m_uiLoadedTextures;
+	GLuint m_uiFreeStagingSlots;
+	GLuint m_uiPendingTranscodes;
+	GLuint64 m_ulUploadedBytes;		// since Initialize()
+} TTextureStats;
+
+/**
+ * Loads images without ever blocking a frame.
+ *
+ * LoadTexture() hands out a handle right away (TEXTURE_STATE_AWAITING_LOAD),
+ * background jobs decode the file (TEXTURE_STATE_LOADING) and copy the
+ * pixels into a free slot of a persistently mapped pixel unpack buffer. The
+ * context thread calls Update() once per frame, it issues glTextureSubImage2D
+ * from the filled slots within a byte budget and fences them, slots come back
+ * once their fence signaled. After the last band the mipmaps are generated and
+ * the texture is TEXTURE_STATE_LOAD_COMPLETE. Until then, or if the image
+ * could not be decoded (TEXTURE_STATE_UNDEFINED), a white placeholder is bound.
+ *
+ * DDS and KTX2 files holding BC1/3/4/5/7 are staged level by level and
+ * uploaded with glCompressedTextureSubImage2D. With a compression set, other
+ * images load from their "<path>.<bcN>.dds" cache when it is newer than the
+ * source, otherwise they load uncompressed and a background job writes the
+ * cache once no decode is pending, the next load picks it up.
+ *
+ * Load, destroy and state queries are thread safe, Initialize(), Destroy(),
+ * Update() and Bind() need the GL context.
+ */
+class CTextureManager : public CSingleton<CTextureManager>
+{
+public:
+	CTextureManager();
+	~CTextureManager();
+
+	CTextureManager(const CTextureManager&) = delete;
+	CTextureManager& operator=(const CTextureManager&) = delete;
+
+	bool Initialize();
+	void Destroy();
+
+	/**
+	 * Queues the image for decoding, every call loads a new texture.
+	 *
+	 * @return Invalid handle if the pool is full
+	 */
+	TextureHandle LoadTexture(const std::string& stPath);
+	void DestroyTexture(TextureHandle hTexture);
+
+	/**
+	 * Format images that are not DDS or KTX2 are transcoded to,
+	 * TEXTURE_COMPRESSION_NONE keeps them RGBA8.
+	 */
+	void SetCompression(GLubyte ubCompression);
+	GLubyte GetCompression() const;
+
+	ETextureState GetState(TextureHandle hTexture) const;
+
+	/**
+	 * Uploads the decoded bands and recycles the staging slots, never waits
+	 * on the GPU or the decode jobs.
+	 */
+	void Update();
+
+	/**
+	 * @return The texture once loaded, the placeholder before or for invalid handles
+	 */
+	GLuint GetTexture(TextureHandle hTexture) const;
+	GLuint GetPlaceholder() const;
+	void Bind(TextureHandle hTexture, GLuint uiUnit) const;
+
+	/**
+	 * Video memory of the texture with its mipmaps, 0 until it is loaded.
+	 */
+	GLuint64 GetMemorySize(TextureHandle hTexture) const;
+
+	TTextureStats GetStats() const;
+
+protected:
+	/**
+	 * Rows of one level copied into a staging slot, waiting to be uploaded.
+	 * Compressed bands start and end on block rows.
+	 */
+	typedef struct SStagingBand
+	{
+		TextureHandle m_hTexture;
+		GLint m_iSlot;
+		GLint m_iLevel;
+		GLint m_iFirstRow;
+		GLint m_iRowCount;
+		GLsizei m_iSize;
+	} TStagingBand;
+
+	/**
+	 * Background job, takes one request, decodes before transcodes.
+	 */
+	void RunRequest();
+	void DecodeTexture(TextureHandle hTexture, const std::string& stPath);
+	void TranscodeTexture(const std::string& stPath);
+	void SetState(TextureHandle hTexture, ETextureState eState);
+
+	/**
+	 * Sets the storage the upload allocates, false if the texture was destroyed.
+	 */
+	bool PrepareTexture(TextureHandle hTexture, EImageDataType eDataType, GLenum eInternalFormat, GLint iWidth, GLint iHeight, GLint iLevels, GLuint64 ulTotalBytes);
+
+	/**
+	 * Splits a level into bands and queues them, blocks while no slot is free.
+	 *
+	 * @return False when shutting down or if a row does not fit in a slot
+	 */
+	bool StageLevel(TextureHandle hTexture, GLint iLevel, GLenum eFormat, GLint iWidth, GLint iHeight, const uint8_t* pData);
+
+	std::string GetCachePath(const std::string& stPath, GLubyte ubCompression) const;
+	bool IsCacheValid(const std::string& stPath, const std::string& stCachePath) const;
+
+	/**
+	 * Blocks the decode job until a slot is free.
+	 *
+	 * @return TEXTURE_INVALID_SLOT when shutting down
+	 */
+	GLint AcquireStagingSlot();
+	void ReleaseStagingSlot(GLint iSlot);
+	void RecycleStagingSlots();
+	void UploadBand(const TStagingBand& band);
+
+private:
+	mutable std::mutex m_mutexTextures;
+	TResourcePool<TTextureResource, TextureHandle> m_poolTextures;
+	std::deque<TextureHandle> m_dequeDecodeRequests;
+	std::deque<std::string> m_dequeTranscodeRequests;	// taken once no decode is pending
+	GLuint m_uiLoadedTextures;
+	std::vector<GLuint> m_vecReleasedTextures;		// GL names of destroyed textures, deleted by Update()
+	GLuint m_uiPendingJobs;							// queued or running, Destroy() waits for them
+	std::condition_variable m_cvJobs;
+
+	std::atomic<bool> m_bIsRunning;
+	std::atomic<GLubyte> m_ubCompression;
+
+	// Staging, slots are free, being filled, queued or fenced
+	mutable std::mutex m_mutexStaging;
+	std::condition_variable m_cvStaging;
+	BufferHandle m_hStagingBuffer;
+	GLuint m_uiStagingBuffer;
+	GLubyte* m_pStaging;
+	std::vector<GLint> m_vecFreeSlots;
+	std::deque<TStagingBand> m_dequeBands;
+	std::array<GLsync, TEXTURE_STAGING_SLOT_COUNT> m_arrSlotFences;	// render thread only
+
+	GLuint m_uiPlaceholder;
+	std::atomic<GLuint64> m_ulUploadedBytes;
+};
@@ -0,0 +1,632 @@
+#include "VirtualTexture.h"
+#include "GLResourceManager.h"
+#include "TerrainPatch.h"
+#include "Shader.h"
+#include "CPUProfiler.h"
+#include <utils.h>
+#include <algorithm>
+#include <cmath>
+
+// world units the height of a splat layer fades in and out over
+static const GLfloat SPLAT_HEIGHT_BLEND = 2.0f;
+static const GLfloat SPLAT_SLOPE_BLEND = 0.1f;
+
+static GLfloat SmoothStep(GLfloat fEdge0, GLfloat fEdge1, GLfloat fValue)
+{
+	const GLfloat fT = std::clamp((fValue - fEdge0) / (fEdge1 - fEdge0), 0.0f, 1.0f);
+	return (fT * fT * (3.0f - 2.0f * fT));
+}
+
+static GLfloat GetRangeWeight(GLfloat fValue, GLfloat fMin, GLfloat fMax, GLfloat fBlend)
+{
+	return (SmoothStep(fMin - fBlend, fMin + fBlend, fValue) * (1.0f - SmoothStep(fMax - fBlend, fMax + fBlend, fValue)));
+}
+
+CVirtualTexture::CVirtualTexture()
+{
+	m_fExtent = 0.0f;
+	m_uiSeed = 0;
+	m_iPages = 0;
+	m_iLevels = 0;
+	m_uiFeedbackBits = 0;
+
+	m_uiPageTable = 0;
+	m_uiCache = 0;
+	m_pReadback = nullptr;
+	m_arrFeedbackFrames.fill(0);
+
+	m_ulLastFeedbackFrame = 0;
+	m_v3CameraPosition = Vector3D(0.0f);
+
+	m_bIsRunning = false;
+	m_stats = TVirtualTextureStats{};
+}
+
+CVirtualTexture::~CVirtualTexture()
+{
+	Destroy();
+}
+
+bool CVirtualTexture::Initialize(GLfloat fExtent, GLuint uiSeed)
+{
+	Destroy();
+
+	if (fExtent <= 0.0f)
+	{
+		syserr("Invalid virtual texture extent %f", fExtent);
+		return (false);
+	}
+
+	m_fExtent = fExtent;
+	m_uiSeed = uiSeed;
+
+	// power of two pages so every level halves cleanly, large terrains get a lower density
+	const GLint iNeededPages = static_cast<GLint>(std::ceil(fExtent * static_cast<GLfloat>(VIRTUAL_TEXTURE_TEXEL_DENSITY) / static_cast<GLfloat>(VIRTUAL_TEXTURE_PAGE_SIZE)));
+	m_iPages = 1;
+	while (m_iPages < iNeededPages && m_iPages < VIRTUAL_TEXTURE_MAX_PAGES)
+	{
+		m_iPages <<= 1;
+	}
+
+	m_iLevels = 1;
+	while (GetPagesAtLevel(m_iLevels - 1) > 1)
+	{
+		m_iLevels++;
+	}
+
+	// the last offset is the total, a bit maps to its level by searching them
+	m_vecLevelOffsets.resize(m_iLevels + 1);
+	m_uiFeedbackBits = 0;
+	for (GLint iLevel = 0; iLevel < m_iLevels; iLevel++)
+	{
+		m_vecLevelOffsets[iLevel] = m_uiFeedbackBits;
+		m_uiFeedbackBits += static_cast<GLuint>(GetPagesAtLevel(iLevel) * GetPagesAtLevel(iLevel));
+	}
+	m_vecLevelOffsets[m_iLevels] = m_uiFeedbackBits;
+
+	const GLsizeiptr lFeedbackSize = static_cast<GLsizeiptr>((m_uiFeedbackBits + 31) / 32) * sizeof(GLuint);
+
+	CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+	m_hFeedbackBuffer = resourceManager.CreateBuffer(lFeedbackSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	const GLbitfield uiReadFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	m_hReadbackBuffer = resourceManager.CreateBuffer(FRAME_PACKET_COUNT * lFeedbackSize, nullptr, uiReadFlags);
+
+	const TBufferResource* pFeedbackBuffer = resourceManager.GetBuffer(m_hFeedbackBuffer);
+	const TBufferResource* pReadbackBuffer = resourceManager.GetBuffer(m_hReadbackBuffer);
+	if (pFeedbackBuffer == nullptr || pReadbackBuffer == nullptr)
+	{
+		syserr("Failed to create the virtual texture feedback buffers");
+		Destroy();
+		return (false);
+	}
+
+	m_pReadback = static_cast<const GLuint*>(glMapNamedBufferRange(pReadbackBuffer->m_uiBuffer, 0, FRAME_PACKET_COUNT * lFeedbackSize, uiReadFlags));
+	if (m_pReadback == nullptr)
+	{
+		syserr("Failed to map the virtual texture read back buffer");
+		Destroy();
+		return (false);
+	}
+
+	glClearNamedBufferData(pFeedbackBuffer->m_uiBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	// one texel per page and level, integer so NEAREST never blends two slots
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_uiPageTable);
+	glTextureStorage2D(m_uiPageTable, m_iLevels, GL_RGBA8UI, m_iPages, m_iPages);
+	glTextureParameteri(m_uiPageTable, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(m_uiPageTable, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	const GLint iCacheSize = VIRTUAL_TEXTURE_CACHE_PAGES * VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE;
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_uiCache);
+	glTextureStorage2D(m_uiCache, 1, GL_RGBA8, iCacheSize, iCacheSize);
+	glTextureParameteri(m_uiCache, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_uiCache, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(m_uiCache, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(m_uiCache, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	m_vecPageTable.resize(m_iLevels);
+	m_vecResidentSlots.resize(m_iLevels);
+	for (GLint iLevel = 0; iLevel < m_iLevels; iLevel++)
+	{
+		const size_t stPages = static_cast<size_t>(GetPagesAtLevel(iLevel)) * GetPagesAtLevel(iLevel);
+		m_vecPageTable[iLevel].assign(stPages, 0);
+		m_vecResidentSlots[iLevel].assign(stPages, VIRTUAL_TEXTURE_INVALID_SLOT);
+	}
+
+	m_vecSlots.assign(VIRTUAL_TEXTURE_CACHE_PAGES * VIRTUAL_TEXTURE_CACHE_PAGES, TCacheSlot{ VIRTUAL_TEXTURE_INVALID_PAGE, 0, false });
+
+	// drawn in order, every layer blends over the previous ones
+	SetSplatLayers({
+		{ Vector3D(0.45f, 0.42f, 0.40f), -1000.0f, 1000.0f, 1000.0f },	// rock
+		{ Vector3D(0.76f, 0.70f, 0.50f), -1000.0f, 4.0f, 0.5f },		// sand
+		{ Vector3D(0.25f, 0.45f, 0.15f), 3.0f, 32.0f, 0.6f },			// grass
+		{ Vector3D(0.95f, 0.95f, 0.97f), 36.0f, 1000.0f, 0.9f },		// snow
+	});
+
+	// every page table entry ends at the top page, it has to exist before the first draw
+	TBakedPage topPage;
+	topPage.m_uiPage = MakePageKey(m_iLevels - 1, 0, 0);
+	BakePage(topPage.m_uiPage, topPage.m_vecPixels);
+	UploadPage(topPage, 0, true);
+
+	syslog("Virtual texture of %d pages per side, %d levels, %d cache slots", m_iPages, m_iLevels, VIRTUAL_TEXTURE_CACHE_PAGES * VIRTUAL_TEXTURE_CACHE_PAGES);
+
+	m_bIsRunning = true;
+	m_threadStream = std::thread(&CVirtualTexture::StreamLoop, this);
+	return (true);
+}
+
+void CVirtualTexture::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		m_bIsRunning = false;
+	}
+	m_cvStream.notify_all();
+
+	if (m_threadStream.joinable())
+	{
+		m_threadStream.join();
+	}
+
+	m_fenceRing.Reset();
+
+	if (m_hFeedbackBuffer.IsValid() || m_hReadbackBuffer.IsValid())
+	{
+		CGLResourceManager& resourceManager = CGLResourceManager::Instance();
+		resourceManager.DestroyBuffer(m_hFeedbackBuffer);
+		resourceManager.DestroyBuffer(m_hReadbackBuffer);
+	}
+	m_hFeedbackBuffer = BufferHandle();
+	m_hReadbackBuffer = BufferHandle();
+	m_pReadback = nullptr;
+
+	if (m_uiPageTable)
+	{
+		glDeleteTextures(1, &m_uiPageTable);
+		m_uiPageTable = 0;
+	}
+
+	if (m_uiCache)
+	{
+		glDeleteTextures(1, &m_uiCache);
+		m_uiCache = 0;
+	}
+
+	m_vecPageTable.clear();
+	m_vecResidentSlots.clear();
+	m_vecSlots.clear();
+	m_vecLevelOffsets.clear();
+	m_ulLastFeedbackFrame = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		m_vecRequests.clear();
+		m_setInFlight.clear();
+		m_dequeBaked.clear();
+		m_stats = TVirtualTextureStats{};
+	}
+}
+
+void CVirtualTexture::SetSplatLayers(const std::vector<TSplatLayer>& vecLayers)
+{
+	std::lock_guard<std::mutex> lock(m_mutexStream);
+	m_vecLayers = vecLayers;
+}
+
+void CVirtualTexture::Update(GLuint64 ulFrameIndex, const Vector3D& v3CameraPosition)
+{
+	ANUBIS_ZONE("VirtualTexture::Update");
+
+	if (m_uiCache == 0)
+	{
+		return;
+	}
+
+	m_v3CameraPosition = v3CameraPosition;
+
+	std::vector<TBakedPage> vecBaked;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		while (m_dequeBaked.empty() == false && vecBaked.size() < VIRTUAL_TEXTURE_UPLOADS_PER_FRAME)
+		{
+			vecBaked.push_back(std::move(m_dequeBaked.front()));
+			m_dequeBaked.pop_front();
+		}
+	}
+
+	// a page without a free or evictable slot is dropped, the feedback asks again
+	for (const TBakedPage& page : vecBaked)
+	{
+		UploadPage(page, ulFrameIndex, false);
+	}
+
+	const GLuint uiResidentPages = static_cast<GLuint>(std::count_if(m_vecSlots.begin(), m_vecSlots.end(), [](const TCacheSlot& slot) { return (slot.m_uiPage != VIRTUAL_TEXTURE_INVALID_PAGE); }));
+
+	std::lock_guard<std::mutex> lock(m_mutexStream);
+	for (const TBakedPage& page : vecBaked)
+	{
+		m_setInFlight.erase(page.m_uiPage);
+	}
+	m_stats.m_uiResidentPages = uiResidentPages;
+}
+
+void CVirtualTexture::SetupShader(const CShader& shader, GLuint64 ulFrameIndex) const
+{
+	shader.SetBool("virtualTexture", m_uiCache != 0);
+	if (m_uiCache == 0)
+	{
+		return;
+	}
+
+	shader.SetInt("pageTable", VIRTUAL_TEXTURE_PAGE_TABLE_UNIT);
+	shader.SetInt("pageCache", VIRTUAL_TEXTURE_CACHE_UNIT);
+	shader.SetFloat("virtualExtent", m_fExtent);
+	shader.SetInt("virtualPages", m_iPages);
+	shader.SetInt("virtualLevels", m_iLevels);
+
+	// every pixel of a STRIDE x STRIDE block reports once per STRIDE^2 frames
+	const GLint iFrame = static_cast<GLint>(ulFrameIndex % (VIRTUAL_TEXTURE_FEEDBACK_STRIDE * VIRTUAL_TEXTURE_FEEDBACK_STRIDE));
+	shader.SetIVec2("feedbackJitter", iFrame % VIRTUAL_TEXTURE_FEEDBACK_STRIDE, iFrame / VIRTUAL_TEXTURE_FEEDBACK_STRIDE);
+
+	glBindTextureUnit(VIRTUAL_TEXTURE_PAGE_TABLE_UNIT, m_uiPageTable);
+	glBindTextureUnit(VIRTUAL_TEXTURE_CACHE_UNIT, m_uiCache);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VIRTUAL_TEXTURE_FEEDBACK_BINDING, GetFeedbackBuffer());
+}
+
+void CVirtualTexture::CopyFeedback(GLuint64 ulFrameIndex)
+{
+	ANUBIS_ZONE("VirtualTexture::CopyFeedback");
+
+	const TBufferResource* pFeedbackBuffer = CGLResourceManager::Instance().GetBuffer(m_hFeedbackBuffer);
+	const TBufferResource* pReadbackBuffer = CGLResourceManager::Instance().GetBuffer(m_hReadbackBuffer);
+	if (pFeedbackBuffer == nullptr || pReadbackBuffer == nullptr)
+	{
+		return;
+	}
+
+	const GLuint uiWords = (m_uiFeedbackBits + 31) / 32;
+
+	// the slot is reused FRAME_PACKET_COUNT frames later, read it before overwriting
+	const GLuint uiSlot = m_fenceRing.GetSlot();
+	if (m_fenceRing.AcquireSlot())
+	{
+		ProcessFeedback(m_pReadback + static_cast<size_t>(uiSlot) * uiWords, m_arrFeedbackFrames[uiSlot]);
+	}
+
+	glCopyNamedBufferSubData(pFeedbackBuffer->m_uiBuffer, pReadbackBuffer->m_uiBuffer, 0, static_cast<GLintptr>(uiSlot) * uiWords * sizeof(GLuint), static_cast<GLsizeiptr>(uiWords) * sizeof(GLuint));
+	glClearNamedBufferData(pFeedbackBuffer->m_uiBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+	m_arrFeedbackFrames[uiSlot] = ulFrameIndex;
+	m_fenceRing.EndFrame();
+}
+
+GLuint CVirtualTexture::GetFeedbackBuffer() const
+{
+	const TBufferResource* pBuffer = CGLResourceManager::Instance().GetBuffer(m_hFeedbackBuffer);
+	return (pBuffer ? pBuffer->m_uiBuffer : 0);
+}
+
+TVirtualTextureStats CVirtualTexture::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutexStream);
+
+	TVirtualTextureStats stats = m_stats;
+	stats.m_uiPendingPages = static_cast<GLuint>(m_vecRequests.size() + m_setInFlight.size());
+	return (stats);
+}
+
+GLuint CVirtualTexture::MakePageKey(GLint iLevel, GLint iX, GLint iY)
+{
+	return (static_cast<GLuint>(iLevel) << 20 | static_cast<GLuint>(iY) << 10 | static_cast<GLuint>(iX));
+}
+
+void CVirtualTexture::SplitPageKey(GLuint uiPage, GLint& iLevel, GLint& iX, GLint& iY)
+{
+	iLevel = static_cast<GLint>(uiPage >> 20);
+	iY = static_cast<GLint>((uiPage >> 10) & 0x3FF);
+	iX = static_cast<GLint>(uiPage & 0x3FF);
+}
+
+GLint CVirtualTexture::GetResidentSlot(GLuint uiPage) const
+{
+	GLint iLevel, iX, iY;
+	SplitPageKey(uiPage, iLevel, iX, iY);
+
+	return (m_vecResidentSlots[iLevel][static_cast<size_t>(iY) * GetPagesAtLevel(iLevel) + iX]);
+}
+
+void CVirtualTexture::StreamLoop()
+{
+	ANUBIS_THREAD_NAME("VirtualTexture");
+
+	for (;;)
+	{
+		GLuint uiPage = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutexStream);
+			m_cvStream.wait(lock, [this]() { return (m_bIsRunning == false || m_vecRequests.empty() == false); });
+			if (m_bIsRunning == false)
+			{
+				return;
+			}
+
+			uiPage = m_vecRequests.back();
+			m_vecRequests.pop_back();
+			m_setInFlight.insert(uiPage);
+		}
+
+		TBakedPage page;
+		page.m_uiPage = uiPage;
+		BakePage(uiPage, page.m_vecPixels);
+
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		m_dequeBaked.push_back(std::move(page));
+		m_stats.m_ulBakedPages++;
+	}
+}
+
+void CVirtualTexture::BakePage(GLuint uiPage, std::vector<GLubyte>& vecPixels) const
+{
+	ANUBIS_ZONE("VirtualTexture::BakePage");
+
+	std::vector<TSplatLayer> vecLayers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		vecLayers = m_vecLayers;
+	}
+
+	GLint iLevel, iPageX, iPageY;
+	SplitPageKey(uiPage, iLevel, iPageX, iPageY);
+
+	// world units per texel, the slope is never measured below the terrain's own resolution
+	const GLfloat fTexelSize = m_fExtent / static_cast<GLfloat>(GetPagesAtLevel(iLevel) * VIRTUAL_TEXTURE_PAGE_SIZE);
+	const GLfloat fStep = std::max(fTexelSize, static_cast<GLfloat>(CELL_SCALE));
+
+	vecPixels.resize(static_cast<size_t>(VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE) * VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE * 4);
+	GLubyte* pPixel = vecPixels.data();
+
+	for (GLint iY = 0; iY < VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE; iY++)
+	{
+		// the border repeats the neighbouring pages, clamped at the edge of the terrain
+		const GLint iTexelY = iPageY * VIRTUAL_TEXTURE_PAGE_SIZE - VIRTUAL_TEXTURE_PAGE_BORDER + iY;
+		const GLfloat fZ = std::clamp((static_cast<GLfloat>(iTexelY) + 0.5f) * fTexelSize, 0.0f, m_fExtent);
+
+		for (GLint iX = 0; iX < VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE; iX++)
+		{
+			const GLint iTexelX = iPageX * VIRTUAL_TEXTURE_PAGE_SIZE - VIRTUAL_TEXTURE_PAGE_BORDER + iX;
+			const GLfloat fX = std::clamp((static_cast<GLfloat>(iTexelX) + 0.5f) * fTexelSize, 0.0f, m_fExtent);
+
+			const GLfloat fHeight = CTerrainPatch::SampleHeight(fX, fZ, m_uiSeed);
+			const GLfloat fDeltaX = CTerrainPatch::SampleHeight(fX + fStep, fZ, m_uiSeed) - fHeight;
+			const GLfloat fDeltaZ = CTerrainPatch::SampleHeight(fX, fZ + fStep, m_uiSeed) - fHeight;
+			const GLfloat fSlope = std::sqrt(fDeltaX * fDeltaX + fDeltaZ * fDeltaZ) / fStep;
+
+			Vector3D v3Color(0.0f);
+			for (size_t i = 0; i < vecLayers.size(); i++)
+			{
+				const TSplatLayer& layer = vecLayers[i];
+				const GLfloat fWeight = (i == 0) ? 1.0f : GetRangeWeight(fHeight, layer.m_fMinHeight, layer.m_fMaxHeight, SPLAT_HEIGHT_BLEND) * GetRangeWeight(fSlope, -1.0f, layer.m_fMaxSlope, SPLAT_SLOPE_BLEND);
+
+				v3Color.x += (layer.m_v3Color.x - v3Color.x) * fWeight;
+				v3Color.y += (layer.m_v3Color.y - v3Color.y) * fWeight;
+				v3Color.z += (layer.m_v3Color.z - v3Color.z) * fWeight;
+			}
+
+			pPixel[0] = static_cast<GLubyte>(std::clamp(v3Color.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+			pPixel[1] = static_cast<GLubyte>(std::clamp(v3Color.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+			pPixel[2] = static_cast<GLubyte>(std::clamp(v3Color.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+			pPixel[3] = 255;
+			pPixel += 4;
+		}
+	}
+}
+
+void CVirtualTexture::ProcessFeedback(const GLuint* pBits, GLuint64 ulFrameIndex)
+{
+	ANUBIS_ZONE("VirtualTexture::ProcessFeedback");
+
+	std::vector<GLuint> vecMissing;
+	const GLuint uiWords = (m_uiFeedbackBits + 31) / 32;
+	GLint iLevel = 0;
+
+	for (GLuint uiWord = 0; uiWord < uiWords; uiWord++)
+	{
+		// most of the buffer stays empty, a word covers 32 pages
+		const GLuint uiMask = pBits[uiWord];
+		if (uiMask == 0)
+		{
+			continue;
+		}
+
+		for (GLuint uiBit = 0; uiBit < 32; uiBit++)
+		{
+			const GLuint uiIndex = uiWord * 32 + uiBit;
+			if ((uiMask & (1u << uiBit)) == 0 || uiIndex >= m_uiFeedbackBits)
+			{
+				continue;
+			}
+
+			while (uiIndex >= m_vecLevelOffsets[iLevel + 1])
+			{
+				iLevel++;
+			}
+
+			const GLint iPages = GetPagesAtLevel(iLevel);
+			const GLint iPage = static_cast<GLint>(uiIndex - m_vecLevelOffsets[iLevel]);
+			GLint iX = iPage % iPages;
+			GLint iY = iPage / iPages;
+
+			// missing pages ask for their parents too, the closest resident one is drawn meanwhile
+			for (GLint iParent = iLevel; iParent < m_iLevels; iParent++)
+			{
+				const GLint iSlot = m_vecResidentSlots[iParent][static_cast<size_t>(iY) * GetPagesAtLevel(iParent) + iX];
+				if (iSlot != VIRTUAL_TEXTURE_INVALID_SLOT)
+				{
+					m_vecSlots[iSlot].m_ulLastUsedFrame = std::max(m_vecSlots[iSlot].m_ulLastUsedFrame, ulFrameIndex);
+					break;
+				}
+
+				vecMissing.push_back(MakePageKey(iParent, iX, iY));
+				iX >>= 1;
+				iY >>= 1;
+			}
+		}
+	}
+
+	std::sort(vecMissing.begin(), vecMissing.end());
+	vecMissing.erase(std::unique(vecMissing.begin(), vecMissing.end()), vecMissing.end());
+
+	// coarse pages first, they fill the most screen, then the closest to the camera
+	const GLdouble dCameraX = m_v3CameraPosition.x;
+	const GLdouble dCameraZ = m_v3CameraPosition.z;
+	std::vector<std::pair<GLdouble, GLuint>> vecPriorities;
+	vecPriorities.reserve(vecMissing.size());
+	for (GLuint uiPage : vecMissing)
+	{
+		GLint iPageLevel, iX, iY;
+		SplitPageKey(uiPage, iPageLevel, iX, iY);
+
+		const GLdouble dPageSize = m_fExtent / static_cast<GLdouble>(GetPagesAtLevel(iPageLevel));
+		const GLdouble dDeltaX = (iX + 0.5) * dPageSize - dCameraX;
+		const GLdouble dDeltaZ = (iY + 0.5) * dPageSize - dCameraZ;
+		const GLdouble dPriority = (m_iLevels - iPageLevel) * 1.0e9 + std::sqrt(dDeltaX * dDeltaX + dDeltaZ * dDeltaZ);
+		vecPriorities.emplace_back(dPriority, uiPage);
+	}
+	std::sort(vecPriorities.begin(), vecPriorities.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+
+		// the previous requests are stale, the thread picks from the back
+		m_vecRequests.clear();
+		for (const std::pair<GLdouble, GLuint>& priority : vecPriorities)
+		{
+			if (m_vecRequests.size() >= VIRTUAL_TEXTURE_MAX_REQUESTS)
+			{
+				break;
+			}
+
+			if (m_setInFlight.count(priority.second) == 0)
+			{
+				m_vecRequests.push_back(priority.second);
+			}
+		}
+		std::reverse(m_vecRequests.begin(), m_vecRequests.end());
+
+		m_stats.m_uiRequestedPages = static_cast<GLuint>(vecMissing.size());
+	}
+	m_cvStream.notify_one();
+
+	m_ulLastFeedbackFrame = ulFrameIndex;
+}
+
+bool CVirtualTexture::UploadPage(const TBakedPage& page, GLuint64 ulFrameIndex, bool bIsPinned)
+{
+	if (GetResidentSlot(page.m_uiPage) != VIRTUAL_TEXTURE_INVALID_SLOT)
+	{
+		return (true);
+	}
+
+	// a free slot, else the least recently used one the last feedback did not ask for
+	GLint iSlot = VIRTUAL_TEXTURE_INVALID_SLOT;
+	GLuint64 ulOldestFrame = ~0ull;
+	for (GLint i = 0; i < static_cast<GLint>(m_vecSlots.size()); i++)
+	{
+		const TCacheSlot& slot = m_vecSlots[i];
+		if (slot.m_uiPage == VIRTUAL_TEXTURE_INVALID_PAGE)
+		{
+			iSlot = i;
+			break;
+		}
+
+		if (slot.m_bIsPinned == false && slot.m_ulLastUsedFrame < m_ulLastFeedbackFrame && slot.m_ulLastUsedFrame < ulOldestFrame)
+		{
+			iSlot = i;
+			ulOldestFrame = slot.m_ulLastUsedFrame;
+		}
+	}
+
+	if (iSlot == VIRTUAL_TEXTURE_INVALID_SLOT)
+	{
+		return (false);
+	}
+
+	TCacheSlot& slot = m_vecSlots[iSlot];
+	if (slot.m_uiPage != VIRTUAL_TEXTURE_INVALID_PAGE)
+	{
+		// the pages below fall back to the evicted page's parent
+		GLint iLevel, iX, iY;
+		SplitPageKey(slot.m_uiPage, iLevel, iX, iY);
+		m_vecResidentSlots[iLevel][static_cast<size_t>(iY) * GetPagesAtLevel(iLevel) + iX] = VIRTUAL_TEXTURE_INVALID_SLOT;
+		RefreshPageTable(slot.m_uiPage);
+
+		std::lock_guard<std::mutex> lock(m_mutexStream);
+		m_stats.m_ulEvictedPages++;
+	}
+
+	const GLint iSlotX = iSlot % VIRTUAL_TEXTURE_CACHE_PAGES;
+	const GLint iSlotY = iSlot / VIRTUAL_TEXTURE_CACHE_PAGES;
+	glTextureSubImage2D(m_uiCache, 0, iSlotX * VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE, iSlotY * VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE,
+		VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE, VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, page.m_vecPixels.data());
+
+	slot.m_uiPage = page.m_uiPage;
+	slot.m_ulLastUsedFrame = ulFrameIndex;
+	slot.m_bIsPinned = bIsPinned;
+
+	GLint iLevel, iX, iY;
+	SplitPageKey(page.m_uiPage, iLevel, iX, iY);
+	m_vecResidentSlots[iLevel][static_cast<size_t>(iY) * GetPagesAtLevel(iLevel) + iX] = iSlot;
+	RefreshPageTable(page.m_uiPage);
+
+	return (true);
+}
+
+void CVirtualTexture::RefreshPageTable(GLuint uiPage)
+{
+	GLint iPageLevel, iPageX, iPageY;
+	SplitPageKey(uiPage, iPageLevel, iPageX, iPageY);
+
+	// top down, a missing page copies the entry its parent got one level above
+	for (GLint iLevel = iPageLevel; iLevel >= 0; iLevel--)
+	{
+		const GLint iPages = GetPagesAtLevel(iLevel);
+		const GLint iSize = 1 << (iPageLevel - iLevel);
+		const GLint iFirstX = iPageX * iSize;
+		const GLint iFirstY = iPageY * iSize;
+
+		std::vector<GLuint>& vecEntries = m_vecPageTable[iLevel];
+		for (GLint iY = iFirstY; iY < iFirstY + iSize; iY++)
+		{
+			for (GLint iX = iFirstX; iX < iFirstX + iSize; iX++)
+			{
+				const size_t stIndex = static_cast<size_t>(iY) * iPages + iX;
+				const GLint iSlot = m_vecResidentSlots[iLevel][stIndex];
+				if (iSlot != VIRTUAL_TEXTURE_INVALID_SLOT)
+				{
+					// slot x, slot y, level of the page in the slot, alpha marks it valid
+					vecEntries[stIndex] = static_cast<GLuint>(iSlot % VIRTUAL_TEXTURE_CACHE_PAGES) | static_cast<GLuint>(iSlot / VIRTUAL_TEXTURE_CACHE_PAGES) << 8 | static_cast<GLuint>(iLevel) << 16 | 255u << 24;
+				}
+				else if (iLevel + 1 < m_iLevels)
+				{
+					vecEntries[stIndex] = m_vecPageTable[iLevel + 1][static_cast<size_t>(iY >> 1) * GetPagesAtLevel(iLevel + 1) + (iX >> 1)];
+				}
+				else
+				{
+					vecEntries[stIndex] = 0;
+				}
+			}
+		}
+
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, iPages);
+		glTextureSubImage2D(m_uiPageTable, iLevel, iFirstX, iFirstY, iSize, iSize, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, vecEntries.data() + static_cast<size_t>(iFirstY) * iPages + iFirstX);
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+GLint CVirtualTexture::GetPagesAtLevel(GLint iLevel) const
+{
+	return (m_iPages >> iLevel);
+}
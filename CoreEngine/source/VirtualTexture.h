@@ -0,0 +1,206 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <maths.h>
+#include <singleton.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "FramePacket.h"
+#include "FenceRing.h"
+
+class CShader;
+
+enum EVirtualTextureData
+{
+	// Texels of a page, the physical copy adds a border so bilinear filtering
+	// never reads the neighbouring page in the cache
+	VIRTUAL_TEXTURE_PAGE_SIZE = 128,
+	VIRTUAL_TEXTURE_PAGE_BORDER = 4,
+	VIRTUAL_TEXTURE_PHYSICAL_PAGE_SIZE = VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER,
+
+	// Pages per side of the physical cache, its memory never changes
+	VIRTUAL_TEXTURE_CACHE_PAGES = 16,
+
+	// Pages per side of the most detailed level, 64K texels
+	VIRTUAL_TEXTURE_MAX_PAGES = 512,
+	VIRTUAL_TEXTURE_MAX_LEVELS = 10,
+
+	// Texels per world unit of the most detailed level
+	VIRTUAL_TEXTURE_TEXEL_DENSITY = 16,
+
+	// One pixel out of STRIDE x STRIDE writes its page request, the pattern
+	// moves every frame
+	VIRTUAL_TEXTURE_FEEDBACK_STRIDE = 8,
+
+	// Baked pages copied into the cache per frame
+	VIRTUAL_TEXTURE_UPLOADS_PER_FRAME = 8,
+
+	// Requests handed to the streaming thread, the most important first
+	VIRTUAL_TEXTURE_MAX_REQUESTS = 64,
+
+	VIRTUAL_TEXTURE_PAGE_TABLE_UNIT = 1,
+	VIRTUAL_TEXTURE_CACHE_UNIT = 2,
+
+	// Shader storage binding of the request bits, see terrain.frag
+	VIRTUAL_TEXTURE_FEEDBACK_BINDING = 8,
+
+	VIRTUAL_TEXTURE_INVALID_PAGE = 0x7FFFFFFF,
+	VIRTUAL_TEXTURE_INVALID_SLOT = -1,
+};
+
+/**
+ * Terrain material selected by height and slope when a page is baked.
+ */
+typedef struct SSplatLayer
+{
+	Vector3D m_v3Color;
+	GLfloat m_fMinHeight;
+	GLfloat m_fMaxHeight;
+	GLfloat m_fMaxSlope;		// rise over run, steeper ground blends to the next layer
+} TSplatLayer;
+
+typedef struct SVirtualTextureStats
+{
+	GLuint m_uiResidentPages;
+	GLuint m_uiRequestedPages;		// not resident in the last read back
+	GLuint m_uiPendingPages;		// queued or being baked
+	GLuint64 m_ulBakedPages;		// since Initialize()
+	GLuint64 m_ulEvictedPages;
+} TVirtualTextureStats;
+
+/**
+ * Sparse virtual texture covering the whole terrain.
+ *
+ * The virtual texture is split into pages of VIRTUAL_TEXTURE_PAGE_SIZE texels
+ * at every level. A fixed size cache texture holds the resident pages, the
+ * page table (one texel per page and level) points every page at its cache
+ * slot or, while it is missing, at its closest resident parent. The top level
+ * page is baked at Initialize() and never evicted.
+ *
+ * terrain.frag samples through the page table and, for a sparse and moving
+ * subset of pixels, sets the bit of the page it wanted in a feedback buffer.
+ * CopyFeedback() reads it back FRAME_PACKET_COUNT frames later, the missing
+ * pages are sorted coarse first and then by distance to the camera and baked
+ * from the splat layers by a streaming thread. Update() copies a few baked
+ * pages per frame into the least recently used slots and patches the page
+ * table below them.
+ *
+ * Initialize() and Destroy() need the GL context, everything else runs on
+ * the render thread.
+ */
+class CVirtualTexture : public CSingleton<CVirtualTexture>
+{
+public:
+	CVirtualTexture();
+	~CVirtualTexture();
+
+	CVirtualTexture(const CVirtualTexture&) = delete;
+	CVirtualTexture& operator=(const CVirtualTexture&) = delete;
+
+	/**
+	 * @param fExtent World units covered along x and z, starting at the origin
+	 * @param uiSeed Heightmap seed of the terrain, see CTerrainPatch::SampleHeight
+	 */
+	bool Initialize(GLfloat fExtent, GLuint uiSeed);
+	void Destroy();
+
+	/**
+	 * Replaces the layers, pages already baked keep the old ones.
+	 */
+	void SetSplatLayers(const std::vector<TSplatLayer>& vecLayers);
+
+	/**
+	 * Uploads baked pages and patches the page table, the camera position
+	 * orders the next requests.
+	 */
+	void Update(GLuint64 ulFrameIndex, const Vector3D& v3CameraPosition);
+
+	/**
+	 * Binds the page table, the cache and the feedback buffer and sets the
+	 * uniforms of terrain.frag.
+	 */
+	void SetupShader(const CShader& shader, GLuint64 ulFrameIndex) const;
+
+	/**
+	 * Reads back the requests of an earlier frame, copies this frame's and
+	 * clears the buffer. Follows the draws, needs a BUFFER_UPDATE barrier.
+	 */
+	void CopyFeedback(GLuint64 ulFrameIndex);
+
+	GLuint GetFeedbackBuffer() const;
+	TVirtualTextureStats GetStats() const;
+
+protected:
+	typedef struct SCacheSlot
+	{
+		GLuint m_uiPage;			// key of the resident page, VIRTUAL_TEXTURE_INVALID_PAGE if free
+		GLuint64 m_ulLastUsedFrame;
+		bool m_bIsPinned;
+	} TCacheSlot;
+
+	typedef struct SBakedPage
+	{
+		GLuint m_uiPage;
+		std::vector<GLubyte> m_vecPixels;	// RGBA8, physical page with its border
+	} TBakedPage;
+
+	// level, x and y packed into one key
+	static GLuint MakePageKey(GLint iLevel, GLint iX, GLint iY);
+	static void SplitPageKey(GLuint uiPage, GLint& iLevel, GLint& iX, GLint& iY);
+	GLint GetResidentSlot(GLuint uiPage) const;
+
+	void StreamLoop();
+	void BakePage(GLuint uiPage, std::vector<GLubyte>& vecPixels) const;
+	void ProcessFeedback(const GLuint* pBits, GLuint64 ulFrameIndex);
+	bool UploadPage(const TBakedPage& page, GLuint64 ulFrameIndex, bool bIsPinned);
+
+	/**
+	 * Rewrites the page table entries under a page that became resident or
+	 * was evicted and uploads them.
+	 */
+	void RefreshPageTable(GLuint uiPage);
+
+	GLint GetPagesAtLevel(GLint iLevel) const;
+
+private:
+	GLfloat m_fExtent;
+	GLuint m_uiSeed;
+	GLint m_iPages;				// per side of level 0
+	GLint m_iLevels;
+	std::vector<GLuint> m_vecLevelOffsets;	// first feedback bit of every level
+	GLuint m_uiFeedbackBits;
+
+	// GPU resources
+	GLuint m_uiPageTable;
+	GLuint m_uiCache;
+	BufferHandle m_hFeedbackBuffer;
+	BufferHandle m_hReadbackBuffer;
+	const GLuint* m_pReadback;
+	CFenceRing m_fenceRing;		// one read back slot per fence
+	std::array<GLuint64, FRAME_PACKET_COUNT> m_arrFeedbackFrames;
+
+	// Residency, render thread only
+	std::vector<std::vector<GLuint>> m_vecPageTable;	// packed RGBA8UI per level
+	std::vector<std::vector<GLint>> m_vecResidentSlots;	// cache slot per page and level
+	std::vector<TCacheSlot> m_vecSlots;
+	GLuint64 m_ulLastFeedbackFrame;		// slots it stamped are never evicted
+	Vector3D m_v3CameraPosition;
+
+	// Streaming
+	mutable std::mutex m_mutexStream;
+	std::condition_variable m_cvStream;
+	std::vector<GLuint> m_vecRequests;			// highest priority last
+	std::unordered_set<GLuint> m_setInFlight;	// taken by the thread until uploaded
+	std::deque<TBakedPage> m_dequeBaked;
+	std::vector<TSplatLayer> m_vecLayers;
+	std::atomic<bool> m_bIsRunning;
+	std::thread m_threadStream;
+
+	TVirtualTextureStats m_stats;
+};
@@ -1,14 +1,38 @@
 #include "Window.h"
 #include <utils.h>
+#include "LinearAllocator.h"
+#include "CPUProfiler.h"
+#include <chrono>
+#include <algorithm>
+
+static GLdouble ElapsedMilliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<GLdouble, std::milli>(end - begin).count();
+}
 
 static void APIENTRY MyDebugCallback(GLenum source, GLenum type, GLuint id,
 	GLenum severity, GLsizei length,
 	const GLchar* message, const void* userParam)
 {
-	syslog("%s", message);
+	// runs inside driver calls, the logger only queues the message
+	switch (severity)
+	{
+	case GL_DEBUG_SEVERITY_HIGH:
+		LogWrite(LOG_LEVEL_ERROR, "GL", "%s", message);
+		break;
+	case GL_DEBUG_SEVERITY_MEDIUM:
+		LogWrite(LOG_LEVEL_WARNING, "GL", "%s", message);
+		break;
+	case GL_DEBUG_SEVERITY_LOW:
+		LogWrite(LOG_LEVEL_INFO, "GL", "%s", message);
+		break;
+	default:
+		LogWrite(LOG_LEVEL_DEBUG, "GL", "%s", message);
+		break;
+	}
 }
 
-CWindow::CWindow()
+CWindow::CWindow() : m_pGLWindow(nullptr), m_pCamera(nullptr), m_pTerrain(nullptr)
 {
 	Clear();
 }
@@ -20,6 +44,104 @@ CWindow::~CWindow()
 
 void CWindow::Clear()
 {
+	// Stop rendering first, the render thread hands the GL context back
+	if (m_pRenderThread)
+	{
+		m_pRenderThread->Stop();
+		m_pRenderThread.reset();
+
+		if (m_pGLWindow)
+		{
+			glfwMakeContextCurrent(m_pGLWindow);
+		}
+	}
+
+	// GL resources have to be released while the context is still alive
+	if (m_pResourceManager)
+	{
+		m_pResourceManager->DestroyShader(m_hShader);
+		m_pResourceManager->DestroyShader(m_hCullShader);
+		m_pResourceManager->DestroyShader(m_hDepthPyramidShader);
+		m_pResourceManager->DestroyShader(m_hMeshShader);
+		m_pResourceManager->DestroyMesh(m_mesh.m_hMesh);
+		m_pResourceManager->DestroyBuffer(m_mesh.m_hMeshletBuffer);
+		m_pResourceManager->DestroyShader(m_hClusterCullShader);
+		m_pResourceManager->DestroyShader(m_hBatch2DShader);
+	}
+	m_hShader = ShaderHandle();
+	m_hCullShader = ShaderHandle();
+	m_hDepthPyramidShader = ShaderHandle();
+	m_hMeshShader = ShaderHandle();
+	m_hClusterCullShader = ShaderHandle();
+	m_hBatch2DShader = ShaderHandle();
+	m_mesh = TMeshAsset{};
+
+	if (m_pFontAtlas)
+	{
+		m_pFontAtlas->Destroy();
+		m_pFontAtlas.reset();
+	}
+	m_hOverlayFont = FontHandle();
+
+	// joins the streaming thread, its buffers go back to the resource manager
+	if (m_pVirtualTexture)
+	{
+		m_pVirtualTexture->Destroy();
+		m_pVirtualTexture.reset();
+	}
+
+	// handles are released before their textures
+	if (m_pBindlessTextures)
+	{
+		m_pBindlessTextures->Destroy();
+		m_pBindlessTextures.reset();
+	}
+	m_hTerrainMaterial = MaterialHandle();
+
+	// waits for the decode jobs, the staging buffer goes back to the resource manager
+	if (m_pTextureManager)
+	{
+		m_pTextureManager->Destroy();
+		m_pTextureManager.reset();
+	}
+	m_hTerrainTexture = TextureHandle();
+
+	if (m_pTerrain)
+	{
+		delete m_pTerrain;
+		m_pTerrain = nullptr;
+	}
+
+	if (m_pCullingScene)
+	{
+		m_pCullingScene->Destroy();
+		m_pCullingScene.reset();
+	}
+
+	if (m_pGeometryPool)
+	{
+		m_pGeometryPool->Destroy();
+		m_pGeometryPool.reset();
+	}
+
+	if (m_pGPUProfiler)
+	{
+		m_pGPUProfiler->Destroy();
+		m_pGPUProfiler.reset();
+	}
+
+	if (m_pResourceManager)
+	{
+		m_pResourceManager->Destroy();
+		m_pResourceManager.reset();
+	}
+
+	if (m_pCamera)
+	{
+		delete m_pCamera;
+		m_pCamera = nullptr;
+	}
+
 	if (m_pGLWindow)
 	{
 		glfwDestroyWindow(m_pGLWindow);
@@ -38,11 +160,47 @@ void CWindow::Clear()
 	m_iWindowedWidth = 0;
 	m_iWindowedHeight = 0;
 
+	m_iHeadlessWidth = HEADLESS_DEFAULT_WIDTH;
+	m_iHeadlessHeight = HEADLESS_DEFAULT_HEIGHT;
+
 	m_ubWindowType = 0;
 
 	// Timing
 	m_fLastFrame = 0.0f;
 	m_fDeltaTime = 0.0f;
+	m_fFixedTimestep = 0.0f;
+	m_frameTimings = TFrameTimings{};
+	m_ulFrameIndex = 0;
+	m_ulFrameLimit = 0;
+	m_iSwapInterval = -1;
+	m_ulCaptureFrame = UINT64_MAX;
+	m_stCapturePath.clear();
+	m_fLastTitleUpdate = 0.0f;
+	m_bProfilerExportDown = false;
+	m_bCPUCaptureDown = false;
+	m_bGPUCullingDown = false;
+	m_bGPUCulling = true;
+	m_stOverlayFontPath.clear();
+	m_bOverlayFontSDF = false;
+	m_vecOverlayLines.clear();
+	m_lastRenderStats = TRenderStats{};
+	m_arrFrameTimeHistory.fill(0.0f);
+	m_uiFrameTimeHistoryIndex = 0;
+
+	// Scene
+	m_cameraPath.Clear();
+	m_iTerrainCellsX = PATCH_XSIZE;
+	m_iTerrainCellsZ = PATCH_ZSIZE;
+	m_uiTerrainSeed = 0;
+	m_stTerrainTexturePath.clear();
+	m_ubTextureCompression = TEXTURE_COMPRESSION_BC7;
+	m_stMeshPath.clear();
+	m_mesh = TMeshAsset{};
+	m_mat4MeshModel.InitIdentity();
+	m_mat4MeshletToWorld.InitIdentity();
+	m_v3MeshCenter = Vector3D(0.0f, 0.0f, 0.0f);
+	m_fMeshRadius = 0.0f;
+	m_iMeshLod = 0;
 
 	// Cursor Part
 	m_iCurrentCursor = GLFW_ARROW_CURSOR;
@@ -62,12 +220,6 @@ void CWindow::Clear()
 	// Input
 	m_bKeyBools.fill(false);
 	m_bMouseKeys.fill(false);
-
-	if (m_pShader)
-	{
-		delete m_pShader;
-		m_pShader = nullptr;
-	}
 }
 
 void CWindow::Destroy()
@@ -76,10 +228,29 @@ void CWindow::Destroy()
 	glfwTerminate();
 }
 
+bool CWindow::FallBackToHeadless(const char* szReason)
+{
+	syserr("%s, falling back to headless rendering", szReason);
+
+	SetWindowType(EWindowMode::HEADLESS_MODE);
+	return InitializeWindow();
+}
+
 bool CWindow::InitializeWindow()
 {
+	const bool bHeadless = IsHeadless();
+
+	// Null platform: no display server, the context comes from EGL (surfaceless)
+	glfwInitHint(GLFW_PLATFORM, bHeadless ? GLFW_PLATFORM_NULL : GLFW_ANY_PLATFORM);
+
 	if (glfwInit() == false)
 	{
+		// no display server at all, GLFW never picks the Null platform by itself
+		if (bHeadless == false && glfwPlatformSupported(GLFW_PLATFORM_NULL))
+		{
+			return FallBackToHeadless("No display available");
+		}
+
 		syserr("Failed to Initialize GLFW");
 		return (false);
 	}
@@ -89,8 +260,10 @@ bool CWindow::InitializeWindow()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	// Enable Multi Sampling, for a smoother drawing
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	// Scenes are rendered into render targets and blitted to the window, a
+	// blit cannot resolve into a multisampled default framebuffer. The MSAA
+	// lives in the scene target, the render thread resolves it before presenting
+	glfwWindowHint(GLFW_SAMPLES, 0);
 
 	// Enable Context Debugging for OpenGL
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
@@ -100,26 +273,49 @@ bool CWindow::InitializeWindow()
 	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // Make it inVisible, later must call "glfwShowWindow"
 	glfwWindowHint(GLFW_FOCUS_ON_SHOW, GLFW_TRUE); // Focus the window once we show it
 
-	// Get Monitor Data
-	m_pMonitor = glfwGetPrimaryMonitor();
-	m_pVideoMode = glfwGetVideoMode(m_pMonitor);
+	if (bHeadless)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+
+		m_iFullScreenWidth = m_iWindowedWidth = m_iHeadlessWidth;
+		m_iFullScreenHeight = m_iWindowedHeight = m_iHeadlessHeight;
+	}
+	else
+	{
+		// Get Monitor Data
+		m_pMonitor = glfwGetPrimaryMonitor();
+		m_pVideoMode = m_pMonitor ? glfwGetVideoMode(m_pMonitor) : nullptr;
+
+		if (m_pVideoMode == nullptr)
+		{
+			glfwTerminate();
+			return FallBackToHeadless("No monitor available");
+		}
 
-	// Setup Colors & Refresh rate based on our monitor
-	glfwWindowHint(GLFW_RED_BITS, m_pVideoMode->redBits);
-	glfwWindowHint(GLFW_GREEN_BITS, m_pVideoMode->greenBits);
-	glfwWindowHint(GLFW_BLUE_BITS, m_pVideoMode->blueBits);
-	glfwWindowHint(GLFW_REFRESH_RATE, m_pVideoMode->refreshRate);
+		// Setup Colors & Refresh rate based on our monitor
+		glfwWindowHint(GLFW_RED_BITS, m_pVideoMode->redBits);
+		glfwWindowHint(GLFW_GREEN_BITS, m_pVideoMode->greenBits);
+		glfwWindowHint(GLFW_BLUE_BITS, m_pVideoMode->blueBits);
+		glfwWindowHint(GLFW_REFRESH_RATE, m_pVideoMode->refreshRate);
 
-	// Setup Window Size & Deminsions
-	m_iFullScreenWidth = m_pVideoMode->width;
-	m_iFullScreenHeight = m_pVideoMode->height;
+		// Setup Window Size & Deminsions
+		m_iFullScreenWidth = m_pVideoMode->width;
+		m_iFullScreenHeight = m_pVideoMode->height;
 
-	// Windowed size is 75% of full screen size!
-	m_iWindowedWidth = (m_iFullScreenWidth * 75) / 100;
-	m_iWindowedHeight = (m_iFullScreenHeight * 75) / 100;
+		// Windowed size is 75% of full screen size!
+		m_iWindowedWidth = (m_iFullScreenWidth * 75) / 100;
+		m_iWindowedHeight = (m_iFullScreenHeight * 75) / 100;
+	}
 
 	// Create Window
-	if (GetWindowType() == EWindowMode::WINDOWED_MODE)
+	if (bHeadless)
+	{
+		m_iWidth = m_iHeadlessWidth;
+		m_iHeight = m_iHeadlessHeight;
+
+		m_pGLWindow = glfwCreateWindow(m_iWidth, m_iHeight, "Lonely", nullptr, nullptr);
+	}
+	else if (GetWindowType() == EWindowMode::WINDOWED_MODE)
 	{
 		m_iWidth = m_iWindowedWidth;
 		m_iHeight = m_iWindowedHeight;
@@ -180,13 +376,116 @@ bool CWindow::InitializeWindow()
 	glDebugMessageCallback(MyDebugCallback, nullptr);
 
 	// Show our window
-	glfwShowWindow(GetGLWindow());
+	if (bHeadless == false)
+	{
+		glfwShowWindow(GetGLWindow());
+	}
+
+	m_pResourceManager = std::make_unique<CGLResourceManager>();
+	m_pResourceManager->Initialize();
+
+	m_pGPUProfiler = std::make_unique<CGPUProfiler>();
+	m_pGPUProfiler->Initialize();
+
+	m_hShader = m_pResourceManager->CreateShader("TerrainShader", { "resources\\indirect.vert", "resources\\terrain.frag" });
+	m_hCullShader = m_pResourceManager->CreateShader("CullShader", { "resources\\cull.comp" }, { "resources\\cull_common.glsl" });
+	m_hDepthPyramidShader = m_pResourceManager->CreateShader("DepthPyramidShader", { "resources\\depth_pyramid.comp" });
+	m_hMeshShader = m_pResourceManager->CreateShader("MeshShader", { "resources\\shader.vert", "resources\\shader.frag" });
+	m_hClusterCullShader = m_pResourceManager->CreateShader("ClusterCullShader", { "resources\\cluster_cull.comp" }, { "resources\\cull_common.glsl" });
+	m_hBatch2DShader = m_pResourceManager->CreateShader("Batch2DShader", { "resources\\batch2d.vert", "resources\\batch2d.frag" });
+
+	// opt in, captures compared against reference images stay free of text
+	if (m_stOverlayFontPath.empty() == false)
+	{
+		m_pFontAtlas = std::make_unique<CFontAtlas>();
+		if (m_pFontAtlas->Initialize())
+		{
+			m_hOverlayFont = m_pFontAtlas->LoadFont(m_stOverlayFontPath, OVERLAY_FONT_SIZE, m_bOverlayFontSDF);
+		}
+	}
+
+	m_pTextureManager = std::make_unique<CTextureManager>();
+	m_pTextureManager->SetCompression(m_ubTextureCompression);
+	if (m_pTextureManager->Initialize() == false)
+	{
+		return (false);
+	}
+
+	// the terrain is drawn with the placeholder until the image is uploaded
+	if (m_stTerrainTexturePath.empty() == false)
+	{
+		m_hTerrainTexture = m_pTextureManager->LoadTexture(m_stTerrainTexturePath);
+	}
+
+	// without the extension the material IDs are still valid, the batch texture is bound instead
+	m_pBindlessTextures = std::make_unique<CBindlessTextures>();
+	m_pBindlessTextures->Initialize();
+	m_hTerrainMaterial = m_pBindlessTextures->CreateMaterial(m_hTerrainTexture);
+
+	m_pCamera = new CCamera(this);
+
+	// the terrain and static meshes share one set of buffers
+	GLuint uiTerrainVertices = 0;
+	GLuint uiTerrainIndices = 0;
+	CTerrain::GetRequiredGeometry(m_iTerrainCellsX, m_iTerrainCellsZ, uiTerrainVertices, uiTerrainIndices);
+
+	m_pGeometryPool = std::make_unique<CGeometryPool>();
+	if (m_pGeometryPool->Initialize(uiTerrainVertices + GEOMETRY_POOL_STATIC_VERTICES, uiTerrainIndices + GEOMETRY_POOL_STATIC_INDICES) == false)
+	{
+		return (false);
+	}
+
+	m_pTerrain = new CTerrain();
+	m_pTerrain->InitializeTerrain(m_iTerrainCellsX, m_iTerrainCellsZ, m_uiTerrainSeed);
+	m_pTerrain->SetMaterial(m_pBindlessTextures->GetMaterialID(m_hTerrainMaterial));
+
+	// the terrain albedo, baked from the heightmap page by page as the camera needs it
+	const GLint iTerrainCells = std::max(m_pTerrain->GetPatchesX() * PATCH_XSIZE, m_pTerrain->GetPatchesZ() * PATCH_ZSIZE);
+	m_pVirtualTexture = std::make_unique<CVirtualTexture>();
+	m_pVirtualTexture->Initialize(static_cast<GLfloat>(iTerrainCells * CELL_SCALE), m_uiTerrainSeed);
+
+	// standing on the ground in the middle of the terrain
+	if (m_stMeshPath.empty() == false && CMeshAsset::Load(m_stMeshPath, m_mesh))
+	{
+		const GLfloat fCentre = static_cast<GLfloat>(iTerrainCells * CELL_SCALE) * 0.5f;
+		const GLfloat fGround = CTerrainPatch::SampleHeight(fCentre, fCentre, m_uiTerrainSeed);
+		const Vector3D v3MeshPosition(fCentre, fGround - m_mesh.m_v3BoundsMin.y, fCentre);
+		m_mat4MeshModel = CMeshAsset::GetModelMatrix(m_mesh, v3MeshPosition);
+		m_mat4MeshletToWorld = CMeshAsset::GetMeshletMatrix(m_mesh, v3MeshPosition);
+
+		const Vector3D v3HalfExtent((m_mesh.m_v3BoundsMax.x - m_mesh.m_v3BoundsMin.x) * 0.5f, (m_mesh.m_v3BoundsMax.y - m_mesh.m_v3BoundsMin.y) * 0.5f,
+			(m_mesh.m_v3BoundsMax.z - m_mesh.m_v3BoundsMin.z) * 0.5f);
+		m_v3MeshCenter = Vector3D(v3MeshPosition.x + m_mesh.m_v3BoundsMin.x + v3HalfExtent.x, v3MeshPosition.y + m_mesh.m_v3BoundsMin.y + v3HalfExtent.y,
+			v3MeshPosition.z + m_mesh.m_v3BoundsMin.z + v3HalfExtent.z);
+		m_fMeshRadius = v3HalfExtent.length();
+	}
+
+	// the terrain never moves, its bounds and draws go to the GPU once
+	m_pCullingScene = std::make_unique<CCullingScene>();
+	m_pTerrain->AddToCullingScene(*m_pCullingScene);
+	if (m_pCullingScene->Upload() == false)
+	{
+		return (false);
+	}
+
+	// Hand the context over to the render thread, from now on the main thread
+	// only polls events, simulates and builds frame packets
+	glfwMakeContextCurrent(nullptr);
+
+	m_pRenderThread = std::make_unique<CRenderThread>();
+	m_pRenderThread->SetOffscreen(bHeadless);
+	m_pRenderThread->SetSwapInterval(m_iSwapInterval);
 
-	m_pShader = new CShader("MainShader");
-	m_pShader->InitializeShader();
-	m_pShader->AttachShader("resources\\shader.vert");
-	m_pShader->AttachShader("resources\\shader.frag");
-	m_pShader->LinkProgram();
+	if (m_stCapturePath.empty() == false)
+	{
+		m_pRenderThread->RequestCapture(m_ulCaptureFrame, m_stCapturePath);
+	}
+
+	if (m_pRenderThread->Start(GetGLWindow()) == false)
+	{
+		syserr("Failed to Start the Render Thread");
+		return (false);
+	}
 
  	return (true);
 }
@@ -226,21 +525,425 @@ GLfloat CWindow::GetHeightF() const
 	return static_cast<GLfloat>(m_iHeight);
 }
 
+void CWindow::SetHeadlessSize(GLint iWidth, GLint iHeight)
+{
+	m_iHeadlessWidth = iWidth;
+	m_iHeadlessHeight = iHeight;
+}
+
+bool CWindow::IsHeadless() const
+{
+	return (m_ubWindowType == EWindowMode::HEADLESS_MODE);
+}
+
+void CWindow::SetFrameLimit(GLuint64 ulFrameLimit)
+{
+	m_ulFrameLimit = ulFrameLimit;
+}
+
+void CWindow::RequestCapture(GLuint64 ulFrameIndex, const std::string& stPath)
+{
+	if (m_pRenderThread)
+	{
+		m_pRenderThread->RequestCapture(ulFrameIndex, stPath);
+		return;
+	}
+
+	m_ulCaptureFrame = ulFrameIndex;
+	m_stCapturePath = stPath;
+}
+
+void CWindow::SetFixedTimestep(GLfloat fTimestep)
+{
+	m_fFixedTimestep = fTimestep;
+}
+
+void CWindow::SetSwapInterval(GLint iSwapInterval)
+{
+	m_iSwapInterval = iSwapInterval;
+}
+
+void CWindow::SetGPUCulling(bool bGPUCulling)
+{
+	m_bGPUCulling = bGPUCulling;
+}
+
+void CWindow::SetTerrainSize(GLint iCellsX, GLint iCellsZ, GLuint uiSeed)
+{
+	m_iTerrainCellsX = iCellsX;
+	m_iTerrainCellsZ = iCellsZ;
+	m_uiTerrainSeed = uiSeed;
+}
+
+void CWindow::SetTerrainTexture(const std::string& stPath)
+{
+	m_stTerrainTexturePath = stPath;
+}
+
+void CWindow::SetMesh(const std::string& stPath)
+{
+	m_stMeshPath = stPath;
+}
+
+void CWindow::SetLodSettings(const TLodSettings& settings)
+{
+	m_lodSelector.SetSettings(settings);
+}
+
+void CWindow::SetOverlayFont(const std::string& stPath, bool bSDF)
+{
+	m_stOverlayFontPath = stPath;
+	m_bOverlayFontSDF = bSDF;
+}
+
+void CWindow::SetTextureCompression(GLubyte ubCompression)
+{
+	m_ubTextureCompression = ubCompression;
+}
+
+void CWindow::SetCameraPath(const CCameraPath& cameraPath)
+{
+	m_cameraPath = cameraPath;
+}
+
 void CWindow::Update()
 {
-	while (glfwWindowShouldClose(GetGLWindow()) == false)
+	while (UpdateFrame())
+	{
+	}
+}
+
+bool CWindow::UpdateFrame()
+{
+	if (glfwWindowShouldClose(GetGLWindow()))
 	{
-		glfwPollEvents();
+		return (false);
+	}
 
+	ANUBIS_ZONE("Window::Frame");
+	const auto frameBegin = std::chrono::steady_clock::now();
+
+	glfwPollEvents();
+
+	if (m_fFixedTimestep > 0.0f)
+	{
+		// derived from the frame index so the time does not drift
+		m_fDeltaTime = m_fFixedTimestep;
+		m_fLastFrame = static_cast<GLfloat>(m_ulFrameIndex * static_cast<GLdouble>(m_fFixedTimestep));
+	}
+	else
+	{
 		GLfloat fCurrentFrame = static_cast<GLfloat>(glfwGetTime());
 		m_fDeltaTime = fCurrentFrame - m_fLastFrame;
 		m_fLastFrame = fCurrentFrame;
+	}
+
+	// do some stuff ..
+	ProcessInput();
+	UpdateCamera();
+
+	const auto waitBegin = std::chrono::steady_clock::now();
+
+	// Blocks only while the render thread is (FRAME_PACKET_COUNT - 1) frames behind
+	TFramePacket* pFramePacket = nullptr;
+	{
+		ANUBIS_ZONE("Window::AcquirePacket");
+		pFramePacket = m_pRenderThread->AcquirePacket();
+	}
+
+	if (pFramePacket == nullptr)
+	{
+		return (false);
+	}
+
+	const auto buildBegin = std::chrono::steady_clock::now();
+
+	// the packet came back, so did the frame arena it was built with
+	CFrameAllocator::Instance().BeginFrame(m_ulFrameIndex);
+	pFramePacket->SetArena(&CFrameAllocator::Instance().GetCurrentArena());
+
+	BuildFramePacket(*pFramePacket);
+	BuildOverlay(*pFramePacket);
+	m_pRenderThread->SubmitPacket(pFramePacket);
+
+	const auto buildEnd = std::chrono::steady_clock::now();
+
+	UpdateProfilerDisplay();
+	UpdateCPUCapture();
+
+	m_frameTimings.m_dInputTime = ElapsedMilliseconds(frameBegin, waitBegin);
+	m_frameTimings.m_dWaitTime = ElapsedMilliseconds(waitBegin, buildBegin);
+	m_frameTimings.m_dBuildTime = ElapsedMilliseconds(buildBegin, buildEnd);
+	m_frameTimings.m_dFrameTime = ElapsedMilliseconds(frameBegin, std::chrono::steady_clock::now());
+
+	if (m_ulFrameLimit > 0 && m_ulFrameIndex >= m_ulFrameLimit)
+	{
+		glfwSetWindowShouldClose(GetGLWindow(), true);
+	}
+
+	return (true);
+}
+
+void CWindow::UpdateCamera()
+{
+	if (m_cameraPath.IsEmpty())
+	{
+		return;
+	}
+
+	Vector3D v3Position{};
+	Vector3D v3Target{};
+	if (m_cameraPath.Sample(m_fLastFrame, v3Position, v3Target))
+	{
+		m_pCamera->SetPosition(v3Position);
+		m_pCamera->LookAt(v3Target);
+	}
+}
+
+const TFrameTimings& CWindow::GetFrameTimings() const
+{
+	return (m_frameTimings);
+}
+
+TRenderStats CWindow::GetRenderStats() const
+{
+	return m_pRenderThread ? m_pRenderThread->GetRenderStats() : TRenderStats{};
+}
+
+void CWindow::BuildFramePacket(TFramePacket& framePacket)
+{
+	ANUBIS_ZONE("Window::BuildFramePacket");
+
+	framePacket.m_ulFrameIndex = m_ulFrameIndex++;
+
+	framePacket.m_iWidth = m_iWidth;
+	framePacket.m_iHeight = m_iHeight;
+
+	framePacket.m_fTime = m_fLastFrame;
+	framePacket.m_fDeltaTime = m_fDeltaTime;
 
-		// do some stuff ..
-		ProcessInput();
+	// Camera
+	framePacket.m_mat4View = m_pCamera->GetViewMatrix();
+	framePacket.m_mat4Projection = m_pCamera->GetProjectionMatrix();
+	framePacket.m_mat4ViewProjection = framePacket.m_mat4Projection * framePacket.m_mat4View;
+	framePacket.m_v3CameraPosition = m_pCamera->GetPosition();
 
-		glfwSwapBuffers(GetGLWindow());
+	framePacket.m_hDepthPyramidShader = m_hDepthPyramidShader;
+	framePacket.m_vecMaterials.push_back(m_pTerrain->GetMaterial());
+
+	// distant meshes draw a simplified level, the clusters only cover the full mesh
+	if (m_mesh.m_hMesh.IsValid())
+	{
+		m_lodSelector.SetProjection(framePacket.m_mat4Projection, m_iHeight);
+		m_iMeshLod = m_lodSelector.SelectLod(m_mesh, m_v3MeshCenter, m_fMeshRadius, framePacket.m_v3CameraPosition, m_iMeshLod);
+	}
+
+	// the clusters of the mesh are culled with the terrain patches, one by one
+	if (m_bGPUCulling && m_mesh.m_uiMeshletCount > 0 && m_iMeshLod == 0)
+	{
+		TClusterBatch& clusterBatch = framePacket.m_clusterBatch;
+		clusterBatch.m_hShader = m_hMeshShader;
+		clusterBatch.m_hCullShader = m_hClusterCullShader;
+		clusterBatch.m_hMesh = m_mesh.m_hMesh;
+		clusterBatch.m_hMeshletBuffer = m_mesh.m_hMeshletBuffer;
+		clusterBatch.m_uiMeshletCount = m_mesh.m_uiMeshletCount;
+		clusterBatch.m_mat4Model = m_mat4MeshModel;
+		clusterBatch.m_mat4MeshletToWorld = m_mat4MeshletToWorld;
 	}
+	else if (m_mesh.m_hMesh.IsValid())
+	{
+		const TMeshLod& lod = m_mesh.m_arrLods[m_iMeshLod];
+		framePacket.m_vecDrawCommands.push_back(TDrawCommand{ m_hMeshShader, m_mesh.m_hMesh, m_mat4MeshModel, lod.m_uiFirstIndex, lod.m_uiIndexCount });
+	}
+
+	// Terrain patches, culled by the render thread and drawn with one multi draw call
+	if (m_bGPUCulling && m_pCullingScene->GetObjectCount() > 0)
+	{
+		TGPUCullBatch& cullBatch = framePacket.m_gpuCullBatch;
+		cullBatch.m_hShader = m_hShader;
+		cullBatch.m_hTexture = m_hTerrainTexture;
+		cullBatch.m_hCullShader = m_hCullShader;
+		cullBatch.m_hMesh = m_pGeometryPool->GetMesh();
+		cullBatch.m_hObjectBuffer = m_pCullingScene->GetObjectBuffer();
+		cullBatch.m_hDrawDataBuffer = m_pCullingScene->GetDrawDataBuffer();
+		cullBatch.m_uiObjectCount = m_pCullingScene->GetObjectCount();
+		return;
+	}
+
+	// Visible terrain patches, drawn with one multi draw call
+	m_frustum.Extract(framePacket.m_mat4ViewProjection);
+
+	TIndirectBatch& indirectBatch = framePacket.m_indirectBatch;
+	indirectBatch.m_hShader = m_hShader;
+	indirectBatch.m_hTexture = m_hTerrainTexture;
+	indirectBatch.m_hMesh = m_pGeometryPool->GetMesh();
+	m_pTerrain->BuildDrawCommands(m_frustum, indirectBatch);
+}
+
+void CWindow::BuildOverlay(TFramePacket& framePacket)
+{
+	ANUBIS_ZONE("Window::BuildOverlay");
+
+	// the previous frame, this one is not over yet
+	m_arrFrameTimeHistory[m_uiFrameTimeHistoryIndex] = static_cast<GLfloat>(m_frameTimings.m_dFrameTime);
+	m_uiFrameTimeHistoryIndex = (m_uiFrameTimeHistoryIndex + 1) % OVERLAY_GRAPH_FRAMES;
+
+	if (m_hOverlayFont.IsValid() == false || m_vecOverlayLines.empty())
+	{
+		return;
+	}
+
+	m_batch2D.Begin(m_iWidth, m_iHeight, framePacket.m_ulFrameIndex);
+
+	// a translucent panel under the text keeps it readable over bright terrain
+	const GLfloat fLineHeight = static_cast<GLfloat>(m_pFontAtlas->GetLineHeight(m_hOverlayFont));
+	const GLfloat fPadding = static_cast<GLfloat>(OVERLAY_PADDING);
+	const GLfloat fGraphHeight = static_cast<GLfloat>(OVERLAY_GRAPH_HEIGHT);
+
+	GLfloat fWidth = static_cast<GLfloat>(OVERLAY_GRAPH_FRAMES * 2);
+	for (const std::string& stLine : m_vecOverlayLines)
+	{
+		fWidth = std::max(fWidth, m_batch2D.MeasureText(m_hOverlayFont, stLine).x);
+	}
+
+	const Vector2D v2PanelSize(fWidth + fPadding * 2.0f, fLineHeight * static_cast<GLfloat>(m_vecOverlayLines.size()) + fGraphHeight + fPadding * 3.0f);
+	const Vector4D v4Panel = m_batch2D.Anchor(EAlignment::ALIGN_TOP_LEFT, v2PanelSize, Vector2D(static_cast<GLfloat>(OVERLAY_MARGIN), static_cast<GLfloat>(OVERLAY_MARGIN)));
+	m_batch2D.AddRect(v4Panel, Vector4D(0.0f, 0.0f, 0.0f, 0.6f));
+
+	m_batch2D.SetLayer(1);
+	m_batch2D.PushClipRect(v4Panel);
+
+	const Vector4D v4Color(1.0f, 1.0f, 1.0f, 1.0f);
+	GLfloat fY = v4Panel.y + fPadding;
+	for (const std::string& stLine : m_vecOverlayLines)
+	{
+		m_batch2D.AddText(m_hOverlayFont, stLine, Vector2D(v4Panel.x + fPadding, fY), v4Color);
+		fY += fLineHeight;
+	}
+
+	// frame times oldest to newest, a guide at 60 Hz
+	const GLfloat fGraphX = v4Panel.x + fPadding;
+	const GLfloat fGraphBottom = fY + fPadding + fGraphHeight;
+	const GLfloat fStep = fWidth / static_cast<GLfloat>(OVERLAY_GRAPH_FRAMES - 1);
+	const GLfloat fScale = fGraphHeight / static_cast<GLfloat>(OVERLAY_GRAPH_MAX_MS);
+
+	const GLfloat fGuideY = fGraphBottom - 1000.0f / 60.0f * fScale;
+	m_batch2D.AddLine(Vector2D(fGraphX, fGuideY), Vector2D(fGraphX + fWidth, fGuideY), 1.0f, Vector4D(1.0f, 1.0f, 1.0f, 0.25f));
+
+	Vector2D v2Previous(0.0f, 0.0f);
+	for (GLuint i = 0; i < OVERLAY_GRAPH_FRAMES; i++)
+	{
+		const GLfloat fTime = std::min(m_arrFrameTimeHistory[(m_uiFrameTimeHistoryIndex + i) % OVERLAY_GRAPH_FRAMES], static_cast<GLfloat>(OVERLAY_GRAPH_MAX_MS));
+		const Vector2D v2Point(fGraphX + fStep * static_cast<GLfloat>(i), fGraphBottom - fTime * fScale);
+		if (i > 0)
+		{
+			m_batch2D.AddLine(v2Previous, v2Point, 1.5f, Vector4D(0.4f, 1.0f, 0.4f, 1.0f));
+		}
+		v2Previous = v2Point;
+	}
+
+	m_batch2D.PopClipRect();
+	m_batch2D.End(framePacket.m_batch2D);
+	framePacket.m_batch2D.m_hShader = m_hBatch2DShader;
+}
+
+void CWindow::UpdateProfilerDisplay()
+{
+	// F2 dumps the recorded GPU timings
+	if (IsKeyDown(GLFW_KEY_F2) && m_bProfilerExportDown == false)
+	{
+		m_pGPUProfiler->ExportCSV("gpu_profile.csv");
+		m_pGPUProfiler->ExportJSON("gpu_profile.json");
+	}
+	m_bProfilerExportDown = IsKeyDown(GLFW_KEY_F2);
+
+	// no need to rebuild the title every frame
+	if (m_fLastFrame - m_fLastTitleUpdate < 0.5f)
+	{
+		return;
+	}
+	m_fLastTitleUpdate = m_fLastFrame;
+
+	TGPUFrameResult frameResult{};
+	if (m_pGPUProfiler->GetLastFrame(frameResult) == false)
+	{
+		return;
+	}
+
+	char szTitle[256];
+	GLint iLength = snprintf(szTitle, sizeof(szTitle), "Lonely | CPU %.2f ms", m_fDeltaTime * 1000.0f);
+
+	// top level scopes only, nested ones are in the exports
+	for (const TGPUScopeResult& scopeResult : frameResult.m_vecScopes)
+	{
+		if (scopeResult.m_iDepth == 0 && iLength > 0 && iLength < static_cast<GLint>(sizeof(szTitle)))
+		{
+			iLength += snprintf(szTitle + iLength, sizeof(szTitle) - iLength, " | GPU %s %.2f ms", scopeResult.m_szName, scopeResult.m_dGPUTime);
+		}
+	}
+
+	glfwSetWindowTitle(GetGLWindow(), szTitle);
+	UpdateOverlayLines(frameResult);
+}
+
+void CWindow::UpdateOverlayLines(const TGPUFrameResult& frameResult)
+{
+	if (m_hOverlayFont.IsValid() == false)
+	{
+		return;
+	}
+
+	// averaged over the frames rendered since the last refresh
+	const TRenderStats renderStats = GetRenderStats();
+	const GLuint64 ulFrames = std::max<GLuint64>(renderStats.m_ulFrames - m_lastRenderStats.m_ulFrames, 1);
+	const GLuint64 ulDrawCalls = (renderStats.m_ulDrawCalls - m_lastRenderStats.m_ulDrawCalls) / ulFrames;
+	const GLuint64 ulTriangles = (renderStats.m_ulTriangles - m_lastRenderStats.m_ulTriangles) / ulFrames;
+	m_lastRenderStats = renderStats;
+
+	m_vecOverlayLines.clear();
+	char szLine[256];
+
+	snprintf(szLine, sizeof(szLine), "CPU %.2f ms  build %.2f ms  wait %.2f ms", m_fDeltaTime * 1000.0f, m_frameTimings.m_dBuildTime, m_frameTimings.m_dWaitTime);
+	m_vecOverlayLines.emplace_back(szLine);
+
+	for (const TGPUScopeResult& scopeResult : frameResult.m_vecScopes)
+	{
+		if (scopeResult.m_iDepth == 0)
+		{
+			snprintf(szLine, sizeof(szLine), "GPU %s %.2f ms", scopeResult.m_szName, scopeResult.m_dGPUTime);
+			m_vecOverlayLines.emplace_back(szLine);
+		}
+	}
+
+	snprintf(szLine, sizeof(szLine), "%llu draw calls  %llu triangles", static_cast<unsigned long long>(ulDrawCalls), static_cast<unsigned long long>(ulTriangles));
+	m_vecOverlayLines.emplace_back(szLine);
+
+	snprintf(szLine, sizeof(szLine), "Culling on the %s  mesh LOD %d", m_bGPUCulling ? "GPU" : "CPU", m_iMeshLod);
+	m_vecOverlayLines.emplace_back(szLine);
+
+	const TFontAtlasStats fontStats = m_pFontAtlas->GetStats();
+	snprintf(szLine, sizeof(szLine), "%u glyphs  atlas %.0f%%  %u strings", fontStats.m_uiGlyphs, fontStats.m_fOccupancy * 100.0f, fontStats.m_uiShapedTexts);
+	m_vecOverlayLines.emplace_back(szLine);
+}
+
+void CWindow::UpdateCPUCapture()
+{
+	// F3 starts a capture, pressing it again writes the trace
+	if (IsKeyDown(GLFW_KEY_F3) && m_bCPUCaptureDown == false)
+	{
+		if (CCPUProfiler::Instance().IsCapturing())
+		{
+			CCPUProfiler::Instance().StopCapture("cpu_trace.json");
+		}
+		else
+		{
+			CCPUProfiler::Instance().StartCapture();
+		}
+	}
+	m_bCPUCaptureDown = IsKeyDown(GLFW_KEY_F3);
+
+	// keeps the per thread rings from filling up
+	CCPUProfiler::Instance().Collect();
 }
 
 void CWindow::ProcessInput()
@@ -265,6 +968,13 @@ void CWindow::ProcessInput()
 		}
 	}
 
+	// F4 switches between culling on the GPU and on the main thread
+	if (IsKeyDown(GLFW_KEY_F4) && m_bGPUCullingDown == false)
+	{
+		SetGPUCulling(m_bGPUCulling == false);
+		syslog("GPU culling %s", m_bGPUCulling ? "enabled" : "disabled");
+	}
+	m_bGPUCullingDown = IsKeyDown(GLFW_KEY_F4);
 }
 
 void CWindow::SetCursor(GLint iCursorNum)
@@ -318,6 +1028,12 @@ bool CWindow::IsKeyUp(GLint iKey)
 
 void CWindow::SetWindowMode(const EWindowMode& windowMode)
 {
+	// there is no monitor to switch to
+	if (IsHeadless() || windowMode == EWindowMode::HEADLESS_MODE)
+	{
+		return;
+	}
+
 	m_ubWindowType = windowMode;
 	if (windowMode == EWindowMode::WINDOWED_MODE)
 	{
@@ -344,10 +1060,8 @@ void CWindow::framebuffer_size_callback(GLFWwindow* window, GLint width, GLint h
 		return;
 	}
 
+	// The viewport is updated by the render thread from the next frame packet
 	appWindow->ResizeWindow(width, height);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, width, height);
 }
 
 void CWindow::mouse_callback(GLFWwindow* window, GLdouble xpos, GLdouble ypos)
@@ -402,7 +1116,6 @@ void CWindow::ResizeWindow(GLint iWidth, GLint iHeight)
 {
 	m_iWidth = iWidth;
 	m_iHeight = iHeight;
-	/*
-	Resize FrameBuffers
-	*/
+
+	// render targets follow the packet size, the render thread resizes them lazily
 }
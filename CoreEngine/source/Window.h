@@ -4,14 +4,55 @@
 #include <GLFW/glfw3.h>
 #include <unordered_map>
 #include <array>
+#include <memory>
 #include "Shader.h"
+#include "Camera.h"
+#include "CameraPath.h"
+#include "Terrain.h"
+#include "GeometryPool.h"
+#include "CullingScene.h"
+#include "RenderThread.h"
+#include "GLResourceManager.h"
+#include "TextureManager.h"
+#include "BindlessTextures.h"
+#include "VirtualTexture.h"
+#include "MeshAsset.h"
+#include "LodSelector.h"
+#include "FontAtlas.h"
+#include "Batch2D.h"
+#include "GPUProfiler.h"
 
 enum EWindowMode : GLubyte
 {
 	WINDOWED_MODE,
 	FULLSCREEN_MODE,
+	HEADLESS_MODE,		// no display needed, renders into an offscreen framebuffer
 };
 
+enum EWindowData
+{
+	HEADLESS_DEFAULT_WIDTH = 1280,
+	HEADLESS_DEFAULT_HEIGHT = 720,
+
+	// Statistics drawn in the top left corner when a font is set
+	OVERLAY_FONT_SIZE = 16,
+	OVERLAY_MARGIN = 8,
+	OVERLAY_PADDING = 4,
+
+	// Frame time graph under the text, the top of the graph is OVERLAY_GRAPH_MAX_MS
+	OVERLAY_GRAPH_FRAMES = 120,
+	OVERLAY_GRAPH_HEIGHT = 48,
+	OVERLAY_GRAPH_MAX_MS = 50,
+};
+
+typedef struct SFrameTimings
+{
+	GLdouble m_dFrameTime;		// ms, whole main thread frame
+	GLdouble m_dInputTime;		// ms, polling events and handling input
+	GLdouble m_dWaitTime;		// ms, blocked until the render thread freed a packet
+	GLdouble m_dBuildTime;		// ms, building and submitting the frame packet
+} TFrameTimings;
+
 class CWindow
 {
 public:
@@ -32,8 +73,102 @@ public:
 	GLfloat GetWidthF() const;
 	GLfloat GetHeightF() const;
 
+	// Headless rendering, set before InitializeWindow
+	void SetHeadlessSize(GLint iWidth, GLint iHeight);
+	bool IsHeadless() const;
+
+	/**
+	 * Closes the window after the given amount of frames, 0 to run until closed.
+	 */
+	void SetFrameLimit(GLuint64 ulFrameLimit);
+
+	/**
+	 * Saves the given frame as a PPM image once it was rendered.
+	 */
+	void RequestCapture(GLuint64 ulFrameIndex, const std::string& stPath);
+
+	/**
+	 * Advances the simulation by a fixed step every frame instead of the
+	 * measured frame time, 0 goes back to real time.
+	 */
+	void SetFixedTimestep(GLfloat fTimestep);
+
+	/**
+	 * 0 disables vsync, -1 keeps the driver default, set before InitializeWindow.
+	 */
+	void SetSwapInterval(GLint iSwapInterval);
+
+	/**
+	 * Size and heightmap seed of the terrain, set before InitializeWindow.
+	 */
+	void SetTerrainSize(GLint iCellsX, GLint iCellsZ, GLuint uiSeed);
+
+	/**
+	 * Image applied to the terrain, loaded in the background once the window
+	 * is initialized. Empty keeps the terrain untextured.
+	 */
+	void SetTerrainTexture(const std::string& stPath);
+
+	/**
+	 * Format PNG and other images are transcoded to in the background,
+	 * TEXTURE_COMPRESSION_NONE uploads them as RGBA8.
+	 */
+	void SetTextureCompression(GLubyte ubCompression);
+
+	/**
+	 * Cooked .amesh placed at the centre of the terrain, loaded while the
+	 * window is initialized. Empty draws the terrain alone.
+	 */
+	void SetMesh(const std::string& stPath);
+
+	/**
+	 * Screen space error thresholds of the mesh levels of detail.
+	 */
+	void SetLodSettings(const TLodSettings& settings);
+
+	/**
+	 * Font of the statistics overlay, set before InitializeWindow. Empty
+	 * draws no text, the statistics stay in the title bar only.
+	 */
+	void SetOverlayFont(const std::string& stPath, bool bSDF);
+
+	/**
+	 * Moves the camera along the path using the simulation time, an empty
+	 * path gives the camera back to the application.
+	 */
+	void SetCameraPath(const CCameraPath& cameraPath);
+
+	/**
+	 * Culls the terrain in a compute pass instead of on the main thread,
+	 * enabled by default. F4 toggles it at runtime.
+	 */
+	void SetGPUCulling(bool bGPUCulling);
+
+	/**
+	 * Runs frames until the window is closed or the frame limit is reached.
+	 */
 	void Update();
 
+	/**
+	 * Runs a single frame.
+	 *
+	 * @return false once the window should close
+	 */
+	bool UpdateFrame();
+
+	// Statistics
+	const TFrameTimings& GetFrameTimings() const;
+	TRenderStats GetRenderStats() const;
+
+	// Frame submission
+	void BuildFramePacket(TFramePacket& framePacket);
+	void BuildOverlay(TFramePacket& framePacket);
+
+	// Profiling
+	void UpdateProfilerDisplay();
+	void UpdateOverlayLines(const TGPUFrameResult& frameResult);
+	void UpdateCPUCapture();
+
 	// User Input
 	void ProcessInput();
 	void SetCursor(GLint iCursorNum);
@@ -49,6 +184,13 @@ public:
 	void SetWindowMode(const EWindowMode& windowMode);
 
 protected:
+	/**
+	 * Renders offscreen when windowed mode has no display or monitor, GLFW has to be terminated.
+	 */
+	bool FallBackToHeadless(const char* szReason);
+
+	void UpdateCamera();
+
 	// Callbacks
 	// glfw: whenever the window size changed (by OS or user resize) this callback function executes
 	static void framebuffer_size_callback(GLFWwindow* window, GLint width, GLint height);
@@ -73,11 +215,16 @@ private:
 	GLint m_iWindowedWidth;
 	GLint m_iWindowedHeight;
 
+	GLint m_iHeadlessWidth;
+	GLint m_iHeadlessHeight;
+
 	GLubyte m_ubWindowType;
 	
 	// Timing
 	GLfloat m_fLastFrame;
 	GLfloat m_fDeltaTime;
+	GLfloat m_fFixedTimestep;
+	TFrameTimings m_frameTimings;
 
 	// Cursors
 	GLint m_iCurrentCursor;
@@ -91,5 +238,67 @@ private:
 	std::array<GLboolean, 3> m_bMouseKeys; // 0 -> Left, 1 -> Right, 2 -> Scroll
 
 	// test shader
-	CShader* m_pShader;
+	ShaderHandle m_hShader;
+	ShaderHandle m_hCullShader;
+	ShaderHandle m_hDepthPyramidShader;
+	ShaderHandle m_hMeshShader;
+	ShaderHandle m_hClusterCullShader;
+	ShaderHandle m_hBatch2DShader;
+
+	// Scene
+	CCamera* m_pCamera;
+	CTerrain* m_pTerrain;
+	CFrustum m_frustum;
+	CCameraPath m_cameraPath;
+
+	GLint m_iTerrainCellsX;
+	GLint m_iTerrainCellsZ;
+	GLuint m_uiTerrainSeed;
+	std::string m_stTerrainTexturePath;
+	TextureHandle m_hTerrainTexture;
+	MaterialHandle m_hTerrainMaterial;
+	GLubyte m_ubTextureCompression;
+	std::string m_stMeshPath;
+	TMeshAsset m_mesh;
+	Matrix4 m_mat4MeshModel;
+	Matrix4 m_mat4MeshletToWorld;
+	Vector3D m_v3MeshCenter;		// world space bounding sphere
+	GLfloat m_fMeshRadius;
+	CLodSelector m_lodSelector;
+	GLint m_iMeshLod;
+
+	// Rendering, owns the GL context once the window is initialized
+	std::unique_ptr<CGLResourceManager> m_pResourceManager;
+	std::unique_ptr<CTextureManager> m_pTextureManager;
+	std::unique_ptr<CBindlessTextures> m_pBindlessTextures;
+	std::unique_ptr<CVirtualTexture> m_pVirtualTexture;
+	std::unique_ptr<CFontAtlas> m_pFontAtlas;
+	std::unique_ptr<CGeometryPool> m_pGeometryPool;
+	std::unique_ptr<CCullingScene> m_pCullingScene;
+	bool m_bGPUCulling;
+	std::unique_ptr<CGPUProfiler> m_pGPUProfiler;
+	std::unique_ptr<CRenderThread> m_pRenderThread;
+	GLuint64 m_ulFrameIndex;
+	GLuint64 m_ulFrameLimit;
+	GLint m_iSwapInterval;
+
+	// Capture requested before the render thread exists
+	GLuint64 m_ulCaptureFrame;
+	std::string m_stCapturePath;
+
+	// Profiler output, timings are shown in the title bar
+	GLfloat m_fLastTitleUpdate;
+	GLboolean m_bProfilerExportDown;
+	GLboolean m_bCPUCaptureDown;
+	GLboolean m_bGPUCullingDown;
+
+	// Overlay, the same lines as long as the title does not change so their shapes are cached
+	std::string m_stOverlayFontPath;
+	bool m_bOverlayFontSDF;
+	FontHandle m_hOverlayFont;
+	std::vector<std::string> m_vecOverlayLines;
+	TRenderStats m_lastRenderStats;		// at the last refresh of the lines
+	std::array<GLfloat, OVERLAY_GRAPH_FRAMES> m_arrFrameTimeHistory;	// ms, ring
+	GLuint m_uiFrameTimeHistoryIndex;	// oldest entry
+	CBatch2D m_batch2D;
 };
\ No newline at end of file
@@ -1,15 +1,207 @@
 #include <utils.h>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <string>
 #include "window.h"
+#include "JobSystem.h"
+#include "LinearAllocator.h"
+#include "CPUProfiler.h"
+#include "Logger.h"
+#include "FrameCapture.h"
+#include "CompressedTexture.h"
+#include "MeshAsset.h"
 
 #pragma comment(lib, "glfw3.lib")
 
+typedef struct SLaunchOptions
+{
+	bool m_bHeadless;
+	GLint m_iWidth;
+	GLint m_iHeight;
+	GLuint64 m_ulFrameCount;		// 0 runs until the window is closed
+	std::string m_stCapturePath;	// last frame is saved here
+	std::string m_stReferencePath;	// capture is compared against this image
+	GLint m_iTolerance;
+	std::string m_stTexturePath;	// applied to the terrain
+	GLubyte m_ubTextureCompression;	// PNG sources are transcoded to it
+	std::string m_stMeshPath;		// cooked mesh placed on the terrain
+	std::string m_stCookSourcePath;	// cooked to m_stCookedPath, then the engine exits
+	std::string m_stCookedPath;
+	bool m_bCompressMesh;			// meshoptimizer codecs and zlib on the cooked streams
+	TLodSettings m_lodSettings;		// screen space error of the mesh levels of detail
+	std::string m_stFontPath;		// statistics overlay, none without a font
+	bool m_bFontSDF;				// overlay glyphs as distance fields
+} TLaunchOptions;
+
+/**
+ * --headless [--size WxH] [--frames N] [--capture out.ppm] [--reference ref.ppm] [--tolerance N] [--texture terrain.png]
+ * [--texture-compression none|bc1|bc3|bc4|bc5|bc7] [--mesh model.amesh] [--lod-error pixels] [--lod-hysteresis 0..1]
+ * [--font overlay.ttf] [--font-sdf]
+ * --cook-mesh source.fbx model.amesh [--compress]
+ */
+static TLaunchOptions ParseCommandLine(int argc, char* argv[])
+{
+	TLaunchOptions options{ false, HEADLESS_DEFAULT_WIDTH, HEADLESS_DEFAULT_HEIGHT, 0, "", "", 2, "", TEXTURE_COMPRESSION_BC7, "", "", "", false, CLodSelector().GetSettings(), "", false };
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool bHasValue = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			options.m_bHeadless = true;
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && bHasValue)
+		{
+			const char* szSize = argv[++i];
+			options.m_iWidth = std::atoi(szSize);
+
+			const char* szHeight = std::strchr(szSize, 'x');
+			options.m_iHeight = szHeight ? std::atoi(szHeight + 1) : options.m_iHeight;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && bHasValue)
+		{
+			options.m_ulFrameCount = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--capture") == 0 && bHasValue)
+		{
+			options.m_stCapturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--reference") == 0 && bHasValue)
+		{
+			options.m_stReferencePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--tolerance") == 0 && bHasValue)
+		{
+			options.m_iTolerance = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--texture") == 0 && bHasValue)
+		{
+			options.m_stTexturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--texture-compression") == 0 && bHasValue)
+		{
+			const char* szCompression = argv[++i];
+			bool bIsKnown = false;
+			for (GLubyte ubCompression = TEXTURE_COMPRESSION_NONE; ubCompression <= TEXTURE_COMPRESSION_BC7; ubCompression++)
+			{
+				if (std::strcmp(szCompression, CCompressedTexture::GetName(ubCompression)) == 0)
+				{
+					options.m_ubTextureCompression = ubCompression;
+					bIsKnown = true;
+				}
+			}
+
+			if (bIsKnown == false)
+			{
+				syserr("Unknown texture compression %s", szCompression);
+			}
+		}
+		else if (std::strcmp(argv[i], "--mesh") == 0 && bHasValue)
+		{
+			options.m_stMeshPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--compress") == 0)
+		{
+			options.m_bCompressMesh = true;
+		}
+		else if (std::strcmp(argv[i], "--lod-error") == 0 && bHasValue)
+		{
+			options.m_lodSettings.m_fPixelError = static_cast<GLfloat>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--lod-hysteresis") == 0 && bHasValue)
+		{
+			options.m_lodSettings.m_fHysteresis = static_cast<GLfloat>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--font") == 0 && bHasValue)
+		{
+			options.m_stFontPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--font-sdf") == 0)
+		{
+			options.m_bFontSDF = true;
+		}
+		else if (std::strcmp(argv[i], "--cook-mesh") == 0 && i + 2 < argc)
+		{
+			options.m_stCookSourcePath = argv[++i];
+			options.m_stCookedPath = argv[++i];
+		}
+		else
+		{
+			syserr("Unknown argument %s", argv[i]);
+		}
+	}
+
+	return (options);
+}
+
+/**
+ * @return EXIT_SUCCESS if the captured frame matches the reference image
+ */
+static int CompareWithReference(const TLaunchOptions& options)
+{
+	TCapturedImage capture{};
+	TCapturedImage reference{};
+	if (CFrameCapture::LoadPPM(options.m_stCapturePath, capture) == false || CFrameCapture::LoadPPM(options.m_stReferencePath, reference) == false)
+	{
+		return (EXIT_FAILURE);
+	}
+
+	TImageDifference difference{};
+	if (CFrameCapture::Compare(capture, reference, options.m_iTolerance, difference) == false)
+	{
+		return (EXIT_FAILURE);
+	}
+
+	syslog("Image comparison: %u pixels differ, max difference %d, RMSE %.3f", difference.m_uiDifferentPixels, difference.m_iMaxDifference, difference.m_dRMSE);
+	return (difference.m_uiDifferentPixels == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char* argv[])
 {
+	// Outlives everything else, messages before and after it are written directly
+	std::unique_ptr<CLogger> pLogger = std::make_unique<CLogger>();
+	pLogger->Initialize("AnubisEngine.log");
+
 	syslog("We are all alone on life's journey, held captive by the limitations of human consciousness.");
+
+	// First in, last out, every thread may record zones while it runs
+	std::unique_ptr<CCPUProfiler> pCPUProfiler = std::make_unique<CCPUProfiler>();
+	pCPUProfiler->Initialize();
+	ANUBIS_THREAD_NAME("Main");
+
+	// One scheduler shared by the whole engine, the main thread is worker 0
+	std::unique_ptr<CJobSystem> pJobSystem = std::make_unique<CJobSystem>();
+	pJobSystem->Initialize();
+
+	// Per frame memory, reset whenever a frame packet is recycled
+	std::unique_ptr<CFrameAllocator> pFrameAllocator = std::make_unique<CFrameAllocator>();
+	pFrameAllocator->Initialize();
+
+	const TLaunchOptions options = ParseCommandLine(argc, argv);
+
+	// an offline step, no window is needed
+	if (options.m_stCookSourcePath.empty() == false)
+	{
+		return CMeshAsset::Cook(options.m_stCookSourcePath, options.m_stCookedPath, options.m_bCompressMesh) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	std::unique_ptr<CWindow> pApp = std::make_unique<CWindow>();
 
-	pApp->SetWindowType(EWindowMode::WINDOWED_MODE);
+	pApp->SetWindowType(options.m_bHeadless ? EWindowMode::HEADLESS_MODE : EWindowMode::WINDOWED_MODE);
+	pApp->SetHeadlessSize(options.m_iWidth, options.m_iHeight);
+	pApp->SetFrameLimit(options.m_ulFrameCount);
+	pApp->SetTerrainTexture(options.m_stTexturePath);
+	pApp->SetTextureCompression(options.m_ubTextureCompression);
+	pApp->SetMesh(options.m_stMeshPath);
+	pApp->SetLodSettings(options.m_lodSettings);
+	pApp->SetOverlayFont(options.m_stFontPath, options.m_bFontSDF);
+
+	if (options.m_stCapturePath.empty() == false && options.m_ulFrameCount > 0)
+	{
+		pApp->RequestCapture(options.m_ulFrameCount - 1, options.m_stCapturePath);
+	}
 
 	if (pApp->InitializeWindow() == false)
 	{
@@ -18,5 +210,13 @@ int main(int argc, char* argv[])
 
 	pApp->Update();
 
+	// stops the render thread, every requested capture is written after this
+	pApp.reset();
+
+	if (options.m_stReferencePath.empty() == false)
+	{
+		return CompareWithReference(options);
+	}
+
 	return (EXIT_SUCCESS);
 }
\ No newline at end of file
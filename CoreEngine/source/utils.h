@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdio>
+#include <cstdarg>
 #include <glad/glad.h>
 
 #ifdef _MSC_VER
@@ -14,8 +15,21 @@
 #define FUNCTION_NAME "UnknownFunction"
 #endif
 
-#define syserr(...) fprintf(stderr, "%s: ", FUNCTION_NAME); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n");
-#define syslog(...) fprintf(stdout, "%s: ", FUNCTION_NAME); fprintf(stdout, __VA_ARGS__); fprintf(stdout, "\n");
+enum ELogLevel : unsigned char
+{
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+};
+
+// printf style, queued to the asynchronous logger (Logger.cpp)
+void LogWrite(ELogLevel eLevel, const char* szFunction, const char* szFormat, ...);
+
+#define sysdbg(...) LogWrite(LOG_LEVEL_DEBUG, FUNCTION_NAME, __VA_ARGS__)
+#define syslog(...) LogWrite(LOG_LEVEL_INFO, FUNCTION_NAME, __VA_ARGS__)
+#define syswarn(...) LogWrite(LOG_LEVEL_WARNING, FUNCTION_NAME, __VA_ARGS__)
+#define syserr(...) LogWrite(LOG_LEVEL_ERROR, FUNCTION_NAME, __VA_ARGS__)
 
 #if !defined(EXIT_SUCCESS)
 #define EXIT_SUCCESS 0
@@ -33,7 +47,7 @@ inline bool IsGLVersionHigher(int MajorVer, int MinorVer)
     glGetIntegerv(GL_MAJOR_VERSION, &glMajorVersion);
     glGetIntegerv(GL_MINOR_VERSION, &glMinorVersion);
 
-    sys_log("IsGLVersionHigher: v%d.%d", glMajorVersion, glMinorVersion);
+    syslog("IsGLVersionHigher: v%d.%d", glMajorVersion, glMinorVersion);
 
     return ((glMajorVersion >= MajorVer) && (glMinorVersion >= MinorVer));
 }
@@ -8,12 +8,7 @@ enum class EAPIType
 	API_NONE
 };
 
-enum class EWindowMode
-{
-	MODE_WINDOWED,
-	MODE_FULLSCREEN,
-	MODE_BORDERLESS
-};
+// EWindowMode lives in CoreEngine/source/Window.h
 
 enum class EAlignment
 {
@@ -1,2 +1,3 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include "stdafx.h"
\ No newline at end of file
+#include "stdafx.h"
+#include "stb_image.h"